@@ -0,0 +1,264 @@
+// CacheBench: cache cost per IO cycle of the engine's three resampled paths.
+//
+// Each cycle runs what the helper runs per 256-frame buffer — FLX4 input,
+// FLX4 output and cue, one polyphase converter each, the output at the
+// inverse ratio — at every polyphase quality, with the filter tables laid
+// out two ways:
+//
+//   private   each converter with its own copy of the table (the layout
+//             before tables were shared)
+//   shared    all three on PolyphaseFilter::shared(), as the engine runs
+//
+// Between cycles an optional sweep over `pressure` KB of unrelated memory
+// stands in for everything else coreaudiod and the host do between
+// callbacks; at 0 the converters run back to back, cache-warm.
+//
+// Reports per cycle: the distinct bytes the converters own (tables plus
+// windows), the median time of the three converter calls, and — where the
+// OS exposes hardware counters (Linux perf events) — L1D and last-level
+// cache read misses. Generic perf events have no L2 counter; on the usual
+// inclusive hierarchies the last level stands in for it. Without counter
+// access the miss columns read "-" and timing alone has to tell.
+//
+// Near 1 the fractional phase only creeps — at 100 ppm it crosses ~13 of
+// 512 rows per block — so a call reads a few rows of its table, not all of
+// it. Sharing mostly shrinks what has to stay resident between callbacks,
+// and shows most where the private copies outgrow the cache: at high.
+//
+// The three paths run on one thread here; in the helper the cue tap has its
+// own IOProc, so its misses land on whichever core that runs on.
+//
+// Usage: flux_bench_cache [cycles] [drift-ppm]
+
+#include "Constants.h"
+#include "PolyphaseResampler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define FLUX_BENCH_PERF 1
+#endif
+
+using namespace flux;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t kBlock = 256;
+
+// ---- Counters ----
+
+class CacheCounters {
+public:
+    CacheCounters()
+    {
+#ifdef FLUX_BENCH_PERF
+        l1_ = open(PERF_COUNT_HW_CACHE_L1D, -1);
+        if (l1_ >= 0) ll_ = open(PERF_COUNT_HW_CACHE_LL, l1_);
+#endif
+    }
+
+    ~CacheCounters()
+    {
+#ifdef FLUX_BENCH_PERF
+        if (ll_ >= 0) close(ll_);
+        if (l1_ >= 0) close(l1_);
+#endif
+    }
+
+    CacheCounters(const CacheCounters&) = delete;
+    CacheCounters& operator=(const CacheCounters&) = delete;
+
+    bool available() const { return l1_ >= 0 && ll_ >= 0; }
+
+    void start()
+    {
+#ifdef FLUX_BENCH_PERF
+        if (!available()) return;
+        ioctl(l1_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(l1_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    // Adds the misses since start().
+    void stop(uint64_t* l1, uint64_t* ll)
+    {
+#ifdef FLUX_BENCH_PERF
+        if (!available()) return;
+        ioctl(l1_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        uint64_t value = 0;
+        if (read(l1_, &value, sizeof(value)) == sizeof(value)) *l1 += value;
+        if (read(ll_, &value, sizeof(value)) == sizeof(value)) *ll += value;
+#endif
+    }
+
+private:
+#ifdef FLUX_BENCH_PERF
+    static int open(uint64_t cache, int group)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = cache
+                    | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = group < 0 ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+    }
+#endif
+
+    int l1_ = -1;
+    int ll_ = -1;
+};
+
+// ---- Scenario ----
+
+struct Path {
+    std::unique_ptr<PolyphaseResampler> resampler;
+    std::vector<float> in;
+    std::vector<float> out;
+    uint64_t offset = 0;        // Input frames consumed
+    double ppm = 0.0;           // Where its servo holds it
+};
+
+struct Result {
+    double bytes = 0.0;
+    double ns = 0.0;
+    double l1 = 0.0;
+    double ll = 0.0;
+};
+
+void sine(std::vector<float>& buf, uint64_t frames, double hz)
+{
+    buf.resize(frames * kChannelsPerDevice);
+    for (uint64_t i = 0; i < frames; ++i) {
+        auto v = static_cast<float>(0.5 * std::sin(2.0 * M_PI * hz * static_cast<double>(i)
+                                                   / kNominalSampleRate));
+        buf[i * 2] = v;
+        buf[i * 2 + 1] = v;
+    }
+}
+
+// One block through a path. The input wraps, so any cycle count works.
+void runPath(Path& p, double ratio)
+{
+    uint64_t inFrames = p.in.size() / 2;
+    if (p.offset + kBlock * 2 > inFrames) p.offset = 0;
+    uint32_t used = 0;
+    p.resampler->process(p.in.data() + p.offset * 2, kBlock * 2, p.out.data(), kBlock,
+                         ratio, &used);
+    p.offset += used;
+}
+
+Result run(ResamplerQuality quality, bool shared, uint32_t pressureKB,
+           uint32_t cycles, double driftPpm, CacheCounters& counters)
+{
+    // Private tables live as long as the run; shared ones for good.
+    std::vector<std::unique_ptr<PolyphaseFilter>> owned;
+    Path paths[3];
+    const double offsets[3] = {0.0, 0.0, 7.0};     // Cue servo off the input's
+    const double hz[3] = {997.0, 440.0, 1234.0};
+    Result result;
+    for (int i = 0; i < 3; ++i) {
+        const PolyphaseFilter* filter = &PolyphaseFilter::shared(quality);
+        if (!shared) {
+            owned.push_back(std::make_unique<PolyphaseFilter>(quality));
+            filter = owned.back().get();
+        }
+        if (!shared || i == 0) result.bytes += static_cast<double>(filter->bytes());
+        paths[i].resampler = std::make_unique<PolyphaseResampler>(*filter);
+        result.bytes += static_cast<double>(paths[i].resampler->stateBytes());
+        sine(paths[i].in, kNominalSampleRate, hz[i]);
+        paths[i].out.resize(kBlock * 2);
+        paths[i].ppm = offsets[i];
+    }
+
+    std::vector<uint8_t> pressure(static_cast<size_t>(pressureKB) * 1024, 1);
+    volatile uint64_t sink = 0;
+
+    std::vector<double> ns;
+    ns.reserve(cycles);
+    uint64_t l1 = 0, ll = 0;
+    for (uint32_t n = 0; n < cycles + 100; ++n) {
+        // Everything else between callbacks.
+        uint64_t sum = 0;
+        for (size_t i = 0; i < pressure.size(); i += 64) sum += pressure[i];
+        sink = sink + sum;
+
+        // The drift wanders slowly, as the clocks' does.
+        double drift = driftPpm + 20.0 * std::sin(static_cast<double>(n) * 0.01);
+        double ratio = 1.0 + drift * 1e-6;
+
+        bool measured = n >= 100;        // Skip the warm-up
+        if (measured) counters.start();
+        auto t0 = Clock::now();
+        runPath(paths[0], ratio * (1.0 + paths[0].ppm * 1e-6));
+        runPath(paths[1], 1.0 / ratio);
+        runPath(paths[2], ratio * (1.0 + paths[2].ppm * 1e-6));
+        auto t1 = Clock::now();
+        if (measured) {
+            counters.stop(&l1, &ll);
+            ns.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+        }
+    }
+
+    std::sort(ns.begin(), ns.end());
+    result.ns = ns[ns.size() / 2];
+    result.l1 = static_cast<double>(l1) / cycles;
+    result.ll = static_cast<double>(ll) / cycles;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    uint32_t cycles = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 5000;
+    double driftPpm = argc > 2 ? std::atof(argv[2]) : 100.0;
+    if (cycles == 0) cycles = 1;
+
+    CacheCounters counters;
+    std::printf("3 polyphase paths x %u-frame blocks, %u cycles, drift %+.0f ppm, %s kernel\n",
+                kBlock, cycles, driftPpm, polyphaseKernelName(bestPolyphaseKernel()));
+    if (!counters.available()) {
+        std::printf("no hardware cache counters here: miss columns omitted\n");
+    }
+    std::printf("\n%-18s %-8s %9s %10s %10s %12s %12s\n",
+                "tier", "layout", "pressure", "owned KB", "ns/cycle", "L1D miss/cy", "LLC miss/cy");
+
+    for (uint32_t q = 0; q < kResamplerQualityCount; ++q) {
+        auto quality = static_cast<ResamplerQuality>(q);
+        for (uint32_t pressureKB : {0u, 256u, 2048u}) {
+            for (bool shared : {false, true}) {
+                Result r = run(quality, shared, pressureKB, cycles, driftPpm, counters);
+                std::printf("%-18s %-8s %6u KB %10.1f %10.0f",
+                            resamplerTierName({kResamplerPolyphase, quality}),
+                            shared ? "shared" : "private", pressureKB,
+                            r.bytes / 1024.0, r.ns);
+                if (counters.available()) {
+                    std::printf(" %12.1f %12.1f", r.l1, r.ll);
+                } else {
+                    std::printf(" %12s %12s", "-", "-");
+                }
+                std::printf("\n");
+            }
+        }
+    }
+    return 0;
+}
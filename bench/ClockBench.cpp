@@ -0,0 +1,178 @@
+// ClockBench: lock time and ratio jitter of the clock estimators.
+//
+// Two synthetic devices, as on the rig: Push and FLX4 crystals a few tens
+// of ppm off nominal, 256-frame callbacks, and host timestamps with the
+// scenario's jitter — Gaussian, plus (for some) rare late timestamps like a
+// missed USB microframe or a late wakeup. Each estimator kind runs on both
+// devices from the same timestamps, and the resampling ratio
+// (push rate / flx4 rate) it produces is compared with the true one:
+//   stable   when isStable() first said yes
+//   @stable  |ratio error| at that moment (ppm) — what resampling starts on
+//   lock     time after which |ratio error| stays under kLockPpm
+//   jitter   ratio error std over the second half of the run (ppm)
+//   max      largest |ratio error| over the second half (ppm)
+//
+// Warm-start scenarios seed both estimators (ClockEstimator::seed) with
+// rates a little off the true ones, as a clock cache from an earlier
+// session would — and one far off, as a stale cache would.
+//
+// Timestamps are nanosecond ticks through NanosecondTimeSource, so this
+// runs anywhere.
+//
+// Usage: flux_bench_clock [seconds]
+
+#include "ClockEstimators.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace flux;
+
+namespace {
+
+constexpr uint32_t kBlock   = 256;
+constexpr double   kNominal = 48000.0;
+constexpr double   kLockPpm = 2.0;
+
+struct Scenario {
+    const char* name;
+    double jitterUs;        // Timestamp jitter (1 sigma)
+    double outlierRate;     // Fraction of callbacks stamped late
+    double outlierUs;       // How late (uniform up to this)
+    double driftPpmPerS;    // FLX4 crystal wander (ramp)
+    double seedErrorPpm;    // Warm start: seed this far off (0 = cold start)
+};
+
+// One device's timestamps.
+struct Device {
+    double ppm;
+    double time = 0.0;          // True seconds so far
+
+    uint64_t stamp(const Scenario& sc, std::mt19937& rng) const
+    {
+        std::normal_distribution<double> jitter(0.0, sc.jitterUs * 1e-6);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        double t = time + jitter(rng);
+        if (unit(rng) < sc.outlierRate) t += unit(rng) * sc.outlierUs * 1e-6;
+        // Offset so early jitter can't go negative.
+        return static_cast<uint64_t>(std::llround((t + 1.0) * 1e9));
+    }
+
+    double rateAt(double elapsed, double drift) const
+    {
+        return kNominal * (1.0 + (ppm + drift * elapsed) * 1e-6);
+    }
+};
+
+struct Result {
+    double stableAt = -1.0;
+    double errorAtStable = 0.0;
+    double lockAt = -1.0;
+    double jitter = 0.0;
+    double maxError = 0.0;
+};
+
+Result run(ClockEstimatorKind kind, const Scenario& sc, double seconds)
+{
+    NanosecondTimeSource time;
+    auto push = makeClockEstimator(kind, kNominal, time);
+    auto flx4 = makeClockEstimator(kind, kNominal, time);
+
+    std::mt19937 rng(42);
+    Device pushDev{20.0};
+    Device flx4Dev{-30.0};
+    if (sc.seedErrorPpm != 0.0) {
+        push->seed(pushDev.rateAt(0.0, 0.0) * (1.0 + sc.seedErrorPpm * 1e-6));
+        flx4->seed(flx4Dev.rateAt(0.0, 0.0) * (1.0 - sc.seedErrorPpm * 1e-6));
+    }
+
+    Result r;
+    double lastUnlocked = 0.0;
+    double sum = 0.0, sumSq = 0.0;
+    uint64_t n = 0;
+
+    while (pushDev.time < seconds) {
+        push->update(pushDev.stamp(sc, rng), kBlock);
+        flx4->update(flx4Dev.stamp(sc, rng), kBlock);
+
+        double pushRate = pushDev.rateAt(pushDev.time, 0.0);
+        double flx4Rate = flx4Dev.rateAt(flx4Dev.time, sc.driftPpmPerS);
+        pushDev.time += kBlock / pushRate;
+        flx4Dev.time += kBlock / flx4Rate;
+
+        double trueRatio = pushRate / flx4Rate;
+        double error = (push->rate() / flx4->rate() / trueRatio - 1.0) * 1e6;
+        double t = pushDev.time;
+
+        bool stable = push->isStable() && flx4->isStable();
+        if (stable && r.stableAt < 0) {
+            r.stableAt = t;
+            r.errorAtStable = std::fabs(error);
+        }
+        if (std::fabs(error) > kLockPpm) lastUnlocked = t;
+
+        if (t >= seconds / 2) {
+            sum += error;
+            sumSq += error * error;
+            r.maxError = std::max(r.maxError, std::fabs(error));
+            ++n;
+        }
+    }
+
+    if (lastUnlocked < seconds / 2) r.lockAt = lastUnlocked;
+    if (n > 0) {
+        double mean = sum / static_cast<double>(n);
+        r.jitter = std::sqrt(std::max(0.0, sumSq / static_cast<double>(n) - mean * mean));
+    }
+    return r;
+}
+
+void print(const char* scenario, ClockEstimatorKind kind, const Result& r)
+{
+    char stable[16] = "never", lock[16] = "never";
+    if (r.stableAt >= 0) std::snprintf(stable, sizeof(stable), "%.2f s", r.stableAt);
+    if (r.lockAt >= 0) std::snprintf(lock, sizeof(lock), "%.2f s", r.lockAt);
+    std::printf("%-24s %-9s %9s %9.1f %9s %9.3f %9.3f\n", scenario,
+                clockEstimatorName(kind), stable, r.errorAtStable, lock,
+                r.jitter, r.maxError);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    double seconds = argc > 1 ? std::atof(argv[1]) : 60.0;
+    if (seconds <= 0) {
+        std::fprintf(stderr, "usage: %s [seconds]\n", argv[0]);
+        return 1;
+    }
+
+    const Scenario scenarios[] = {
+        {"jitter 10 us",             10.0, 0.0,    0.0, 0.0, 0.0},
+        {"jitter 100 us",           100.0, 0.0,    0.0, 0.0, 0.0},
+        {"jitter 100 us + 1% late", 100.0, 0.01, 3000.0, 0.0, 0.0},
+        {"jitter 300 us",           300.0, 0.0,    0.0, 0.0, 0.0},
+        {"jitter 50 us, 0.2 ppm/s",  50.0, 0.0,    0.0, 0.2, 0.0},
+        {"warm, seed 0.3 ppm off",  100.0, 0.01, 3000.0, 0.0, 0.3},
+        {"warm, seed 1 ppm off",    100.0, 0.01, 3000.0, 0.0, 1.0},
+        {"warm, seed 5 ppm off",    100.0, 0.01, 3000.0, 0.0, 5.0},
+        {"warm, seed 100 ppm off",  100.0, 0.01, 3000.0, 0.0, 100.0},
+    };
+
+    std::printf("%.0f s per run, %u-frame callbacks, Push +20 ppm, FLX4 -30 ppm, "
+                "lock = within %.0f ppm\n\n", seconds, kBlock, kLockPpm);
+    std::printf("%-24s %-9s %9s %9s %9s %9s %9s\n", "scenario", "estimator",
+                "stable", "@stable", "lock", "jitter", "max");
+
+    for (const auto& sc : scenarios) {
+        for (uint32_t k = 0; k < kClockEstimatorKindCount; ++k) {
+            auto kind = static_cast<ClockEstimatorKind>(k);
+            print(k == 0 ? sc.name : "", kind, run(kind, sc, seconds));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,245 @@
+// CopyBench: bytes written per FLX4 callback on the helper's realtime
+// paths, before and after moving AudioEngine onto the zero-copy span API.
+//
+// Models one FLX4 IOProc cycle (input resample → flx4Input, flx4Output →
+// resample → hardware) plus one cue tap cycle (resample + gain →
+// flx4CueInput). "before" is the old shape: resample into a local buffer,
+// then write() it; read() into a stack buffer, then resample. "after"
+// resamples directly into / out of the ring spans.
+//
+// Both variants count every byte they write, by what writes it:
+//
+//   conv   converter output — into a local buffer, a ring span or the
+//          hardware buffer; the work itself, the same either way
+//   gain   the cue's in-place gain pass
+//   copy   memcpy between a ring and a local buffer (write() / read())
+//
+// so the copies the span API removes show as the difference in the copy
+// columns, next to the work that stays.
+//
+// libsamplerate isn't needed here: a streaming linear interpolator with the
+// same in/out contract stands in for src_process, so both variants do the
+// same conversion work and differ only in the copies around it. The plugin
+// side of each ring is simulated with plain read()/write() and not counted.
+//
+// Usage: flux_bench_copy [callbacks-per-size]
+
+#include "OwnedRing.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace flux;
+
+namespace {
+
+constexpr double kRatio = 1.0001;   // ~100 ppm drift
+constexpr float kGain = 2.0f;
+
+// Streaming linear interpolator, stereo. Stand-in for src_process.
+struct LinearResampler {
+    float  last[kChannelsPerDevice] = {};
+    double pos = 0.0;   // next output position, in input frames after `last`
+
+    long process(const float* in, long inFrames,
+                 float* out, long outFrames,
+                 double ratio, long* used)
+    {
+        double step = 1.0 / ratio;
+        long gen = 0;
+        while (gen < outFrames) {
+            long i = static_cast<long>(pos);
+            if (i >= inFrames) break;
+            auto frac = static_cast<float>(pos - static_cast<double>(i));
+            const float* a = (i == 0) ? last : in + (i - 1) * kChannelsPerDevice;
+            const float* b = in + i * kChannelsPerDevice;
+            for (uint32_t c = 0; c < kChannelsPerDevice; ++c) {
+                out[gen * kChannelsPerDevice + c] = a[c] + (b[c] - a[c]) * frac;
+            }
+            ++gen;
+            pos += step;
+        }
+        long consumed = static_cast<long>(pos);
+        if (consumed > inFrames) consumed = inFrames;
+        if (consumed > 0) {
+            for (uint32_t c = 0; c < kChannelsPerDevice; ++c) {
+                last[c] = in[(consumed - 1) * kChannelsPerDevice + c];
+            }
+            pos -= static_cast<double>(consumed);
+        }
+        *used = consumed;
+        return gen;
+    }
+};
+
+struct Stats {
+    int64_t converted = 0;
+    int64_t scaled = 0;
+    int64_t copied = 0;
+    double  seconds = 0.0;
+};
+
+struct Rig {
+    OwnedRing flx4Input{kSlaveRingFrames};
+    OwnedRing flx4Cue{kSlaveRingFrames};
+    OwnedRing flx4Output{kSlaveRingFrames};
+    LinearResampler in, out, cue;
+};
+
+int64_t frameBytes(long frames) { return frames * kBytesPerFrame; }
+
+// ---- Old shape: intermediate buffers + write()/read() ----
+
+void cycleBefore(Rig& rig, const float* hwIn, float* hwOut, long frames,
+                 float* resampleBuf, float* cueBuf, float* tempIn, Stats& stats)
+{
+    long used = 0;
+    long maxOutput = static_cast<long>(static_cast<double>(frames) * kRatio + 4);
+
+    long gen = rig.in.process(hwIn, frames, resampleBuf, maxOutput, kRatio, &used);
+    stats.converted += frameBytes(gen);
+    if (rig.flx4Input->write(resampleBuf, static_cast<uint32_t>(gen))) {
+        stats.copied += frameBytes(gen);
+    }
+
+    gen = rig.cue.process(hwIn, frames, cueBuf, maxOutput, kRatio, &used);
+    stats.converted += frameBytes(gen);
+    for (long i = 0; i < gen * static_cast<long>(kChannelsPerDevice); ++i) cueBuf[i] *= kGain;
+    stats.scaled += frameBytes(gen);
+    if (rig.flx4Cue->write(cueBuf, static_cast<uint32_t>(gen))) {
+        stats.copied += frameBytes(gen);
+    }
+
+    long inputNeeded = static_cast<long>(static_cast<double>(frames) * kRatio + 4);
+    if (rig.flx4Output->read(tempIn, static_cast<uint32_t>(inputNeeded))) {
+        stats.copied += frameBytes(inputNeeded);
+        gen = rig.out.process(tempIn, inputNeeded, hwOut, frames, 1.0 / kRatio, &used);
+        stats.converted += frameBytes(gen);
+    }
+}
+
+// ---- New shape: resample straight into / out of ring spans ----
+
+long intoSpans(LinearResampler& r, const float* in, long inFrames,
+               const RingSpans<float>& spans)
+{
+    long used = 0;
+    long n1 = spans.frames1;
+    long gen = r.process(in, inFrames, spans.data1, n1, kRatio, &used);
+    if (gen == n1 && spans.frames2 > 0) {
+        gen += r.process(in + used * kChannelsPerDevice, inFrames - used,
+                         spans.data2, spans.frames2, kRatio, &used);
+    }
+    return gen;
+}
+
+void cycleAfter(Rig& rig, const float* hwIn, float* hwOut, long frames, Stats& stats)
+{
+    auto maxOutput = static_cast<uint32_t>(static_cast<double>(frames) * kRatio + 4);
+
+    auto spans = rig.flx4Input->prepareWrite(maxOutput);
+    if (spans.total() >= maxOutput) {
+        auto gen = static_cast<uint32_t>(intoSpans(rig.in, hwIn, frames, spans));
+        stats.converted += frameBytes(gen);
+        rig.flx4Input->commitWrite(gen);
+    }
+
+    spans = rig.flx4Cue->prepareWrite(maxOutput);
+    if (spans.total() >= maxOutput) {
+        auto gen = static_cast<uint32_t>(intoSpans(rig.cue, hwIn, frames, spans));
+        stats.converted += frameBytes(gen);
+        uint32_t first = gen < spans.frames1 ? gen : spans.frames1;
+        for (uint32_t i = 0; i < first * kChannelsPerDevice; ++i) spans.data1[i] *= kGain;
+        for (uint32_t i = 0; i < (gen - first) * kChannelsPerDevice; ++i) spans.data2[i] *= kGain;
+        stats.scaled += frameBytes(gen);
+        rig.flx4Cue->commitWrite(gen);
+    }
+
+    auto inputNeeded = static_cast<long>(static_cast<double>(frames) * kRatio + 4);
+    auto in = rig.flx4Output->readSpans();
+    if (in.total() >= inputNeeded) {
+        long used = 0, total = 0;
+        long n1 = in.frames1 < inputNeeded ? in.frames1 : inputNeeded;
+        long gen = rig.out.process(in.data1, n1, hwOut, frames, 1.0 / kRatio, &used);
+        total += used;
+        if (gen < frames && in.frames2 > 0 && total < inputNeeded) {
+            gen += rig.out.process(in.data2, inputNeeded - total,
+                                   hwOut + gen * kChannelsPerDevice,
+                                   frames - gen, 1.0 / kRatio, &used);
+            total += used;
+        }
+        stats.converted += frameBytes(gen);
+        rig.flx4Output->consume(static_cast<uint32_t>(total));
+    }
+}
+
+// Plugin side: drain the input rings, refill the output ring.
+void pluginCycle(Rig& rig, float* scratch, long frames)
+{
+    auto n = static_cast<uint32_t>(frames);
+    rig.flx4Input->read(scratch, n);
+    rig.flx4Cue->read(scratch, n);
+    while (rig.flx4Output->availableRead() < n * 3) {
+        rig.flx4Output->write(scratch, n);
+    }
+}
+
+template <typename Cycle>
+Stats run(long frames, int callbacks, Cycle cycle)
+{
+    Rig rig;
+    std::vector<float> hwIn(static_cast<size_t>(frames) * kChannelsPerDevice, 0.25f);
+    std::vector<float> hwOut(hwIn.size());
+    std::vector<float> scratch(8192 * kChannelsPerDevice, 0.5f);
+
+    Stats stats;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < callbacks; ++i) {
+        pluginCycle(rig, scratch.data(), frames);
+        cycle(rig, hwIn.data(), hwOut.data(), frames, stats);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    stats.seconds = std::chrono::duration<double>(t1 - t0).count();
+    return stats;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int callbacks = argc > 1 ? std::atoi(argv[1]) : 200000;
+
+    // Same sizes as AudioEngine's old kResampleBufFrames buffers.
+    constexpr size_t kBufSamples = 4096 * kChannelsPerDevice;
+    std::vector<float> resampleBuf(kBufSamples), cueBuf(kBufSamples), tempIn(kBufSamples);
+
+    std::printf("%d callbacks per size (helper side only, plugin side excluded)\n", callbacks);
+    std::printf("bytes written per callback: conv = converter output, gain = cue gain pass,\n"
+                "copy = memcpy to or from a ring\n\n");
+    std::printf("%8s | %-26s | %-26s | %s\n", "", "before B/cb", "after B/cb", "ns/cb");
+    std::printf("%8s | %8s %8s %8s | %8s %8s %8s | %10s %10s\n", "frames",
+                "conv", "gain", "copy", "conv", "gain", "copy", "before", "after");
+
+    for (long frames : {64L, 128L, 256L, 512L, 1024L}) {
+        Stats before = run(frames, callbacks,
+            [&](Rig& rig, const float* in, float* out, long n, Stats& stats) {
+                cycleBefore(rig, in, out, n, resampleBuf.data(), cueBuf.data(),
+                            tempIn.data(), stats);
+            });
+        Stats after = run(frames, callbacks, cycleAfter);
+
+        auto perCallback = [&](int64_t bytes) {
+            return static_cast<double>(bytes) / callbacks;
+        };
+        std::printf("%8ld | %8.0f %8.0f %8.0f | %8.0f %8.0f %8.0f | %10.0f %10.0f\n", frames,
+                    perCallback(before.converted), perCallback(before.scaled),
+                    perCallback(before.copied),
+                    perCallback(after.converted), perCallback(after.scaled),
+                    perCallback(after.copied),
+                    before.seconds * 1e9 / callbacks,
+                    after.seconds * 1e9 / callbacks);
+    }
+    return 0;
+}
@@ -0,0 +1,1003 @@
+// EngineSim: deterministic headless simulation of the whole helper data path.
+//
+// Drives the real EngineCore — clock estimators, drift publish, timeline
+// stamping, latency servos, resamplers, concealment — from simulated
+// devices instead of CoreAudio, against a real SharedMemoryLayout in
+// process memory:
+//
+//   Push    master clock: masterIO() every Push buffer
+//   FLX4    slave clock:  slaveIO() every FLX4 buffer
+//   cue     process tap on the FLX4 clock: cueIO() every FLX4 buffer
+//   plugin  the HAL's IO cycle on the Push clock, doing what PluginHandler
+//           does: peekAt() every input stream at timestamp -
+//           kInputAlignmentLatency through a concealer and release() it,
+//           stamp and produce() every output stream
+//
+// --slaves n aggregates n slaves instead of the FLX4 alone: the FLX4 and
+// n - 1 more like it ("dev2", "dev3", ...), each on its own crystal —
+// --flx4-ppm plus 35 ppm per device — with its own cue tap. The engine
+// keeps every slave's clock, servos and converters apart, so each stream
+// should report as it does with one slave.
+//
+// Each device runs on its own crystal (ppm off nominal) from a random
+// phase. Callbacks wake late by a random scheduling delay, every host
+// timestamp they see carries Gaussian jitter, and helper callbacks can be
+// dropped outright (an overloaded IOProc) — the device's sample time moves
+// on without them. Host time is in nanoseconds from a simulated clock, and
+// all randomness comes from one seeded generator, so a run is exactly
+// reproducible from its command line.
+//
+// Reports, per run:
+//   lock      when every slave's drift record had gone ready
+//   resyncs   Push timeline breaks (clock seed bumps)
+// per slave:
+//   ratio     drift ratio error vs the true clocks at the end (ppm), and the
+//             input/output servo corrections
+//   latency   the output latency the engine publishes for the plugin
+// and per stream, after --settle seconds:
+//   writes / overruns / dropped    producer side (Metrics.h)
+//   reads / underruns / partials   consumer side
+//   fill min / avg / max           sampled every plugin cycle
+//   click                          largest second difference of the audio
+//                                  the plugin serves (inputs) or a slave
+//                                  plays (outputs) — every device sends a
+//                                  sine, so anything well above its
+//                                  curvature is a discontinuity
+//
+// --switch t:[stream=]tier crossfades converters at t seconds, as a SIGHUP
+// to the helper would (EngineCore::setResampler), to check that a switch
+// leaves no click and no xrun.
+//
+// --flx4-rate hz runs the slaves at another nominal rate than Push's 48 kHz
+// (44100, say), so every slave stream goes through a fixed-ratio stage as
+// well as its converter (EngineCore.h).
+//
+// --push-rate hz and --session-rate hz set Push's nominal rate and the
+// virtual device's, which shared memory and the plugin run at: with the
+// two apart, Push's streams go through fixed-ratio stages too, and the
+// master clock is published in session samples. --rate-change t:hz moves
+// the session to another rate at t seconds, as the helper does when a
+// client changes the virtual device's rate: IO stops, the engine rebuilds
+// its stages and restarts its converters, and the plugin's timeline starts
+// over at the new rate. Expect a few xruns around each change; settle after
+// the last.
+//
+// --clients n has n plugin clients (1..8) read every input in each cycle,
+// each through its own concealer, as PluginHandler serves them: the rings
+// are only released once all have read, so every client should hear the
+// same audio and the report should match a single client's. The click
+// column is the worst client's.
+//
+// --channels n gives every device n input and n output channels (1..8),
+// carried whole by its capture and playback streams; cue taps stay stereo
+// and take the first two. Converters pad odd widths out to their kernels'.
+//
+// --planar hands the engine every device's audio as CoreAudio does for a
+// non-interleaved device — one mono buffer per channel — so each IOProc
+// gathers and scatters its channels at the device boundary. The rings and
+// converters see the same interleaved frames either way, so the report
+// matches an interleaved run.
+//
+// --workers n gives the slave IOProcs real worker threads to convert their
+// input on (WorkerPool.h). Where a job runs doesn't change what it
+// computes, so the report matches an inline run except for the jobs line:
+// how many a worker ran and how many were taken back inline.
+//
+// Without libsamplerate (any non-macOS build) the engine runs the in-tree
+// polyphase resampler; the clock and servo dynamics are the same.
+//
+// Exit status is 1 if the clocks never lock, or if a run without injected
+// dropouts xruns after settling.
+//
+// Usage: flux_sim_engine [--seconds s] [--settle s] [--seed n]
+//                        [--push-ppm p] [--flx4-ppm p] [--flx4-rate hz]
+//                        [--push-rate hz] [--session-rate hz] [--rate-change t:hz]...
+//                        [--push-buffer f] [--flx4-buffer f] [--plugin-buffer f]
+//                        [--stamp-jitter-us us] [--sched-jitter-us us]
+//                        [--dropout-rate r] [--no-cue] [--slaves n]
+//                        [--estimator dll|adaptive|kalman|lsq]
+//                        [--resampler [stream=]tier]... [--switch t:[stream=]tier]...
+//                        [--channels n] [--planar] [--workers n] [--clients n]
+//                        [--trace file.csv]
+
+#include "Conceal.h"
+#include "EngineCore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace flux;
+
+namespace {
+
+struct Options {
+    double   seconds = 120.0;
+    double   settle = 40.0;
+    uint32_t seed = 1;
+    double   pushPpm = 20.0;
+    double   flx4Ppm = -30.0;
+    double   flx4Rate = kNominalSampleRate;     // Nominal
+    double   pushRate = kNominalSampleRate;     // Nominal
+    double   sessionRate = kNominalSampleRate;
+    uint32_t pushBuffer = 256;
+    uint32_t flx4Buffer = 256;
+    uint32_t pluginBuffer = 256;
+    double   stampJitterUs = 20.0;
+    double   schedJitterUs = 200.0;
+    double   dropoutRate = 0.0;
+    bool     cue = true;
+    uint32_t channels = kChannelsPerDevice;
+    bool     planar = false;
+    uint32_t slaves = 1;
+    uint32_t clients = 1;
+    ClockEstimatorKind estimator = kClockEstimatorKalman;
+    EngineConfig       engine;
+    const char* trace = nullptr;
+
+    // --resampler args, applied once the device list is known.
+    std::vector<std::string> resamplers;
+
+    // Runtime converter switches: at `at` seconds, apply a --resampler arg.
+    struct Switch {
+        double      at;
+        std::string resampler;
+    };
+    std::vector<Switch> switches;
+
+    // Session rate changes: at `at` seconds, run the session at `rate`.
+    struct RateChange {
+        double at;
+        double rate;
+    };
+    std::vector<RateChange> rateChanges;
+};
+
+// Host clock of the simulation: nanosecond ticks, set by the event loop.
+class SimTimeSource : public TimeSource {
+public:
+    uint64_t now() const override { return now_; }
+    double toSeconds(double ticks) const override { return ticks * 1e-9; }
+
+    void set(uint64_t ticks) { now_ = ticks; }
+
+private:
+    uint64_t now_ = 0;
+};
+
+// One free-running clock and the callback it drives. Cycle k covers device
+// samples [k * buffer, (k + 1) * buffer) and wakes once the last of them
+// has passed, plus a scheduling delay.
+struct SimDevice {
+    double   rate = kNominalSampleRate;   // True rate, Hz
+    double   phase = 0.0;                 // True time of sample 0, seconds
+    uint32_t buffer = 256;
+    uint64_t cycle = 0;
+    double   wake = 0.0;
+
+    double timeOf(double sample) const { return phase + sample / rate; }
+    double boundary(uint64_t k) const { return timeOf(static_cast<double>((k + 1) * buffer)); }
+};
+
+// Per-stream figures over the settled part of the run.
+struct FillStats {
+    uint32_t min = std::numeric_limits<uint32_t>::max();
+    uint32_t max = 0;
+    double   sum = 0.0;
+    uint64_t samples = 0;
+
+    void add(uint32_t fill)
+    {
+        min = std::min(min, fill);
+        max = std::max(max, fill);
+        sum += fill;
+        ++samples;
+    }
+};
+
+// Largest |x[n] - 2 x[n-1] + x[n-2]| of the first channel.
+struct ClickMeter {
+    float  x1 = 0.0f, x2 = 0.0f;
+    int    primed = 0;
+    double max = 0.0;
+
+    void add(const float* buf, uint32_t frames, uint32_t channels)
+    {
+        for (uint32_t i = 0; i < frames; ++i) {
+            float x = buf[i * channels];
+            if (primed == 2) max = std::max(max, static_cast<double>(std::fabs(x - 2.0f * x1 + x2)));
+            else ++primed;
+            x2 = x1;
+            x1 = x;
+        }
+    }
+};
+
+struct MetricsSnapshot {
+    uint64_t writes = 0, overruns = 0, dropped = 0;
+    uint64_t reads = 0, underruns = 0, partials = 0;
+};
+
+MetricsSnapshot snapshot(const StreamMetrics& m)
+{
+    MetricsSnapshot s;
+    s.writes = m.writes.load(std::memory_order_relaxed);
+    s.overruns = m.overruns.load(std::memory_order_relaxed);
+    s.dropped = m.droppedFrames.load(std::memory_order_relaxed);
+    s.reads = m.reads.load(std::memory_order_relaxed);
+    s.underruns = m.underruns.load(std::memory_order_relaxed);
+    s.partials = m.partials.load(std::memory_order_relaxed);
+    return s;
+}
+
+// "<device> in", "<device> cue", "<device> out".
+std::string streamName(const SharedMemoryLayout& shm, uint32_t stream)
+{
+    static const char* const kRoleNames[] = {"in", "cue", "out"};
+    const StreamDescriptor& desc = shm.streams[stream];
+    return std::string(shm.devices[desc.device].name) + " " + kRoleNames[desc.role];
+}
+
+// A device's stream name as parseResamplerArg() takes it.
+const char* roleSuffix(StreamRole role)
+{
+    switch (role) {
+        case kStreamCapture: return "in";
+        case kStreamCue:     return "cue";
+        default:             return "out";
+    }
+}
+
+// Fill a block with a sine at the device's own sample time, so every
+// stream carries continuous audio.
+void sine(std::vector<float>& buf, uint32_t frames, uint32_t channels, uint64_t sampleTime,
+          double hz)
+{
+    for (uint32_t i = 0; i < frames; ++i) {
+        auto v = static_cast<float>(0.25 * std::sin(2.0 * M_PI * hz
+                                    * static_cast<double>(sampleTime + i) / kNominalSampleRate));
+        for (uint32_t ch = 0; ch < channels; ++ch) buf[i * channels + ch] = v;
+    }
+}
+
+class Simulation {
+public:
+    explicit Simulation(const Options& opt)
+        : opt_(opt)
+        , rng_(opt.seed)
+        , stampJitter_(0.0, opt.stampJitterUs * 1e-6)
+        , schedJitter_(opt.schedJitterUs > 0 ? 1.0 / (opt.schedJitterUs * 1e-6) : 1.0)
+        , dropout_(opt.dropoutRate)
+    {
+    }
+
+    ~Simulation()
+    {
+        core_.reset();
+        if (shm_) {
+            shm_->~SharedMemoryLayout();
+            ::operator delete(shm_, std::align_val_t{64});
+        }
+    }
+
+    int run();
+
+private:
+    // Host tick for a true time, with timestamp jitter.
+    uint64_t hostTicks(double t, bool jitter = true)
+    {
+        double noisy = t + (jitter ? stampJitter_(rng_) : 0.0);
+        return static_cast<uint64_t>(std::llround((noisy + 1.0) * 1e9));
+    }
+
+    IOTime ioTime(const SimDevice& dev, double sample)
+    {
+        IOTime t;
+        t.hostTime = hostTicks(dev.timeOf(sample));
+        t.sampleTime = sample;
+        t.hostValid = t.sampleValid = true;
+        return t;
+    }
+
+    double schedDelay()
+    {
+        if (opt_.schedJitterUs <= 0) return 0.0;
+        // Exponential with a 2.5 ms cap; schedule() keeps each device's
+        // callbacks in order whatever the draw.
+        return std::min(schedJitter_(rng_), 2.5e-3);
+    }
+
+    void schedule(SimDevice& dev)
+    {
+        dev.wake = std::max(dev.wake, dev.boundary(dev.cycle) + schedDelay());
+    }
+
+    // One simulated slave: its IOProc's clock, its tap's (the same
+    // crystal) and its true rate offset.
+    struct Slave {
+        uint32_t  device = 0;
+        double    ppm = 0.0;
+        SimDevice io, cue;
+        double    lockAt = -1.0;
+    };
+
+    // Everything the sim keeps per shared memory stream: a concealer and
+    // click meter per plugin client (outputs only use the first meter).
+    struct Stream {
+        std::string     name;
+        std::vector<StreamConcealer> conceal;
+        MetricsSnapshot settled;
+        FillStats       fill;
+        std::vector<ClickMeter>      click;
+
+        double clickMax() const
+        {
+            double worst = 0.0;
+            for (const auto& meter : click) worst = std::max(worst, meter.max);
+            return worst;
+        }
+    };
+
+    IOBufferList ioBuffers(std::vector<float>& buf, std::vector<float>& planar, uint32_t frames);
+    void interleave(const IOBufferList& list, std::vector<float>& buf);
+
+    void masterCycle();
+    void slaveCycle(Slave& slave);
+    void cueCycle(Slave& slave);
+    void pluginCycle();
+    void sample(double t);
+    void applySwitches(double t);
+    void applyRateChanges(double t);
+
+    // Push's true rate over the slave's, in session samples: what the
+    // slave's drift ratio should come out at.
+    double trueRatio(const Slave& slave) const
+    {
+        return push_.rate * sessionRate_ / opt_.pushRate / slave.io.rate;
+    }
+
+    Options      opt_;
+    std::mt19937 rng_;
+    std::normal_distribution<double>      stampJitter_;
+    std::exponential_distribution<double> schedJitter_;
+    std::bernoulli_distribution           dropout_;
+
+    SimTimeSource       clock_;
+    SharedMemoryLayout* shm_ = nullptr;
+    std::unique_ptr<EngineCore> core_;
+
+    SimDevice          push_, plugin_;
+    std::vector<Slave> slaves_;
+
+    std::vector<float>  in_, out_;
+    std::vector<float>  planarIn_, planarOut_;     // --planar: one channel after another
+    std::vector<Stream> streams_;     // Parallel to the stream table
+
+    // Results.
+    double   lockAt_ = -1.0;
+    bool     settled_ = false;
+    uint64_t dropped_ = 0;
+    size_t   nextSwitch_ = 0;
+    size_t   nextRateChange_ = 0;
+    double   sessionRate_ = kNominalSampleRate;
+    FILE*    trace_ = nullptr;
+    double   nextTrace_ = 0.0;
+};
+
+// ---- Helper callbacks ----
+
+// What a device's IOProc gets for buf: one interleaved buffer, or with
+// --planar one mono buffer per channel, split out of it.
+IOBufferList Simulation::ioBuffers(std::vector<float>& buf, std::vector<float>& planar,
+                                   uint32_t frames)
+{
+    uint32_t channels = opt_.channels;
+    if (!opt_.planar) return IOBufferList::interleaved(buf.data(), channels, frames);
+
+    IOBufferList list;
+    list.count = channels;
+    list.frames = frames;
+    uint32_t stride = static_cast<uint32_t>(planar.size()) / kMaxStreamChannels;
+    for (uint32_t ch = 0; ch < channels; ++ch) {
+        float* dst = planar.data() + ch * stride;
+        for (uint32_t i = 0; i < frames; ++i) dst[i] = buf[i * channels + ch];
+        list.buffers[ch] = {dst, 1};
+    }
+    return list;
+}
+
+// Back into buf from what ioBuffers() handed out, once the engine has
+// filled it.
+void Simulation::interleave(const IOBufferList& list, std::vector<float>& buf)
+{
+    if (!opt_.planar) return;
+    for (uint32_t ch = 0; ch < list.count; ++ch) {
+        for (uint32_t i = 0; i < list.frames; ++i) {
+            buf[i * list.count + ch] = list.buffers[ch].data[i];
+        }
+    }
+}
+
+void Simulation::masterCycle()
+{
+    uint32_t frames = push_.buffer;
+    auto sampleTime = push_.cycle * frames;
+
+    if (!dropout_(rng_)) {
+        IOCycle cycle;
+        cycle.now.hostTime = hostTicks(push_.wake);
+        cycle.now.hostValid = true;
+        sine(in_, frames, opt_.channels, sampleTime, 440.0);
+        cycle.input = ioBuffers(in_, planarIn_, frames);
+        cycle.inputTime = ioTime(push_, static_cast<double>(sampleTime));
+        cycle.output = ioBuffers(out_, planarOut_, frames);
+        cycle.outputTime = ioTime(push_, static_cast<double>(sampleTime + 2 * frames));
+        core_->masterIO(cycle);
+    } else {
+        ++dropped_;
+    }
+}
+
+void Simulation::slaveCycle(Slave& slave)
+{
+    SimDevice& dev = slave.io;
+    uint32_t frames = dev.buffer;
+    auto sampleTime = dev.cycle * frames;
+
+    if (!dropout_(rng_)) {
+        IOCycle cycle;
+        cycle.now.hostTime = hostTicks(dev.wake);
+        cycle.now.hostValid = true;
+        sine(in_, frames, opt_.channels, sampleTime, 660.0);
+        cycle.input = ioBuffers(in_, planarIn_, frames);
+        cycle.inputTime = ioTime(dev, static_cast<double>(sampleTime));
+        cycle.output = ioBuffers(out_, planarOut_, frames);
+        cycle.outputTime = ioTime(dev, static_cast<double>(sampleTime + 2 * frames));
+        core_->slaveIO(slave.device, cycle);
+        interleave(cycle.output, out_);
+        if (settled_) {
+            int out = shm_->findStream(slave.device, kStreamPlayback);
+            streams_[out].click[0].add(out_.data(), frames, opt_.channels);
+        }
+    } else {
+        ++dropped_;
+    }
+}
+
+void Simulation::cueCycle(Slave& slave)
+{
+    SimDevice& dev = slave.cue;
+    uint32_t frames = dev.buffer;
+    auto sampleTime = dev.cycle * frames;
+    sine(in_, frames, opt_.channels, sampleTime, 880.0);
+    core_->cueIO(slave.device, ioBuffers(in_, planarIn_, frames),
+                 ioTime(dev, static_cast<double>(sampleTime)));
+}
+
+// ---- Plugin (HAL IO cycle on the Push clock) ----
+// As PluginHandler: inputs by timestamp through the concealers, outputs
+// stamped with their HAL output time. The HAL only runs once the helper has
+// published a Push clock to derive zero timestamps from.
+
+void Simulation::pluginCycle()
+{
+    ClockSnapshot clock;
+    if (!shm_->masterClock.tryLoad(&clock) || clock.hostTime == 0) return;
+
+    uint32_t frames = plugin_.buffer;
+    auto inputTime = static_cast<int64_t>(plugin_.cycle * frames);
+    int64_t outputTime = inputTime + 2 * frames;
+
+    for (uint32_t i = 0; i < shm_->streamCount; ++i) {
+        if (shm_->streams[i].direction != kStreamDirInput) continue;
+
+        AudioRing* ring = shm_->streamRing(i);
+        Stream& stream = streams_[i];
+        uint32_t fill = ring->availableRead();
+        int64_t at = inputTime - kInputAlignmentLatency;
+        for (uint32_t c = 0; c < opt_.clients; ++c) {
+            uint32_t lead = 0;
+            uint32_t served = ring->peekAt(out_.data(), frames, at, &lead);
+            stream.conceal[c].apply(out_.data(), frames, lead, served);
+            if (c == 0) shm_->metrics[i].onRead(fill, frames, served);
+            if (settled_) stream.click[c].add(out_.data(), frames, ring->frameSamples());
+        }
+        ring->release(at + frames);
+    }
+
+    for (uint32_t i = 0; i < shm_->streamCount; ++i) {
+        if (shm_->streams[i].direction != kStreamDirOutput) continue;
+
+        AudioRing* ring = shm_->streamRing(i);
+        sine(in_, frames, ring->frameSamples(), static_cast<uint64_t>(outputTime), 220.0);
+        ring->alignTo(outputTime, 0);
+        uint32_t lost = ring->produce(in_.data(), frames);
+        shm_->metrics[i].onWrite(lost);
+    }
+}
+
+// Converter switches due by t, as the helper's SIGHUP reload does them:
+// every stream whose tier the argument changes. Also collects retired
+// converters, like the helper's main loop.
+void Simulation::applySwitches(double t)
+{
+    core_->collect();
+    while (nextSwitch_ < opt_.switches.size() && opt_.switches[nextSwitch_].at <= t) {
+        const auto& sw = opt_.switches[nextSwitch_++];
+        EngineConfig wanted = core_->config();
+        parseResamplerArg(sw.resampler.c_str(), &wanted);
+
+        const EngineConfig& current = core_->config();
+        for (uint32_t device = 1; device < wanted.devices.size(); ++device) {
+            const DeviceConfig& to = wanted.devices[device];
+            const DeviceConfig& from = current.devices[device];
+            const std::pair<StreamRole, ResamplerTier> streams[] = {
+                {kStreamCapture, to.inputResampler},
+                {kStreamCue, to.cueResampler},
+                {kStreamPlayback, to.outputResampler},
+            };
+            const ResamplerTier was[] = {
+                from.inputResampler, from.cueResampler, from.outputResampler};
+            for (int i = 0; i < 3; ++i) {
+                if (streams[i].second == was[i]) continue;
+                std::printf("%7.2f s  %s-%s: %s -> %s\n", t, to.name.c_str(),
+                            roleSuffix(streams[i].first), resamplerTierName(was[i]),
+                            resamplerTierName(streams[i].second));
+                core_->setResampler(device, streams[i].first, streams[i].second);
+            }
+        }
+    }
+}
+
+// Session rate changes due by t. The plugin's cycles carry on at the new
+// rate from where its clock is now, a new timeline like the engine's.
+void Simulation::applyRateChanges(double t)
+{
+    while (nextRateChange_ < opt_.rateChanges.size()
+           && opt_.rateChanges[nextRateChange_].at <= t)
+    {
+        double rate = opt_.rateChanges[nextRateChange_++].rate;
+        std::printf("%7.2f s  session rate %.0f -> %.0f Hz\n", t, sessionRate_, rate);
+        if (!core_->setSessionRate(rate)) continue;
+        sessionRate_ = rate;
+        plugin_.rate = push_.rate * rate / opt_.pushRate;
+        // The loop moves on to the next cycle, the first to end after t.
+        auto now = static_cast<uint64_t>((t - plugin_.phase) * plugin_.rate);
+        plugin_.cycle = now / plugin_.buffer - 1;
+    }
+}
+
+// Ring fills and the trace, once per plugin cycle.
+void Simulation::sample(double t)
+{
+    bool locked = true;
+    for (Slave& slave : slaves_) {
+        DriftSnapshot drift;
+        if (shm_->drift[slave.device].tryLoad(&drift) && drift.ready) {
+            if (slave.lockAt < 0) slave.lockAt = t;
+        } else if (slave.lockAt < 0) {
+            locked = false;
+        }
+    }
+    if (locked && lockAt_ < 0) lockAt_ = t;
+
+    if (!settled_ && t >= opt_.settle) {
+        settled_ = true;
+        for (uint32_t i = 0; i < shm_->streamCount; ++i) {
+            streams_[i].settled = snapshot(shm_->metrics[i]);
+        }
+    }
+
+    if (settled_) {
+        for (uint32_t i = 0; i < shm_->streamCount; ++i) {
+            streams_[i].fill.add(shm_->streamRing(i)->availableRead());
+        }
+    }
+
+    if (trace_ && t >= nextTrace_) {
+        nextTrace_ += 0.1;
+        std::fprintf(trace_, "%.3f", t);
+        for (const Slave& slave : slaves_) {
+            DriftSnapshot drift;
+            bool ready = shm_->drift[slave.device].tryLoad(&drift) && drift.ready;
+            std::fprintf(trace_, ",%d,%.3f,%.3f,%.3f", ready ? 1 : 0,
+                         ready ? (drift.ratio / trueRatio(slave) - 1.0) * 1e6 : 0.0,
+                         drift.inputCorrection * 1e6, drift.outputCorrection * 1e6);
+        }
+        for (uint32_t i = 0; i < shm_->streamCount; ++i) {
+            std::fprintf(trace_, ",%u", shm_->streamRing(i)->availableRead());
+        }
+        std::fprintf(trace_, "\n");
+    }
+}
+
+int Simulation::run()
+{
+    EngineConfig config = opt_.engine;
+    config.clockEstimator = opt_.estimator;
+    config.time = &clock_;
+
+    // ---- Shared region, as the helper lays it out ----
+    LayoutTable table;
+    if (!layoutFor(config, &table)) {
+        std::fprintf(stderr, "invalid device table\n");
+        return 1;
+    }
+    size_t size = SharedMemoryLayout::sizeFor(table);
+    void* region = ::operator new(size, std::align_val_t{64});
+    std::memset(region, 0, size);
+    shm_ = new (region) SharedMemoryLayout();
+    if (!shm_->init(table, 1)) {
+        std::fprintf(stderr, "invalid stream table\n");
+        return 1;
+    }
+
+    streams_.resize(shm_->streamCount);
+    for (uint32_t i = 0; i < shm_->streamCount; ++i) {
+        streams_[i].name = streamName(*shm_, i);
+        streams_[i].conceal.resize(opt_.clients);
+        streams_[i].click.resize(opt_.clients);
+        for (auto& conceal : streams_[i].conceal) conceal.setChannels(shm_->streams[i].channels);
+    }
+
+    core_ = std::make_unique<EngineCore>(shm_, config);
+    if (!core_->valid() || !core_->begin()) {
+        std::fprintf(stderr, "can't start the engine (resamplers %s / %s)\n",
+                     resamplerTierName(config.devices[1].inputResampler),
+                     resamplerTierName(config.devices[1].outputResampler));
+        return 1;
+    }
+
+    // ---- Devices ----
+    std::uniform_real_distribution<double> phase(0.0, 0.01);
+    push_.rate = opt_.pushRate * (1.0 + opt_.pushPpm * 1e-6);
+    push_.buffer = opt_.pushBuffer;
+    push_.phase = phase(rng_);
+    sessionRate_ = opt_.sessionRate;
+    core_->setSessionRate(sessionRate_);
+    core_->setClock(kMasterDevice, opt_.pushRate);
+
+    slaves_.resize(config.devices.size() - 1);
+    for (uint32_t device = 1; device < config.devices.size(); ++device) {
+        Slave& slave = slaves_[device - 1];
+        slave.device = device;
+        slave.ppm = opt_.flx4Ppm + 35.0 * (device - 1);
+        slave.io.rate = opt_.flx4Rate * (1.0 + slave.ppm * 1e-6);
+        slave.io.buffer = opt_.flx4Buffer;
+        slave.io.phase = phase(rng_);
+        slave.cue = slave.io;
+        core_->setClock(device, opt_.flx4Rate);
+    }
+
+    // The plugin's cycles are Push sample times, in session samples; the
+    // HAL wakes a little after the Push IOProc.
+    plugin_.rate = push_.rate * sessionRate_ / opt_.pushRate;
+    plugin_.buffer = opt_.pluginBuffer;
+    plugin_.phase = push_.phase + 0.5e-3;
+
+    std::vector<SimDevice*> devices = {&push_};
+    for (Slave& slave : slaves_) {
+        devices.push_back(&slave.io);
+        devices.push_back(&slave.cue);
+    }
+    devices.push_back(&plugin_);
+    for (SimDevice* dev : devices) schedule(*dev);
+    if (!opt_.cue) {
+        // No cue streams in the layout: the taps never run.
+        for (Slave& slave : slaves_) slave.cue.wake = std::numeric_limits<double>::infinity();
+    }
+
+    uint32_t maxBuffer = std::max({opt_.pushBuffer, opt_.flx4Buffer, opt_.pluginBuffer});
+    in_.assign(maxBuffer * kMaxStreamChannels, 0.0f);
+    out_.assign(maxBuffer * kMaxStreamChannels, 0.0f);
+    if (opt_.planar) {
+        planarIn_.assign(maxBuffer * kMaxStreamChannels, 0.0f);
+        planarOut_.assign(maxBuffer * kMaxStreamChannels, 0.0f);
+    }
+
+    if (opt_.trace) {
+        trace_ = std::fopen(opt_.trace, "w");
+        if (!trace_) {
+            std::fprintf(stderr, "can't write %s\n", opt_.trace);
+            return 1;
+        }
+        std::fprintf(trace_, "t");
+        for (const Slave& slave : slaves_) {
+            const char* name = shm_->devices[slave.device].name;
+            std::fprintf(trace_, ",%s_ready,%s_ratio_err_ppm,%s_in_corr_ppm,%s_out_corr_ppm",
+                         name, name, name, name);
+        }
+        for (const Stream& stream : streams_) {
+            std::string column = stream.name;
+            std::replace(column.begin(), column.end(), ' ', '_');
+            std::fprintf(trace_, ",fill_%s", column.c_str());
+        }
+        std::fprintf(trace_, "\n");
+    }
+
+    // ---- Event loop: earliest wake first ----
+    for (;;) {
+        SimDevice* next = devices[0];
+        for (SimDevice* dev : devices) {
+            if (dev->wake < next->wake) next = dev;
+        }
+        double t = next->wake;
+        if (t >= opt_.seconds) break;
+        clock_.set(hostTicks(t, false));
+
+        if (next == &push_) {
+            masterCycle();
+        } else if (next == &plugin_) {
+            pluginCycle();
+            sample(t);
+            applySwitches(t);
+            applyRateChanges(t);
+        } else {
+            for (Slave& slave : slaves_) {
+                if (next == &slave.io) slaveCycle(slave);
+                if (next == &slave.cue) cueCycle(slave);
+            }
+        }
+        ++next->cycle;
+        schedule(*next);
+    }
+
+    std::vector<uint32_t> outLatency;
+    for (const Slave& slave : slaves_) {
+        outLatency.push_back(shm_->streamLatency(slave.device, kStreamPlayback)->load());
+    }
+    const WorkerPool* workers = core_->workers();
+    uint32_t workerThreads = workers ? workers->workers() : 0;
+    uint64_t offloaded = workers ? workers->offloaded() : 0;
+    uint64_t reclaimed = workers ? workers->reclaimed() : 0;
+    core_->end();
+    if (trace_) std::fclose(trace_);
+
+    // ---- Report ----
+    ClockSnapshot clock;
+    shm_->masterClock.tryLoad(&clock);
+
+    const DeviceConfig& flx4 = config.devices[1];
+    std::printf("%.0f s, seed %u, %s estimator, resamplers %s / %s / %s, cue %s\n",
+                opt_.seconds, opt_.seed, clockEstimatorName(opt_.estimator),
+                resamplerTierName(flx4.inputResampler),
+                resamplerTierName(flx4.cueResampler),
+                resamplerTierName(flx4.outputResampler),
+                opt_.cue ? "on" : "off");
+    if (opt_.clients > 1) std::printf("plugin clients: %u\n", opt_.clients);
+    std::printf("clocks: push %.0f Hz %+.1f ppm / %u, flx4 %.0f Hz %+.1f ppm / %u, "
+                "plugin %.0f Hz / %u\n",
+                opt_.pushRate, opt_.pushPpm, opt_.pushBuffer, opt_.flx4Rate, opt_.flx4Ppm,
+                opt_.flx4Buffer, sessionRate_, opt_.pluginBuffer);
+    for (size_t i = 1; i < slaves_.size(); ++i) {
+        std::printf("        %s %.0f Hz %+.1f ppm / %u\n", shm_->devices[slaves_[i].device].name,
+                    opt_.flx4Rate, slaves_[i].ppm, opt_.flx4Buffer);
+    }
+    std::printf("jitter: stamps %.0f us, scheduling %.0f us, dropout %.4f (%llu dropped)\n\n",
+                opt_.stampJitterUs, opt_.schedJitterUs, opt_.dropoutRate,
+                static_cast<unsigned long long>(dropped_));
+
+    if (lockAt_ >= 0) {
+        std::printf("lock      %.2f s\n", lockAt_);
+    } else {
+        std::printf("lock      never\n");
+    }
+    std::printf("resyncs   %llu\n", static_cast<unsigned long long>(clock.seed > 0 ? clock.seed - 1 : 0));
+    for (size_t i = 0; i < slaves_.size(); ++i) {
+        const Slave& slave = slaves_[i];
+        DriftSnapshot drift;
+        shm_->drift[slave.device].tryLoad(&drift);
+        std::printf("ratio     %-5s %+.3f ppm   servo in %+.2f ppm, out %+.2f ppm\n",
+                    shm_->devices[slave.device].name,
+                    drift.ready ? (drift.ratio / trueRatio(slave) - 1.0) * 1e6 : 0.0,
+                    drift.inputCorrection * 1e6, drift.outputCorrection * 1e6);
+    }
+    for (size_t i = 0; i < slaves_.size(); ++i) {
+        std::printf("latency   %s out %u frames reported\n",
+                    shm_->devices[slaves_[i].device].name, outLatency[i]);
+    }
+    if (workerThreads > 0) {
+        std::printf("jobs      %u workers: %llu offloaded, %llu taken back\n", workerThreads,
+                    static_cast<unsigned long long>(offloaded),
+                    static_cast<unsigned long long>(reclaimed));
+    }
+    std::printf("\n");
+
+    std::printf("after %.0f s:\n", opt_.settle);
+    std::printf("%-9s %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s\n",
+                "stream", "writes", "overrun", "dropped", "reads", "underrun", "partial",
+                "fill min", "fill avg", "fill max", "click");
+
+    uint64_t xruns = 0;
+    for (uint32_t i = 0; i < shm_->streamCount; ++i) {
+        const Stream& stream = streams_[i];
+        MetricsSnapshot end = snapshot(shm_->metrics[i]);
+        const MetricsSnapshot& from = stream.settled;
+        const FillStats& fill = stream.fill;
+        MetricsSnapshot d;
+        d.writes = end.writes - from.writes;
+        d.overruns = end.overruns - from.overruns;
+        d.dropped = end.dropped - from.dropped;
+        d.reads = end.reads - from.reads;
+        d.underruns = end.underruns - from.underruns;
+        d.partials = end.partials - from.partials;
+        xruns += d.overruns + d.underruns + d.partials;
+
+        std::printf("%-9s %8llu %8llu %8llu %8llu %8llu %8llu %8u %8.0f %8u %8.4f\n",
+                    stream.name.c_str(),
+                    static_cast<unsigned long long>(d.writes),
+                    static_cast<unsigned long long>(d.overruns),
+                    static_cast<unsigned long long>(d.dropped),
+                    static_cast<unsigned long long>(d.reads),
+                    static_cast<unsigned long long>(d.underruns),
+                    static_cast<unsigned long long>(d.partials),
+                    fill.samples ? fill.min : 0,
+                    fill.samples ? fill.sum / static_cast<double>(fill.samples) : 0.0,
+                    fill.max, stream.clickMax());
+    }
+
+    if (lockAt_ < 0) return 1;
+    if (opt_.dropoutRate <= 0.0 && xruns > 0) return 1;
+    return 0;
+}
+
+void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s [--seconds s] [--settle s] [--seed n]\n"
+                 "       [--push-ppm p] [--flx4-ppm p] [--flx4-rate hz]\n"
+                 "       [--push-rate hz] [--session-rate hz] [--rate-change t:hz]...\n"
+                 "       [--push-buffer f] [--flx4-buffer f] [--plugin-buffer f]\n"
+                 "       [--stamp-jitter-us us] [--sched-jitter-us us]\n"
+                 "       [--dropout-rate r] [--no-cue] [--slaves n]\n"
+                 "       [--estimator dll|adaptive|kalman|lsq]\n"
+                 "       [--resampler [<device>-in=|<device>-cue=|<device>-out=]tier]...\n"
+                 "       [--switch t:[<device>-in=|<device>-cue=|<device>-out=]tier]...\n"
+                 "       [--channels n] [--planar] [--workers n] [--clients n]\n"
+                 "       [--trace file.csv]\n"
+                 "tiers: linear, cubic, sinc|polyphase|samplerate[-low|-medium|-high]\n",
+                 argv0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--no-cue") {
+            opt.cue = false;
+        } else if (arg == "--planar") {
+            opt.planar = true;
+        } else if (!hasValue) {
+            usage(argv[0]);
+            return 1;
+        } else if (arg == "--seconds") {
+            opt.seconds = std::atof(argv[++i]);
+        } else if (arg == "--settle") {
+            opt.settle = std::atof(argv[++i]);
+        } else if (arg == "--seed") {
+            opt.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--push-ppm") {
+            opt.pushPpm = std::atof(argv[++i]);
+        } else if (arg == "--flx4-ppm") {
+            opt.flx4Ppm = std::atof(argv[++i]);
+        } else if (arg == "--flx4-rate") {
+            opt.flx4Rate = std::atof(argv[++i]);
+        } else if (arg == "--push-buffer") {
+            opt.pushBuffer = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (arg == "--flx4-buffer") {
+            opt.flx4Buffer = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (arg == "--plugin-buffer") {
+            opt.pluginBuffer = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (arg == "--stamp-jitter-us") {
+            opt.stampJitterUs = std::atof(argv[++i]);
+        } else if (arg == "--sched-jitter-us") {
+            opt.schedJitterUs = std::atof(argv[++i]);
+        } else if (arg == "--dropout-rate") {
+            opt.dropoutRate = std::atof(argv[++i]);
+        } else if (arg == "--estimator") {
+            if (!parseClockEstimatorKind(argv[++i], &opt.estimator)) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--slaves") {
+            opt.slaves = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (arg == "--clients") {
+            opt.clients = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (arg == "--resampler") {
+            opt.resamplers.push_back(argv[++i]);
+        } else if (arg == "--switch") {
+            std::string value = argv[++i];
+            auto colon = value.find(':');
+            if (colon == std::string::npos) {
+                usage(argv[0]);
+                return 1;
+            }
+            opt.switches.push_back({std::atof(value.substr(0, colon).c_str()),
+                                    value.substr(colon + 1)});
+        } else if (arg == "--push-rate") {
+            opt.pushRate = std::atof(argv[++i]);
+        } else if (arg == "--session-rate") {
+            opt.sessionRate = std::atof(argv[++i]);
+        } else if (arg == "--rate-change") {
+            std::string value = argv[++i];
+            auto colon = value.find(':');
+            double rate = colon == std::string::npos ? 0.0 : std::atof(value.c_str() + colon + 1);
+            if (!isSupportedSampleRate(rate)) {
+                usage(argv[0]);
+                return 1;
+            }
+            opt.rateChanges.push_back({std::atof(value.substr(0, colon).c_str()), rate});
+        } else if (arg == "--channels") {
+            opt.channels = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (arg == "--workers") {
+            opt.engine.workerThreads = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (arg == "--trace") {
+            opt.trace = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (opt.seconds <= 0 || opt.settle >= opt.seconds
+        || opt.pushBuffer == 0 || opt.flx4Buffer == 0 || opt.pluginBuffer == 0
+        || opt.pushBuffer > 4096 || opt.flx4Buffer > 4096 || opt.pluginBuffer > 4096
+        || opt.dropoutRate < 0.0 || opt.dropoutRate >= 1.0
+        || opt.slaves == 0 || opt.slaves >= kMaxDevices
+        || opt.clients == 0 || opt.clients > 8
+        || !LayoutTable::validChannels(opt.channels)
+        || opt.pushRate <= 0.0 || !isSupportedSampleRate(opt.sessionRate))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Push, the FLX4 and the extra slaves; cue taps on all of them unless
+    // --no-cue.
+    DeviceConfig flx4 = opt.engine.devices[1];
+    opt.engine.devices.resize(1);
+    for (uint32_t k = 1; k <= opt.slaves; ++k) {
+        DeviceConfig slave = flx4;
+        if (k > 1) slave.name = "dev" + std::to_string(k);
+        slave.cue = opt.cue;
+        opt.engine.devices.push_back(slave);
+    }
+    for (DeviceConfig& device : opt.engine.devices) {
+        device.inputChannels = device.outputChannels = opt.channels;
+    }
+    for (const auto& resampler : opt.resamplers) {
+        if (!parseResamplerArg(resampler.c_str(), &opt.engine)) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    for (const auto& sw : opt.switches) {
+        EngineConfig check = opt.engine;
+        if (!parseResamplerArg(sw.resampler.c_str(), &check)) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::stable_sort(opt.switches.begin(), opt.switches.end(),
+                     [](const Options::Switch& a, const Options::Switch& b) { return a.at < b.at; });
+    std::stable_sort(opt.rateChanges.begin(), opt.rateChanges.end(),
+                     [](const Options::RateChange& a, const Options::RateChange& b) {
+                         return a.at < b.at;
+                     });
+
+    Simulation sim(opt);
+    return sim.run();
+}
@@ -0,0 +1,202 @@
+// IpcBench: cross-process throughput and latency of the shared memory data
+// plane, with the two sides in separate processes connected through the
+// POSIX transport (memfd + SCM_RIGHTS).
+//
+// The parent plays the helper: it starts a UnixSocketServer and produces
+// into the input rings. The forked child plays the plugin: it connects with
+// a UnixSocketClient, validates the layout like the plugin does, and
+//   - echoes every pushInput block back through pushOutput (latency), and
+//   - drains flx4Input as fast as it arrives (throughput).
+// Both sides poll, yielding between attempts like RingBench, so on a
+// machine with a spare core the numbers are the ring + cache-coherency cost
+// rather than scheduler wakeups. On a single core they measure yields.
+// With mirrored, the layout mirrors its rings and both processes map them so.
+//
+// Usage: flux_bench_ipc [megabytes] [pings] [modulo|mirrored]
+
+#include "UnixTransport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace flux;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t kPingFrames   = 64;     // One small HAL buffer
+constexpr uint32_t kStreamFrames = 512;
+
+// ---- Plugin side (child process) ----
+
+int runPlugin(const std::string& socketPath)
+{
+    UnixSocketClient client(socketPath);
+    auto deadline = Clock::now() + std::chrono::seconds(5);
+    while (!client.connect()) {
+        if (Clock::now() > deadline) {
+            std::fprintf(stderr, "plugin: could not connect to %s\n", socketPath.c_str());
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    auto* shm = client.sharedMemory();
+    // The master's capture and playback, and the first slave's capture.
+    int pingInIndex = shm->findStream(kMasterDevice, kStreamCapture);
+    int pingOutIndex = shm->findStream(kMasterDevice, kStreamPlayback);
+    int streamIndex = shm->findStream(1, kStreamCapture);
+    if (pingInIndex < 0 || pingOutIndex < 0 || streamIndex < 0) return 1;
+    AudioRing* pingIn = client.ring(static_cast<uint32_t>(pingInIndex));
+    AudioRing* pingOut = client.ring(static_cast<uint32_t>(pingOutIndex));
+    AudioRing* stream = client.ring(static_cast<uint32_t>(streamIndex));
+
+    std::vector<float> ping(kPingFrames * kChannelsPerDevice);
+    std::vector<float> block(kStreamFrames * kChannelsPerDevice);
+
+    // Run until the helper goes back offline.
+    while (shm->helperStatus.load(std::memory_order_acquire) != kHelperRunning) {
+        std::this_thread::yield();
+    }
+    while (shm->helperStatus.load(std::memory_order_acquire) == kHelperRunning) {
+        bool idle = true;
+        if (pingIn->read(ping.data(), kPingFrames)) {
+            while (!pingOut->write(ping.data(), kPingFrames)) {
+                std::this_thread::yield();
+            }
+            idle = false;
+        }
+        while (stream->read(block.data(), kStreamFrames)) idle = false;
+        if (idle) std::this_thread::yield();
+    }
+    return 0;
+}
+
+// ---- Helper side (parent process) ----
+
+std::vector<double> measureLatency(AudioRing& out, AudioRing& back, int pings)
+{
+    std::vector<float> ping(kPingFrames * kChannelsPerDevice, 0.0f);
+    std::vector<float> echo(ping.size());
+    std::vector<double> roundTrips;
+    roundTrips.reserve(static_cast<size_t>(pings));
+
+    for (int i = 0; i < pings; ++i) {
+        ping[0] = static_cast<float>(i);
+        auto t0 = Clock::now();
+        out.write(ping.data(), kPingFrames);
+        while (!back.read(echo.data(), kPingFrames)) {
+            std::this_thread::yield();
+        }
+        auto t1 = Clock::now();
+        if (echo[0] != ping[0]) {
+            std::fprintf(stderr, "helper: ping %d came back as %g\n", i, echo[0]);
+        }
+        roundTrips.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+    }
+    std::sort(roundTrips.begin(), roundTrips.end());
+    return roundTrips;
+}
+
+double measureThroughput(AudioRing& ring, int64_t totalBytes)
+{
+    std::vector<float> block(kStreamFrames * kChannelsPerDevice, 0.5f);
+    int64_t blocks = totalBytes / (kStreamFrames * kBytesPerFrame);
+
+    auto t0 = Clock::now();
+    for (int64_t i = 0; i < blocks; ++i) {
+        while (!ring.write(block.data(), kStreamFrames)) {
+            std::this_thread::yield();
+        }
+    }
+    while (ring.availableRead() > 0) {      // Until the consumer has it all
+        std::this_thread::yield();
+    }
+    auto t1 = Clock::now();
+
+    double secs = std::chrono::duration<double>(t1 - t0).count();
+    double bytes = static_cast<double>(blocks) * kStreamFrames * kBytesPerFrame;
+    return bytes / secs / (1024.0 * 1024.0);
+}
+
+double percentile(const std::vector<double>& sorted, double p)
+{
+    auto i = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+    return sorted[i];
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int64_t megabytes = argc > 1 ? std::atoll(argv[1]) : 512;
+    int pings = argc > 2 ? std::atoi(argv[2]) : 20000;
+    std::string mode = argc > 3 ? argv[3] : "modulo";
+    if (megabytes <= 0 || pings <= 0 || (mode != "modulo" && mode != "mirrored")) {
+        std::fprintf(stderr, "usage: %s [megabytes] [pings] [modulo|mirrored]\n", argv[0]);
+        return 1;
+    }
+
+    std::string socketPath = "/tmp/flux-bench-ipc-" + std::to_string(getpid()) + ".sock";
+
+    // Fork before any threads exist; the child retries until the socket is up.
+    pid_t child = fork();
+    if (child < 0) {
+        std::perror("fork");
+        return 1;
+    }
+    if (child == 0) {
+        _exit(runPlugin(socketPath));
+    }
+
+    LayoutTable table = defaultLayoutTable();
+    table.mirrored = mode == "mirrored";
+    UnixSocketServer server(socketPath);
+    if (!server.start(table)) {
+        kill(child, SIGTERM);
+        waitpid(child, nullptr, 0);
+        return 1;
+    }
+    std::thread serverThread([&server] { server.runMessageLoop(); });
+
+    auto* shm = server.sharedMemory();
+    shm->helperStatus.store(kHelperRunning, std::memory_order_release);
+
+    auto roundTrips = measureLatency(*shm->ring(kMasterDevice, kStreamCapture),
+                                     *shm->ring(kMasterDevice, kStreamPlayback), pings);
+    double mbps = measureThroughput(*shm->ring(1, kStreamCapture),
+                                    megabytes * 1024 * 1024);
+
+    shm->helperStatus.store(kHelperOffline, std::memory_order_release);
+    int status = 0;
+    waitpid(child, &status, 0);
+    server.requestStop();
+    serverThread.join();
+    server.stop();
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::fprintf(stderr, "plugin process failed\n");
+        return 1;
+    }
+
+    std::printf("two processes, memfd + SCM_RIGHTS, layout v%u, %s rings\n\n",
+                kLayoutVersion, mode.c_str());
+    std::printf("round trip, %u-frame blocks, %d pings (ns)\n", kPingFrames, pings);
+    std::printf("%10s %10s %10s %10s\n", "p50", "p99", "p99.9", "max");
+    std::printf("%10.0f %10.0f %10.0f %10.0f\n\n",
+                percentile(roundTrips, 0.5), percentile(roundTrips, 0.99),
+                percentile(roundTrips, 0.999), roundTrips.back());
+    std::printf("stream, %u-frame blocks, %lld MB: %.0f MB/s\n",
+                kStreamFrames, static_cast<long long>(megabytes), mbps);
+    return 0;
+}
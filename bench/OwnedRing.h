@@ -0,0 +1,40 @@
+#pragma once
+
+// A FrameRing header followed by its data, laid out the way the shared
+// region places it, on the heap. Lets the benches use the same ring type
+// as the helper and plugin without building a whole SharedMemoryLayout.
+
+#include "SharedMemory.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace flux {
+
+struct OwnedRing {
+    StereoRing* ring = nullptr;
+
+    explicit OwnedRing(uint32_t capacityFrames)
+    {
+        // bytesFor() is a multiple of 64 for any power-of-two capacity >= 8,
+        // as aligned_alloc requires.
+        void* storage = std::aligned_alloc(64, StereoRing::bytesFor(capacityFrames));
+        if (!storage) throw std::bad_alloc();
+        ring = new (storage) StereoRing;
+        ring->init(capacityFrames);
+    }
+
+    ~OwnedRing()
+    {
+        ring->~StereoRing();
+        std::free(ring);
+    }
+
+    OwnedRing(const OwnedRing&) = delete;
+    OwnedRing& operator=(const OwnedRing&) = delete;
+
+    StereoRing* operator->() { return ring; }
+    StereoRing& operator*() { return *ring; }
+};
+
+} // namespace flux
@@ -0,0 +1,298 @@
+// RateBench: FLX4 at 44.1 kHz against Push at 48 kHz — one variable-ratio
+// converter doing the whole rate change vs a fixed 160 / 147 stage plus a
+// converter that only corrects drift.
+//
+// Both ways round, as the engine runs them:
+//
+//   up    44.1 → 48 kHz (FLX4 input, cue): stage first, then the converter
+//   down  48 → 44.1 kHz (FLX4 output): converter first, then the stage
+//
+// with the ratio drifting around the nominal one by 100 ± 20 ppm. For each
+// polyphase quality (the stage takes the converter's), and libsamplerate's
+// where built, reports:
+//
+//   cost   ns per output frame streaming stereo in 256-frame blocks, best
+//          of three passes
+//   SNR    at 1, 10 and 19 kHz: the output least-squares fitted with a sine
+//          at the tone's frequency; the rest is noise
+//   alias  down only: a 23 kHz tone, above 44.1 kHz's Nyquist, should come
+//          out as nothing — its output level in dB relative to the input's
+//
+// The single-stage polyphase converter's cutoff is fixed below the input's
+// Nyquist — it was built for ratios near 1 — so on the way down the alias
+// column is its failure, not its cost.
+//
+// Usage: flux_bench_rates [seconds-of-audio-per-pass]
+
+#include "Constants.h"
+#include "PolyphaseResampler.h"
+#include "RationalResampler.h"
+#include "Resampler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace flux;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double   kFLX4Rate = 44100.0;
+constexpr double   kPushRate = 48000.0;
+constexpr uint32_t kBlock = 256;
+constexpr uint32_t kChunk = 1024;
+
+double drifting(uint64_t n)
+{
+    return 1.0 + 100e-6 + 20e-6 * std::sin(static_cast<double>(n) * 0.01);
+}
+
+void sine(std::vector<float>& buf, uint64_t frames, double hz, double rate)
+{
+    buf.resize(frames * kChannelsPerDevice);
+    for (uint64_t i = 0; i < frames; ++i) {
+        auto v = static_cast<float>(0.5 * std::sin(2.0 * M_PI * hz * static_cast<double>(i) / rate));
+        buf[i * 2] = v;
+        buf[i * 2 + 1] = v;
+    }
+}
+
+// Everything `frames` input frames make through rs at ratio; returns frames
+// written to out.
+uint32_t drain(Resampler& rs, const float* in, uint32_t frames, double ratio, float* out)
+{
+    auto room = static_cast<uint32_t>(frames * ratio + 8);
+    uint32_t produced = 0;
+    while (frames > 0) {
+        uint32_t used = 0;
+        produced += rs.process(in, frames, out + produced * 2, room - produced, ratio, &used);
+        in += used * 2;
+        frames -= used;
+        if (used == 0) break;
+    }
+    return produced;
+}
+
+// One way of getting a stream from one rate to the other.
+struct Path {
+    virtual ~Path() = default;
+    // Convert one block at `ratio` (output / input, nominal included).
+    // Returns frames appended to out.
+    virtual uint32_t block(const float* in, uint32_t frames, double ratio, float* out) = 0;
+};
+
+// One variable-ratio converter for the whole ratio.
+struct SinglePath : Path {
+    std::unique_ptr<Resampler> rs;
+    explicit SinglePath(std::unique_ptr<Resampler> r) : rs(std::move(r)) {}
+
+    uint32_t block(const float* in, uint32_t frames, double ratio, float* out) override
+    {
+        return drain(*rs, in, frames, ratio, out);
+    }
+};
+
+// Fixed stage and drift converter, in the engine's order for the direction.
+struct TwoStagePath : Path {
+    std::unique_ptr<RationalResampler> stage;
+    std::unique_ptr<Resampler>         drift;
+    bool                               stageFirst;
+    std::vector<float>                 scratch;
+
+    TwoStagePath(std::unique_ptr<RationalResampler> s, std::unique_ptr<Resampler> d, bool first)
+        : stage(std::move(s)), drift(std::move(d)), stageFirst(first)
+        , scratch(static_cast<size_t>(kChunk + 64) * 2)
+    {
+    }
+
+    uint32_t block(const float* in, uint32_t frames, double ratio, float* out) override
+    {
+        double driftRatio = ratio / stage->ratio();
+        uint32_t produced = 0;
+        uint32_t used = 0;
+        if (stageFirst) {
+            while (frames > 0) {
+                uint32_t staged = stage->process(in, frames, scratch.data(), kChunk, &used);
+                in += used * 2;
+                frames -= used;
+                produced += drain(*drift, scratch.data(), staged, driftRatio, out + produced * 2);
+                if (used == 0 && staged == 0) break;
+            }
+        } else {
+            while (frames > 0) {
+                auto room = static_cast<uint32_t>(std::min<double>(frames * driftRatio + 8, kChunk));
+                uint32_t made = drift->process(in, frames, scratch.data(), room, driftRatio, &used);
+                in += used * 2;
+                frames -= used;
+                uint32_t taken = 0;
+                produced += stage->process(scratch.data(), made, out + produced * 2,
+                                           stage->outputFor(made), &taken);
+                if (used == 0 && made == 0) break;
+            }
+        }
+        return produced;
+    }
+};
+
+struct Candidate {
+    std::string name;
+    std::function<std::unique_ptr<Path>(bool up)> make;
+};
+
+std::vector<Candidate> candidates()
+{
+    std::vector<Candidate> list;
+    for (uint32_t q = 0; q < kResamplerQualityCount; ++q) {
+        auto quality = static_cast<ResamplerQuality>(q);
+        std::string name = resamplerTierName({kResamplerPolyphase, quality});
+        list.push_back({name + " single", [quality](bool) {
+            return std::unique_ptr<Path>(new SinglePath(
+                std::make_unique<PolyphaseResampler>(quality)));
+        }});
+        list.push_back({name + " two-stage", [quality](bool up) {
+            auto stage = up ? RationalResampler::make(kFLX4Rate, kPushRate, quality)
+                            : RationalResampler::make(kPushRate, kFLX4Rate, quality);
+            return std::unique_ptr<Path>(new TwoStagePath(
+                std::move(stage), std::make_unique<PolyphaseResampler>(quality), up));
+        }});
+    }
+    for (uint32_t q = 0; q < kResamplerQualityCount; ++q) {
+        ResamplerTier tier{kResamplerSamplerate, static_cast<ResamplerQuality>(q)};
+        if (!makeResampler(tier, kChannelsPerDevice)) continue;
+        list.push_back({std::string(resamplerTierName(tier)) + " single", [tier](bool) {
+            return std::unique_ptr<Path>(new SinglePath(makeResampler(tier, kChannelsPerDevice)));
+        }});
+        list.push_back({std::string(resamplerTierName(tier)) + " two-stage", [tier](bool up) {
+            auto stage = up ? RationalResampler::make(kFLX4Rate, kPushRate, tier.quality)
+                            : RationalResampler::make(kPushRate, kFLX4Rate, tier.quality);
+            return std::unique_ptr<Path>(new TwoStagePath(
+                std::move(stage), makeResampler(tier, kChannelsPerDevice), up));
+        }});
+    }
+    return list;
+}
+
+// Stream `in` through the path in kBlock blocks; nominal ratio drifting.
+uint64_t stream(Path& path, const std::vector<float>& in, double nominal,
+                const std::function<double(uint64_t)>& drift, std::vector<float>& out)
+{
+    uint64_t inFrames = in.size() / 2;
+    out.resize(static_cast<size_t>((inFrames * nominal) * 1.01 + 4096) * 2);
+    uint64_t produced = 0;
+    uint64_t n = 0;
+    for (uint64_t offset = 0; offset + kBlock <= inFrames; offset += kBlock, ++n) {
+        produced += path.block(in.data() + offset * 2, kBlock, nominal * drift(n),
+                               out.data() + produced * 2);
+    }
+    return produced;
+}
+
+// SNR (dB) of the left channel from `skip` on, against the best-fitting
+// a sin + b cos + c at angular frequency w (radians per output frame).
+double fitSnr(const std::vector<float>& out, uint64_t frames, uint64_t skip, double w)
+{
+    double m[3][3] = {}, v[3] = {};
+    for (uint64_t i = skip; i < frames; ++i) {
+        double basis[3] = {std::sin(w * i), std::cos(w * i), 1.0};
+        double y = out[i * 2];
+        for (int r = 0; r < 3; ++r) {
+            v[r] += basis[r] * y;
+            for (int col = 0; col < 3; ++col) m[r][col] += basis[r] * basis[col];
+        }
+    }
+    for (int p = 0; p < 3; ++p) {
+        for (int r = p + 1; r < 3; ++r) {
+            double f = m[r][p] / m[p][p];
+            for (int col = p; col < 3; ++col) m[r][col] -= f * m[p][col];
+            v[r] -= f * v[p];
+        }
+    }
+    double x[3];
+    for (int r = 2; r >= 0; --r) {
+        double sum = v[r];
+        for (int col = r + 1; col < 3; ++col) sum -= m[r][col] * x[col];
+        x[r] = sum / m[r][r];
+    }
+
+    double signal = 0.0, noise = 0.0;
+    for (uint64_t i = skip; i < frames; ++i) {
+        double fit = x[0] * std::sin(w * i) + x[1] * std::cos(w * i) + x[2];
+        double e = out[i * 2] - fit;
+        signal += fit * fit;
+        noise += e * e;
+    }
+    return noise > 0.0 ? 10.0 * std::log10(signal / noise) : 999.0;
+}
+
+void run(const Candidate& c, bool up, double seconds)
+{
+    double inRate = up ? kFLX4Rate : kPushRate;
+    double nominal = up ? kPushRate / kFLX4Rate : kFLX4Rate / kPushRate;
+    std::vector<float> in, out;
+
+    // Cost, with the drifting ratio.
+    sine(in, static_cast<uint64_t>(seconds * inRate), 997.0, inRate);
+    double bestNs = 1e30;
+    for (int pass = 0; pass < 3; ++pass) {
+        auto path = c.make(up);
+        auto t0 = Clock::now();
+        uint64_t produced = stream(*path, in, nominal, drifting, out);
+        auto t1 = Clock::now();
+        bestNs = std::min(bestNs, std::chrono::duration<double, std::nano>(t1 - t0).count()
+                                  / static_cast<double>(produced));
+    }
+    std::printf("%-28s %-5s %7.1f", c.name.c_str(), up ? "up" : "down", bestNs);
+
+    // Quality, at a fixed ratio.
+    constexpr double kDrift = 1.0 + 100e-6;
+    auto fixed = [](uint64_t) { return kDrift; };
+    double outRate = inRate * nominal * kDrift;
+    for (double hz : {1000.0, 10000.0, 19000.0}) {
+        sine(in, static_cast<uint64_t>(2.0 * inRate), hz, inRate);
+        auto path = c.make(up);
+        uint64_t produced = stream(*path, in, nominal, fixed, out);
+        std::printf(" %8.1f", fitSnr(out, produced, 4800, 2.0 * M_PI * hz / outRate));
+    }
+
+    if (!up) {
+        sine(in, static_cast<uint64_t>(2.0 * inRate), 23000.0, inRate);
+        auto path = c.make(up);
+        uint64_t produced = stream(*path, in, nominal, fixed, out);
+        double power = 0.0;
+        for (uint64_t i = 4800; i < produced; ++i) power += out[i * 2] * out[i * 2];
+        power /= static_cast<double>(produced - 4800);
+        std::printf(" %8.1f", 10.0 * std::log10(std::max(power, 1e-30) / 0.125));
+    } else {
+        std::printf(" %8s", "-");
+    }
+    std::printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    double seconds = argc > 1 ? std::atof(argv[1]) : 10.0;
+    if (seconds <= 0) {
+        std::fprintf(stderr, "usage: %s [seconds-of-audio-per-pass]\n", argv[0]);
+        return 1;
+    }
+
+    std::printf("44.1 <-> 48 kHz, %.0f s of audio per pass, %u-frame blocks, %s kernel\n\n",
+                seconds, kBlock, polyphaseKernelName(bestPolyphaseKernel()));
+    std::printf("%-28s %-5s %7s %8s %8s %8s %8s\n",
+                "converter", "way", "ns", "1k dB", "10k dB", "19k dB", "alias dB");
+    for (const auto& c : candidates()) {
+        for (bool up : {true, false}) run(c, up, seconds);
+    }
+    return 0;
+}
@@ -0,0 +1,332 @@
+// ResamplerBench: cost and quality of each resampler the engine can run.
+//
+// For every converter tier built into this binary — libsamplerate (macOS
+// builds) at each quality, the polyphase resampler at each quality with
+// each SIMD kernel this CPU supports, cubic and linear — reports:
+//
+//   cost   ns and TSC cycles (x86 only) per output frame, streaming stereo
+//          at several buffer sizes with the ratio drifting around 1 + 100
+//          ppm, as the servoed engine runs it. Best of three passes.
+//   SNR    for a sine at several frequencies at a fixed 1 + 100 ppm ratio:
+//          the output is least-squares fitted with a sine at the expected
+//          frequency; everything the fit doesn't explain (aliasing, imaging,
+//          interpolation error) is noise. With the tier's group delay — the
+//          latency it adds to its stream.
+//   batch  polyphase only: two and four stereo streams at one drifting
+//          ratio, each through its own converter vs all through one
+//          processStreams() pass, 256-frame blocks. ns per output frame
+//          per stream, and the largest difference between the two ways'
+//          outputs — only the kernels' summation order should differ.
+//
+// Usage: flux_bench_resampler [seconds-of-audio-per-pass]
+
+#include "Constants.h"
+#include "PolyphaseResampler.h"
+#include "Resampler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <x86intrin.h>
+#define FLUX_BENCH_TSC 1
+#endif
+
+using namespace flux;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Candidate {
+    std::string name;
+    std::function<std::unique_ptr<Resampler>()> make;
+};
+
+std::vector<Candidate> candidates()
+{
+    std::vector<Candidate> list;
+    for (uint32_t q = 0; q < kResamplerQualityCount; ++q) {
+        ResamplerTier tier{kResamplerSamplerate, static_cast<ResamplerQuality>(q)};
+        if (!makeResampler(tier, kChannelsPerDevice)) continue;
+        list.push_back({resamplerTierName(tier), [tier] {
+            return makeResampler(tier, kChannelsPerDevice);
+        }});
+    }
+    for (uint32_t q = 0; q < kResamplerQualityCount; ++q) {
+        auto quality = static_cast<ResamplerQuality>(q);
+        ResamplerTier tier{kResamplerPolyphase, quality};
+        for (uint32_t k = 0; k < kKernelCount; ++k) {
+            auto kernel = static_cast<PolyphaseKernel>(k);
+            if (!polyphaseKernelSupported(kernel)) continue;
+            list.push_back({std::string(resamplerTierName(tier)) + "/" + polyphaseKernelName(kernel),
+                            [quality, kernel] {
+                return std::unique_ptr<Resampler>(new PolyphaseResampler(quality, kernel));
+            }});
+        }
+    }
+    for (ResamplerKind kind : {kResamplerCubic, kResamplerLinear}) {
+        list.push_back({resamplerName(kind), [kind] {
+            return makeResampler({kind, kResamplerMedium}, kChannelsPerDevice);
+        }});
+    }
+    return list;
+}
+
+void sine(std::vector<float>& buf, uint64_t frames, double hz)
+{
+    buf.resize(frames * kChannelsPerDevice);
+    for (uint64_t i = 0; i < frames; ++i) {
+        auto v = static_cast<float>(0.5 * std::sin(2.0 * M_PI * hz * static_cast<double>(i)
+                                                   / kNominalSampleRate));
+        buf[i * 2] = v;
+        buf[i * 2 + 1] = v;
+    }
+}
+
+// Stream `in` through the resampler in blocks of `block` input frames.
+// ratioAt(n) gives the ratio for block n. Returns output frames.
+uint64_t stream(Resampler& rs, const std::vector<float>& in, uint32_t block,
+                const std::function<double(uint64_t)>& ratioAt, std::vector<float>& out)
+{
+    uint64_t inFrames = in.size() / 2;
+    out.resize((inFrames + inFrames / 100 + 1024) * 2);
+
+    uint64_t produced = 0;
+    uint64_t n = 0;
+    for (uint64_t offset = 0; offset + block <= inFrames; offset += block, ++n) {
+        const float* src = in.data() + offset * 2;
+        uint32_t left = block;
+        double ratio = ratioAt(n);
+        auto room = static_cast<uint32_t>(block * ratio + 8);
+        while (left > 0) {
+            uint32_t used = 0;
+            produced += rs.process(src, left, out.data() + produced * 2, room, ratio, &used);
+            src += used * 2;
+            left -= used;
+            if (used == 0) break;
+        }
+    }
+    return produced;
+}
+
+// ---- Cost ----
+
+void cost(const Candidate& c, const std::vector<uint32_t>& blocks, double seconds)
+{
+    std::vector<float> in, out;
+    sine(in, static_cast<uint64_t>(seconds * kNominalSampleRate), 997.0);
+    auto drifting = [](uint64_t n) {
+        return 1.0 + 100e-6 + 20e-6 * std::sin(static_cast<double>(n) * 0.01);
+    };
+
+    std::printf("%-24s", c.name.c_str());
+    for (uint32_t block : blocks) {
+        double bestNs = 1e30, bestCycles = 1e30;
+        for (int pass = 0; pass < 3; ++pass) {
+            auto rs = c.make();
+#ifdef FLUX_BENCH_TSC
+            uint64_t c0 = __rdtsc();
+#endif
+            auto t0 = Clock::now();
+            uint64_t produced = stream(*rs, in, block, drifting, out);
+            auto t1 = Clock::now();
+#ifdef FLUX_BENCH_TSC
+            uint64_t c1 = __rdtsc();
+            bestCycles = std::min(bestCycles, static_cast<double>(c1 - c0) / produced);
+#endif
+            double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+            bestNs = std::min(bestNs, ns / static_cast<double>(produced));
+        }
+#ifdef FLUX_BENCH_TSC
+        std::printf(" %7.1f %6.0f", bestNs, bestCycles);
+#else
+        std::printf(" %7.1f %6s", bestNs, "-");
+#endif
+    }
+    std::printf("\n");
+}
+
+// ---- Quality ----
+
+// SNR (dB) of the left channel from `skip` on, against the best-fitting
+// a sin + b cos + c at angular frequency w (radians per output frame).
+double fitSnr(const std::vector<float>& out, uint64_t frames, uint64_t skip, double w)
+{
+    // Normal equations for [sin, cos, 1].
+    double m[3][3] = {}, v[3] = {};
+    for (uint64_t i = skip; i < frames; ++i) {
+        double basis[3] = {std::sin(w * i), std::cos(w * i), 1.0};
+        double y = out[i * 2];
+        for (int r = 0; r < 3; ++r) {
+            v[r] += basis[r] * y;
+            for (int col = 0; col < 3; ++col) m[r][col] += basis[r] * basis[col];
+        }
+    }
+    // Gaussian elimination, 3x3.
+    for (int p = 0; p < 3; ++p) {
+        for (int r = p + 1; r < 3; ++r) {
+            double f = m[r][p] / m[p][p];
+            for (int col = p; col < 3; ++col) m[r][col] -= f * m[p][col];
+            v[r] -= f * v[p];
+        }
+    }
+    double x[3];
+    for (int r = 2; r >= 0; --r) {
+        double sum = v[r];
+        for (int col = r + 1; col < 3; ++col) sum -= m[r][col] * x[col];
+        x[r] = sum / m[r][r];
+    }
+
+    double signal = 0.0, noise = 0.0;
+    for (uint64_t i = skip; i < frames; ++i) {
+        double fit = x[0] * std::sin(w * i) + x[1] * std::cos(w * i) + x[2];
+        double e = out[i * 2] - fit;
+        signal += fit * fit;
+        noise += e * e;
+    }
+    return noise > 0.0 ? 10.0 * std::log10(signal / noise) : 999.0;
+}
+
+void quality(const Candidate& c, const std::vector<double>& tones)
+{
+    constexpr double kRatio = 1.0 + 100e-6;
+    std::vector<float> in, out;
+
+    std::printf("%-24s", c.name.c_str());
+    for (double hz : tones) {
+        sine(in, static_cast<uint64_t>(2.0 * kNominalSampleRate), hz);
+        auto rs = c.make();
+        uint64_t produced = stream(*rs, in, 256, [](uint64_t) { return kRatio; }, out);
+        double w = 2.0 * M_PI * hz / (kNominalSampleRate * kRatio);
+        std::printf(" %8.1f", fitSnr(out, produced, 4800, w));
+    }
+    std::printf(" %8u\n", c.make()->groupDelay());
+}
+
+// ---- Batch ----
+
+struct BatchResult {
+    double separateNs = 0.0;    // Per output frame per stream
+    double batchNs = 0.0;
+    float  maxDiff = 0.0f;
+};
+
+BatchResult batch(ResamplerQuality quality, PolyphaseKernel kernel, uint32_t streams,
+                  double seconds)
+{
+    constexpr uint32_t kBlock = 256;
+    auto frames = static_cast<uint64_t>(seconds * kNominalSampleRate);
+    std::vector<std::vector<float>> in(streams);
+    for (uint32_t s = 0; s < streams; ++s) sine(in[s], frames, 997.0 + 211.0 * s);
+    auto drifting = [](uint64_t n) {
+        return 1.0 + 100e-6 + 20e-6 * std::sin(static_cast<double>(n) * 0.01);
+    };
+
+    std::vector<std::vector<float>> separate(streams), batched(streams);
+    for (uint32_t s = 0; s < streams; ++s) batched[s].resize((frames + frames / 100 + 1024) * 2);
+
+    BatchResult r{1e30, 1e30, 0.0f};
+    uint64_t produced = 0, producedBatch = 0;
+    for (int pass = 0; pass < 3; ++pass) {
+        auto t0 = Clock::now();
+        for (uint32_t s = 0; s < streams; ++s) {
+            PolyphaseResampler rs(quality, kernel);
+            produced = stream(rs, in[s], kBlock, drifting, separate[s]);
+        }
+        auto t1 = Clock::now();
+
+        PolyphaseResampler rs(quality, kernel, streams * 2);
+        const float* src[kPolyphaseMaxChannels / 2];
+        float* dst[kPolyphaseMaxChannels / 2];
+        producedBatch = 0;
+        uint64_t n = 0;
+        for (uint64_t offset = 0; offset + kBlock <= frames; offset += kBlock, ++n) {
+            uint32_t left = kBlock;
+            double ratio = drifting(n);
+            auto room = static_cast<uint32_t>(kBlock * ratio + 8);
+            uint64_t at = offset;
+            while (left > 0) {
+                for (uint32_t s = 0; s < streams; ++s) {
+                    src[s] = in[s].data() + at * 2;
+                    dst[s] = batched[s].data() + producedBatch * 2;
+                }
+                uint32_t used = 0;
+                producedBatch += rs.processStreams(src, left, dst, room, ratio, &used);
+                at += used;
+                left -= used;
+                if (used == 0) break;
+            }
+        }
+        auto t2 = Clock::now();
+
+        double perFrame = static_cast<double>(produced) * streams;
+        r.separateNs = std::min(r.separateNs,
+                                std::chrono::duration<double, std::nano>(t1 - t0).count() / perFrame);
+        r.batchNs = std::min(r.batchNs,
+                             std::chrono::duration<double, std::nano>(t2 - t1).count() / perFrame);
+    }
+
+    if (producedBatch != produced) r.maxDiff = INFINITY;
+    for (uint32_t s = 0; s < streams && producedBatch == produced; ++s) {
+        for (uint64_t i = 0; i < produced * 2; ++i) {
+            r.maxDiff = std::max(r.maxDiff, std::fabs(separate[s][i] - batched[s][i]));
+        }
+    }
+    return r;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    double seconds = argc > 1 ? std::atof(argv[1]) : 10.0;
+    if (seconds <= 0) {
+        std::fprintf(stderr, "usage: %s [seconds-of-audio-per-pass]\n", argv[0]);
+        return 1;
+    }
+
+    auto list = candidates();
+    const std::vector<uint32_t> blocks = {64, 128, 256, 512, 1024};
+    const std::vector<double> tones = {100.0, 1000.0, 5000.0, 10000.0, 18000.0};
+
+    std::printf("Cost per output frame, stereo, %.0f s of audio per pass, best of 3\n", seconds);
+    std::printf("%-24s", "resampler");
+    for (uint32_t block : blocks) std::printf("  %5u: ns  cyc", block);
+    std::printf("\n");
+    for (const auto& c : list) cost(c, blocks, seconds);
+
+    std::printf("\nSNR (dB) at ratio 1 + 100 ppm, 256-frame blocks\n");
+    std::printf("%-24s", "resampler");
+    for (double hz : tones) std::printf(" %6.0f Hz", hz);
+    std::printf(" %8s\n", "delay");
+    for (const auto& c : list) quality(c, tones);
+
+    std::printf("\nBatch: stereo streams sharing a ratio, separate converters vs one pass,\n"
+                "ns per output frame per stream, 256-frame blocks, best of 3\n");
+    std::printf("%-24s %7s %10s %10s %8s %10s\n",
+                "resampler", "streams", "separate", "batched", "speedup", "max diff");
+    for (uint32_t q = 0; q < kResamplerQualityCount; ++q) {
+        auto quality = static_cast<ResamplerQuality>(q);
+        for (uint32_t k = 0; k < kKernelCount; ++k) {
+            auto kernel = static_cast<PolyphaseKernel>(k);
+            if (!polyphaseKernelSupported(kernel)) continue;
+            std::string name = std::string(resamplerTierName({kResamplerPolyphase, quality}))
+                             + "/" + polyphaseKernelName(kernel);
+            for (uint32_t streams : {2u, 4u}) {
+                BatchResult r = batch(quality, kernel, streams, seconds);
+                std::printf("%-24s %7u %10.2f %10.2f %7.2fx %10.2g\n", name.c_str(), streams,
+                            r.separateNs, r.batchNs, r.separateNs / r.batchNs, r.maxDiff);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,156 @@
+// RingBench: throughput of a modulo FrameRing vs a mirrored one, at typical
+// HAL callback block sizes.
+//
+// Both rings are the FLX4 capture ring of a real region, over the POSIX
+// transport: the producer writes through the helper-side mapping, the
+// consumer reads through a plugin-side one, each with its own second mapping
+// when the layout is mirrored (Transport.h). Block sizes that don't divide
+// the capacity make every few transfers straddle the wrap point, which is
+// where the modulo ring pays for its second memcpy. Each ring's contents are
+// checked across several wraps before it is timed.
+//
+// Usage: flux_bench_ring [megabytes-per-run]
+
+#include "UnixTransport.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace flux;
+
+namespace {
+
+// A region laid out with the default table, served and mapped back in this
+// process, and the FLX4 capture ring as each side sees it.
+class Region {
+public:
+    Region(const std::string& socketPath, bool mirrored)
+        : server_(socketPath), client_(socketPath)
+    {
+        LayoutTable table = defaultLayoutTable();
+        table.mirrored = mirrored;
+        if (!server_.start(table)) return;
+        loop_ = std::thread([this] { server_.runMessageLoop(); });
+        if (!client_.connect()) return;
+
+        int stream = client_.sharedMemory()->findStream(1, kStreamCapture);
+        if (stream < 0) return;
+        producer_ = server_.sharedMemory()->streamRing(static_cast<uint32_t>(stream));
+        consumer_ = client_.ring(static_cast<uint32_t>(stream));
+    }
+
+    ~Region()
+    {
+        client_.disconnect();
+        server_.requestStop();
+        if (loop_.joinable()) loop_.join();
+        server_.stop();
+    }
+
+    bool ok() const { return producer_ && consumer_; }
+    AudioRing& producer() { return *producer_; }
+    AudioRing& consumer() { return *consumer_; }
+
+private:
+    UnixSocketServer server_;
+    UnixSocketClient client_;
+    std::thread      loop_;
+    AudioRing*       producer_ = nullptr;
+    AudioRing*       consumer_ = nullptr;
+};
+
+// Stream numbered frames through the ring, one 441-frame block at a time
+// (never a divisor of the capacity), for a few laps. False on the first
+// sample that comes back wrong.
+bool checkContents(AudioRing& in, AudioRing& out)
+{
+    constexpr uint32_t kFrames = 441;
+    uint32_t channels = in.frameSamples();
+    std::vector<float> src(kFrames * channels);
+    std::vector<float> dst(src.size());
+    uint32_t blocks = 4 * in.capacity / kFrames;
+
+    for (uint32_t b = 0; b < blocks; ++b) {
+        for (size_t i = 0; i < src.size(); ++i) {
+            src[i] = static_cast<float>(b * src.size() + i);
+        }
+        if (!in.write(src.data(), kFrames) || !out.read(dst.data(), kFrames)) return false;
+        if (dst != src) return false;
+    }
+    return true;
+}
+
+double runStream(AudioRing& in, AudioRing& out, uint32_t blockFrames, int64_t totalBytes)
+{
+    std::vector<float> src(blockFrames * in.frameSamples(), 0.5f);
+    std::vector<float> dst(src.size());
+    int64_t blocks = totalBytes / static_cast<int64_t>(blockFrames * in.frameBytes());
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::thread producer([&] {
+        for (int64_t i = 0; i < blocks; ++i) {
+            while (!in.write(src.data(), blockFrames)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    for (int64_t i = 0; i < blocks; ++i) {
+        while (!out.read(dst.data(), blockFrames)) {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    auto t1 = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(t1 - t0).count();
+    double bytes = static_cast<double>(blocks) * blockFrames * in.frameBytes();
+    return bytes / secs / (1024.0 * 1024.0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int64_t megabytes = argc > 1 ? std::atoll(argv[1]) : 512;
+    int64_t totalBytes = megabytes * 1024 * 1024;
+
+    std::string socketPath = "/tmp/flux-bench-ring-" + std::to_string(getpid());
+    Region modulo(socketPath + "-modulo.sock", false);
+    Region mirrored(socketPath + "-mirrored.sock", true);
+    if (!modulo.ok() || !mirrored.ok()) {
+        std::fprintf(stderr, "could not set up the rings\n");
+        return 1;
+    }
+    if (!mirrored.consumer().mirrored) {
+        std::fprintf(stderr, "the FLX4 capture ring didn't come out mirrored\n");
+        return 1;
+    }
+    if (!checkContents(modulo.producer(), modulo.consumer())
+        || !checkContents(mirrored.producer(), mirrored.consumer()))
+    {
+        std::fprintf(stderr, "ring contents came back wrong\n");
+        return 1;
+    }
+
+    std::printf("%lld MB per run, capacity %u frames (%zu bytes), page %ld bytes\n\n",
+                static_cast<long long>(megabytes), mirrored.consumer().capacity,
+                mirrored.consumer().capacity * mirrored.consumer().frameBytes(),
+                sysconf(_SC_PAGESIZE));
+    std::printf("%8s %8s %14s %14s\n", "frames", "bytes", "modulo MB/s", "mirrored MB/s");
+
+    for (uint32_t frames : {64u, 128u, 256u, 441u, 512u, 1024u}) {
+        double split = runStream(modulo.producer(), modulo.consumer(), frames, totalBytes);
+        double mir = runStream(mirrored.producer(), mirrored.consumer(), frames, totalBytes);
+        std::printf("%8u %8zu %14.0f %14.0f\n",
+                    frames, frames * mirrored.consumer().frameBytes(), split, mir);
+    }
+    return 0;
+}
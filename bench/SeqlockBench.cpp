@@ -0,0 +1,166 @@
+// SeqlockBench: torn-read stress test for the published clock record.
+//
+// One writer thread publishes clock points as fast as it can; reader threads
+// read them back and check that every field came from the same publish
+// (host time and seed are derived from the sample time, so a mix of two
+// publishes is detectable). Runs the old shape — independent relaxed
+// atomics, as ClockData used to be — and the Seqlock<ClockSnapshot> the
+// helper publishes now.
+//
+// Expected: "atomics" reports torn reads (more with spare cores, fewer on a
+// single core where only preemption mid-publish can tear); "seqlock" reports
+// none.
+//
+// Usage: flux_bench_seqlock [seconds-per-variant] [readers]
+
+#include "SharedMemory.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace flux;
+
+namespace {
+
+// Field relationships for publish n.
+double   sampleTimeOf(uint64_t n) { return static_cast<double>(n) * 512.0; }
+uint64_t hostTimeOf(uint64_t n)   { return n * 10667 + 7; }
+uint64_t seedOf(uint64_t n)       { return n / 3; }
+
+bool consistent(double sampleTime, uint64_t hostTime, uint64_t seed)
+{
+    auto n = static_cast<uint64_t>(sampleTime / 512.0);
+    return hostTime == hostTimeOf(n) && seed == seedOf(n);
+}
+
+// The pre-seqlock ClockData: three independent relaxed atomics.
+struct AtomicsClock {
+    std::atomic<double>   sampleTime{0.0};
+    std::atomic<uint64_t> hostTime{hostTimeOf(0)};
+    std::atomic<uint64_t> seed{0};
+
+    void publish(uint64_t n)
+    {
+        sampleTime.store(sampleTimeOf(n), std::memory_order_relaxed);
+        hostTime.store(hostTimeOf(n), std::memory_order_relaxed);
+        seed.store(seedOf(n), std::memory_order_relaxed);
+    }
+
+    bool read(double* s, uint64_t* h, uint64_t* d) const
+    {
+        *s = sampleTime.load(std::memory_order_relaxed);
+        *h = hostTime.load(std::memory_order_relaxed);
+        *d = seed.load(std::memory_order_relaxed);
+        return true;
+    }
+};
+
+struct SeqlockClock {
+    Seqlock<ClockSnapshot> clock;
+
+    SeqlockClock() { publish(0); }
+
+    void publish(uint64_t n)
+    {
+        ClockSnapshot snap;
+        snap.sampleTime = sampleTimeOf(n);
+        snap.hostTime = hostTimeOf(n);
+        snap.seed = seedOf(n);
+        clock.store(snap);
+    }
+
+    bool read(double* s, uint64_t* h, uint64_t* d) const
+    {
+        ClockSnapshot snap;
+        if (!clock.tryLoad(&snap)) return false;
+        *s = snap.sampleTime;
+        *h = snap.hostTime;
+        *d = snap.seed;
+        return true;
+    }
+};
+
+struct Result {
+    uint64_t publishes = 0;
+    uint64_t reads = 0;
+    uint64_t retries = 0;   // tryLoad gave up (seqlock only)
+    uint64_t torn = 0;
+};
+
+template <typename Clock>
+Result stress(double seconds, int readers)
+{
+    Clock clock;
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> reads{0}, retries{0}, torn{0};
+
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; ++r) {
+        threads.emplace_back([&] {
+            uint64_t myReads = 0, myRetries = 0, myTorn = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                double s;
+                uint64_t h, d;
+                if (!clock.read(&s, &h, &d)) {
+                    ++myRetries;
+                    continue;
+                }
+                ++myReads;
+                if (!consistent(s, h, d)) ++myTorn;
+            }
+            reads += myReads;
+            retries += myRetries;
+            torn += myTorn;
+        });
+    }
+
+    Result result;
+    auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+    uint64_t n = 0;
+    while (std::chrono::steady_clock::now() < end) {
+        for (int i = 0; i < 1024; ++i) clock.publish(++n);
+    }
+    stop = true;
+    for (auto& t : threads) t.join();
+
+    result.publishes = n;
+    result.reads = reads;
+    result.retries = retries;
+    result.torn = torn;
+    return result;
+}
+
+void print(const char* name, const Result& r)
+{
+    std::printf("%-8s %14llu %14llu %10llu %10llu\n", name,
+                static_cast<unsigned long long>(r.publishes),
+                static_cast<unsigned long long>(r.reads),
+                static_cast<unsigned long long>(r.retries),
+                static_cast<unsigned long long>(r.torn));
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    double seconds = argc > 1 ? std::atof(argv[1]) : 2.0;
+    int readers = argc > 2 ? std::atoi(argv[2]) : 2;
+    if (seconds <= 0 || readers <= 0) {
+        std::fprintf(stderr, "usage: %s [seconds-per-variant] [readers]\n", argv[0]);
+        return 1;
+    }
+
+    std::printf("%.1f s per variant, 1 writer, %d readers\n\n", seconds, readers);
+    std::printf("%-8s %14s %14s %10s %10s\n", "variant", "publishes", "reads", "retries", "torn");
+
+    Result atomics = stress<AtomicsClock>(seconds, readers);
+    print("atomics", atomics);
+    Result seqlock = stress<SeqlockClock>(seconds, readers);
+    print("seqlock", seqlock);
+
+    return seqlock.torn == 0 ? 0 : 1;
+}
@@ -0,0 +1,224 @@
+// ServoSim: headless simulation of the FLX4 output path's latency servo.
+//
+// Two free-running clocks, as on the real rig: the plugin writes Push-clock
+// blocks into the ring a little ahead of their HAL output time and stamps
+// them with it; the helper's FLX4 IOProc drains the ring through the
+// resampler at the FLX4 clock. The resampler's ratio is the DLL estimate —
+// true ratio times a bias (the error the servo exists for) plus
+// per-callback noise — trimmed by a FillServo that holds the stream's
+// latency (Push output time + group delay - Push stamp of the ring's oldest
+// frame, read through host timestamps with a little jitter) at
+// kSlaveStreamLatency.
+//
+// Latency rather than raw fill: the two IOProcs run at nearly the same
+// period, so the fill a callback sees carries the producer's phase — up to
+// a block, drifting over minutes at a few ppm apart. A servo on raw fill
+// chases that phase. The stamps don't have it.
+//
+// Each scenario runs open loop (DLL ratio only, as before the servo) and
+// closed loop, and reports:
+//   converge  time until the 1 s mean latency error stays within ±16 frames
+//   mean/std  latency error over the second half of the run
+//   min/max   ring fill over the whole run
+//   xrun      consumer callbacks that found the ring short (underrun) plus
+//             producer blocks that didn't fit (overrun)
+//   corr      largest |correction| (ppm) the servo applied
+//
+// The input rings are the mirror image (error = the timeline error left by
+// FrameRing::alignTo), so the same dynamics apply there.
+//
+// Usage: flux_sim_servo [seconds]
+
+#include "Constants.h"
+#include "FillServo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace flux;
+
+namespace {
+
+constexpr uint32_t kBlock     = 256;     // Both sides' HAL buffer (frames)
+constexpr uint32_t kCapacity  = kSlaveRingFrames;
+constexpr double   kTarget    = kSlaveStreamLatency;
+constexpr double   kWriteLead = kBlock + 4;      // Plugin writes this far ahead (buffer + safety offset)
+constexpr double   kStampJitter = 0.5;           // Host-time → Push-time noise (frames, 1 sigma)
+
+struct Scenario {
+    const char* name;
+    double pushPpm;         // Push crystal vs nominal
+    double flx4Ppm;         // FLX4 crystal vs nominal
+    double biasPpm;         // DLL ratio error
+    double noisePpm;        // DLL ratio noise (per callback, 1 sigma)
+    double startOffset;     // Latency error when the consumer starts (frames)
+    double stepAt;          // Seconds; bias jumps by stepPpm then (0 = never)
+    double stepPpm;
+};
+
+struct Result {
+    double   convergeSeconds = -1.0;   // -1: never
+    double   meanError = 0.0;
+    double   stdError = 0.0;
+    double   minFill = 1e9;
+    double   maxFill = 0.0;
+    uint64_t xruns = 0;
+    double   maxCorrectionPpm = 0.0;
+};
+
+Result simulate(const Scenario& sc, double seconds, bool servoOn)
+{
+    const double pushRate = kNominalSampleRate * (1.0 + sc.pushPpm * 1e-6);
+    const double flx4Rate = kNominalSampleRate * (1.0 + sc.flx4Ppm * 1e-6);
+    const double trueRatio = flx4Rate / pushRate;     // Output / input
+
+    std::mt19937 rng(1234);
+    std::normal_distribution<double> ratioNoise(0.0, sc.noisePpm * 1e-6);
+    std::normal_distribution<double> stampNoise(0.0, kStampJitter);
+
+    FillServo servo(kNominalSampleRate);
+
+    // Ring positions in frames. Frame n carries Push stamp n + kWriteLead.
+    // The resampler consumes a non-integer number of frames per callback.
+    double written = 0.0, consumed = 0.0;
+    double tPush = 0.0, tFlx4 = 0.0;
+    const double pushPeriod = kBlock / pushRate;
+    const double flx4Period = kBlock / flx4Rate;
+    bool started = false;
+
+    // Per-second means of the error, for convergence.
+    std::vector<double> secondMeans;
+    double secondSum = 0.0;
+    uint64_t secondCount = 0;
+    double nextSecond = 1.0;
+
+    double sum = 0.0, sumSq = 0.0;
+    uint64_t n = 0;
+
+    Result r;
+    while (tFlx4 < seconds) {
+        if (tPush <= tFlx4) {
+            // Plugin writes one Push block.
+            if (written - consumed + kBlock > kCapacity) {
+                ++r.xruns;
+            } else {
+                written += kBlock;
+            }
+            tPush += pushPeriod;
+            continue;
+        }
+
+        // Helper's FLX4 callback: measure latency, servo, resample.
+        double pushNow = tFlx4 * pushRate + stampNoise(rng);
+        double latency = pushNow + kResamplerGroupDelay - (consumed + kWriteLead);
+        double error = latency - kTarget;
+        tFlx4 += flx4Period;
+
+        // Hold off until the stream has its latency (plus the scenario's
+        // deliberate start error), like the engine's priming.
+        if (!started) {
+            if (error < sc.startOffset) continue;
+            started = true;
+        }
+
+        double fill = written - consumed;
+        r.minFill = std::min(r.minFill, fill);
+        r.maxFill = std::max(r.maxFill, fill);
+
+        double bias = sc.biasPpm + (sc.stepAt > 0 && tFlx4 >= sc.stepAt ? sc.stepPpm : 0.0);
+        double ratio = trueRatio * (1.0 + bias * 1e-6 + ratioNoise(rng));
+        if (servoOn) {
+            servo.update(error, kBlock);
+            ratio = servo.apply(ratio);
+            r.maxCorrectionPpm = std::max(r.maxCorrectionPpm,
+                                          std::fabs(servo.correction()) * 1e6);
+        }
+
+        double needed = kBlock / ratio;
+        if (needed > fill) {
+            ++r.xruns;
+            consumed = written;
+        } else {
+            consumed += needed;
+        }
+
+        secondSum += error;
+        ++secondCount;
+        if (tFlx4 >= seconds / 2) {
+            sum += error;
+            sumSq += error * error;
+            ++n;
+        }
+        if (tFlx4 >= nextSecond) {
+            secondMeans.push_back(secondSum / static_cast<double>(secondCount));
+            secondSum = 0.0;
+            secondCount = 0;
+            nextSecond += 1.0;
+        }
+    }
+
+    // Converged at the start of the last run of in-band seconds that lasts
+    // to the end.
+    size_t settled = secondMeans.size();
+    while (settled > 0 && std::fabs(secondMeans[settled - 1]) <= 16.0) --settled;
+    if (settled < secondMeans.size()) r.convergeSeconds = static_cast<double>(settled);
+
+    if (n > 0) {
+        r.meanError = sum / static_cast<double>(n);
+        r.stdError = std::sqrt(std::max(0.0, sumSq / static_cast<double>(n)
+                                             - r.meanError * r.meanError));
+    }
+    return r;
+}
+
+void print(const char* name, const char* mode, const Result& r)
+{
+    char converge[16];
+    if (r.convergeSeconds < 0) {
+        std::snprintf(converge, sizeof(converge), "never");
+    } else {
+        std::snprintf(converge, sizeof(converge), "%.0f s", r.convergeSeconds);
+    }
+    std::printf("%-22s %-6s %9s %9.1f %8.1f %8.0f %8.0f %6llu %7.1f\n",
+                name, mode, converge, r.meanError, r.stdError, r.minFill, r.maxFill,
+                static_cast<unsigned long long>(r.xruns), r.maxCorrectionPpm);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    double seconds = argc > 1 ? std::atof(argv[1]) : 180.0;
+    if (seconds <= 0) {
+        std::fprintf(stderr, "usage: %s [seconds]\n", argv[0]);
+        return 1;
+    }
+
+    const Scenario scenarios[] = {
+        {"unbiased, jitter only",  20.0, -30.0,    0.0, 3.0,    0.0,  0.0,   0.0},
+        {"bias +20 ppm",           20.0, -30.0,   20.0, 3.0,    0.0,  0.0,   0.0},
+        {"bias -50 ppm",          -10.0,  40.0,  -50.0, 3.0,    0.0,  0.0,   0.0},
+        {"start 400 frames late",  20.0, -30.0,   20.0, 3.0,  400.0,  0.0,   0.0},
+        {"start 400 frames early", 20.0, -30.0,  -20.0, 3.0, -400.0,  0.0,   0.0},
+        {"bias step +40 at 60 s",  20.0, -30.0,   10.0, 3.0,    0.0, 60.0,  40.0},
+    };
+
+    std::printf("%.0f s per run, target latency %.0f frames, %u-frame blocks, %u-frame ring\n\n",
+                seconds, kTarget, kBlock, kCapacity);
+    std::printf("%-22s %-6s %9s %9s %8s %8s %8s %6s %7s\n",
+                "scenario", "mode", "converge", "mean err", "std err",
+                "min fill", "max fill", "xrun", "corr");
+
+    bool ok = true;
+    for (const auto& sc : scenarios) {
+        print(sc.name, "open", simulate(sc, seconds, false));
+        Result closed = simulate(sc, seconds, true);
+        print("", "servo", closed);
+        ok = ok && closed.xruns == 0 && closed.convergeSeconds >= 0;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+// WorkerBench: FLX4 callback duration, conversions inline vs offloaded.
+//
+// Runs the FLX4 IOProc's two conversions — input into the Push domain,
+// output out of it — per simulated callback, the way EngineCore::slaveIO()
+// does:
+//
+//   inline     input, then output, on the callback thread
+//   offloaded  input posted to a WorkerPool thread as a RealtimeJob, output
+//              converted meanwhile, then the job collected — run inline if
+//              no worker had started it (the deadline fallback)
+//
+// for each polyphase quality at several buffer sizes. Callbacks are paced
+// --gap-us apart, so workers go back to sleep between them and every
+// handover pays a real wake-up, as it would between HAL cycles.
+//
+// Reports the callback's duration — median, 99.9th percentile and worst —
+// and for offloaded runs the share of jobs a worker ran. Tries for
+// SCHED_FIFO on Linux (needs privileges) and says whether it got it; on an
+// unprivileged, busy machine the tail is the scheduler's as much as ours.
+// Offloading needs a second core: with one, every job comes back inline
+// and the run measures what the fallback costs.
+//
+// Usage: flux_bench_workers [callbacks] [--gap-us us]
+
+#include "Constants.h"
+#include "PolyphaseResampler.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace flux;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// SCHED_FIFO for the calling thread, if we're allowed.
+bool raisePriority()
+{
+#if defined(__linux__)
+    sched_param param{};
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+#else
+    return false;
+#endif
+}
+
+// One direction of the FLX4 callback: a converter and its buffers.
+struct Conversion {
+    PolyphaseResampler resampler;
+    std::vector<float> in;
+    std::vector<float> out;
+    uint32_t frames = 0;
+    double   ratio = 1.0;
+    uint64_t offset = 0;
+
+    Conversion(ResamplerQuality quality, uint32_t buffer, double hz)
+        : resampler(quality)
+        , out(static_cast<size_t>(buffer + 16) * kChannelsPerDevice)
+        , frames(buffer)
+    {
+        in.resize(static_cast<size_t>(kNominalSampleRate) * kChannelsPerDevice);
+        for (size_t i = 0; i < in.size() / 2; ++i) {
+            auto v = static_cast<float>(0.5 * std::sin(2.0 * M_PI * hz * static_cast<double>(i)
+                                                       / kNominalSampleRate));
+            in[i * 2] = v;
+            in[i * 2 + 1] = v;
+        }
+    }
+
+    static void run(void* context)
+    {
+        auto* c = static_cast<Conversion*>(context);
+        uint64_t inFrames = c->in.size() / 2;
+        if (c->offset + c->frames * 2 > inFrames) c->offset = 0;
+        uint32_t used = 0;
+        c->resampler.process(c->in.data() + c->offset * 2, c->frames * 2,
+                             c->out.data(), c->frames, c->ratio, &used);
+        c->offset += used;
+    }
+};
+
+struct Result {
+    double median = 0.0;
+    double p999 = 0.0;
+    double worst = 0.0;
+    double offloaded = 0.0;     // Share of jobs a worker ran
+};
+
+Result run(ResamplerQuality quality, uint32_t buffer, bool offload,
+           uint32_t callbacks, uint32_t gapUs)
+{
+    Conversion input(quality, buffer, 997.0);
+    Conversion output(quality, buffer, 440.0);
+    RealtimeJob job(&Conversion::run, &input);
+    std::unique_ptr<WorkerPool> pool;
+    if (offload) pool = std::make_unique<WorkerPool>(1, [] { raisePriority(); });
+
+    std::vector<double> us;
+    us.reserve(callbacks);
+    for (uint32_t n = 0; n < callbacks + 50; ++n) {
+        std::this_thread::sleep_for(std::chrono::microseconds(gapUs));
+
+        double drift = 100e-6 + 20e-6 * std::sin(static_cast<double>(n) * 0.01);
+        input.ratio = 1.0 + drift;
+        output.ratio = 1.0 / (1.0 + drift);
+
+        auto t0 = Clock::now();
+        bool posted = pool && pool->post(job);
+        if (!posted) Conversion::run(&input);
+        Conversion::run(&output);
+        if (posted) pool->collect(job);
+        auto t1 = Clock::now();
+
+        if (n >= 50) us.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+    }
+
+    std::sort(us.begin(), us.end());
+    Result r;
+    r.median = us[us.size() / 2];
+    r.p999 = us[std::min(us.size() - 1, us.size() * 999 / 1000)];
+    r.worst = us.back();
+    if (pool) {
+        double total = static_cast<double>(pool->offloaded() + pool->reclaimed());
+        r.offloaded = total > 0.0 ? static_cast<double>(pool->offloaded()) / total : 0.0;
+    }
+    return r;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    uint32_t callbacks = 2000;
+    uint32_t gapUs = 1000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--gap-us" && i + 1 < argc) {
+            gapUs = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else {
+            callbacks = static_cast<uint32_t>(std::atoi(argv[i]));
+        }
+    }
+    if (callbacks == 0) callbacks = 1;
+
+    bool realtime = raisePriority();
+    unsigned cores = std::thread::hardware_concurrency();
+    std::printf("%u callbacks, %u us apart, %s kernel, %s scheduling, %u cores\n",
+                callbacks, gapUs, polyphaseKernelName(bestPolyphaseKernel()),
+                realtime ? "SCHED_FIFO" : "default", cores);
+    if (cores < 2) {
+        std::printf("one core: no worker can run alongside, so every job falls back inline\n");
+    }
+    std::printf("\n");
+    std::printf("%-18s %6s %-10s %9s %9s %9s %9s\n",
+                "tier", "buffer", "mode", "med us", "p99.9 us", "max us", "worker");
+
+    for (uint32_t q = 0; q < kResamplerQualityCount; ++q) {
+        auto quality = static_cast<ResamplerQuality>(q);
+        for (uint32_t buffer : {256u, 1024u, 4096u}) {
+            for (bool offload : {false, true}) {
+                Result r = run(quality, buffer, offload, callbacks, gapUs);
+                std::printf("%-18s %6u %-10s %9.1f %9.1f %9.1f",
+                            resamplerTierName({kResamplerPolyphase, quality}), buffer,
+                            offload ? "offloaded" : "inline", r.median, r.p999, r.worst);
+                if (offload) {
+                    std::printf(" %8.1f%%\n", r.offloaded * 100.0);
+                } else {
+                    std::printf(" %9s\n", "-");
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,284 @@
+#include "CrossfadeResampler.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace flux {
+
+CrossfadeResampler::CrossfadeResampler(std::unique_ptr<Resampler> active, uint32_t channels)
+    : channels_(channels)
+    , active_(std::move(active))
+    , history_(static_cast<size_t>(kHistoryFrames) * channels, 0.0f)
+    , backlog_(static_cast<size_t>(kBacklogFrames) * channels, 0.0f)
+    , queue_(static_cast<size_t>(kQueueFrames) * channels, 0.0f)
+    , scratch_(static_cast<size_t>(kScratchFrames) * channels, 0.0f)
+    , held_(channels, 0.0f)
+{
+}
+
+CrossfadeResampler::~CrossfadeResampler()
+{
+    delete requested_.exchange(nullptr, std::memory_order_acquire);
+    delete retired_.exchange(nullptr, std::memory_order_acquire);
+}
+
+uint32_t CrossfadeResampler::groupDelay() const
+{
+    if (!next_) return active_->groupDelay() + backlogFrames_ + queueFrames_;
+    if (nextLeads_) return next_->groupDelay() - skip_;
+    return active_->groupDelay();
+}
+
+// ---- Control thread ----
+
+void CrossfadeResampler::request(std::unique_ptr<Resampler> next)
+{
+    collect();
+    delete requested_.exchange(next.release(), std::memory_order_acq_rel);
+}
+
+void CrossfadeResampler::collect()
+{
+    delete retired_.exchange(nullptr, std::memory_order_acquire);
+}
+
+// ---- Realtime thread ----
+
+uint32_t CrossfadeResampler::process(const float* in, uint32_t inFrames,
+                                     float* out, uint32_t outFrames,
+                                     double ratio, uint32_t* used)
+{
+    if (next_) return processFade(in, inFrames, out, outFrames, ratio, used);
+
+    uint32_t generated = processActive(in, inFrames, out, outFrames, ratio, used);
+    // Adopt after the call, so the history includes its input.
+    adopt(ratio);
+    return generated;
+}
+
+void CrossfadeResampler::reset()
+{
+    if (next_) {
+        // A fade only starts with the retired slot empty.
+        retired_.store(active_.release(), std::memory_order_release);
+        active_ = std::move(next_);
+        ++switches_;
+    }
+    active_->reset();
+    skip_ = 0;
+    fadePos_ = 0;
+    historyPos_ = 0;
+    historyFill_ = 0;
+    backlogFrames_ = 0;
+    queueFrames_ = 0;
+}
+
+void CrossfadeResampler::adopt(double ratio)
+{
+    if (backlogFrames_ > 0 || queueFrames_ > 0) return;
+    if (retired_.load(std::memory_order_acquire) != nullptr) return;
+    Resampler* requested = requested_.exchange(nullptr, std::memory_order_acq_rel);
+    if (!requested) return;
+    next_.reset(requested);
+
+    // The next frame out carries input from activeDelay frames back. The
+    // replacement, once primed, would start from nextDelay frames back.
+    uint32_t activeDelay = active_->groupDelay();
+    uint32_t nextDelay = next_->groupDelay();
+    nextLeads_ = nextDelay >= activeDelay;
+    skip_ = nextLeads_ ? nextDelay - activeDelay : 0;
+    uint32_t ahead = nextLeads_ ? 0 : activeDelay - nextDelay;
+
+    // Prime it with the recent input, oldest first. A longer replacement
+    // throws the output away and skips skip_ more; a shorter one keeps its
+    // last `ahead` frames, which the active converter hasn't produced yet.
+    uint32_t start = historyFill_ < kHistoryFrames ? 0 : historyPos_;
+    uint32_t first = std::min(historyFill_, kHistoryFrames - start);
+    appendBacklog(history_.data() + static_cast<size_t>(start) * channels_, first);
+    appendBacklog(history_.data(), historyFill_ - first);
+    while (backlogFrames_ > 0) {
+        uint32_t taken = 0;
+        uint32_t got = next_->process(backlog_.data(), backlogFrames_, scratch_.data(),
+                                      kScratchFrames, ratio, &taken);
+        consumeBacklog(taken);
+        uint32_t keep = std::min(got, ahead);
+        uint32_t drop = queueFrames_ + keep > ahead ? queueFrames_ + keep - ahead : 0;
+        popQueue(nullptr, drop);
+        std::memcpy(queue_.data() + static_cast<size_t>(queueFrames_) * channels_,
+                    scratch_.data() + static_cast<size_t>(got - keep) * channels_,
+                    static_cast<size_t>(keep) * channels_ * sizeof(float));
+        queueFrames_ += keep;
+        if (taken == 0 && got == 0) break;
+    }
+    backlogFrames_ = 0;
+    fadePos_ = 0;
+}
+
+void CrossfadeResampler::finish()
+{
+    if (nextLeads_) {
+        // The old converter's input and the output it ran ahead with.
+        backlogFrames_ = 0;
+        queueFrames_ = 0;
+    }
+    // Otherwise both are the replacement's: they go out ahead of it.
+    retired_.store(active_.release(), std::memory_order_release);
+    active_ = std::move(next_);
+    skip_ = 0;
+    fadePos_ = 0;
+    ++switches_;
+}
+
+uint32_t CrossfadeResampler::processActive(const float* in, uint32_t inFrames,
+                                           float* out, uint32_t outFrames,
+                                           double ratio, uint32_t* used)
+{
+    *used = 0;
+
+    // What a shorter replacement ran ahead with goes first: its output,
+    // then the input it trailed by.
+    uint32_t generated = std::min(queueFrames_, outFrames);
+    popQueue(out, generated);
+    if (backlogFrames_ > 0 && generated < outFrames) {
+        uint32_t taken = 0;
+        generated += active_->process(backlog_.data(), backlogFrames_,
+                                      out + static_cast<size_t>(generated) * channels_,
+                                      outFrames - generated, ratio, &taken);
+        consumeBacklog(taken);
+    }
+    if (queueFrames_ > 0 || backlogFrames_ > 0) return generated;
+
+    uint32_t taken = 0;
+    if (generated < outFrames) {
+        generated += active_->process(in, inFrames,
+                                      out + static_cast<size_t>(generated) * channels_,
+                                      outFrames - generated, ratio, &taken);
+    }
+    remember(in, taken);
+    *used = taken;
+    return generated;
+}
+
+uint32_t CrossfadeResampler::processFade(const float* in, uint32_t inFrames,
+                                         float* out, uint32_t outFrames,
+                                         double ratio, uint32_t* used)
+{
+    Resampler& driver = nextLeads_ ? *next_ : *active_;
+    Resampler& follower = nextLeads_ ? *active_ : *next_;
+
+    // A longer replacement first skips what the active one already produced.
+    uint32_t consumed = 0;
+    while (skip_ > 0) {
+        uint32_t taken = 0;
+        uint32_t got = driver.process(in + static_cast<size_t>(consumed) * channels_,
+                                      inFrames - consumed, scratch_.data(),
+                                      std::min(skip_, kScratchFrames), ratio, &taken);
+        consumed += taken;
+        skip_ -= got;
+        if (taken == 0 && got == 0) break;
+    }
+
+    uint32_t generated = 0;
+    if (skip_ == 0) {
+        uint32_t taken = 0;
+        generated = driver.process(in + static_cast<size_t>(consumed) * channels_,
+                                   inFrames - consumed, out, outFrames, ratio, &taken);
+        consumed += taken;
+    }
+    remember(in, consumed);
+    *used = consumed;
+
+    // The follower runs on the same input until it has caught up with the
+    // driver's output. Being the shorter of the two it is normally ahead.
+    const float* src = in;
+    uint32_t left = consumed;
+    while (queueFrames_ < generated) {
+        uint32_t fed = std::min(left, kBacklogFrames - backlogFrames_);
+        appendBacklog(src, fed);
+        src += static_cast<size_t>(fed) * channels_;
+        left -= fed;
+
+        uint32_t taken = 0;
+        uint32_t got = follower.process(backlog_.data(), backlogFrames_,
+                                        queue_.data() + static_cast<size_t>(queueFrames_) * channels_,
+                                        kQueueFrames - queueFrames_, ratio, &taken);
+        consumeBacklog(taken);
+        queueFrames_ += got;
+        if (fed == 0 && taken == 0 && got == 0) break;
+    }
+    // Whatever it didn't need this time. A backlog this far behind means it
+    // has stalled; dropping input is all that's left.
+    appendBacklog(src, std::min(left, kBacklogFrames - backlogFrames_));
+
+    // Linear ramp from the active converter's output to the replacement's,
+    // frame by frame against the follower's. Ran short by a frame or so:
+    // hold its last one.
+    uint32_t paired = std::min(generated, queueFrames_);
+    if (paired > 0) {
+        std::memcpy(held_.data(), queue_.data() + static_cast<size_t>(paired - 1) * channels_,
+                    channels_ * sizeof(float));
+    }
+    for (uint32_t i = 0; i < generated; ++i) {
+        fadePos_ = std::min(fadePos_ + 1, kCrossfadeFrames);
+        float gain = static_cast<float>(fadePos_) / kCrossfadeFrames;
+        float* dst = out + static_cast<size_t>(i) * channels_;
+        const float* other = i < paired ? queue_.data() + static_cast<size_t>(i) * channels_
+                                        : held_.data();
+        for (uint32_t c = 0; c < channels_; ++c) {
+            float from = nextLeads_ ? other[c] : dst[c];
+            float to = nextLeads_ ? dst[c] : other[c];
+            dst[c] = from + gain * (to - from);
+        }
+    }
+    popQueue(nullptr, paired);
+
+    if (fadePos_ >= kCrossfadeFrames) finish();
+    return generated;
+}
+
+void CrossfadeResampler::remember(const float* in, uint32_t frames)
+{
+    if (frames > kHistoryFrames) {
+        in += static_cast<size_t>(frames - kHistoryFrames) * channels_;
+        frames = kHistoryFrames;
+    }
+    while (frames > 0) {
+        uint32_t n = std::min(frames, kHistoryFrames - historyPos_);
+        std::memcpy(history_.data() + static_cast<size_t>(historyPos_) * channels_, in,
+                    static_cast<size_t>(n) * channels_ * sizeof(float));
+        in += static_cast<size_t>(n) * channels_;
+        frames -= n;
+        historyPos_ = (historyPos_ + n) % kHistoryFrames;
+        historyFill_ = std::min(historyFill_ + n, kHistoryFrames);
+    }
+}
+
+void CrossfadeResampler::appendBacklog(const float* in, uint32_t frames)
+{
+    if (frames == 0) return;
+    std::memcpy(backlog_.data() + static_cast<size_t>(backlogFrames_) * channels_, in,
+                static_cast<size_t>(frames) * channels_ * sizeof(float));
+    backlogFrames_ += frames;
+}
+
+void CrossfadeResampler::consumeBacklog(uint32_t frames)
+{
+    if (frames == 0) return;
+    backlogFrames_ -= frames;
+    std::memmove(backlog_.data(), backlog_.data() + static_cast<size_t>(frames) * channels_,
+                 static_cast<size_t>(backlogFrames_) * channels_ * sizeof(float));
+}
+
+// Take `frames` off the front of the queue, into out unless it's null.
+void CrossfadeResampler::popQueue(float* out, uint32_t frames)
+{
+    if (frames == 0) return;
+    if (out) {
+        std::memcpy(out, queue_.data(), static_cast<size_t>(frames) * channels_ * sizeof(float));
+    }
+    queueFrames_ -= frames;
+    std::memmove(queue_.data(), queue_.data() + static_cast<size_t>(frames) * channels_,
+                 static_cast<size_t>(queueFrames_) * channels_ * sizeof(float));
+}
+
+} // namespace flux
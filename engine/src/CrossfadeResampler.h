@@ -0,0 +1,134 @@
+#pragma once
+
+// CrossfadeResampler: a stream's converter, switchable while it runs.
+//
+// Wraps the active converter and forwards to it. request() hands over a
+// replacement built off the realtime thread; the wrapper adopts it at the
+// end of the next process() call that finds it idle:
+//
+//   1. The replacement is primed with the last kHistoryFrames of input, so
+//      its filter starts full instead of from silence.
+//   2. For kCrossfadeFrames output frames both run on the same input and
+//      the replacement is faded in. The two are paired by content, not by
+//      count: converters with different group delays emit the same input
+//      instant at different output positions. The one with the longer
+//      delay drives — it takes the caller's input and its output goes to
+//      the caller — and the other follows on the same input through a
+//      backlog, its output queued until the driver catches up with it.
+//   3. The replacement becomes active; the old converter waits in a slot
+//      for collect() to delete it.
+//
+// So the stream never jumps: a longer converter makes up its extra delay
+// by emitting that many fewer frames as the fade starts (it has to skip
+// output the old one already produced — taking that much more input than
+// usual, which a caller pulling until its block is full simply supplies),
+// and a shorter one by emitting its head start after the fade
+// (extraOutput() more output than usual).
+// groupDelay() follows that frame by frame, so timeline stamps taken from
+// it stay continuous through a switch. switches() counts completed ones.
+//
+// Threading: process() and reset() on the stream's realtime thread;
+// request() and collect() on one control thread. They only share the two
+// handover slots. No allocation on the realtime side: a request is only
+// adopted once the previous converter has been collected.
+
+#include "Resampler.h"
+
+#include <atomic>
+#include <vector>
+
+namespace flux {
+
+class CrossfadeResampler : public Resampler {
+public:
+    static constexpr uint32_t kCrossfadeFrames = 480;   // 10 ms at 48 kHz
+    static constexpr uint32_t kHistoryFrames   = 512;   // Covers the longest sinc
+    static constexpr uint32_t kBacklogFrames   = 8192;  // Input the follower trails by
+    static constexpr uint32_t kQueueFrames     = 8192;  // Follower output ahead of the driver
+    static constexpr uint32_t kScratchFrames   = 1024;  // Discarded output per pass
+
+    CrossfadeResampler(std::unique_ptr<Resampler> active, uint32_t channels);
+    ~CrossfadeResampler() override;
+
+    CrossfadeResampler(const CrossfadeResampler&) = delete;
+    CrossfadeResampler& operator=(const CrossfadeResampler&) = delete;
+
+    uint32_t process(const float* in, uint32_t inFrames,
+                     float* out, uint32_t outFrames,
+                     double ratio, uint32_t* used) override;
+
+    // Ends a fade at once on the replacement, then resets it.
+    void reset() override;
+
+    ResamplerTier tier() const override { return active_->tier(); }
+
+    // The delay of what the next output frame carries: the driving
+    // converter's, less output it still has to skip, plus input and output
+    // queued ahead of the active one after a fade.
+    uint32_t groupDelay() const override;
+
+    // Output beyond a block's worth that the next call produces from a full
+    // block of input. Input it has no room to convert is dropped, so callers
+    // with a fixed input block leave this much more room. Realtime thread.
+    uint32_t extraOutput() const { return next_ ? 0 : queueFrames_ + backlogFrames_; }
+
+    // Completed switches. Realtime thread.
+    uint32_t switches() const { return switches_; }
+
+    // ---- Control thread ----
+
+    // Switch to `next`, crossfading. Replaces a request not yet adopted.
+    void request(std::unique_ptr<Resampler> next);
+
+    // Delete the converter the last switch retired, if any.
+    void collect();
+
+private:
+    // Start fading to a requested converter, if there is one and the last
+    // switch has been cleaned up after.
+    void adopt(double ratio);
+
+    uint32_t processActive(const float* in, uint32_t inFrames,
+                           float* out, uint32_t outFrames,
+                           double ratio, uint32_t* used);
+    uint32_t processFade(const float* in, uint32_t inFrames,
+                         float* out, uint32_t outFrames,
+                         double ratio, uint32_t* used);
+
+    // A fade has run its course: the replacement takes over.
+    void finish();
+
+    void remember(const float* in, uint32_t frames);
+    void appendBacklog(const float* in, uint32_t frames);
+    void consumeBacklog(uint32_t frames);
+    void popQueue(float* out, uint32_t frames);
+
+    uint32_t                   channels_;
+    std::unique_ptr<Resampler> active_;
+    std::unique_ptr<Resampler> next_;       // Fading in, realtime thread
+    bool                       nextLeads_ = false;  // next_ drives the fade
+    uint32_t                   skip_ = 0;   // Driver output still to discard
+    uint32_t                   fadePos_ = 0;
+    uint32_t                   switches_ = 0;
+
+    std::atomic<Resampler*>    requested_{nullptr};     // Control → realtime
+    std::atomic<Resampler*>    retired_{nullptr};       // Realtime → control
+
+    // Last kHistoryFrames of input, circular.
+    std::vector<float>         history_;
+    uint32_t                   historyPos_ = 0;
+    uint32_t                   historyFill_ = 0;
+
+    // While fading: the follower's input and its output queued ahead of the
+    // driver. Once a shorter converter has taken over, whatever is left of
+    // both goes out ahead of it.
+    std::vector<float>         backlog_;
+    uint32_t                   backlogFrames_ = 0;
+    std::vector<float>         queue_;
+    uint32_t                   queueFrames_ = 0;
+
+    std::vector<float>         scratch_;
+    std::vector<float>         held_;       // Follower's last frame, if it runs short
+};
+
+} // namespace flux
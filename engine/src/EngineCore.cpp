@@ -0,0 +1,1156 @@
+#include "EngineCore.h"
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <cstring>
+#include <string>
+
+namespace flux {
+
+// ---- Hardware buffers ----
+// A stream takes the first of a device's channels, in buffer order. The
+// common case — one interleaved buffer of exactly the stream's channels —
+// goes straight between the hardware buffer and the ring or converter;
+// anything else (non-interleaved buffers, more or fewer channels than the
+// stream) is gathered into or scattered from interleaved scratch, up to
+// kMaxIOBufferFrames at a time. That is one copy more than the direct
+// case, and it includes stereo as two mono buffers — the FLX4's output
+// layout: the converters only take interleaved frames, so the span paths
+// stay zero-copy on the ring side only. A buffer's worth of frames per
+// cycle (2 KB for 256 stereo frames), against the converter's pass over
+// the same frames.
+
+IOBufferList IOBufferList::interleaved(float* data, uint32_t channels, uint32_t frames)
+{
+    IOBufferList list;
+    if (data) {
+        list.buffers[0] = {data, channels};
+        list.count = 1;
+    }
+    list.frames = frames;
+    return list;
+}
+
+// The list's single buffer if it holds exactly `channels` interleaved
+// channels, nullptr otherwise.
+static float* directBuffer(const IOBufferList& list, uint32_t channels)
+{
+    return list.count == 1 && list.buffers[0].channels == channels ? list.buffers[0].data
+                                                                   : nullptr;
+}
+
+// Interleave frames [offset, offset + frames) of the list's first `channels`
+// channels into dst. Channels the device doesn't have come out silent.
+static void gatherFrames(const IOBufferList& list, uint32_t offset, uint32_t frames,
+                         float* dst, uint32_t channels)
+{
+    uint32_t c = 0;
+    for (uint32_t b = 0; b < list.count && c < channels; ++b) {
+        const IOBuffer& buf = list.buffers[b];
+        if (!buf.data || buf.channels == 0) continue;
+        uint32_t take = std::min(buf.channels, channels - c);
+        const float* src = buf.data + static_cast<size_t>(offset) * buf.channels;
+        for (uint32_t i = 0; i < frames; ++i) {
+            for (uint32_t j = 0; j < take; ++j) {
+                dst[static_cast<size_t>(i) * channels + c + j] =
+                    src[static_cast<size_t>(i) * buf.channels + j];
+            }
+        }
+        c += take;
+    }
+    for (; c < channels; ++c) {
+        for (uint32_t i = 0; i < frames; ++i) dst[static_cast<size_t>(i) * channels + c] = 0.0f;
+    }
+}
+
+// Spread `frames` interleaved frames of `channels` channels over the list's
+// buffers from frame offset on. Device channels past the stream's are
+// silenced.
+static void scatterFrames(const float* src, uint32_t channels, const IOBufferList& list,
+                          uint32_t offset, uint32_t frames)
+{
+    uint32_t c = 0;
+    for (uint32_t b = 0; b < list.count; ++b) {
+        const IOBuffer& buf = list.buffers[b];
+        if (!buf.data || buf.channels == 0) continue;
+        uint32_t give = c < channels ? std::min(buf.channels, channels - c) : 0;
+        float* dst = buf.data + static_cast<size_t>(offset) * buf.channels;
+        for (uint32_t i = 0; i < frames; ++i) {
+            uint32_t j = 0;
+            for (; j < give; ++j) {
+                dst[static_cast<size_t>(i) * buf.channels + j] =
+                    src[static_cast<size_t>(i) * channels + c + j];
+            }
+            for (; j < buf.channels; ++j) dst[static_cast<size_t>(i) * buf.channels + j] = 0.0f;
+        }
+        c += give;
+    }
+}
+
+// Hand a device's input to take(block, frames) as interleaved blocks of
+// the stream's channels: the hardware buffer itself, or gathered chunks.
+template <typename Take>
+static void forInput(const IOBufferList& in, uint32_t channels, float* scratch, Take take)
+{
+    if (const float* direct = directBuffer(in, channels)) {
+        take(direct, in.frames);
+        return;
+    }
+    for (uint32_t done = 0; done < in.frames;) {
+        uint32_t n = std::min(in.frames - done, kMaxIOBufferFrames);
+        gatherFrames(in, done, n, scratch, channels);
+        take(static_cast<const float*>(scratch), n);
+        done += n;
+    }
+}
+
+// Fill a device's output through fill(block, frames), which writes interleaved
+// blocks of the stream's channels: into the hardware buffer itself, or
+// into scratch chunks scattered out.
+template <typename Fill>
+static void forOutput(const IOBufferList& out, uint32_t channels, float* scratch, Fill fill)
+{
+    if (float* direct = directBuffer(out, channels)) {
+        fill(direct, out.frames);
+        return;
+    }
+    for (uint32_t done = 0; done < out.frames;) {
+        uint32_t n = std::min(out.frames - done, kMaxIOBufferFrames);
+        fill(scratch, n);
+        scatterFrames(scratch, channels, out, done, n);
+        done += n;
+    }
+}
+
+// ---- Zero-copy resampling into / out of ring spans ----
+// The converter reads from and writes to shared memory directly, so each
+// realtime path does no memcpy beyond the conversion itself. Frames are
+// interleaved, `channels` wide — the ring's.
+
+// The part of a span pair after its first `frames` frames.
+static RingSpans<float> spansAfter(const RingSpans<float>& spans, uint32_t frames,
+                                   uint32_t channels)
+{
+    if (frames < spans.frames1) {
+        return {spans.data1 + frames * channels, spans.frames1 - frames,
+                spans.data2, spans.frames2};
+    }
+    uint32_t into = std::min(frames - spans.frames1, spans.frames2);
+    return {spans.data2 + into * channels, spans.frames2 - into, nullptr, 0};
+}
+
+// Resample inFrames into a ring's writable spans. The second span is only
+// touched once the first is full. Returns frames generated.
+static uint32_t resampleIntoSpans(Resampler& src, uint32_t channels,
+                                  const float* in, uint32_t inFrames,
+                                  double ratio,
+                                  const RingSpans<float>& out)
+{
+    float*   dst[2]       = {out.data1, out.data2};
+    uint32_t dstFrames[2] = {out.frames1, out.frames2};
+    uint32_t generated    = 0;
+
+    for (int i = 0; i < 2; ++i) {
+        if (dstFrames[i] == 0) break;
+
+        uint32_t used = 0;
+        uint32_t gen = src.process(in, inFrames, dst[i], dstFrames[i], ratio, &used);
+
+        generated += gen;
+        in += used * channels;
+        inFrames -= used;
+
+        // Converter ran dry before filling this span — nothing left for the next.
+        if (gen < dstFrames[i]) break;
+    }
+    return generated;
+}
+
+// Pull a ring through the converter until out holds outFrames. Each pass
+// offers what the still-missing output needs at ratio, a few frames over,
+// and releases exactly what the converter took: input it leaves stays in
+// the ring for the next cycle, where the servo still sees it, and a
+// converter that wants more than the estimate — a crossfade skipping ahead
+// to a longer filter, libsamplerate priming — gets another pass. Short only
+// when the ring runs dry. Returns frames generated.
+static uint32_t pullFromRing(Resampler& src, AudioRing& ring, double ratio,
+                             float* out, uint32_t outFrames)
+{
+    static constexpr uint32_t kPullMargin = 4;
+    const uint32_t channels = ring.frameSamples();
+    uint32_t generated = 0;
+
+    while (generated < outFrames) {
+        // The first span is the contiguous run up to the wrap; the next
+        // pass starts on the other side of it.
+        auto spans = ring.readSpans();
+        if (spans.frames1 == 0) break;
+
+        auto wanted = static_cast<uint32_t>(
+            static_cast<double>(outFrames - generated) / ratio) + kPullMargin;
+        uint32_t used = 0;
+        uint32_t gen = src.process(spans.data1, std::min(wanted, spans.frames1),
+                                   out + generated * channels,
+                                   outFrames - generated, ratio, &used);
+        ring.consume(used);
+        generated += gen;
+        if (used == 0 && gen == 0) break;
+    }
+    return generated;
+}
+
+// ---- Fixed-ratio stages ----
+// A stream with a rate stage converts through the stage's scratch buffer,
+// kRateChunkFrames of the intermediate rate at a time.
+
+static constexpr uint32_t kRateChunkFrames = 1024;
+
+// Input side: the stage, then the converter into the ring's spans, a
+// chunk at a time. Each chunk is no more than what's left of the spans
+// needs at ratio, a few frames over, and no input is staged once they are
+// full: whatever the stage took past that would have nowhere to go.
+// Returns frames generated.
+static uint32_t resampleStagedIntoSpans(RationalResampler& stage, float* scratch,
+                                        Resampler& src, uint32_t channels,
+                                        const float* in, uint32_t inFrames,
+                                        double ratio,
+                                        const RingSpans<float>& out)
+{
+    static constexpr uint32_t kStageMargin = 4;
+    const uint32_t total = out.frames1 + out.frames2;
+    uint32_t generated = 0;
+    while (inFrames > 0 && generated < total) {
+        auto wanted = static_cast<uint32_t>(static_cast<double>(total - generated) / ratio);
+        uint32_t chunk = std::min(wanted + kStageMargin, kRateChunkFrames);
+        uint32_t used = 0;
+        uint32_t staged = stage.process(in, inFrames, scratch, chunk, &used);
+        in += used * channels;
+        inFrames -= used;
+        generated += resampleIntoSpans(src, channels, scratch, staged, ratio,
+                                       spansAfter(out, generated, channels));
+        if (used == 0 && staged == 0) break;
+    }
+    return generated;
+}
+
+// Output side: pull the converter's output through the stage until out
+// holds outFrames, asking the ring for exactly what the stage needs. Short
+// only when the ring runs dry. Returns frames generated.
+static uint32_t pullStagedFromRing(RationalResampler& stage, float* scratch,
+                                   Resampler& src, AudioRing& ring, double ratio,
+                                   float* out, uint32_t outFrames)
+{
+    const uint32_t channels = ring.frameSamples();
+
+    // Outputs per pass whose input fits the scratch buffer, whatever the
+    // stage's phase.
+    uint32_t chunk = std::max<uint32_t>(
+        1, static_cast<uint32_t>((kRateChunkFrames - 2) * stage.ratio()));
+    uint32_t generated = 0;
+
+    while (generated < outFrames) {
+        uint32_t wanted = std::min(outFrames - generated, chunk);
+        uint32_t needed = stage.inputFor(wanted);
+        uint32_t got = needed > 0 ? pullFromRing(src, ring, ratio, scratch, needed) : 0;
+        uint32_t used = 0;
+        uint32_t made = stage.process(scratch, got, out + generated * channels,
+                                      wanted, &used);
+        generated += made;
+        if (got < needed || made == 0) break;
+    }
+    return generated;
+}
+
+// A stage with no converter behind it — the master's, or a slave's until
+// its clock locks: straight into a ring's spans, the second only once the
+// first is full. Returns frames generated.
+static uint32_t stageIntoSpans(RationalResampler& stage, uint32_t channels,
+                               const float* in, uint32_t inFrames,
+                               const RingSpans<float>& out)
+{
+    float*   dst[2] = {out.data1, out.data2};
+    uint32_t dstFrames[2] = {out.frames1, out.frames2};
+    uint32_t generated = 0;
+
+    for (int i = 0; i < 2 && dstFrames[i] > 0; ++i) {
+        uint32_t used = 0;
+        generated += stage.process(in, inFrames, dst[i], dstFrames[i], &used);
+        in += used * channels;
+        inFrames -= used;
+    }
+    return generated;
+}
+
+// And out of a ring through a stage alone: out filled from exactly the
+// input it needs, through scratch. Short only when the ring runs dry.
+// Returns frames generated.
+static uint32_t pullStageFromRing(RationalResampler& stage, float* scratch, AudioRing& ring,
+                                  float* out, uint32_t outFrames)
+{
+    const uint32_t channels = ring.frameSamples();
+    uint32_t chunk = std::max<uint32_t>(
+        1, static_cast<uint32_t>((kRateChunkFrames - 2) * stage.ratio()));
+    uint32_t generated = 0;
+
+    while (generated < outFrames) {
+        uint32_t wanted = std::min(outFrames - generated, chunk);
+        uint32_t needed = stage.inputFor(wanted);
+        uint32_t got = needed > 0 ? ring.readSome(scratch, needed) : 0;
+        uint32_t used = 0;
+        uint32_t made = stage.process(scratch, got, out + generated * channels,
+                                      wanted, &used);
+        generated += made;
+        if (got < needed || made == 0) break;
+    }
+    return generated;
+}
+
+// Resample a device's input — through the stage, if any — into a ring's
+// spans, gathering its channels a chunk at a time if it has to. Returns
+// frames generated.
+static uint32_t convertInput(RationalResampler* stage, float* stageScratch,
+                             Resampler& src, uint32_t channels,
+                             const IOBufferList& in, float* gather,
+                             double ratio, const RingSpans<float>& out)
+{
+    uint32_t generated = 0;
+    forInput(in, channels, gather, [&](const float* block, uint32_t frames) {
+        auto spans = spansAfter(out, generated, channels);
+        generated += stage
+            ? resampleStagedIntoSpans(*stage, stageScratch, src, channels, block, frames,
+                                      ratio, spans)
+            : resampleIntoSpans(src, channels, block, frames, ratio, spans);
+    });
+    return generated;
+}
+
+void EngineCore::InputConversion::run(void* context)
+{
+    auto* job = static_cast<InputConversion*>(context);
+    job->generated = convertInput(job->stage, job->scratch, *job->resampler, job->channels,
+                                  *job->input, job->gather, job->ratio, job->spans);
+}
+
+// Apply gain in place to the first `frames` frames of a span pair.
+static void scaleSpans(const RingSpans<float>& spans, uint32_t frames, uint32_t channels,
+                       float gain)
+{
+    uint32_t first = frames < spans.frames1 ? frames : spans.frames1;
+    for (uint32_t i = 0; i < first * channels; ++i) {
+        spans.data1[i] *= gain;
+    }
+    for (uint32_t i = 0; i < (frames - first) * channels; ++i) {
+        spans.data2[i] *= gain;
+    }
+}
+
+// ---- Configuration ----
+
+std::vector<DeviceConfig> defaultDevices()
+{
+    DeviceConfig push;
+    push.name = "push";
+    push.uid = kDefaultPushUID;
+
+    DeviceConfig flx4;
+    flx4.name = "flx4";
+    flx4.uid = kDefaultFLX4UID;
+    flx4.cue = true;
+    flx4.cueGain = kCueTapGainCompensation;
+    return {push, flx4};
+}
+
+bool layoutFor(const EngineConfig& config, LayoutTable* out)
+{
+    LayoutTable table;
+    for (const auto& device : config.devices) {
+        bool cue = !table.devices.empty() && device.cue;
+        if (!table.addDevice(device.name.c_str(), cue, device.ringFrames,
+                             device.inputChannels, device.outputChannels))
+        {
+            return false;
+        }
+    }
+    if (table.devices.empty()) return false;
+    *out = std::move(table);
+    return true;
+}
+
+// The configured tier for a slave's stream.
+static ResamplerTier* streamTier(DeviceConfig& device, StreamRole role)
+{
+    switch (role) {
+        case kStreamCapture: return &device.inputResampler;
+        case kStreamCue:     return &device.cueResampler;
+        default:             return &device.outputResampler;
+    }
+}
+
+bool parseResampledStream(const char* name, const EngineConfig& config,
+                          uint32_t* outDevice, StreamRole* outRole)
+{
+    std::string stream = name;
+    auto dash = stream.rfind('-');
+    if (dash == std::string::npos) return false;
+
+    std::string suffix = stream.substr(dash + 1);
+    StreamRole role;
+    if (suffix == "in") {
+        role = kStreamCapture;
+    } else if (suffix == "cue") {
+        role = kStreamCue;
+    } else if (suffix == "out") {
+        role = kStreamPlayback;
+    } else {
+        return false;
+    }
+
+    // The master isn't resampled; a slave only has a cue if configured.
+    for (size_t i = 1; i < config.devices.size(); ++i) {
+        const DeviceConfig& device = config.devices[i];
+        if (device.name != stream.substr(0, dash)) continue;
+        if (role == kStreamCue && !device.cue) return false;
+        *outDevice = static_cast<uint32_t>(i);
+        *outRole = role;
+        return true;
+    }
+    return false;
+}
+
+bool parseResamplerArg(const char* arg, EngineConfig* config)
+{
+    std::string text = arg;
+    auto eq = text.find('=');
+
+    ResamplerTier tier;
+    if (!parseResamplerTier(text.c_str() + (eq == std::string::npos ? 0 : eq + 1), &tier)) {
+        return false;
+    }
+    if (eq == std::string::npos) {
+        for (size_t i = 1; i < config->devices.size(); ++i) {
+            DeviceConfig& device = config->devices[i];
+            device.inputResampler = device.cueResampler = device.outputResampler = tier;
+        }
+        return true;
+    }
+
+    uint32_t device = 0;
+    StreamRole role;
+    if (!parseResampledStream(text.substr(0, eq).c_str(), *config, &device, &role)) return false;
+    *streamTier(config->devices[device], role) = tier;
+    return true;
+}
+
+// A switchable converter for a ring's stream, as wide as the ring. nullptr
+// if there is no ring or the tier can't be created at that width.
+static std::unique_ptr<CrossfadeResampler> makeStreamResampler(const ResamplerTier& tier,
+                                                               const AudioRing* ring)
+{
+    if (!ring) return nullptr;
+    auto resampler = makeResampler(tier, ring->frameSamples());
+    if (!resampler) return nullptr;
+    return std::make_unique<CrossfadeResampler>(std::move(resampler), ring->frameSamples());
+}
+
+// Gather / scatter scratch for a ring's stream (forInput / forOutput).
+static std::vector<float> ioScratch(const AudioRing* ring)
+{
+    return std::vector<float>(ring ? static_cast<size_t>(kMaxIOBufferFrames)
+                                     * ring->frameSamples() : 0, 0.0f);
+}
+
+EngineCore::EngineCore(SharedMemoryLayout* shm, const EngineConfig& config)
+    : shm_(shm)
+    , config_(config)
+    , masterInput_(shm->ring(kMasterDevice, kStreamCapture))
+    , masterOutput_(shm->ring(kMasterDevice, kStreamPlayback))
+    , masterInputMetrics_(shm->streamMetrics(kMasterDevice, kStreamCapture))
+    , masterOutputMetrics_(shm->streamMetrics(kMasterDevice, kStreamPlayback))
+    , masterOutputLatency_(shm->streamLatency(kMasterDevice, kStreamPlayback))
+    , masterEstimator_(makeClockEstimator(config.clockEstimator, kNominalSampleRate, *config.time))
+{
+    masterInputGather_ = ioScratch(masterInput_);
+    masterOutputScatter_ = ioScratch(masterOutput_);
+    if (masterOutput_) masterOutputConceal_.setChannels(masterOutput_->frameSamples());
+
+    slaves_.resize(config_.devices.size());
+    for (uint32_t device = 1; device < slaves_.size(); ++device) {
+        auto s = std::make_unique<Slave>();
+        s->device = device;
+        s->input = shm->ring(device, kStreamCapture);
+        s->output = shm->ring(device, kStreamPlayback);
+        s->inputMetrics = shm->streamMetrics(device, kStreamCapture);
+        s->outputMetrics = shm->streamMetrics(device, kStreamPlayback);
+        s->outputLatency = shm->streamLatency(device, kStreamPlayback);
+        if (config_.devices[device].cue) {
+            s->cue = shm->ring(device, kStreamCue);
+            s->cueMetrics = shm->streamMetrics(device, kStreamCue);
+        }
+        s->inputGather = ioScratch(s->input);
+        s->cueGather = ioScratch(s->cue);
+        s->outputScatter = ioScratch(s->output);
+        if (s->output) s->outputConceal.setChannels(s->output->frameSamples());
+        if (device < kMaxDevices) s->drift = &shm->drift[device];
+        s->estimator = makeClockEstimator(config.clockEstimator, kNominalSampleRate, *config.time);
+        slaves_[device] = std::move(s);
+    }
+}
+
+bool EngineCore::valid() const
+{
+    if (!masterInput_ || !masterOutput_ || shm_->deviceCount != config_.devices.size()) {
+        return false;
+    }
+    for (uint32_t device = 0; device < shm_->deviceCount; ++device) {
+        if (config_.devices[device].name != shm_->devices[device].name) return false;
+    }
+    const DeviceConfig& master = config_.devices[kMasterDevice];
+    if (!masterOutputLatency_ || masterInput_->frameSamples() != master.inputChannels
+        || masterOutput_->frameSamples() != master.outputChannels)
+    {
+        return false;
+    }
+    for (uint32_t device = 1; device < slaves_.size(); ++device) {
+        const Slave& s = *slaves_[device];
+        const DeviceConfig& cfg = config_.devices[device];
+        if (!s.input || !s.output || !s.outputLatency || !s.drift
+            || (cfg.cue && !s.cue)
+            || s.input->frameSamples() != cfg.inputChannels
+            || s.output->frameSamples() != cfg.outputChannels)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+EngineCore::Slave* EngineCore::slave(uint32_t device) const
+{
+    return device < slaves_.size() ? slaves_[device].get() : nullptr;
+}
+
+// ---- Session control ----
+
+bool EngineCore::begin()
+{
+    for (uint32_t device = 1; device < slaves_.size(); ++device) {
+        Slave& s = *slaves_[device];
+        const DeviceConfig& cfg = config_.devices[device];
+        s.resamplerIn = makeStreamResampler(cfg.inputResampler, s.input);
+        s.resamplerOut = makeStreamResampler(cfg.outputResampler, s.output);
+        s.resamplerCue = cfg.cue ? makeStreamResampler(cfg.cueResampler, s.cue) : nullptr;
+        if (!s.resamplerIn || !s.resamplerOut) {
+            end();
+            return false;
+        }
+        s.outSwitches = 0;
+        buildRateStages(s);
+        s.outputConceal.reset();
+        s.outputPrimed = false;
+    }
+    if (config_.workerThreads > 0 && slaves_.size() > 1) {
+        workers_ = std::make_unique<WorkerPool>(config_.workerThreads, config_.workerSetup);
+    }
+
+    // Every session is a new master timeline.
+    buildMasterStages();
+    return true;
+}
+
+void EngineCore::end()
+{
+    workers_.reset();
+    for (uint32_t device = 1; device < slaves_.size(); ++device) {
+        Slave& s = *slaves_[device];
+        s.resamplerIn.reset();
+        s.resamplerOut.reset();
+        s.resamplerCue.reset();
+        s.rateIn.reset();
+        s.rateCue.reset();
+        s.rateOut.reset();
+    }
+    masterRateIn_.reset();
+    masterRateOut_.reset();
+}
+
+CrossfadeResampler* EngineCore::resampler(const Slave& s, StreamRole role)
+{
+    switch (role) {
+        case kStreamCapture:  return s.resamplerIn.get();
+        case kStreamCue:      return s.resamplerCue.get();
+        case kStreamPlayback: return s.resamplerOut.get();
+        default:              return nullptr;
+    }
+}
+
+bool EngineCore::setResampler(uint32_t device, StreamRole role, const ResamplerTier& tier)
+{
+    Slave* s = slave(device);
+    CrossfadeResampler* current = s ? resampler(*s, role) : nullptr;
+    if (!current) return false;
+    const AudioRing* ring = role == kStreamCapture ? s->input
+                          : role == kStreamCue     ? s->cue : s->output;
+    auto next = makeResampler(tier, ring->frameSamples());
+    if (!next) return false;
+
+    current->request(std::move(next));
+    *streamTier(config_.devices[device], role) = tier;
+    return true;
+}
+
+bool EngineCore::hasCue(uint32_t device) const
+{
+    Slave* s = slave(device);
+    return s && s->resamplerCue;
+}
+
+void EngineCore::collect()
+{
+    for (uint32_t device = 1; device < slaves_.size(); ++device) {
+        for (auto role : {kStreamCapture, kStreamCue, kStreamPlayback}) {
+            if (CrossfadeResampler* r = resampler(*slaves_[device], role)) r->collect();
+        }
+    }
+}
+
+void EngineCore::setClock(uint32_t device, double nominalRate, double seedRate)
+{
+    if (device == kMasterDevice) {
+        masterEstimator_ = makeClockEstimator(config_.clockEstimator, nominalRate, *config_.time);
+        if (seedRate > 0.0) masterEstimator_->seed(seedRate);
+        if (nominalRate != masterNominal_) {
+            masterNominal_ = nominalRate;
+            buildMasterStages();
+        }
+        return;
+    }
+
+    Slave* s = slave(device);
+    if (!s) return;
+    s->estimator = makeClockEstimator(config_.clockEstimator, nominalRate, *config_.time);
+    if (seedRate > 0.0) s->estimator->seed(seedRate);
+    if (nominalRate != s->nominal) {
+        s->nominal = nominalRate;
+        if (s->resamplerIn) buildRateStages(*s);
+    }
+}
+
+bool EngineCore::setSessionRate(double rate)
+{
+    if (!isSupportedSampleRate(rate)) return false;
+    if (rate == sessionRate_) return true;
+    sessionRate_ = rate;
+
+    // Every stage converts to or from the session's rate. What the master
+    // output has queued is at the old one; slave outputs resync on their
+    // own.
+    if (masterOutput_) masterOutput_->clear();
+    buildMasterStages();
+    for (uint32_t i = 1; i < slaves_.size(); ++i) {
+        if (slaves_[i]->resamplerIn) buildRateStages(*slaves_[i]);
+    }
+    return true;
+}
+
+void EngineCore::resetClock(uint32_t device)
+{
+    if (device == kMasterDevice) {
+        masterEstimator_->reset();
+    } else if (Slave* s = slave(device)) {
+        s->estimator->reset();
+    }
+}
+
+void EngineCore::buildRateStages(Slave& s)
+{
+    const DeviceConfig& cfg = config_.devices[s.device];
+    uint32_t inCh = s.input->frameSamples();
+    uint32_t cueCh = s.cue ? s.cue->frameSamples() : kChannelsPerDevice;
+    uint32_t outCh = s.output->frameSamples();
+    s.rateIn = RationalResampler::make(s.nominal, sessionRate_,
+                                       cfg.inputResampler.quality, inCh);
+    s.rateCue = cfg.cue ? RationalResampler::make(s.nominal, sessionRate_,
+                                                  cfg.cueResampler.quality, cueCh)
+                        : nullptr;
+    s.rateOut = RationalResampler::make(sessionRate_, s.nominal,
+                                        cfg.outputResampler.quality, outCh);
+    s.rateInScratch.assign(s.rateIn ? kRateChunkFrames * inCh : 0, 0.0f);
+    s.rateCueScratch.assign(s.rateCue ? kRateChunkFrames * cueCh : 0, 0.0f);
+    s.rateOutScratch.assign(s.rateOut ? kRateChunkFrames * outCh : 0, 0.0f);
+
+    // The queue is configured as at kNominalSampleRate and kept as long at
+    // the session's, within what the ring holds with room to resync.
+    auto queue = static_cast<uint32_t>(
+        std::lround(cfg.outputQueue * sessionRate_ / kNominalSampleRate));
+    auto room = s.output->capacity - static_cast<uint32_t>(kLatencyResyncFrames) - 1;
+    s.outputQueue = std::min(queue, room);
+
+    // The converters' ratios and the streams' delays just changed. The
+    // servos' errors are in session frames.
+    for (auto role : {kStreamCapture, kStreamCue, kStreamPlayback}) {
+        if (CrossfadeResampler* r = resampler(s, role)) r->reset();
+    }
+    s.inputServo = FillServo(sessionRate_);
+    s.outputServo = FillServo(sessionRate_);
+    s.cueServo = FillServo(sessionRate_);
+    publishOutputLatency(s);
+}
+
+void EngineCore::buildMasterStages()
+{
+    if (!masterInput_ || !masterOutput_ || !masterOutputLatency_) return;
+    const DeviceConfig& cfg = config_.devices[kMasterDevice];
+    uint32_t inCh = masterInput_->frameSamples();
+    uint32_t outCh = masterOutput_->frameSamples();
+    masterRateIn_ = RationalResampler::make(masterNominal_, sessionRate_,
+                                            cfg.inputResampler.quality, inCh);
+    masterRateOut_ = RationalResampler::make(sessionRate_, masterNominal_,
+                                             cfg.outputResampler.quality, outCh);
+    masterRateOutScratch_.assign(masterRateOut_ ? kRateChunkFrames * outCh : 0, 0.0f);
+    masterOutputLatency_->store(masterRateOut_ ? masterRateOut_->inputDelay() : 0,
+                                std::memory_order_relaxed);
+    masterOutputPrimed_ = !masterRateOut_;
+
+    // Session samples count afresh from here.
+    ++masterSeed_;
+    masterTimelineValid_ = false;
+    masterOutputConceal_.reset();
+}
+
+// Map a host time onto the master sample timeline, extrapolating from the
+// last published master clock point at the estimated master rate. Returns
+// false until the master has published a clock point.
+bool EngineCore::masterSampleTimeAt(uint64_t hostTime, int64_t* outSampleTime) const
+{
+    ClockSnapshot clock;
+    if (!shm_->masterClock.tryLoad(&clock) || clock.hostTime == 0) return false;
+
+    double t = clock.sampleTime
+             + config_.time->deltaSeconds(hostTime, clock.hostTime) * clock.rate;
+    *outSampleTime = std::llround(t);
+    return true;
+}
+
+// ---- Master IOProc ----
+// Direct passthrough: hardware → shared memory, shared memory → hardware,
+// through the master's stages when it runs off the session rate. Also
+// publishes clock timestamps for the plugin's GetZeroTimeStamp, in session
+// samples: the master's own, scaled by the stages' exact ratio.
+
+void EngineCore::masterIO(const IOCycle& cycle)
+{
+    uint32_t frames = cycle.input.frames;
+
+    // Update master clock estimate.
+    if (cycle.now.hostValid) {
+        masterEstimator_->update(cycle.now.hostTime, frames);
+    }
+
+    // Publish master clock → plugin reads this in GetZeroTimeStamp, the
+    // slave IOProcs and cue taps extrapolate from it. A block that doesn't
+    // start where the last one ended (overload, dropped buffers) is a new
+    // timeline: bump the seed so the HAL resynchronizes.
+    const IOTime& inputTime = cycle.inputTime;
+    if (inputTime.sampleValid && inputTime.hostValid) {
+        int64_t sampleTime = std::llround(inputTime.sampleTime);
+        if (masterTimelineValid_ && sampleTime != masterNextSampleTime_) {
+            ++masterSeed_;
+        }
+        masterNextSampleTime_ = sampleTime + frames;
+        masterTimelineValid_ = true;
+
+        double scale = sessionRate_ / masterNominal_;
+        ClockSnapshot clock;
+        clock.sampleTime = inputTime.sampleTime * scale;
+        clock.hostTime = inputTime.hostTime;
+        clock.seed = masterSeed_;
+        clock.rate = masterEstimator_->rate() * scale;
+        clock.rateStable = masterEstimator_->isStable() ? 1 : 0;
+        shm_->masterClock.store(clock);
+    }
+
+    // Master input → shared memory (for plugin to serve to Ableton).
+    // The master's own sample time is the tag — exact, no tolerance: any
+    // mismatch means frames were dropped. Through a stage it is the scaled
+    // time less the stage's delay, which only lands within a frame of the
+    // frames written, so it gets a resampled stream's tolerance.
+    if (!cycle.input.empty() && masterRateIn_) {
+        RationalResampler& stage = *masterRateIn_;
+        uint32_t channels = masterInput_->frameSamples();
+        if (inputTime.sampleValid) {
+            auto tag = std::llround(inputTime.sampleTime * sessionRate_ / masterNominal_);
+            masterInput_->alignTo(tag - stage.outputDelay(), kResampledTimelineTolerance);
+        }
+        uint32_t lost = 0;
+        forInput(cycle.input, channels, masterInputGather_.data(),
+                 [&](const float* block, uint32_t n) {
+                     uint32_t dropped = 0;
+                     auto spans = masterInput_->reserve(stage.outputFor(n), &dropped);
+                     lost += dropped;
+                     masterInput_->commitWrite(stageIntoSpans(stage, channels, block, n, spans));
+                 });
+        masterInputMetrics_->onWrite(lost);
+    } else if (!cycle.input.empty()) {
+        if (inputTime.sampleValid) {
+            masterInput_->alignTo(std::llround(inputTime.sampleTime), 0);
+        }
+        uint32_t lost = 0;
+        forInput(cycle.input, masterInput_->frameSamples(), masterInputGather_.data(),
+                 [&](const float* block, uint32_t n) {
+                     lost += masterInput_->produce(block, n);
+                 });
+        masterInputMetrics_->onWrite(lost);
+    }
+
+    // Shared memory → master output (Ableton's audio going to the hardware).
+    if (!cycle.output.empty()) {
+        uint32_t outFrames = cycle.output.frames;
+        uint32_t fill = masterOutput_->availableRead();
+        uint32_t served = 0;
+
+        // Through a stage a cycle pulls more or fewer frames than the
+        // plugin writes in one, so the ring's low point depends on where
+        // reading started: start it a pull ahead, or it can land short.
+        bool hold = false;
+        if (!masterOutputPrimed_) {
+            hold = fill < 2 * masterRateOut_->inputFor(outFrames);
+            masterOutputPrimed_ = !hold;
+        }
+
+        forOutput(cycle.output, masterOutput_->frameSamples(), masterOutputScatter_.data(),
+                  [&](float* dst, uint32_t n) {
+                      uint32_t got = hold ? 0
+                          : masterRateOut_
+                          ? pullStageFromRing(*masterRateOut_, masterRateOutScratch_.data(),
+                                              *masterOutput_, dst, n)
+                          : masterOutput_->readSome(dst, n);
+                      masterOutputConceal_.apply(dst, n, 0, got);
+                      served += got;
+                  });
+        masterOutputMetrics_->onRead(fill, outFrames, served);
+    }
+}
+
+// ---- Slave output latency ----
+// The plugin stamps every output block with its master-domain HAL time, so
+// the slave's callback can read the stream's queue straight off the ring:
+// when the oldest queued frame goes into the converter (this buffer's
+// master output time) minus when it was meant to be heard. The servo holds
+// that at the device's outputQueue, and the converter's group delay comes
+// on top — that sum is what publishOutputLatency() tells the plugin to
+// report, so a tier switch changes the reported latency rather than the
+// queue. Errors the servo shouldn't have to slew through — start-up, a
+// plugin stall — are fixed by waiting or skipping. Returns true while the
+// IOProc should play silence and leave the ring be.
+
+bool EngineCore::holdOutput(Slave& s, const IOTime& outputTime, uint32_t outputFrames)
+{
+    int64_t masterTime = 0, tailTime = 0;
+    if (!outputTime.hostValid
+        || !masterSampleTimeAt(outputTime.hostTime, &masterTime)
+        || !s.output->tailTime(&tailTime))
+    {
+        // No timeline to steer by: plain drift ratio.
+        return false;
+    }
+
+    int64_t error = masterTime - tailTime
+                  - static_cast<int64_t>(s.outputQueue);
+
+    if (error < -kLatencyResyncFrames || (!s.outputPrimed && error < 0)) {
+        // Too little queued: wait for the latency to build up.
+        s.outputPrimed = false;
+        s.outputServo.reset();
+        return true;
+    }
+    if (error > kLatencyResyncFrames) {
+        // Too much queued: drop the excess rather than slew off seconds.
+        uint32_t avail = s.output->availableRead();
+        s.output->consume(error < avail ? static_cast<uint32_t>(error) : avail);
+        s.outputServo.reset();
+        error = 0;
+    }
+
+    s.outputPrimed = true;
+    s.outputServo.update(static_cast<double>(error), outputFrames, s.nominal);
+    return false;
+}
+
+void EngineCore::publishOutputLatency(Slave& s)
+{
+    uint32_t stageDelay = s.rateOut ? s.rateOut->inputDelay() : 0;
+    s.outputLatency->store(s.outputQueue + s.resamplerOut->groupDelay()
+                           + stageDelay, std::memory_order_relaxed);
+}
+
+// ---- Slave IOProc (resampled to/from the master clock) ----
+// Input: read from the hardware, resample to the master clock, write to
+// shared memory. Output: read from shared memory, resample to the slave's
+// clock, write to the hardware.
+
+void EngineCore::slaveIO(uint32_t device, const IOCycle& cycle)
+{
+    Slave* sp = slave(device);
+    if (!sp) return;
+    Slave& s = *sp;
+    uint32_t inputFrames = cycle.input.frames;
+
+    // Update the slave's clock estimate.
+    if (cycle.now.hostValid) {
+        s.estimator->update(cycle.now.hostTime, inputFrames);
+    }
+
+    // The master rate comes from the master IOProc's last clock publish;
+    // the master estimator itself belongs to that thread. Publish the
+    // combined drift record for the cue tap and for monitoring.
+    ClockSnapshot clock;
+    bool masterStable = shm_->masterClock.tryLoad(&clock) && clock.rateStable;
+    bool dllReady = masterStable && s.estimator->isStable();
+
+    if (!dllReady) {
+        s.inputServo.reset();
+        s.outputServo.reset();
+    }
+
+    // Servo corrections are as of the previous callback.
+    DriftSnapshot drift;
+    drift.masterRate = clock.rate;
+    drift.slaveRate = s.estimator->rate();
+    drift.ratio = dllReady ? clock.rate / s.estimator->rate() : 1.0;
+    drift.inputCorrection = s.inputServo.correction();
+    drift.outputCorrection = s.outputServo.correction();
+    drift.ready = dllReady ? 1 : 0;
+    s.drift->store(drift);
+
+    // Stamp the input block with its master-domain capture time. The
+    // resampled output lags the input by the converter's group delay.
+    // Whatever error the stamp leaves (within tolerance) is the input
+    // servo's error: the plugin reads at a fixed kInputAlignmentLatency
+    // behind, so holding the timeline on its stamps is what holds the
+    // stream at that latency. The group delay follows a converter switch
+    // frame by frame, so the stamps stay continuous through one. A rate
+    // stage's delay comes on top.
+    int64_t masterTime = 0;
+    if (cycle.inputTime.hostValid && masterSampleTimeAt(cycle.inputTime.hostTime, &masterTime)) {
+        int64_t delay = s.rateIn ? s.rateIn->outputDelay() : 0;
+        if (dllReady && s.resamplerIn) delay += s.resamplerIn->groupDelay();
+        int64_t error = s.input->alignTo(masterTime - delay, kResampledTimelineTolerance);
+        // Ahead of the stamps → resample slower.
+        if (dllReady) s.inputServo.update(-static_cast<double>(error), inputFrames, s.nominal);
+    }
+
+    // ---- Input → resample → shared memory ----
+    // Committed once the output is done: a worker, if there is one, runs
+    // the conversion meanwhile.
+    bool inputConverting = false;
+    bool inputPosted = false;
+    if (!cycle.input.empty() && s.resamplerIn && dllReady) {
+        // What's left of the drift ratio after the rate stage, if any.
+        double ratio = s.inputServo.apply(drift.ratio);
+        uint32_t staged = inputFrames;
+        if (s.rateIn) {
+            ratio /= s.rateIn->ratio();
+            staged = s.rateIn->outputFor(inputFrames);
+        }
+
+        // Plus whatever a converter switch has queued to go out first.
+        auto maxOutput = static_cast<uint32_t>(
+            static_cast<double>(staged) * ratio + 4) + s.resamplerIn->extraOutput();
+
+        // Resample straight into the ring — no intermediate buffer —
+        // making room under its overflow policy.
+        uint32_t lost = 0;
+        auto spans = s.input->reserve(maxOutput, &lost);
+        s.inputMetrics->onWrite(lost);
+
+        InputConversion& job = s.inputConversion;
+        job.resampler = s.resamplerIn.get();
+        job.stage = s.rateIn.get();
+        job.scratch = s.rateInScratch.data();
+        job.gather = s.inputGather.data();
+        job.channels = s.input->frameSamples();
+        job.input = &cycle.input;
+        job.ratio = ratio;
+        job.spans = spans;
+        job.generated = 0;
+        inputConverting = true;
+        inputPosted = workers_ && workers_->post(s.inputJob);
+        if (!inputPosted) InputConversion::run(&job);
+    } else if (!cycle.input.empty() && s.rateIn) {
+        // Clocks not stable yet, device off the session rate: the rate
+        // stage alone, at drift ratio 1 — raw frames would play at the
+        // wrong speed.
+        RationalResampler& stage = *s.rateIn;
+        uint32_t channels = s.input->frameSamples();
+        uint32_t lost = 0;
+        forInput(cycle.input, channels, s.inputGather.data(),
+                 [&](const float* block, uint32_t n) {
+                     uint32_t dropped = 0;
+                     auto spans = s.input->reserve(stage.outputFor(n), &dropped);
+                     lost += dropped;
+                     s.input->commitWrite(stageIntoSpans(stage, channels, block, n, spans));
+                 });
+        s.inputMetrics->onWrite(lost);
+    } else if (!cycle.input.empty()) {
+        // Clocks not stable yet — pass through raw (better than silence).
+        uint32_t lost = 0;
+        forInput(cycle.input, s.input->frameSamples(), s.inputGather.data(),
+                 [&](const float* block, uint32_t n) { lost += s.input->produce(block, n); });
+        s.inputMetrics->onWrite(lost);
+    }
+
+    // ---- Shared memory → resample → Output ----
+    if (!cycle.output.empty()) {
+        uint32_t outputFrames = cycle.output.frames;
+        uint32_t channels = s.output->frameSamples();
+        float* scratch = s.outputScatter.data();
+
+        if (s.resamplerOut && dllReady && !holdOutput(s, cycle.outputTime, outputFrames)) {
+            double ratio = s.outputServo.apply(1.0 / drift.ratio);
+
+            // Pull master-domain frames straight out of the ring into the
+            // hardware buffer — through the rate stage, if any — until
+            // it's full. A short ring still gives up what it has; the
+            // concealer covers the rest.
+            uint32_t fill = s.output->availableRead();
+            uint32_t generated = 0;
+            forOutput(cycle.output, channels, scratch, [&](float* dst, uint32_t frames) {
+                uint32_t gen = s.rateOut
+                    ? pullStagedFromRing(*s.rateOut, s.rateOutScratch.data(), *s.resamplerOut,
+                                         *s.output, ratio / s.rateOut->ratio(), dst, frames)
+                    : pullFromRing(*s.resamplerOut, *s.output, ratio, dst, frames);
+                s.outputConceal.apply(dst, frames, 0, gen);
+                generated += gen;
+            });
+            s.outputMetrics->onRead(fill, outputFrames, generated);
+
+            if (s.resamplerOut->switches() != s.outSwitches) {
+                s.outSwitches = s.resamplerOut->switches();
+                publishOutputLatency(s);
+            }
+        } else if (s.resamplerOut && dllReady) {
+            // Building up to the target latency — nothing to play yet.
+            forOutput(cycle.output, channels, scratch, [&](float* dst, uint32_t frames) {
+                s.outputConceal.apply(dst, frames, 0, 0);
+            });
+        } else {
+            // Clocks not ready — direct passthrough, through the rate
+            // stage alone if the device is off the session rate.
+            uint32_t fill = s.output->availableRead();
+            uint32_t served = 0;
+            forOutput(cycle.output, channels, scratch, [&](float* dst, uint32_t frames) {
+                uint32_t got = s.rateOut
+                    ? pullStageFromRing(*s.rateOut, s.rateOutScratch.data(), *s.output,
+                                        dst, frames)
+                    : s.output->readSome(dst, frames);
+                s.outputConceal.apply(dst, frames, 0, got);
+                served += got;
+            });
+            s.outputMetrics->onRead(fill, outputFrames, served);
+        }
+    }
+
+    // ---- Input, collected ----
+    // A worker that hasn't started on it by now is too late: the job comes
+    // back and runs here.
+    if (inputConverting) {
+        if (inputPosted) workers_->collect(s.inputJob);
+        if (s.inputConversion.generated > 0) {
+            s.input->commitWrite(s.inputConversion.generated);
+        }
+    }
+}
+
+// ---- Cue tap (a process's audio on one of the slave's output streams) ----
+// Resample from the slave's clock → master clock, write to its cue ring.
+
+void EngineCore::cueIO(uint32_t device, const IOBufferList& input, const IOTime& inputTime)
+{
+    Slave* sp = slave(device);
+    if (input.empty() || !sp || !sp->resamplerCue) return;
+    Slave& s = *sp;
+    uint32_t frames = input.frames;
+    uint32_t channels = s.cue->frameSamples();
+    float gain = config_.devices[device].cueGain;
+
+    // Drift state comes from the slave IOProc's last publish; the
+    // estimators themselves belong to the IOProc threads.
+    DriftSnapshot drift;
+    bool dllReady = s.drift->tryLoad(&drift) && drift.ready;
+
+    int64_t masterTime = 0;
+    if (inputTime.hostValid && masterSampleTimeAt(inputTime.hostTime, &masterTime)) {
+        int64_t delay = s.rateCue ? s.rateCue->outputDelay() : 0;
+        if (dllReady) delay += s.resamplerCue->groupDelay();
+        int64_t error = s.cue->alignTo(masterTime - delay, kResampledTimelineTolerance);
+        // Ahead of the stamps → resample slower.
+        if (dllReady) s.cueServo.update(-static_cast<double>(error), frames, s.nominal);
+    }
+
+    if (dllReady) {
+        double ratio = s.cueServo.apply(drift.ratio);
+        uint32_t staged = frames;
+        if (s.rateCue) {
+            ratio /= s.rateCue->ratio();
+            staged = s.rateCue->outputFor(frames);
+        }
+        auto maxOutput = static_cast<uint32_t>(
+            static_cast<double>(staged) * ratio + 4) + s.resamplerCue->extraOutput();
+
+        // Resample straight into the cue ring, making room under its
+        // overflow policy.
+        uint32_t lost = 0;
+        auto spans = s.cue->reserve(maxOutput, &lost);
+        s.cueMetrics->onWrite(lost);
+
+        uint32_t generated = convertInput(s.rateCue.get(), s.rateCueScratch.data(),
+                                          *s.resamplerCue, channels, input,
+                                          s.cueGather.data(), ratio, spans);
+        if (generated > 0) {
+            // Compensate for the tap's attenuation (DeviceConfig::cueGain).
+            if (gain != 1.0f) scaleSpans(spans, generated, channels, gain);
+            s.cue->commitWrite(generated);
+        }
+    } else if (s.rateCue) {
+        s.cueServo.reset();
+
+        // Clocks not stable, device off the session rate: the rate stage
+        // alone, at drift ratio 1.
+        uint32_t lost = 0;
+        auto spans = s.cue->reserve(s.rateCue->outputFor(frames), &lost);
+        s.cueMetrics->onWrite(lost);
+
+        uint32_t written = 0;
+        forInput(input, channels, s.cueGather.data(), [&](const float* block, uint32_t n) {
+            written += stageIntoSpans(*s.rateCue, channels, block, n,
+                                      spansAfter(spans, written, channels));
+        });
+        if (gain != 1.0f) scaleSpans(spans, written, channels, gain);
+        s.cue->commitWrite(written);
+    } else {
+        s.cueServo.reset();
+
+        // Clocks not stable — pass through raw (still compensate gain).
+        // Gain is applied on the way into the ring.
+        uint32_t lost = 0;
+        auto spans = s.cue->reserve(frames, &lost);
+        s.cueMetrics->onWrite(lost);
+
+        uint32_t written = 0;
+        forInput(input, channels, s.cueGather.data(), [&](const float* block, uint32_t n) {
+            auto dst = spansAfter(spans, written, channels);
+            uint32_t first = std::min(n, dst.frames1);
+            uint32_t second = std::min(n - first, dst.frames2);
+            for (uint32_t i = 0; i < first * channels; ++i) {
+                dst.data1[i] = block[i] * gain;
+            }
+            for (uint32_t i = 0; i < second * channels; ++i) {
+                dst.data2[i] = block[first * channels + i] * gain;
+            }
+            written += first + second;
+        });
+        s.cue->commitWrite(written);
+    }
+}
+
+} // namespace flux
@@ -0,0 +1,402 @@
+#pragma once
+
+// EngineCore: the helper's realtime processing, without CoreAudio.
+//
+// Everything the IOProcs do between the hardware buffers and the shared
+// memory rings lives here — clock estimation, the master clock and drift
+// publishes, timeline stamping, the latency servos, resampling and
+// concealment. AudioEngine owns the devices and the process taps and
+// forwards their callbacks as plain buffers and timestamps; the simulator
+// (bench/EngineSim.cpp) drives the same entry points from simulated
+// devices, so the whole data path runs on any platform.
+//
+// The engine aggregates one master device and any number of slaves, as
+// configured (EngineConfig::devices) and laid out in shared memory
+// (layoutFor()). Each slave has its own clock estimator, servos, converters
+// and rings; nothing is shared between slaves. Every stream carries as many
+// of its device's channels as configured, interleaved, in one ring and one
+// converter; the engine takes them from and puts them back into whatever
+// buffers the device has (IOBufferList).
+//
+// Shared memory runs at the session rate — the virtual device's, one of
+// kSupportedSampleRates. The master clock is published in session samples,
+// so the plugin and every slave see one timeline whatever the master's own
+// rate; any device at another nominal rate, the master included, converts
+// through a fixed-ratio stage (RationalResampler.h).
+//
+// Threading is as in the helper: masterIO() on the master's IOProc thread,
+// slaveIO() for each slave on that slave's IOProc thread, cueIO() for a
+// slave on its tap thread. They only share state through the seqlock
+// records in shared memory, so the devices' IOProcs run in parallel on as
+// many cores as there are. Session control (begin/end, clock setup) must
+// not overlap the IO calls. With worker threads configured, slaveIO() runs
+// its input conversion on one of them while it converts the output itself
+// (WorkerPool.h); all slaves post to the same pool.
+
+#include "ClockEstimators.h"
+#include "Conceal.h"
+#include "CrossfadeResampler.h"
+#include "FillServo.h"
+#include "RationalResampler.h"
+#include "SharedMemory.h"
+#include "WorkerPool.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace flux {
+
+// One hardware timestamp. Either part may be missing, as in CoreAudio.
+struct IOTime {
+    uint64_t hostTime = 0;
+    double   sampleTime = 0.0;
+    bool     hostValid = false;
+    bool     sampleValid = false;
+};
+
+// One hardware buffer: `channels` interleaved channels — one per buffer on
+// a non-interleaved device.
+struct IOBuffer {
+    float*   data = nullptr;
+    uint32_t channels = 0;
+};
+
+// A device's buffers for one direction of an IO cycle, as CoreAudio's
+// AudioBufferList has them; every buffer holds `frames` frames. A stream
+// takes the first of the device's channels, in buffer order, and leaves
+// the rest — silenced, on the way out. Only one interleaved buffer of
+// exactly the stream's channels is used in place; any other layout, two
+// mono buffers for a stereo stream included, costs a gather or scatter
+// copy (EngineCore.cpp). Empty: no IO that way.
+struct IOBufferList {
+    IOBuffer buffers[kMaxIOBuffers];
+    uint32_t count = 0;
+    uint32_t frames = 0;
+
+    // One interleaved buffer (or none, for nullptr).
+    static IOBufferList interleaved(float* data, uint32_t channels, uint32_t frames);
+
+    bool empty() const { return count == 0; }
+};
+
+// One IOProc cycle: the device's buffers and their timestamps.
+struct IOCycle {
+    IOTime       now;
+    IOBufferList input;
+    IOTime       inputTime;
+    IOBufferList output;
+    IOTime       outputTime;
+};
+
+// One device the engine aggregates.
+struct DeviceConfig {
+    // Name in the shared memory device table, the plugin's stream names and
+    // --resampler arguments: short (kDeviceNameLength), unique.
+    std::string name;
+
+    // CoreAudio device UID (helper only).
+    std::string uid;
+
+    // Ring capacity (frames, power of two) for the device's streams; 0 for
+    // the Constants.h default. See LayoutTable::addDevice.
+    uint32_t    ringFrames = 0;
+
+    // Channels the capture and playback streams carry, 1 to
+    // kMaxStreamChannels: the device's first ones, in one ring and one
+    // converter each. A cue tap is stereo.
+    uint32_t    inputChannels = kChannelsPerDevice;
+    uint32_t    outputChannels = kChannelsPerDevice;
+
+    // ---- Slaves only ----
+
+    // Tap the device's output for a cue stream: the stream index to tap,
+    // a bundle-id substring for the process whose audio it is, and a gain
+    // to make up for the tap's attenuation.
+    bool        cue = false;
+    int         cueStreamIndex = kFLX4CueStreamIndex;
+    std::string cueProcess = kDjayBundleSubstring;
+    float       cueGain = 1.0f;
+
+    // Converter tier per resampled stream at session start; setResampler()
+    // switches them while running. A master's streams are only resampled
+    // by a fixed stage off the session rate, at these tiers' qualities.
+    ResamplerTier inputResampler;
+    ResamplerTier cueResampler;
+    ResamplerTier outputResampler;
+
+    // Master-domain audio (frames at kNominalSampleRate; as long at other
+    // session rates) the output servo keeps queued ahead of the converter.
+    // The stream's latency is this plus the converter's group delay; the
+    // engine publishes it for the plugin to report.
+    uint32_t    outputQueue = kSlaveOutputQueueFrames;
+};
+
+// Push as the master and the FLX4, with its cue tap, as the one slave.
+std::vector<DeviceConfig> defaultDevices();
+
+struct EngineConfig {
+    // The master first, then the slaves.
+    std::vector<DeviceConfig> devices = defaultDevices();
+
+    ClockEstimatorKind clockEstimator = kClockEstimatorKalman;
+
+    // Realtime worker threads the slave IOProcs hand their input
+    // conversions to; 0 runs everything inline. Each slave posts one job a
+    // cycle, so about one per slave is plenty. The cue taps already run on
+    // their own threads. workerSetup, if set, runs on each worker as it
+    // starts.
+    uint32_t              workerThreads = 0;
+    std::function<void()> workerSetup;
+
+    const TimeSource*  time = &hostTimeSource();
+};
+
+// The shared memory layout for a configuration. False if it has no
+// devices, too many, a name that doesn't fit or a channel count out of
+// range.
+bool layoutFor(const EngineConfig& config, LayoutTable* out);
+
+// Apply a resampler choice: "tier" for every resampled stream, or
+// "stream=tier" for one of them — "<device>-in", "<device>-cue" or
+// "<device>-out" for a slave (tier names as in parseResamplerTier). False
+// if it doesn't parse.
+bool parseResamplerArg(const char* arg, EngineConfig* config);
+
+// The device and stream a parseResamplerArg() stream name stands for.
+// False if none.
+bool parseResampledStream(const char* name, const EngineConfig& config,
+                          uint32_t* outDevice, StreamRole* outRole);
+
+class EngineCore {
+public:
+    EngineCore(SharedMemoryLayout* shm, const EngineConfig& config = {});
+
+    // The layout has the configured devices, in order, with every stream
+    // the engine drives.
+    bool valid() const;
+
+    uint32_t deviceCount() const { return static_cast<uint32_t>(config_.devices.size()); }
+
+    // ---- Session control ----
+
+    // New session: fresh master timeline, resamplers, servos and
+    // concealers. False if a slave's input/output resamplers can't be
+    // created; a missing cue resampler only disables that cue path.
+    // Each stream's timeline stamps follow its resampler's group delay.
+    bool begin();
+    void end();
+
+    // Crossfade a slave's resampled stream over to another converter tier
+    // while IO runs. Builds the converter here, off the realtime threads;
+    // the stream's thread picks it up on its next block. False if the
+    // stream isn't running a resampler or the tier can't be created.
+    bool setResampler(uint32_t device, StreamRole role, const ResamplerTier& tier);
+
+    // Free the converters switches have retired. Call now and then from
+    // the control thread.
+    void collect();
+
+    // (Re)create a device's clock estimator at its nominal rate, seeded
+    // with a rate from an earlier session if seedRate > 0. A device whose
+    // nominal rate differs from the session's gets a fixed-ratio stage on
+    // each stream (see Slave below); changing its rate restarts its
+    // converters.
+    void setClock(uint32_t device, double nominalRate, double seedRate = 0.0);
+
+    // Run shared memory at another sample rate: rebuilds every device's
+    // stages, restarts the converters and servos and starts a new master
+    // timeline. IO must be stopped. False, changing nothing, unless the
+    // rate is one of kSupportedSampleRates.
+    bool setSessionRate(double rate);
+    double sessionRate() const { return sessionRate_; }
+
+    // Device went away: forget its clock.
+    void resetClock(uint32_t device);
+
+    // The slave runs a cue converter.
+    bool hasCue(uint32_t device) const;
+
+    const EngineConfig& config() const { return config_; }
+
+    // The slave IOProcs' worker pool, nullptr if they run inline.
+    const WorkerPool* workers() const { return workers_.get(); }
+
+    // ---- Realtime entry points ----
+
+    // Master: passthrough both ways — through its stages off the session
+    // rate — publishes the master clock in session samples.
+    void masterIO(const IOCycle& cycle);
+
+    // A slave: resampled to/from the master clock, publishes its drift.
+    void slaveIO(uint32_t device, const IOCycle& cycle);
+
+    // A slave's cue tap (its clock): resampled into its cue ring.
+    void cueIO(uint32_t device, const IOBufferList& input, const IOTime& inputTime);
+
+private:
+    // One cycle's slave input conversion, as a job: set up and committed
+    // by the slave's IOProc, run on a worker or inline. Only the job
+    // touches the input converter, the gather buffer and the reserved
+    // spans between post and collect; the hardware buffers stay valid
+    // until the IOProc returns, after collect.
+    struct InputConversion {
+        CrossfadeResampler* resampler = nullptr;
+        RationalResampler*  stage = nullptr;      // If any, with its scratch
+        float*              scratch = nullptr;
+        float*              gather = nullptr;     // For a device that needs it
+        uint32_t            channels = 0;
+        const IOBufferList* input = nullptr;
+        double              ratio = 1.0;
+        RingSpans<float>    spans;
+        uint32_t            generated = 0;
+
+        static void run(void* context);
+    };
+
+    // Everything one slave device needs, owned by its IOProc thread except
+    // the cue path (its tap thread) and the converter switches (session
+    // control).
+    struct Slave {
+        uint32_t device = 0;
+
+        // Rings resolved from the stream table once, at construction; no
+        // cue ring unless the device is configured with one. Their metrics
+        // blocks; this process owns one side of each stream.
+        AudioRing*     input = nullptr;
+        AudioRing*     cue = nullptr;
+        AudioRing*     output = nullptr;
+        StreamMetrics* inputMetrics = nullptr;
+        StreamMetrics* cueMetrics = nullptr;
+        StreamMetrics* outputMetrics = nullptr;
+        std::atomic<uint32_t>* outputLatency = nullptr;
+        DriftRecord*   drift = nullptr;
+
+        // Underrun concealment for the output, which this process consumes.
+        StreamConcealer outputConceal;
+
+        // Interleaved scratch for devices whose buffers aren't the
+        // streams' layout (forInput / forOutput in EngineCore.cpp), each
+        // on its stream's thread. kMaxIOBufferFrames of the stream's
+        // channels.
+        std::vector<float> inputGather;
+        std::vector<float> cueGather;
+        std::vector<float> outputScatter;
+
+        // Other threads read the rate from the drift record.
+        std::unique_ptr<ClockEstimator> estimator;
+
+        // Rate servos trimming the drift ratio per resampled stream, each
+        // owned by the thread that runs that stream's resampler. Rebuilt
+        // for the session rate with the stages (buildRateStages).
+        FillServo inputServo;       // IOProc
+        FillServo outputServo;      // IOProc
+        FillServo cueServo;         // Cue tap thread
+        bool      outputPrimed = false;
+
+        // The output servo's target: DeviceConfig::outputQueue, in session
+        // frames (buildRateStages).
+        uint32_t  outputQueue = kSlaveOutputQueueFrames;
+
+        // Resamplers, each as wide as its stream. Input: hardware → shared
+        // memory (slave → master clock domain). Output: shared memory →
+        // hardware (master → slave). Cue: tap audio → shared memory (slave
+        // → master). All three read/write the shared memory rings in place
+        // (prepareWrite / readSpans), so there are no intermediate
+        // resample buffers. Each can be switched at runtime
+        // (CrossfadeResampler.h). The output's switch count, last seen,
+        // tells the IOProc to republish its latency.
+        std::unique_ptr<CrossfadeResampler> resamplerIn;
+        std::unique_ptr<CrossfadeResampler> resamplerOut;
+        std::unique_ptr<CrossfadeResampler> resamplerCue;
+        uint32_t outSwitches = 0;
+
+        // With the slave at another nominal rate than the session, each
+        // stream also has a fixed-ratio stage between the two rates: ahead
+        // of its converter on the way in, behind it on the way out. The
+        // converter then runs at the drift ratio divided by the stage's,
+        // near 1 — so switching, servos and timeline stamps work as at
+        // matching rates — and the stage's delay adds to the converter's.
+        // Each stage converts through its own scratch buffer, a chunk at a
+        // time, on its stream's thread. nullptr at matching rates, or ones
+        // too far apart or too oddly related for a fixed stage
+        // (RationalResampler::make): the converter does it all.
+        double nominal = kNominalSampleRate;
+        std::unique_ptr<RationalResampler> rateIn;
+        std::unique_ptr<RationalResampler> rateCue;
+        std::unique_ptr<RationalResampler> rateOut;
+        std::vector<float> rateInScratch;
+        std::vector<float> rateCueScratch;
+        std::vector<float> rateOutScratch;
+
+        InputConversion inputConversion;
+        RealtimeJob     inputJob{&InputConversion::run, &inputConversion};
+    };
+
+    // The slave for a device index, nullptr for the master or out of range.
+    Slave* slave(uint32_t device) const;
+
+    // Master sample time at a given host time (for stamping slave input).
+    bool masterSampleTimeAt(uint64_t hostTime, int64_t* outSampleTime) const;
+
+    // Slave output latency control (its IOProc). True → play silence.
+    bool holdOutput(Slave& s, const IOTime& outputTime, uint32_t outputFrames);
+
+    // Publish a slave output's latency for the plugin to report: queue
+    // plus the active converter's group delay.
+    void publishOutputLatency(Slave& s);
+
+    // The stream's converter, nullptr if it has none.
+    static CrossfadeResampler* resampler(const Slave& s, StreamRole role);
+
+    // (Re)build a slave's fixed-ratio stages for the nominal rates, or drop
+    // them if the rates match. Session control.
+    void buildRateStages(Slave& s);
+
+    // The same for the master's streams, and a new master timeline.
+    void buildMasterStages();
+
+    SharedMemoryLayout*    shm_;
+    EngineConfig           config_;
+
+    // ---- Master ----
+    // Rings and metrics resolved once; the output's concealer and the
+    // estimator belong to the master's IOProc thread. Other threads read
+    // its rate from the masterClock seqlock record.
+    AudioRing*      masterInput_;
+    AudioRing*      masterOutput_;
+    StreamMetrics*  masterInputMetrics_;
+    StreamMetrics*  masterOutputMetrics_;
+    std::atomic<uint32_t>* masterOutputLatency_;
+    StreamConcealer masterOutputConceal_;
+    std::vector<float> masterInputGather_;
+    std::vector<float> masterOutputScatter_;
+    std::unique_ptr<ClockEstimator> masterEstimator_;
+    double          masterNominal_ = kNominalSampleRate;
+    double          sessionRate_ = kNominalSampleRate;
+
+    // Stages between the master's rate and the session's (nullptr while
+    // they match): the input's straight into its ring, the output's
+    // through scratch. Like a slave's, with no converter behind them —
+    // the master is the clock. The output holds silence after a rebuild
+    // until its ring has queued a pull's worth beyond the first pull.
+    std::unique_ptr<RationalResampler> masterRateIn_;
+    std::unique_ptr<RationalResampler> masterRateOut_;
+    std::vector<float> masterRateOutScratch_;
+    bool            masterOutputPrimed_ = true;
+
+    // Master timeline continuity (master IOProc only) — drives the clock
+    // seed.
+    uint64_t masterSeed_ = 0;
+    int64_t  masterNextSampleTime_ = 0;
+    bool     masterTimelineValid_ = false;
+
+    // ---- Slaves ----
+    // Indexed by device; the master's entry is empty. Each is allocated on
+    // its own, so no two IOProcs write the same cache lines.
+    std::vector<std::unique_ptr<Slave>> slaves_;
+    std::unique_ptr<WorkerPool>         workers_;
+};
+
+} // namespace flux
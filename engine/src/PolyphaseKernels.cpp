@@ -0,0 +1,288 @@
+#include "PolyphaseKernels.h"
+
+#include <cstddef>
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define FLUX_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__)
+#define FLUX_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace flux {
+
+// ---- Scalar ----
+
+static void kernelScalar(const float* x, const float* h0, const float* h1,
+                         float frac, uint32_t taps, float* out)
+{
+    float left = 0.0f, right = 0.0f;
+    for (uint32_t k = 0; k < taps; ++k) {
+        float h = h0[k] + frac * (h1[k] - h0[k]);
+        left += x[2 * k] * h;
+        right += x[2 * k + 1] * h;
+    }
+    out[0] = left;
+    out[1] = right;
+}
+
+// Several stereo streams interleaved into one C-channel frame.
+template <uint32_t C>
+static void kernelScalarN(const float* x, const float* h0, const float* h1,
+                          float frac, uint32_t taps, float* out)
+{
+    float acc[C] = {};
+    for (uint32_t k = 0; k < taps; ++k) {
+        float h = h0[k] + frac * (h1[k] - h0[k]);
+        for (uint32_t c = 0; c < C; ++c) acc[c] += x[C * k + c] * h;
+    }
+    for (uint32_t c = 0; c < C; ++c) out[c] = acc[c];
+}
+
+#ifdef FLUX_KERNELS_X86
+
+// [L R L R] → out[0] = L + L, out[1] = R + R.
+static inline void storeStereo(__m128 acc, float* out)
+{
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    _mm_storel_pi(reinterpret_cast<__m64*>(out), acc);
+}
+
+// ---- SSE2: 4 taps (8 samples) per iteration ----
+
+static void kernelSSE(const float* x, const float* h0, const float* h1,
+                      float frac, uint32_t taps, float* out)
+{
+    __m128 f = _mm_set1_ps(frac);
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (uint32_t k = 0; k < taps; k += 4) {
+        __m128 a = _mm_loadu_ps(h0 + k);
+        __m128 b = _mm_loadu_ps(h1 + k);
+        __m128 h = _mm_add_ps(a, _mm_mul_ps(f, _mm_sub_ps(b, a)));
+        __m128 lo = _mm_unpacklo_ps(h, h);             // h0 h0 h1 h1
+        __m128 hi = _mm_unpackhi_ps(h, h);             // h2 h2 h3 h3
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(lo, _mm_loadu_ps(x + 2 * k)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(hi, _mm_loadu_ps(x + 2 * k + 4)));
+    }
+    storeStereo(_mm_add_ps(acc0, acc1), out);
+}
+
+// 4 or 8 channels: each coefficient broadcast across a frame's vectors,
+// alternate taps into two accumulator sets.
+template <uint32_t C>
+static void kernelSSEN(const float* x, const float* h0, const float* h1,
+                       float frac, uint32_t taps, float* out)
+{
+    constexpr uint32_t V = C / 4;
+    __m128 f = _mm_set1_ps(frac);
+    __m128 acc0[V], acc1[V];
+    for (uint32_t v = 0; v < V; ++v) acc0[v] = acc1[v] = _mm_setzero_ps();
+    for (uint32_t k = 0; k < taps; k += 4) {
+        __m128 a = _mm_loadu_ps(h0 + k);
+        __m128 b = _mm_loadu_ps(h1 + k);
+        __m128 h = _mm_add_ps(a, _mm_mul_ps(f, _mm_sub_ps(b, a)));
+        __m128 hk[4] = {_mm_shuffle_ps(h, h, 0x00), _mm_shuffle_ps(h, h, 0x55),
+                        _mm_shuffle_ps(h, h, 0xAA), _mm_shuffle_ps(h, h, 0xFF)};
+        const float* frame = x + static_cast<size_t>(k) * C;
+        for (uint32_t v = 0; v < V; ++v) {
+            acc0[v] = _mm_add_ps(acc0[v], _mm_mul_ps(hk[0], _mm_loadu_ps(frame + 4 * v)));
+            acc1[v] = _mm_add_ps(acc1[v], _mm_mul_ps(hk[1], _mm_loadu_ps(frame + C + 4 * v)));
+            acc0[v] = _mm_add_ps(acc0[v], _mm_mul_ps(hk[2], _mm_loadu_ps(frame + 2 * C + 4 * v)));
+            acc1[v] = _mm_add_ps(acc1[v], _mm_mul_ps(hk[3], _mm_loadu_ps(frame + 3 * C + 4 * v)));
+        }
+    }
+    for (uint32_t v = 0; v < V; ++v) _mm_storeu_ps(out + 4 * v, _mm_add_ps(acc0[v], acc1[v]));
+}
+
+// ---- AVX2 + FMA: 8 taps (16 samples) per iteration ----
+
+__attribute__((target("avx2,fma")))
+static void kernelAVX2(const float* x, const float* h0, const float* h1,
+                       float frac, uint32_t taps, float* out)
+{
+    const __m256i dupLo = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+    const __m256i dupHi = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+    __m256 f = _mm256_set1_ps(frac);
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for (uint32_t k = 0; k < taps; k += 8) {
+        __m256 a = _mm256_loadu_ps(h0 + k);
+        __m256 h = _mm256_fmadd_ps(f, _mm256_sub_ps(_mm256_loadu_ps(h1 + k), a), a);
+        __m256 lo = _mm256_permutevar8x32_ps(h, dupLo);
+        __m256 hi = _mm256_permutevar8x32_ps(h, dupHi);
+        acc0 = _mm256_fmadd_ps(lo, _mm256_loadu_ps(x + 2 * k), acc0);
+        acc1 = _mm256_fmadd_ps(hi, _mm256_loadu_ps(x + 2 * k + 8), acc1);
+    }
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    storeStereo(_mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1)), out);
+}
+
+// 4 channels: two frames per vector, h[k] in the low half and h[k + 1] in
+// the high one, folded together at the end.
+__attribute__((target("avx2,fma")))
+static void kernelAVX2x4(const float* x, const float* h0, const float* h1,
+                         float frac, uint32_t taps, float* out)
+{
+    const __m256i pair[4] = {
+        _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1), _mm256_setr_epi32(2, 2, 2, 2, 3, 3, 3, 3),
+        _mm256_setr_epi32(4, 4, 4, 4, 5, 5, 5, 5), _mm256_setr_epi32(6, 6, 6, 6, 7, 7, 7, 7)};
+    __m256 f = _mm256_set1_ps(frac);
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for (uint32_t k = 0; k < taps; k += 8) {
+        __m256 a = _mm256_loadu_ps(h0 + k);
+        __m256 h = _mm256_fmadd_ps(f, _mm256_sub_ps(_mm256_loadu_ps(h1 + k), a), a);
+        const float* frame = x + static_cast<size_t>(k) * 4;
+        acc0 = _mm256_fmadd_ps(_mm256_permutevar8x32_ps(h, pair[0]), _mm256_loadu_ps(frame), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_permutevar8x32_ps(h, pair[1]), _mm256_loadu_ps(frame + 8), acc1);
+        acc0 = _mm256_fmadd_ps(_mm256_permutevar8x32_ps(h, pair[2]), _mm256_loadu_ps(frame + 16), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_permutevar8x32_ps(h, pair[3]), _mm256_loadu_ps(frame + 24), acc1);
+    }
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    _mm_storeu_ps(out, _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1)));
+}
+
+// 8 channels: one frame per vector.
+__attribute__((target("avx2,fma")))
+static void kernelAVX2x8(const float* x, const float* h0, const float* h1,
+                         float frac, uint32_t taps, float* out)
+{
+    __m256 f = _mm256_set1_ps(frac);
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for (uint32_t k = 0; k < taps; k += 8) {
+        __m256 a = _mm256_loadu_ps(h0 + k);
+        __m256 h = _mm256_fmadd_ps(f, _mm256_sub_ps(_mm256_loadu_ps(h1 + k), a), a);
+        const float* frame = x + static_cast<size_t>(k) * 8;
+        for (int j = 0; j < 8; j += 2) {
+            __m256 hj0 = _mm256_permutevar8x32_ps(h, _mm256_set1_epi32(j));
+            __m256 hj1 = _mm256_permutevar8x32_ps(h, _mm256_set1_epi32(j + 1));
+            acc0 = _mm256_fmadd_ps(hj0, _mm256_loadu_ps(frame + 8 * j), acc0);
+            acc1 = _mm256_fmadd_ps(hj1, _mm256_loadu_ps(frame + 8 * j + 8), acc1);
+        }
+    }
+    _mm256_storeu_ps(out, _mm256_add_ps(acc0, acc1));
+}
+
+static bool cpuHasAVX2()
+{
+    static const bool has = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return has;
+}
+
+#endif // FLUX_KERNELS_X86
+
+#ifdef FLUX_KERNELS_NEON
+
+// ---- NEON: 4 taps (8 samples) per iteration ----
+
+static void kernelNEON(const float* x, const float* h0, const float* h1,
+                       float frac, uint32_t taps, float* out)
+{
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (uint32_t k = 0; k < taps; k += 4) {
+        float32x4_t a = vld1q_f32(h0 + k);
+        float32x4_t h = vfmaq_n_f32(a, vsubq_f32(vld1q_f32(h1 + k), a), frac);
+        float32x4x2_t dup = vzipq_f32(h, h);            // h0 h0 h1 h1 | h2 h2 h3 h3
+        acc0 = vfmaq_f32(acc0, dup.val[0], vld1q_f32(x + 2 * k));
+        acc1 = vfmaq_f32(acc1, dup.val[1], vld1q_f32(x + 2 * k + 4));
+    }
+    float32x4_t acc = vaddq_f32(acc0, acc1);
+    vst1_f32(out, vadd_f32(vget_low_f32(acc), vget_high_f32(acc)));
+}
+
+// 4 or 8 channels: each coefficient applied by lane to a frame's vectors.
+template <uint32_t C>
+static void kernelNEONN(const float* x, const float* h0, const float* h1,
+                        float frac, uint32_t taps, float* out)
+{
+    constexpr uint32_t V = C / 4;
+    float32x4_t acc0[V], acc1[V];
+    for (uint32_t v = 0; v < V; ++v) acc0[v] = acc1[v] = vdupq_n_f32(0.0f);
+    for (uint32_t k = 0; k < taps; k += 4) {
+        float32x4_t a = vld1q_f32(h0 + k);
+        float32x4_t h = vfmaq_n_f32(a, vsubq_f32(vld1q_f32(h1 + k), a), frac);
+        const float* frame = x + static_cast<size_t>(k) * C;
+        for (uint32_t v = 0; v < V; ++v) {
+            acc0[v] = vfmaq_laneq_f32(acc0[v], vld1q_f32(frame + 4 * v), h, 0);
+            acc1[v] = vfmaq_laneq_f32(acc1[v], vld1q_f32(frame + C + 4 * v), h, 1);
+            acc0[v] = vfmaq_laneq_f32(acc0[v], vld1q_f32(frame + 2 * C + 4 * v), h, 2);
+            acc1[v] = vfmaq_laneq_f32(acc1[v], vld1q_f32(frame + 3 * C + 4 * v), h, 3);
+        }
+    }
+    for (uint32_t v = 0; v < V; ++v) vst1q_f32(out + 4 * v, vaddq_f32(acc0[v], acc1[v]));
+}
+
+#endif // FLUX_KERNELS_NEON
+
+// ---- Dispatch ----
+
+bool polyphaseKernelSupported(PolyphaseKernel kernel)
+{
+    return polyphaseKernelFn(kernel) != nullptr;
+}
+
+PolyphaseKernel bestPolyphaseKernel()
+{
+    for (auto kernel : {kKernelAVX2, kKernelNEON, kKernelSSE}) {
+        if (polyphaseKernelSupported(kernel)) return kernel;
+    }
+    return kKernelScalar;
+}
+
+bool polyphaseChannelsSupported(uint32_t channels)
+{
+    return channels == 2 || channels == 4 || channels == 8;
+}
+
+uint32_t polyphaseLanes(uint32_t channels)
+{
+    if (channels == 0 || channels > kPolyphaseMaxChannels) return 0;
+    return channels <= 2 ? 2 : channels <= 4 ? 4 : 8;
+}
+
+PolyphaseKernelFn polyphaseKernelFn(PolyphaseKernel kernel, uint32_t channels)
+{
+    if (!polyphaseChannelsSupported(channels)) return nullptr;
+
+    switch (kernel) {
+        case kKernelScalar:
+            return channels == 2 ? kernelScalar
+                 : channels == 4 ? kernelScalarN<4> : kernelScalarN<8>;
+#ifdef FLUX_KERNELS_X86
+        case kKernelSSE:
+            return channels == 2 ? kernelSSE
+                 : channels == 4 ? kernelSSEN<4> : kernelSSEN<8>;
+        case kKernelAVX2:
+            if (!cpuHasAVX2()) return nullptr;
+            return channels == 2 ? kernelAVX2
+                 : channels == 4 ? kernelAVX2x4 : kernelAVX2x8;
+#endif
+#ifdef FLUX_KERNELS_NEON
+        case kKernelNEON:
+            return channels == 2 ? kernelNEON
+                 : channels == 4 ? kernelNEONN<4> : kernelNEONN<8>;
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+const char* polyphaseKernelName(PolyphaseKernel kernel)
+{
+    switch (kernel) {
+        case kKernelScalar: return "scalar";
+        case kKernelSSE:    return "sse2";
+        case kKernelAVX2:   return "avx2";
+        case kKernelNEON:   return "neon";
+        default:            return "?";
+    }
+}
+
+} // namespace flux
@@ -0,0 +1,55 @@
+#pragma once
+
+// Inner loops of the polyphase resampler, one per instruction set.
+//
+// Each kernel computes one output frame: the dot product of `taps`
+// interleaved input frames with a filter phase blended from two adjacent
+// table rows, h = h0 + frac * (h1 - h0). The rows are mono; the SIMD
+// kernels broadcast each coefficient across the frame's channels in
+// registers, so the table stays the same size whatever the channel count.
+//
+// Stereo is the common case. The 4- and 8-channel variants run two or four
+// stereo streams that share a ratio as one interleaved frame — one
+// coefficient fetch and blend for all of them, with the channels filling
+// the SIMD lanes (PolyphaseResampler::processStreams).
+//
+// taps must be a multiple of 8. Loads are unaligned — the input window
+// starts wherever the read position is.
+
+#include <cstdint>
+
+namespace flux {
+
+enum PolyphaseKernel : uint32_t {
+    kKernelScalar = 0,
+    kKernelSSE    = 1,     // x86-64 baseline (SSE2)
+    kKernelAVX2   = 2,     // AVX2 + FMA, runtime-detected
+    kKernelNEON   = 3,     // AArch64 baseline
+    kKernelCount
+};
+
+// Channel counts with a kernel: 2, 4 and 8.
+static constexpr uint32_t kPolyphaseMaxChannels = 8;
+bool polyphaseChannelsSupported(uint32_t channels);
+
+// The kernel width a channel count runs at: the narrowest kernel that
+// holds it (1 → 2, 3 → 4, 5 to 7 → 8), 0 for none. The resamplers pad each
+// frame to it in their input window, so any count up to
+// kPolyphaseMaxChannels converts; the padding lanes stay silent.
+uint32_t polyphaseLanes(uint32_t channels);
+
+using PolyphaseKernelFn = void (*)(const float* x, const float* h0, const float* h1,
+                                   float frac, uint32_t taps, float* out);
+
+// Built into this binary and supported by this CPU.
+bool polyphaseKernelSupported(PolyphaseKernel kernel);
+
+// Widest supported kernel.
+PolyphaseKernel bestPolyphaseKernel();
+
+// nullptr if unsupported. The kernel writes `channels` floats per frame.
+PolyphaseKernelFn polyphaseKernelFn(PolyphaseKernel kernel, uint32_t channels = 2);
+
+const char* polyphaseKernelName(PolyphaseKernel kernel);
+
+} // namespace flux
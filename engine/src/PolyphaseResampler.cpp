@@ -0,0 +1,241 @@
+#include "PolyphaseResampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace flux {
+
+// ---- Filter design ----
+// Kaiser windows. Each cutoff puts the transition band — wider the shorter
+// and steeper-skirted the filter — just below Nyquist: ~0.12 fs at 32 taps,
+// ~0.09 fs at 64, ~0.06 fs at 128. Phases grow with the stopband so the
+// interpolation between rows stays under it.
+
+static constexpr PolyphaseDesign kDesigns[kResamplerQualityCount] = {
+    { 32, 128,  6.0, 0.440},    // Low
+    { 64, 256,  9.0, 0.455},    // Medium
+    {128, 512, 12.0, 0.470},    // High
+};
+
+// Zeroth-order modified Bessel function of the first kind.
+static double besselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+const PolyphaseDesign& polyphaseDesign(ResamplerQuality quality)
+{
+    return kDesigns[quality < kResamplerQualityCount ? quality : kResamplerMedium];
+}
+
+double kaiserWindow(double x, double beta)
+{
+    if (std::fabs(x) >= 1.0) return 0.0;
+    return besselI0(beta * std::sqrt(1.0 - x * x)) / besselI0(beta);
+}
+
+// Row p holds the filter for an output taps / 2 - 1 + p / phases frames
+// into the window: tap k sits at t = k - (taps / 2 - 1) - p / phases from
+// the output. Each row is normalized to unity DC gain, so the phase
+// interpolation doesn't ripple the level.
+static std::vector<float> designTable(const PolyphaseDesign& design)
+{
+    const uint32_t taps = design.taps;
+    const uint32_t phases = design.phases;
+    std::vector<float> table(static_cast<size_t>(phases + 1) * taps);
+    const double half = taps / 2.0;
+
+    std::vector<double> row(taps);
+    for (uint32_t p = 0; p <= phases; ++p) {
+        double offset = static_cast<double>(p) / phases;
+        double sum = 0.0;
+        for (uint32_t k = 0; k < taps; ++k) {
+            double t = static_cast<double>(k) - (half - 1.0) - offset;
+            double x = 2.0 * design.cutoff * t;
+            double sinc = std::fabs(x) < 1e-12 ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+            row[k] = sinc * kaiserWindow(t / half, design.beta);
+            sum += row[k];
+        }
+        for (uint32_t k = 0; k < taps; ++k) {
+            table[static_cast<size_t>(p) * taps + k] = static_cast<float>(row[k] / sum);
+        }
+    }
+    return table;
+}
+
+// ---- PolyphaseFilter ----
+
+PolyphaseFilter::PolyphaseFilter(ResamplerQuality quality)
+    : quality_(quality < kResamplerQualityCount ? quality : kResamplerMedium)
+    , taps_(kDesigns[quality_].taps)
+    , phases_(kDesigns[quality_].phases)
+    , table_(designTable(kDesigns[quality_]))
+{
+}
+
+const PolyphaseFilter& PolyphaseFilter::shared(ResamplerQuality quality)
+{
+    // One static per quality, so only the tables in use get built.
+    switch (quality) {
+        case kResamplerLow: {
+            static const PolyphaseFilter low(kResamplerLow);
+            return low;
+        }
+        case kResamplerHigh: {
+            static const PolyphaseFilter high(kResamplerHigh);
+            return high;
+        }
+        default: {
+            static const PolyphaseFilter medium(kResamplerMedium);
+            return medium;
+        }
+    }
+}
+
+// ---- PolyphaseResampler ----
+
+PolyphaseResampler::PolyphaseResampler(ResamplerQuality quality, PolyphaseKernel kernel,
+                                       uint32_t channels)
+    : PolyphaseResampler(PolyphaseFilter::shared(quality), kernel, channels)
+{
+}
+
+PolyphaseResampler::PolyphaseResampler(const PolyphaseFilter& filter, PolyphaseKernel kernel,
+                                       uint32_t channels)
+    : filter_(&filter)
+    , taps_(filter.taps())
+    , phases_(filter.phases())
+    , channels_(polyphaseLanes(channels) ? channels : 2)
+    , lanes_(polyphaseLanes(channels_))
+    , kernel_(polyphaseKernelSupported(kernel) ? kernel : kKernelScalar)
+    , kernelFn_(polyphaseKernelFn(kernel_, lanes_))
+    , window_(static_cast<size_t>(taps_ + kChunk) * lanes_, 0.0f)
+{
+    reset();
+}
+
+void PolyphaseResampler::reset()
+{
+    // Prime the window with silence so the first output lines up with the
+    // first input frame.
+    std::fill(window_.begin(), window_.end(), 0.0f);
+    fill_ = taps_ / 2 - 1;
+    pos_ = 0.0;
+    ratio_ = 0.0;
+}
+
+uint32_t PolyphaseResampler::process(const float* in, uint32_t inFrames,
+                                     float* out, uint32_t outFrames,
+                                     double ratio, uint32_t* used)
+{
+    return convert(&in, inFrames, &out, outFrames, 1, ratio, used);
+}
+
+uint32_t PolyphaseResampler::processStreams(const float* const* in, uint32_t inFrames,
+                                            float* const* out, uint32_t outFrames,
+                                            double ratio, uint32_t* used)
+{
+    return convert(in, inFrames, out, outFrames, channels_ % 2 == 0 ? channels_ / 2 : 1,
+                   ratio, used);
+}
+
+uint32_t PolyphaseResampler::convert(const float* const* in, uint32_t inFrames,
+                                     float* const* out, uint32_t outFrames,
+                                     uint32_t parts, double ratio, uint32_t* used)
+{
+    const uint32_t width = channels_ / parts;
+
+    // One interleaved buffer at the kernel's width goes through the window
+    // as is; anything else is gathered into padded frames and scattered
+    // back out.
+    const bool direct = parts == 1 && channels_ == lanes_;
+
+    // Ramp from where the last call left off to the new ratio over the
+    // frames this call is expected to produce.
+    double current = ratio_ > 0.0 ? ratio_ : ratio;
+    double expected = (static_cast<double>(inFrames) + fill_ - pos_ - taps_) * ratio;
+    double frames = std::min(static_cast<double>(outFrames), std::max(expected, 1.0));
+    double slope = (ratio - current) / frames;
+
+    uint32_t taken = 0;
+    uint32_t generated = 0;
+
+    for (;;) {
+        // Everything the window holds enough input for.
+        while (generated < outFrames) {
+            auto whole = static_cast<uint32_t>(pos_);
+            if (whole + taps_ > fill_) break;
+
+            double phase = (pos_ - whole) * phases_;
+            auto row = static_cast<uint32_t>(phase);
+            const float* h0 = filter_->row(row);
+            const float* x = window_.data() + static_cast<size_t>(whole) * lanes_;
+            auto frac = static_cast<float>(phase - row);
+            if (direct) {
+                kernelFn_(x, h0, h0 + taps_, frac, taps_,
+                          out[0] + static_cast<size_t>(generated) * channels_);
+            } else {
+                float frame[kPolyphaseMaxChannels];
+                kernelFn_(x, h0, h0 + taps_, frac, taps_, frame);
+                for (uint32_t p = 0; p < parts; ++p) {
+                    std::memcpy(out[p] + static_cast<size_t>(generated) * width,
+                                frame + p * width, width * sizeof(float));
+                }
+            }
+            ++generated;
+
+            if (slope > 0.0) {
+                current = std::min(current + slope, ratio);
+            } else if (slope < 0.0) {
+                current = std::max(current + slope, ratio);
+            }
+            pos_ += 1.0 / current;
+        }
+        if (generated == outFrames || taken == inFrames) break;
+
+        // Slide the window: keep the history from the read position on.
+        auto drop = std::min(static_cast<uint32_t>(pos_), fill_);
+        if (drop > 0) {
+            std::memmove(window_.data(), window_.data() + static_cast<size_t>(drop) * lanes_,
+                         static_cast<size_t>(fill_ - drop) * lanes_ * sizeof(float));
+            fill_ -= drop;
+            pos_ -= drop;
+        }
+
+        // Top it up with what the remaining outputs need, no more: input
+        // left with the caller stays in its ring, where the engine can
+        // still measure it.
+        double last = pos_ + (outFrames - generated - 1) / current;
+        auto needed = static_cast<uint32_t>(std::max(
+            static_cast<double>(static_cast<uint32_t>(last) + taps_) - fill_, 1.0));
+        uint32_t n = std::min({needed, inFrames - taken, taps_ + kChunk - fill_});
+        float* dst = window_.data() + static_cast<size_t>(fill_) * lanes_;
+        if (direct) {
+            std::memcpy(dst, in[0] + static_cast<size_t>(taken) * channels_,
+                        static_cast<size_t>(n) * channels_ * sizeof(float));
+        } else {
+            for (uint32_t p = 0; p < parts; ++p) {
+                const float* src = in[p] + static_cast<size_t>(taken) * width;
+                for (uint32_t i = 0; i < n; ++i) {
+                    std::memcpy(dst + static_cast<size_t>(i) * lanes_ + p * width,
+                                src + static_cast<size_t>(i) * width, width * sizeof(float));
+                }
+            }
+        }
+        fill_ += n;
+        taken += n;
+    }
+
+    ratio_ = current;
+    *used = taken;
+    return generated;
+}
+
+} // namespace flux
@@ -0,0 +1,145 @@
+#pragma once
+
+// PolyphaseResampler: in-tree windowed-sinc converter for ratios near 1.0.
+//
+// A Kaiser-windowed sinc is tabulated at a number of fractional offsets
+// (plus one row, so every phase has a right neighbour). Each output frame
+// blends the two rows around its exact offset and runs one dot product over
+// the filter's taps — the only per-frame work, done by a SIMD kernel picked
+// at construction (PolyphaseKernels.h).
+//
+// Quality picks the filter:
+//   low     32 taps, 128 phases, ~60 dB stopband, passband to ~18 kHz
+//   medium  64 taps, 256 phases, ~90 dB, to ~19.7 kHz
+//   high   128 taps, 512 phases, ~115 dB, to ~21 kHz
+// Group delay is half the taps: 16, 32 or 64 frames.
+//
+// The cutoff is fixed, so it is only band-limited for ratios within a few
+// percent of 1 — the drift-correction range the engine runs at. The ratio
+// passed to process() is approached linearly over the block instead of
+// stepped, so servo corrections don't modulate the output.
+//
+// Stereo by default; 4 or 8 channels run two or four stereo streams that
+// share a ratio as one, through the kernels' wider variants — one phase
+// position, one coefficient blend and one loop for all of them, and every
+// stream sees exactly the same phase. process() takes them interleaved
+// into one frame, processStreams() one stereo buffer per stream, gathered
+// into the window on the way in and scattered on the way out. Other counts
+// up to 8 — a mono input, a six-channel interface — run padded to the next
+// kernel width (polyphaseLanes), gathered and scattered the same way. Input is
+// buffered in that short window, with the history the filter needs carried
+// over between calls. Only the input the requested output needs is taken.
+//
+// The table is a PolyphaseFilter, read-only once built. Resamplers at the
+// same quality share one — the engine runs three streams on the same
+// filter — so each instance adds only its window to the cache footprint.
+
+#include "PolyphaseKernels.h"
+#include "Resampler.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace flux {
+
+// The filter behind each quality. RationalResampler builds its fixed-ratio
+// tables from the same designs.
+struct PolyphaseDesign {
+    uint32_t taps;
+    uint32_t phases;
+    double   beta;          // Kaiser window shape
+    double   cutoff;        // Of the input rate
+};
+
+const PolyphaseDesign& polyphaseDesign(ResamplerQuality quality);
+
+// Kaiser window at x in [-1, 1]; 0 outside.
+double kaiserWindow(double x, double beta);
+
+// One quality's phase table: (phases + 1) rows of taps, mono.
+class PolyphaseFilter {
+public:
+    explicit PolyphaseFilter(ResamplerQuality quality);
+
+    // The process-wide table for `quality`, built on first use — off the
+    // realtime threads, where resamplers are made — and never freed.
+    static const PolyphaseFilter& shared(ResamplerQuality quality);
+
+    ResamplerQuality quality() const { return quality_; }
+    uint32_t taps() const { return taps_; }
+    uint32_t phases() const { return phases_; }
+    const float* row(uint32_t phase) const
+    {
+        return table_.data() + static_cast<size_t>(phase) * taps_;
+    }
+    size_t bytes() const { return table_.size() * sizeof(float); }
+
+private:
+    ResamplerQuality   quality_;
+    uint32_t           taps_;
+    uint32_t           phases_;
+    std::vector<float> table_;
+};
+
+class PolyphaseResampler : public Resampler {
+public:
+    // channels: 1 to 8 (polyphaseLanes); stereo otherwise.
+    explicit PolyphaseResampler(ResamplerQuality quality = kResamplerMedium,
+                                PolyphaseKernel kernel = bestPolyphaseKernel(),
+                                uint32_t channels = 2);
+
+    // On a filter the caller keeps alive instead of the shared one.
+    explicit PolyphaseResampler(const PolyphaseFilter& filter,
+                                PolyphaseKernel kernel = bestPolyphaseKernel(),
+                                uint32_t channels = 2);
+
+    uint32_t process(const float* in, uint32_t inFrames,
+                     float* out, uint32_t outFrames,
+                     double ratio, uint32_t* used) override;
+
+    // process() for channels() / 2 stereo streams sharing the ratio, each in
+    // its own buffer: in[s] and out[s] are stream s's interleaved frames.
+    // All streams take and make the same number of frames. An odd channel
+    // count is one stream, as process().
+    uint32_t processStreams(const float* const* in, uint32_t inFrames,
+                            float* const* out, uint32_t outFrames,
+                            double ratio, uint32_t* used);
+
+    void reset() override;
+
+    ResamplerTier tier() const override { return {kResamplerPolyphase, filter_->quality()}; }
+
+    // The newest taps / 2 input frames are still waiting in the window.
+    uint32_t groupDelay() const override { return taps_ / 2; }
+
+    PolyphaseKernel kernel() const { return kernel_; }
+    uint32_t channels() const { return channels_; }
+
+    // Per-instance state: the input window.
+    size_t stateBytes() const { return window_.size() * sizeof(float); }
+
+private:
+    // Window capacity beyond the filter history (frames).
+    static constexpr uint32_t kChunk = 512;
+
+    // The streaming loop behind both entry points: `parts` buffers of
+    // channels_ / parts interleaved channels each, padded to lanes_ in the
+    // window.
+    uint32_t convert(const float* const* in, uint32_t inFrames,
+                     float* const* out, uint32_t outFrames,
+                     uint32_t parts, double ratio, uint32_t* used);
+
+    const PolyphaseFilter* filter_;  // Shared, read-only
+    uint32_t           taps_;
+    uint32_t           phases_;
+    uint32_t           channels_;
+    uint32_t           lanes_;       // Kernel width, >= channels_
+    PolyphaseKernel    kernel_;
+    PolyphaseKernelFn  kernelFn_;
+    std::vector<float> window_;      // (taps_ + kChunk) frames of lanes_
+    uint32_t           fill_ = 0;    // Frames in window_
+    double             pos_ = 0.0;   // Next output, in frames from window_[0]
+    double             ratio_ = 0.0; // Ratio the last call ended at (0: none yet)
+};
+
+} // namespace flux
@@ -0,0 +1,190 @@
+#include "RationalResampler.h"
+#include "PolyphaseResampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+
+namespace flux {
+
+// ---- Filter design ----
+// Row p filters for an output p / up of the way past its newest input
+// frame: tap m (oldest first) sits j = taps - 1 - m frames back from it,
+// at t = j + p / up - taps / 2 from the output. The cutoff is the quality's,
+// scaled down to the output's Nyquist when decimating. Each row is
+// normalized to unity DC gain.
+
+static std::vector<float> designTable(uint32_t up, uint32_t down, const PolyphaseDesign& design)
+{
+    const uint32_t taps = design.taps;
+    const double half = taps / 2.0;
+    const double cutoff = design.cutoff * std::min(1.0, static_cast<double>(up) / down);
+    std::vector<float> table(static_cast<size_t>(up) * taps);
+
+    std::vector<double> row(taps);
+    for (uint32_t p = 0; p < up; ++p) {
+        double sum = 0.0;
+        for (uint32_t m = 0; m < taps; ++m) {
+            double t = static_cast<double>(taps - 1 - m) + static_cast<double>(p) / up - half;
+            double x = 2.0 * cutoff * t;
+            double sinc = std::fabs(x) < 1e-12 ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+            row[m] = sinc * kaiserWindow(t / half, design.beta);
+            sum += row[m];
+        }
+        for (uint32_t m = 0; m < taps; ++m) {
+            table[static_cast<size_t>(p) * taps + m] = static_cast<float>(row[m] / sum);
+        }
+    }
+    return table;
+}
+
+// The process-wide table for up / down at `quality`, built on first use —
+// off the realtime threads, where stages are made — and freed with the last
+// stage using it.
+static std::shared_ptr<const std::vector<float>> sharedTable(uint32_t up, uint32_t down,
+                                                             ResamplerQuality quality)
+{
+    using Key = std::tuple<uint32_t, uint32_t, ResamplerQuality>;
+    static std::mutex mutex;
+    static std::map<Key, std::weak_ptr<const std::vector<float>>> tables;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& entry = tables[Key{up, down, quality}];
+    auto table = entry.lock();
+    if (!table) {
+        table = std::make_shared<const std::vector<float>>(
+            designTable(up, down, polyphaseDesign(quality)));
+        entry = table;
+    }
+    return table;
+}
+
+std::unique_ptr<RationalResampler> RationalResampler::make(double inRate, double outRate,
+                                                           ResamplerQuality quality,
+                                                           uint32_t channels)
+{
+    auto in = std::llround(inRate);
+    auto out = std::llround(outRate);
+    if (in <= 0 || out <= 0 || in == out) return nullptr;
+    if (std::fabs(inRate - in) > 1e-6 || std::fabs(outRate - out) > 1e-6) return nullptr;
+    if (!polyphaseLanes(channels)) return nullptr;
+
+    auto g = std::gcd(in, out);
+    if (out / g > kMaxFactor || in / g > kMaxFactor) return nullptr;
+    if (std::max(in, out) > std::min(in, out) * kMaxRatio) return nullptr;
+    return std::make_unique<RationalResampler>(static_cast<uint32_t>(out / g),
+                                               static_cast<uint32_t>(in / g),
+                                               quality, channels);
+}
+
+RationalResampler::RationalResampler(uint32_t up, uint32_t down, ResamplerQuality quality,
+                                     uint32_t channels, PolyphaseKernel kernel)
+    : up_(std::max(up, 1u))
+    , down_(std::max(down, 1u))
+    , taps_(polyphaseDesign(quality).taps)
+    , channels_(polyphaseLanes(channels) ? channels : 2)
+    , lanes_(polyphaseLanes(channels_))
+    , kernelFn_(polyphaseKernelFn(polyphaseKernelSupported(kernel) ? kernel : kKernelScalar,
+                                  lanes_))
+    , table_(sharedTable(up_, down_, quality))
+    , rows_(table_->data())
+    , window_(static_cast<size_t>(taps_ - 1 + kChunk) * lanes_, 0.0f)
+{
+    reset();
+}
+
+void RationalResampler::reset()
+{
+    // taps - 1 frames of silence ahead of the first input, which is the
+    // first output's newest frame.
+    std::fill(window_.begin(), window_.end(), 0.0f);
+    fill_ = taps_ - 1;
+    pos_ = static_cast<uint64_t>(taps_ - 1) * up_;
+}
+
+uint32_t RationalResampler::outputDelay() const
+{
+    return static_cast<uint32_t>(std::llround(static_cast<double>(taps_ / 2) * up_ / down_));
+}
+
+uint32_t RationalResampler::outputFor(uint32_t inFrames) const
+{
+    uint64_t limit = static_cast<uint64_t>(up_) * (fill_ + inFrames);
+    if (pos_ >= limit) return 0;
+    return static_cast<uint32_t>((limit - pos_ + down_ - 1) / down_);
+}
+
+uint32_t RationalResampler::inputFor(uint32_t outFrames) const
+{
+    if (outFrames == 0) return 0;
+    uint64_t newest = (pos_ + static_cast<uint64_t>(outFrames - 1) * down_) / up_;
+    return newest >= fill_ ? static_cast<uint32_t>(newest + 1 - fill_) : 0;
+}
+
+uint32_t RationalResampler::process(const float* in, uint32_t inFrames,
+                                    float* out, uint32_t outFrames, uint32_t* used)
+{
+    const uint32_t capacity = taps_ - 1 + kChunk;
+    uint32_t taken = 0;
+    uint32_t generated = 0;
+
+    for (;;) {
+        // Every output whose newest input frame is in the window.
+        while (generated < outFrames) {
+            uint64_t newest = pos_ / up_;
+            if (newest >= fill_) break;
+            const float* h = row(static_cast<uint32_t>(pos_ - newest * up_));
+            const float* x = window_.data() + static_cast<size_t>(newest - (taps_ - 1)) * lanes_;
+            float* dst = out + static_cast<size_t>(generated) * channels_;
+            if (lanes_ == channels_) {
+                kernelFn_(x, h, h, 0.0f, taps_, dst);
+            } else {
+                // Padded: the kernel's frame, less the silent lanes.
+                float frame[kPolyphaseMaxChannels];
+                kernelFn_(x, h, h, 0.0f, taps_, frame);
+                std::memcpy(dst, frame, channels_ * sizeof(float));
+            }
+            ++generated;
+            pos_ += down_;
+        }
+        // Out full stops the pass only once the window can make the next
+        // output: input short of that would make nothing anyway, so it is
+        // taken (and no more) rather than left for the caller to carry over.
+        if (taken == inFrames || (generated == outFrames && pos_ / up_ < fill_)) break;
+
+        // Slide: keep the taps - 1 frames before the next output's newest.
+        auto drop = static_cast<uint32_t>(
+            std::min<uint64_t>(pos_ / up_ - (taps_ - 1), fill_));
+        if (drop > 0) {
+            std::memmove(window_.data(), window_.data() + static_cast<size_t>(drop) * lanes_,
+                         static_cast<size_t>(fill_ - drop) * lanes_ * sizeof(float));
+            fill_ -= drop;
+            pos_ -= static_cast<uint64_t>(drop) * up_;
+        }
+
+        uint32_t n = std::min(inFrames - taken, capacity - fill_);
+        if (generated == outFrames) {
+            n = std::min(n, static_cast<uint32_t>(pos_ / up_ + 1 - fill_));
+        }
+        float* dst = window_.data() + static_cast<size_t>(fill_) * lanes_;
+        const float* src = in + static_cast<size_t>(taken) * channels_;
+        if (lanes_ == channels_) {
+            std::memcpy(dst, src, static_cast<size_t>(n) * channels_ * sizeof(float));
+        } else {
+            for (uint32_t i = 0; i < n; ++i) {
+                std::memcpy(dst + static_cast<size_t>(i) * lanes_,
+                            src + static_cast<size_t>(i) * channels_, channels_ * sizeof(float));
+            }
+        }
+        fill_ += n;
+        taken += n;
+    }
+    *used = taken;
+    return generated;
+}
+
+} // namespace flux
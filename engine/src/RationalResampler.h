@@ -0,0 +1,109 @@
+#pragma once
+
+// RationalResampler: fixed-ratio polyphase converter for a nominal rate
+// change, up / down = output rate / input rate in lowest terms (160 / 147
+// for 44.1 → 48 kHz).
+//
+// When the FLX4 runs at another nominal rate than Push, each resampled
+// stream converts in two stages: this one takes it between the two nominal
+// rates, and the stream's own converter (Resampler.h), at a ratio near 1,
+// only corrects drift. The exact rational phases need no interpolation
+// between table rows, and the variable stage keeps the near-unity ratio
+// its filters, the crossfade and the timeline stamps are built around.
+//
+// A Kaiser-windowed sinc prototype `up` phases by the quality's taps
+// (32 / 64 / 128 per phase, as in PolyphaseResampler), cut off below the
+// lower of the two Nyquists. Each output frame is one dot product of one
+// phase row with the newest taps input frames, through the polyphase
+// SIMD kernels. Group delay is taps / 2 input frames.
+//
+// The phase arithmetic is exact, so outputFor() and inputFor() say in
+// advance what a block makes and needs: callers size their buffers and
+// pulls by them rather than by a ratio estimate.
+//
+// The table is read-only once built, and stages with the same factors and
+// quality share one — a session's input, cue and output stages, and the
+// master's, up to 80 KB each at high quality — so each instance adds only
+// its window.
+//
+// Construction allocates; process() and reset() are realtime-safe.
+
+#include "PolyphaseKernels.h"
+#include "Resampler.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace flux {
+
+class RationalResampler {
+public:
+    // Largest up or down factor built (44.1 / 48 / 88.2 / 96 kHz pairs
+    // need at most 320), and the largest rate change either way.
+    static constexpr uint32_t kMaxFactor = 1024;
+    static constexpr uint32_t kMaxRatio = 8;
+
+    // nullptr if the rates aren't whole, are equal, or are further apart or
+    // less simply related than the limits above, or channels isn't
+    // supported.
+    static std::unique_ptr<RationalResampler> make(double inRate, double outRate,
+                                                   ResamplerQuality quality,
+                                                   uint32_t channels = 2);
+
+    RationalResampler(uint32_t up, uint32_t down, ResamplerQuality quality,
+                      uint32_t channels = 2,
+                      PolyphaseKernel kernel = bestPolyphaseKernel());
+
+    // Convert up to inFrames interleaved frames into at most outFrames.
+    // Returns frames generated; *used is the input frames taken — all of
+    // them unless out filled up before the input ran out of frames it
+    // would make output from. So out sized by outputFor(inFrames) takes
+    // the whole block.
+    uint32_t process(const float* in, uint32_t inFrames,
+                     float* out, uint32_t outFrames, uint32_t* used);
+
+    // Back to silence (new timeline).
+    void reset();
+
+    // Output frames the next inFrames input frames complete.
+    uint32_t outputFor(uint32_t inFrames) const;
+
+    // Input frames the next outFrames output frames need.
+    uint32_t inputFor(uint32_t outFrames) const;
+
+    uint32_t up() const { return up_; }
+    uint32_t down() const { return down_; }
+    double ratio() const { return static_cast<double>(up_) / down_; }
+    uint32_t taps() const { return taps_; }
+
+    // taps / 2 input frames, in input and in output frames.
+    uint32_t inputDelay() const { return taps_ / 2; }
+    uint32_t outputDelay() const;
+
+    // This stage's own memory: the window. The table is shared.
+    size_t bytes() const { return window_.size() * sizeof(float); }
+
+private:
+    // Window capacity beyond the filter history (input frames).
+    static constexpr uint32_t kChunk = 512;
+
+    const float* row(uint32_t phase) const
+    {
+        return rows_ + static_cast<size_t>(phase) * taps_;
+    }
+
+    uint32_t           up_;
+    uint32_t           down_;
+    uint32_t           taps_;
+    uint32_t           channels_;
+    uint32_t           lanes_;       // Kernel width, >= channels_ (polyphaseLanes)
+    PolyphaseKernelFn  kernelFn_;
+    std::shared_ptr<const std::vector<float>> table_;  // up_ rows of taps_, newest tap last
+    const float*       rows_;        // table_'s
+    std::vector<float> window_;      // (taps_ - 1 + kChunk) frames of lanes_
+    uint32_t           fill_ = 0;    // Frames in window_
+    uint64_t           pos_ = 0;     // Next output, in 1 / up_ frames from window_[0]
+};
+
+} // namespace flux
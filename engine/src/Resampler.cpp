@@ -0,0 +1,315 @@
+#include "Resampler.h"
+#include "PolyphaseResampler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef FLUX_HAVE_SAMPLERATE
+#include <samplerate.h>
+#endif
+
+namespace flux {
+
+// ---- Linear interpolation ----
+// Reads between the previous block's last frame and this block's frames,
+// so the output is continuous across calls. pos_ is the next output
+// position in input frames, counted from that held-over frame.
+
+class LinearResampler : public Resampler {
+public:
+    explicit LinearResampler(uint32_t channels)
+        : channels_(channels)
+        , last_(channels, 0.0f)
+    {
+    }
+
+    uint32_t process(const float* in, uint32_t inFrames,
+                     float* out, uint32_t outFrames,
+                     double ratio, uint32_t* used) override
+    {
+        double step = 1.0 / ratio;
+        uint32_t generated = 0;
+
+        while (generated < outFrames) {
+            auto i1 = static_cast<int64_t>(pos_);
+            if (i1 >= static_cast<int64_t>(inFrames)) break;
+
+            float frac = static_cast<float>(pos_ - static_cast<double>(i1));
+            const float* a = i1 == 0 ? last_.data() : in + (i1 - 1) * channels_;
+            const float* b = in + i1 * channels_;
+            float* dst = out + generated * channels_;
+            for (uint32_t c = 0; c < channels_; ++c) {
+                dst[c] = a[c] + frac * (b[c] - a[c]);
+            }
+            ++generated;
+            pos_ += step;
+        }
+
+        auto whole = static_cast<int64_t>(pos_);
+        uint32_t consumed = whole < static_cast<int64_t>(inFrames)
+                          ? static_cast<uint32_t>(whole) : inFrames;
+        if (consumed > 0) {
+            const float* tail = in + (consumed - 1) * channels_;
+            for (uint32_t c = 0; c < channels_; ++c) last_[c] = tail[c];
+            pos_ -= consumed;
+        }
+        *used = consumed;
+        return generated;
+    }
+
+    void reset() override
+    {
+        std::fill(last_.begin(), last_.end(), 0.0f);
+        pos_ = 1.0;
+    }
+
+    ResamplerTier tier() const override { return {kResamplerLinear, kResamplerMedium}; }
+
+    // An output needs the frame after it.
+    uint32_t groupDelay() const override { return 1; }
+
+private:
+    uint32_t           channels_;
+    std::vector<float> last_;
+    double             pos_ = 1.0;
+};
+
+// ---- Cubic (Catmull-Rom) interpolation ----
+// Like linear, but over four frames: the previous block's last three are
+// held over, so input index j reads held_[j] for j < 3 and in[j - 3] after.
+// An output between frames i and i + 1 needs i - 1 .. i + 2.
+
+class CubicResampler : public Resampler {
+public:
+    static constexpr uint32_t kHeld = 3;
+
+    explicit CubicResampler(uint32_t channels)
+        : channels_(channels)
+        , held_(static_cast<size_t>(kHeld) * channels, 0.0f)
+        , next_(static_cast<size_t>(kHeld) * channels, 0.0f)
+    {
+    }
+
+    uint32_t process(const float* in, uint32_t inFrames,
+                     float* out, uint32_t outFrames,
+                     double ratio, uint32_t* used) override
+    {
+        auto frame = [&](int64_t j) {
+            return j < kHeld ? held_.data() + j * channels_ : in + (j - kHeld) * channels_;
+        };
+
+        double step = 1.0 / ratio;
+        uint32_t generated = 0;
+        int64_t last = static_cast<int64_t>(kHeld + inFrames) - 1;
+
+        while (generated < outFrames) {
+            auto i = static_cast<int64_t>(pos_);
+            if (i + 2 > last) break;
+
+            float t = static_cast<float>(pos_ - static_cast<double>(i));
+            const float* p0 = frame(i - 1);
+            const float* p1 = frame(i);
+            const float* p2 = frame(i + 1);
+            const float* p3 = frame(i + 2);
+            float* dst = out + generated * channels_;
+            for (uint32_t c = 0; c < channels_; ++c) {
+                float a = -0.5f * p0[c] + 1.5f * p1[c] - 1.5f * p2[c] + 0.5f * p3[c];
+                float b = p0[c] - 2.5f * p1[c] + 2.0f * p2[c] - 0.5f * p3[c];
+                float d = -0.5f * p0[c] + 0.5f * p2[c];
+                dst[c] = ((a * t + b) * t + d) * t + p1[c];
+            }
+            ++generated;
+            pos_ += step;
+        }
+
+        // Keep the three frames from i - 1 on for the next call.
+        int64_t drop = static_cast<int64_t>(pos_) - 1;
+        uint32_t consumed = drop <= 0 ? 0
+                          : drop < static_cast<int64_t>(inFrames) ? static_cast<uint32_t>(drop)
+                          : inFrames;
+        if (consumed > 0) {
+            for (uint32_t j = 0; j < kHeld; ++j) {
+                std::memcpy(next_.data() + j * channels_, frame(consumed + j),
+                            channels_ * sizeof(float));
+            }
+            held_.swap(next_);
+            pos_ -= consumed;
+        }
+        *used = consumed;
+        return generated;
+    }
+
+    void reset() override
+    {
+        std::fill(held_.begin(), held_.end(), 0.0f);
+        pos_ = kHeld;
+    }
+
+    ResamplerTier tier() const override { return {kResamplerCubic, kResamplerMedium}; }
+
+    // An output needs the two frames after it.
+    uint32_t groupDelay() const override { return 2; }
+
+private:
+    uint32_t           channels_;
+    std::vector<float> held_;
+    std::vector<float> next_;       // Scratch for the held-over frames
+    double             pos_ = kHeld;
+};
+
+// ---- libsamplerate ----
+
+#ifdef FLUX_HAVE_SAMPLERATE
+class SamplerateResampler : public Resampler {
+public:
+    SamplerateResampler(SRC_STATE* state, ResamplerQuality quality)
+        : state_(state)
+        , quality_(quality)
+    {
+    }
+
+    ~SamplerateResampler() override { src_delete(state_); }
+
+    uint32_t process(const float* in, uint32_t inFrames,
+                     float* out, uint32_t outFrames,
+                     double ratio, uint32_t* used) override
+    {
+        SRC_DATA data;
+        data.data_in = in;
+        data.data_out = out;
+        data.input_frames = inFrames;
+        data.output_frames = outFrames;
+        data.src_ratio = ratio;
+        data.end_of_input = 0;
+
+        if (src_process(state_, &data) != 0) {
+            *used = 0;
+            return 0;
+        }
+        *used = static_cast<uint32_t>(data.input_frames_used);
+        return static_cast<uint32_t>(data.output_frames_gen);
+    }
+
+    void reset() override { src_reset(state_); }
+
+    ResamplerTier tier() const override { return {kResamplerSamplerate, quality_}; }
+
+    // Half the sinc's length in input frames at ratio 1 — its coefficient
+    // table length over its increment, rounded up: 2464 / 128, 22438 / 491
+    // and 340239 / 2381.
+    uint32_t groupDelay() const override
+    {
+        static constexpr uint32_t kDelays[kResamplerQualityCount] = {20, 46, 143};
+        return kDelays[quality_];
+    }
+
+private:
+    SRC_STATE*       state_;
+    ResamplerQuality quality_;
+};
+#endif
+
+// ---- Factory ----
+
+ResamplerKind defaultResamplerKind()
+{
+#ifdef FLUX_HAVE_SAMPLERATE
+    return kResamplerSamplerate;
+#else
+    return kResamplerPolyphase;
+#endif
+}
+
+std::unique_ptr<Resampler> makeResampler(const ResamplerTier& tier, uint32_t channels)
+{
+    if (tier.quality >= kResamplerQualityCount) return nullptr;
+
+    switch (tier.kind) {
+        case kResamplerLinear:
+            return std::make_unique<LinearResampler>(channels);
+        case kResamplerCubic:
+            return std::make_unique<CubicResampler>(channels);
+#ifdef FLUX_HAVE_SAMPLERATE
+        case kResamplerSamplerate: {
+            // Fastest: 97 dB SNR, 80% bandwidth. Medium: 97 dB, 90%.
+            // Best: 97 dB, 97%.
+            static constexpr int kConverters[kResamplerQualityCount] = {
+                SRC_SINC_FASTEST, SRC_SINC_MEDIUM_QUALITY, SRC_SINC_BEST_QUALITY};
+            int err = 0;
+            SRC_STATE* state = src_new(kConverters[tier.quality], static_cast<int>(channels), &err);
+            if (!state) return nullptr;
+            return std::make_unique<SamplerateResampler>(state, tier.quality);
+        }
+#endif
+        case kResamplerPolyphase:
+            if (!polyphaseLanes(channels)) return nullptr;
+            return std::make_unique<PolyphaseResampler>(tier.quality, bestPolyphaseKernel(),
+                                                        channels);
+        default:
+            return nullptr;
+    }
+}
+
+const char* resamplerName(ResamplerKind kind)
+{
+    switch (kind) {
+        case kResamplerLinear:     return "linear";
+        case kResamplerSamplerate: return "samplerate";
+        case kResamplerPolyphase:  return "polyphase";
+        case kResamplerCubic:      return "cubic";
+        default:                   return "?";
+    }
+}
+
+static const char* const kQualityNames[kResamplerQualityCount] = {"low", "medium", "high"};
+
+const char* resamplerTierName(const ResamplerTier& tier)
+{
+    static const char* const kSamplerate[kResamplerQualityCount] = {
+        "samplerate-low", "samplerate-medium", "samplerate-high"};
+    static const char* const kPolyphase[kResamplerQualityCount] = {
+        "polyphase-low", "polyphase-medium", "polyphase-high"};
+
+    if (tier.quality >= kResamplerQualityCount) return "?";
+    switch (tier.kind) {
+        case kResamplerSamplerate: return kSamplerate[tier.quality];
+        case kResamplerPolyphase:  return kPolyphase[tier.quality];
+        default:                   return resamplerName(tier.kind);
+    }
+}
+
+bool parseResamplerTier(const char* name, ResamplerTier* out)
+{
+    std::string text = name;
+    auto dash = text.find('-');
+    std::string base = text.substr(0, dash);
+
+    ResamplerQuality quality = kResamplerMedium;
+    if (dash != std::string::npos) {
+        std::string suffix = text.substr(dash + 1);
+        uint32_t q = 0;
+        while (q < kResamplerQualityCount && suffix != kQualityNames[q]) ++q;
+        if (q == kResamplerQualityCount) return false;
+        quality = static_cast<ResamplerQuality>(q);
+    }
+
+    if (base == "sinc") {
+        *out = {defaultResamplerKind(), quality};
+        return true;
+    }
+    for (uint32_t k = 0; k < kResamplerKindCount; ++k) {
+        auto kind = static_cast<ResamplerKind>(k);
+        if (base != resamplerName(kind)) continue;
+
+        // Only the sinc converters come in qualities.
+        bool sinc = kind == kResamplerSamplerate || kind == kResamplerPolyphase;
+        if (!sinc && dash != std::string::npos) return false;
+        *out = {kind, quality};
+        return true;
+    }
+    return false;
+}
+
+} // namespace flux
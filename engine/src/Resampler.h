@@ -0,0 +1,97 @@
+#pragma once
+
+// Resampler: the variable-ratio converter behind each resampled stream.
+//
+// The engine streams through it block by block — process() keeps the
+// filter state between calls, so a block split across two ring spans
+// converts exactly as one call would. ratio is output rate / input rate,
+// as in libsamplerate, and may change on every call.
+//
+// Implementations:
+//   samplerate  libsamplerate SRC_SINC_FASTEST / MEDIUM / BEST_QUALITY
+//               (macOS builds)
+//   polyphase   in-tree windowed-sinc with SIMD kernels, for ratios near 1,
+//               32 / 64 / 128 taps (PolyphaseResampler.h) — the default
+//               where libsamplerate isn't built
+//   cubic       four-tap Catmull-Rom interpolation, in-tree
+//   linear      two-tap interpolation, in-tree — a cheap fallback
+//
+// A tier is a converter plus, for the two sinc ones, a quality. Tiers trade
+// CPU for stopband and passband, and differ in group delay — the engine
+// stamps each stream's timeline by the active tier's delay, and the FLX4
+// output reports it as stream latency (EngineCore.h).
+//
+// process() is realtime-safe; construction is not.
+
+#include <cstdint>
+#include <memory>
+
+namespace flux {
+
+enum ResamplerKind : uint32_t {
+    kResamplerLinear     = 0,
+    kResamplerSamplerate = 1,
+    kResamplerPolyphase  = 2,
+    kResamplerCubic      = 3,
+    kResamplerKindCount
+};
+
+// Filter length of the sinc converters; linear and cubic have just the one.
+enum ResamplerQuality : uint32_t {
+    kResamplerLow    = 0,
+    kResamplerMedium = 1,
+    kResamplerHigh   = 2,
+    kResamplerQualityCount
+};
+
+// libsamplerate when this build has it, polyphase otherwise.
+ResamplerKind defaultResamplerKind();
+
+struct ResamplerTier {
+    ResamplerKind    kind = defaultResamplerKind();
+    ResamplerQuality quality = kResamplerMedium;
+
+    bool operator==(const ResamplerTier& other) const
+    {
+        return kind == other.kind && quality == other.quality;
+    }
+    bool operator!=(const ResamplerTier& other) const { return !(*this == other); }
+};
+
+class Resampler {
+public:
+    virtual ~Resampler() = default;
+
+    // Convert up to inFrames interleaved frames into at most outFrames.
+    // Returns frames generated; *used is the input frames consumed. Input
+    // the converter didn't take must be offered again next call.
+    virtual uint32_t process(const float* in, uint32_t inFrames,
+                             float* out, uint32_t outFrames,
+                             double ratio, uint32_t* used) = 0;
+
+    // Drop filter history (new timeline).
+    virtual void reset() = 0;
+
+    virtual ResamplerTier tier() const = 0;
+
+    // Input frames (at ratio 1) between a frame going in and its converted
+    // frame coming out. The engine shifts the stream's timeline stamps by
+    // it, so resampled streams stay sample-aligned with the Push ones.
+    virtual uint32_t groupDelay() const = 0;
+};
+
+// nullptr if the tier isn't available in this build or can't be created.
+std::unique_ptr<Resampler> makeResampler(const ResamplerTier& tier, uint32_t channels);
+
+const char* resamplerName(ResamplerKind kind);
+
+// "linear", "cubic", or a sinc converter with its quality:
+// "polyphase-high", "samplerate-low", ...
+const char* resamplerTierName(const ResamplerTier& tier);
+
+// Accepts the tier names above, a bare "polyphase" / "samplerate" for
+// medium quality, and "sinc[-low|-medium|-high]" for the default sinc
+// converter at that quality.
+bool parseResamplerTier(const char* name, ResamplerTier* out);
+
+} // namespace flux
@@ -0,0 +1,138 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace flux {
+
+// Spin-wait hint: yields the core's pipeline to its sibling thread.
+static inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+WorkerPool::WorkerPool(uint32_t workers, std::function<void()> setup)
+{
+#if defined(__APPLE__)
+    semaphore_create(mach_task_self(), &semaphore_, SYNC_POLICY_FIFO, 0);
+#else
+    sem_init(&semaphore_, 0, 0);
+#endif
+    workers = std::min(workers, kMaxWorkers);
+    for (uint32_t i = 0; i < workers; ++i) {
+        threads_.emplace_back([this, setup] { run(setup); });
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    stopping_.store(true, std::memory_order_release);
+    for (size_t i = 0; i < threads_.size(); ++i) wake();
+    for (auto& thread : threads_) thread.join();
+#if defined(__APPLE__)
+    semaphore_destroy(mach_task_self(), semaphore_);
+#else
+    sem_destroy(&semaphore_);
+#endif
+}
+
+void WorkerPool::wake()
+{
+#if defined(__APPLE__)
+    semaphore_signal(semaphore_);
+#else
+    sem_post(&semaphore_);
+#endif
+}
+
+void WorkerPool::wait()
+{
+#if defined(__APPLE__)
+    semaphore_wait(semaphore_);
+#else
+    while (sem_wait(&semaphore_) != 0) {}   // EINTR
+#endif
+}
+
+// ---- Realtime thread ----
+
+bool WorkerPool::post(RealtimeJob& job)
+{
+    if (threads_.empty()) return false;
+
+    job.state_.store(RealtimeJob::kPosted, std::memory_order_release);
+    for (uint32_t i = 0; i < kSlots; ++i) {
+        RealtimeJob* empty = nullptr;
+        if (slots_[i].compare_exchange_strong(empty, &job, std::memory_order_release,
+                                              std::memory_order_relaxed))
+        {
+            job.slot_ = i;
+            wake();
+            return true;
+        }
+    }
+    job.state_.store(RealtimeJob::kIdle, std::memory_order_relaxed);
+    return false;
+}
+
+bool WorkerPool::collect(RealtimeJob& job)
+{
+    // Not started: take it back — slot too, if no worker has emptied it —
+    // and run it here.
+    uint32_t posted = RealtimeJob::kPosted;
+    if (job.state_.compare_exchange_strong(posted, RealtimeJob::kIdle,
+                                           std::memory_order_acquire))
+    {
+        RealtimeJob* self = &job;
+        slots_[job.slot_].compare_exchange_strong(self, nullptr, std::memory_order_relaxed);
+        job.fn_(job.context_);
+        reclaimed_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // A worker has it: it's as far along as it would be inline.
+    while (job.state_.load(std::memory_order_acquire) != RealtimeJob::kDone) cpuRelax();
+    job.state_.store(RealtimeJob::kIdle, std::memory_order_relaxed);
+    offloaded_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+// ---- Workers ----
+
+void WorkerPool::run(const std::function<void()>& setup)
+{
+    if (setup) setup();
+
+    for (;;) {
+        wait();
+        if (stopping_.load(std::memory_order_acquire)) return;
+
+        // Whatever is queued. A job the poster took back, or that another
+        // worker got to first, fails the claim. A pointer left behind in a
+        // slot can only claim the job's current posting, which is as good.
+        for (auto& slot : slots_) {
+            RealtimeJob* job = slot.exchange(nullptr, std::memory_order_acquire);
+            if (!job) continue;
+            uint32_t posted = RealtimeJob::kPosted;
+            if (job->state_.compare_exchange_strong(posted, RealtimeJob::kRunning,
+                                                    std::memory_order_acquire))
+            {
+                job->fn_(job->context_);
+                job->state_.store(RealtimeJob::kDone, std::memory_order_release);
+            }
+        }
+    }
+}
+
+} // namespace flux
@@ -0,0 +1,104 @@
+#pragma once
+
+// WorkerPool: realtime helper threads an IOProc can hand work to.
+//
+// An IOProc with two independent pieces of work — the FLX4 callback's
+// input and output conversions — posts one as a RealtimeJob, does the
+// other itself, then collects the job. A worker that picked it up ran it
+// alongside; one that didn't get to it in time doesn't hold the IOProc up:
+// collect() takes the job back and runs it inline. Either way it runs
+// exactly once, with the same input, so the audio doesn't depend on which
+// thread ran it — only the callback's duration does. Its worst case is the
+// inline one plus a job handover, never a thread wake-up: collect() only
+// ever waits on a job a worker is already running.
+//
+// Jobs are owned by the posting thread and reused every cycle. The queue
+// is a fixed array of job slots, claimed and released with CAS; workers
+// sleep on a semaphore that post() signals, so the realtime side neither
+// allocates nor locks.
+//
+// Threading: post() and collect() for a job on the thread that owns it.
+// Construction and destruction on a control thread, with no job posted.
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#if defined(__APPLE__)
+#include <mach/semaphore.h>
+#else
+#include <semaphore.h>
+#endif
+
+namespace flux {
+
+class RealtimeJob {
+public:
+    using Fn = void (*)(void* context);
+
+    RealtimeJob(Fn fn, void* context) : fn_(fn), context_(context) {}
+
+    RealtimeJob(const RealtimeJob&) = delete;
+    RealtimeJob& operator=(const RealtimeJob&) = delete;
+
+private:
+    friend class WorkerPool;
+
+    enum State : uint32_t { kIdle, kPosted, kRunning, kDone };
+
+    Fn                    fn_;
+    void*                 context_;
+    std::atomic<uint32_t> state_{kIdle};
+    uint32_t              slot_ = 0;      // Owner thread only
+};
+
+class WorkerPool {
+public:
+    static constexpr uint32_t kMaxWorkers = 4;
+    static constexpr uint32_t kSlots = 8;
+
+    // Starts `workers` threads (at most kMaxWorkers). Each runs `setup`, if
+    // any, first — to raise its scheduling class, say.
+    explicit WorkerPool(uint32_t workers, std::function<void()> setup = {});
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    uint32_t workers() const { return static_cast<uint32_t>(threads_.size()); }
+
+    // ---- Realtime thread ----
+
+    // Queue the job for a worker. False if every slot is taken: run it
+    // inline instead.
+    bool post(RealtimeJob& job);
+
+    // Wait for a posted job. If no worker has started it, runs it here.
+    // True if a worker ran it.
+    bool collect(RealtimeJob& job);
+
+    // Jobs run by a worker, and taken back and run inline. Written by the
+    // posting threads, readable anywhere.
+    uint64_t offloaded() const { return offloaded_.load(std::memory_order_relaxed); }
+    uint64_t reclaimed() const { return reclaimed_.load(std::memory_order_relaxed); }
+
+private:
+    void run(const std::function<void()>& setup);
+    void wake();
+    void wait();
+
+    std::atomic<RealtimeJob*> slots_[kSlots] = {};
+    std::atomic<bool>         stopping_{false};
+    std::atomic<uint64_t>     offloaded_{0};
+    std::atomic<uint64_t>     reclaimed_{0};
+#if defined(__APPLE__)
+    semaphore_t               semaphore_;
+#else
+    sem_t                     semaphore_;
+#endif
+    std::vector<std::thread>  threads_;
+};
+
+} // namespace flux
@@ -1,18 +1,111 @@
 #include "AudioEngine.h"
 #include <os/log.h>
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <mach/thread_policy.h>
+#include <pthread.h>
+#include <algorithm>
+#include <cmath>
 #include <cstring>
+#include <ctime>
 
 namespace flux {
 
 static os_log_t sLog = os_log_create("com.pushflx4.aggregate.helper", "AudioEngine");
 
+// The HAL's timestamp flags → IOTime.
+static IOTime ioTime(const AudioTimeStamp* stamp)
+{
+    IOTime t;
+    if (!stamp) return t;
+    t.hostValid = (stamp->mFlags & kAudioTimeStampHostTimeValid) != 0;
+    t.sampleValid = (stamp->mFlags & kAudioTimeStampSampleTimeValid) != 0;
+    t.hostTime = stamp->mHostTime;
+    t.sampleTime = stamp->mSampleTime;
+    return t;
+}
+
+// A HAL buffer list → IOBufferList: every buffer (up to kMaxIOBuffers), one
+// interleaved buffer or one per channel alike. The engine gathers or
+// scatters whatever the streams' channels don't match.
+static IOBufferList bufferList(const AudioBufferList* abl)
+{
+    IOBufferList list;
+    if (!abl) return list;
+    uint32_t count = std::min<uint32_t>(abl->mNumberBuffers, kMaxIOBuffers);
+    for (uint32_t i = 0; i < count; ++i) {
+        const auto& buf = abl->mBuffers[i];
+        if (!buf.mData || buf.mNumberChannels == 0) break;
+        list.buffers[list.count++] = {static_cast<float*>(buf.mData), buf.mNumberChannels};
+    }
+    if (list.count > 0) {
+        list.frames = abl->mBuffers[0].mDataByteSize
+                      / (abl->mBuffers[0].mNumberChannels * sizeof(float));
+    }
+    return list;
+}
+
+// One HAL IO cycle → IOCycle.
+static IOCycle ioCycle(const AudioTimeStamp* now,
+                       const AudioBufferList* inputData,
+                       const AudioTimeStamp* inputTime,
+                       AudioBufferList* outputData,
+                       const AudioTimeStamp* outputTime)
+{
+    IOCycle cycle;
+    cycle.now = ioTime(now);
+    cycle.input = bufferList(inputData);
+    cycle.inputTime = ioTime(inputTime);
+    cycle.output = bufferList(outputData);
+    cycle.outputTime = ioTime(outputTime);
+    return cycle;
+}
+
+// ---- Worker threads ----
+// The slave IOProcs' workers (EngineConfig::workerThreads) get the same
+// scheduling class as the IOProcs they serve: time-constraint, with a
+// period of a typical slave buffer. The period is only a hint to the
+// scheduler; the IOProc never waits on a worker that hasn't started.
+
+static constexpr uint32_t kWorkerPeriodFrames = 256;
+
+static void promoteWorker()
+{
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    double periodNs = 1e9 * kWorkerPeriodFrames / kNominalSampleRate;
+    auto period = static_cast<uint32_t>(periodNs * timebase.denom / timebase.numer);
+
+    thread_time_constraint_policy_data_t policy;
+    policy.period = period;
+    policy.computation = period / 2;
+    policy.constraint = period;
+    policy.preemptible = 1;
+    kern_return_t kr = thread_policy_set(pthread_mach_thread_np(pthread_self()),
+                                         THREAD_TIME_CONSTRAINT_POLICY,
+                                         reinterpret_cast<thread_policy_t>(&policy),
+                                         THREAD_TIME_CONSTRAINT_POLICY_COUNT);
+    if (kr != KERN_SUCCESS) {
+        os_log_error(sLog, "Worker thread left at default priority (%d)", kr);
+    }
+}
+
+static EngineConfig withWorkerSetup(EngineConfig config)
+{
+    if (!config.workerSetup) config.workerSetup = promoteWorker;
+    return config;
+}
+
 AudioEngine::AudioEngine(SharedMemoryLayout* shm,
-                         const std::string& pushUID,
-                         const std::string& flx4UID)
+                         const EngineConfig& config,
+                         ClockCache* clockCache)
     : shm_(shm)
-    , pushUID_(pushUID)
-    , flx4UID_(flx4UID)
+    , core_(shm, withWorkerSetup(config))
+    , clockCache_(clockCache)
 {
+    for (size_t i = 0; i < config.devices.size(); ++i) {
+        devices_.push_back(std::make_unique<Device>());
+    }
 }
 
 AudioEngine::~AudioEngine()
@@ -24,300 +117,306 @@ bool AudioEngine::start()
 {
     if (running_) return true;
 
-    // Initialize resamplers (stereo, medium quality — 97dB SNR, 90% bandwidth).
-    int err;
-    resamplerIn_ = src_new(SRC_SINC_MEDIUM_QUALITY, kChannelsPerDevice, &err);
-    if (!resamplerIn_) {
-        os_log_error(sLog, "Failed to create input resampler: %s",
-                     src_strerror(err));
+    if (!core_.valid()) {
+        os_log_error(sLog, "Shared memory layout doesn't match the device configuration");
         return false;
     }
-    resamplerOut_ = src_new(SRC_SINC_MEDIUM_QUALITY, kChannelsPerDevice, &err);
-    if (!resamplerOut_) {
-        os_log_error(sLog, "Failed to create output resampler: %s",
-                     src_strerror(err));
-        src_delete(resamplerIn_);
-        resamplerIn_ = nullptr;
+    if (!startDevices()) return false;
+
+    shm_->helperStatus.store(kHelperRunning, std::memory_order_release);
+    running_ = true;
+    return true;
+}
+
+void AudioEngine::stop()
+{
+    if (!running_) return;
+
+    stopDevices();
+    shm_->helperStatus.store(kHelperOffline, std::memory_order_release);
+    running_ = false;
+
+    os_log_info(sLog, "AudioEngine stopped");
+}
+
+bool AudioEngine::startDevices()
+{
+    // The session runs at the rate a client last set the virtual device
+    // to, if it is one we offer.
+    auto requested = static_cast<double>(shm_->requestedRate.load(std::memory_order_acquire));
+    if (isSupportedSampleRate(requested)) core_.setSessionRate(requested);
+    shm_->sessionRate.store(static_cast<uint32_t>(core_.sessionRate()),
+                            std::memory_order_release);
+
+    // New session: master timeline, resamplers, servos, concealers.
+    if (!core_.begin()) {
+        os_log_error(sLog, "Failed to create the slave resamplers");
         return false;
     }
-    resamplerCue_ = src_new(SRC_SINC_MEDIUM_QUALITY, kChannelsPerDevice, &err);
-    if (!resamplerCue_) {
-        os_log_error(sLog, "Failed to create cue resampler: %s",
-                     src_strerror(err));
-        // Non-fatal: cue tap is optional. Continue without it.
-    }
 
-    // Open Push (master clock).
-    if (pushHW_.open(pushUID_)) {
-        double pushRate = pushHW_.nominalSampleRate();
-        pushDLL_ = DriftTracker(pushRate > 0 ? pushRate : 48000.0);
-        os_log_info(sLog, "Push sample rate: %.0f Hz", pushRate);
-        shm_->pushState.store(kDeviceConnected, std::memory_order_release);
-        pushHW_.start([this](auto... args) { onPushIO(args...); });
-        if (pushHW_.isRunning()) {
-            shm_->pushState.store(kDeviceRunning, std::memory_order_release);
+    const auto& configs = core_.config().devices;
+    const DeviceConfig& master = configs[kMasterDevice];
+    startedAt_ = std::chrono::steady_clock::now();
+
+    // Open every device. Rates from the last session with the same master
+    // and slave, if any, seed the estimators — each device only if it
+    // still runs at the nominal rate they were measured at. The master
+    // takes its rate from the first slave that has one. Every clock is set
+    // before any IOProc starts: seeding the master rebuilds its estimator
+    // and rate stages, which its IOProc must never see change under it.
+    bool masterSeeded = false;
+    for (uint32_t i = 0; i < devices_.size(); ++i) {
+        Device& device = *devices_[i];
+        const DeviceConfig& cfg = configs[i];
+        const char* name = cfg.name.c_str();
+        device.nominal = 0.0;
+        device.savedRates = ClockCacheEntry{};
+
+        if (!device.hw.open(cfg.uid)) {
+            core_.resetClock(i);
+            os_log_error(sLog, "%{public}s not found — will retry on hot-plug", name);
+            continue;
         }
-    } else {
-        pushDLL_.reset();
-        os_log_error(sLog, "Push not found — will retry on hot-plug");
+
+        double rate = device.hw.nominalSampleRate();
+        device.nominal = rate > 0 ? rate : kNominalSampleRate;
+        os_log_info(sLog, "%{public}s sample rate: %.0f Hz", name, rate);
+
+        ClockCacheEntry cached;
+        if (i == kMasterDevice) {
+            core_.setClock(i, device.nominal);
+        } else if (clockCache_ && clockCache_->lookup(master.uid, cfg.uid, &cached)) {
+            if (!masterSeeded && devices_[kMasterDevice]->nominal == cached.masterNominal) {
+                core_.setClock(kMasterDevice, cached.masterNominal, cached.masterRate);
+                os_log_info(sLog, "%{public}s clock seeded at %.4f Hz",
+                            master.name.c_str(), cached.masterRate);
+                masterSeeded = true;
+            }
+            if (cached.slaveNominal == device.nominal) {
+                core_.setClock(i, device.nominal, cached.slaveRate);
+                os_log_info(sLog, "%{public}s clock seeded at %.4f Hz", name, cached.slaveRate);
+            } else {
+                core_.setClock(i, device.nominal);
+            }
+        } else {
+            core_.setClock(i, device.nominal);
+        }
+        shm_->deviceState[i].store(kDeviceConnected, std::memory_order_release);
     }
 
-    // Open FLX4 (slave).
-    if (flx4HW_.open(flx4UID_)) {
-        double flx4Rate = flx4HW_.nominalSampleRate();
-        flx4DLL_ = DriftTracker(flx4Rate > 0 ? flx4Rate : 48000.0);
-        os_log_info(sLog, "FLX4 sample rate: %.0f Hz", flx4Rate);
-        shm_->flx4State.store(kDeviceConnected, std::memory_order_release);
-        flx4HW_.start([this](auto... args) { onFLX4IO(args...); });
-        if (flx4HW_.isRunning()) {
-            shm_->flx4State.store(kDeviceRunning, std::memory_order_release);
+    // Then start them.
+    uint32_t runningDevices = 0;
+    for (uint32_t i = 0; i < devices_.size(); ++i) {
+        Device& device = *devices_[i];
+        if (device.nominal <= 0.0) continue;
+        device.hw.start([this, i](AudioDeviceID, const AudioTimeStamp* now,
+                                  const AudioBufferList* inputData,
+                                  const AudioTimeStamp* inputTime,
+                                  AudioBufferList* outputData,
+                                  const AudioTimeStamp* outputTime) {
+            onIO(i, now, inputData, inputTime, outputData, outputTime);
+        });
+        if (device.hw.isRunning()) {
+            shm_->deviceState[i].store(kDeviceRunning, std::memory_order_release);
+            ++runningDevices;
         }
-    } else {
-        flx4DLL_.reset();
-        os_log_error(sLog, "FLX4 not found — will retry on hot-plug");
     }
 
-    // ---- Cue process tap (djay → FLX4 output stream 1 = cue channels 3-4) ----
-    if (flx4HW_.isRunning() && resamplerCue_) {
-        if (cueTap_.create(flx4UID_, kFLX4CueStreamIndex, kDjayBundleSubstring)) {
-            cueTap_.start([this](const AudioBufferList* inData,
-                                 const AudioTimeStamp* /*inTime*/,
-                                 UInt32 frameCount) {
+    // ---- Cue process taps (a process's audio on a slave's output stream) ----
+    uint32_t tappedDevices = 0;
+    for (uint32_t i = 1; i < devices_.size(); ++i) {
+        Device& device = *devices_[i];
+        const DeviceConfig& cfg = configs[i];
+        if (!cfg.cue) continue;
+        if (!core_.hasCue(i)) {
+            // Non-fatal: cue tap is optional. Continue without it.
+            os_log_error(sLog, "Failed to create %{public}s cue resampler", cfg.name.c_str());
+            continue;
+        }
+        if (!device.hw.isRunning()) continue;
+
+        device.cueTap = std::make_unique<ProcessTap>();
+        if (device.cueTap->create(cfg.uid, cfg.cueStreamIndex, cfg.cueProcess)) {
+            device.cueTap->start([this, i](const AudioBufferList* inData,
+                                           const AudioTimeStamp* inTime,
+                                           UInt32 frameCount) {
                 // Tap callback — runs on the tap's IO thread.
-                // Resample from FLX4 clock → Push clock, write to cue ring buffer.
-                if (!inData || inData->mNumberBuffers == 0 || !resamplerCue_) return;
-
-                const auto& buf = inData->mBuffers[0];
-                bool dllReady = pushDLL_.isStable() && flx4DLL_.isStable();
-
-                if (dllReady) {
-                    double ratio = pushDLL_.rate() / flx4DLL_.rate();
-                    uint32_t maxOutput = static_cast<uint32_t>(
-                        static_cast<double>(frameCount) * ratio + 4);
-                    if (maxOutput > kResampleBufFrames) maxOutput = kResampleBufFrames;
-
-                    SRC_DATA data;
-                    data.data_in = static_cast<const float*>(buf.mData);
-                    data.data_out = cueResampleBuf_;
-                    data.input_frames = frameCount;
-                    data.output_frames = maxOutput;
-                    data.src_ratio = ratio;
-                    data.end_of_input = 0;
-
-                    if (src_process(resamplerCue_, &data) == 0
-                        && data.output_frames_gen > 0) {
-                        // Compensate for multi-channel tap attenuation bug.
-                        // FLX4 has 2 stereo pairs → tap delivers -6 dB.
-                        uint32_t totalSamples =
-                            data.output_frames_gen * kChannelsPerDevice;
-                        for (uint32_t i = 0; i < totalSamples; ++i) {
-                            cueResampleBuf_[i] *= kCueTapGainCompensation;
-                        }
-                        shm_->flx4CueInput.write(
-                            cueResampleBuf_,
-                            data.output_frames_gen * kBytesPerFrame);
-                    }
-                } else {
-                    // DLL not stable — pass through raw (still compensate gain).
-                    // Copy to cue buffer, apply gain, write to shm.
-                    uint32_t totalSamples = frameCount * kChannelsPerDevice;
-                    const float* src = static_cast<const float*>(buf.mData);
-                    for (uint32_t i = 0; i < totalSamples && i < kResampleBufFrames * kChannelsPerDevice; ++i) {
-                        cueResampleBuf_[i] = src[i] * kCueTapGainCompensation;
-                    }
-                    shm_->flx4CueInput.write(
-                        cueResampleBuf_,
-                        frameCount * kBytesPerFrame);
-                }
+                IOBufferList input = bufferList(inData);
+                if (input.empty()) return;
+                input.frames = std::min<uint32_t>(input.frames, frameCount);
+                core_.cueIO(i, input, ioTime(inTime));
             });
-            os_log_info(sLog, "Cue tap started on FLX4 stream %d", kFLX4CueStreamIndex);
+            os_log_info(sLog, "Cue tap started on %{public}s stream %d",
+                        cfg.name.c_str(), cfg.cueStreamIndex);
+            if (device.cueTap->isRunning()) ++tappedDevices;
         } else {
-            os_log_info(sLog, "Cue tap not available (djay not running?) — will work without cue");
+            device.cueTap.reset();
+            os_log_info(sLog, "%{public}s cue tap not available (%{public}s not running?) — "
+                        "will work without cue", cfg.name.c_str(), cfg.cueProcess.c_str());
         }
     }
 
-    shm_->helperStatus.store(kHelperRunning, std::memory_order_release);
-    running_ = true;
-    os_log_info(sLog, "AudioEngine started (Push: %s, FLX4: %s, Cue: %s)",
-                pushHW_.isRunning() ? "running" : "offline",
-                flx4HW_.isRunning() ? "running" : "offline",
-                cueTap_.isRunning() ? "tapped" : "off");
+    os_log_info(sLog, "AudioEngine started (%u of %zu devices running, master %{public}s, "
+                "%u cue taps, session %.0f Hz)", runningDevices, devices_.size(),
+                devices_[kMasterDevice]->hw.isRunning() ? "running" : "offline", tappedDevices,
+                core_.sessionRate());
     return true;
 }
 
-void AudioEngine::stop()
+void AudioEngine::stopDevices()
 {
-    if (!running_) return;
-
-    cueTap_.stop();
-    pushHW_.stop();
-    flx4HW_.stop();
+    for (auto& device : devices_) {
+        if (device->cueTap) device->cueTap->stop();
+    }
+    for (auto& device : devices_) device->hw.stop();
 
-    if (resamplerIn_) { src_delete(resamplerIn_); resamplerIn_ = nullptr; }
-    if (resamplerOut_) { src_delete(resamplerOut_); resamplerOut_ = nullptr; }
-    if (resamplerCue_) { src_delete(resamplerCue_); resamplerCue_ = nullptr; }
+    // The drift records still hold the last estimates.
+    saveClockRates();
 
-    shm_->pushState.store(kDeviceDisconnected, std::memory_order_release);
-    shm_->flx4State.store(kDeviceDisconnected, std::memory_order_release);
-    shm_->helperStatus.store(kHelperOffline, std::memory_order_release);
-    running_ = false;
+    core_.end();
 
-    os_log_info(sLog, "AudioEngine stopped");
+    for (uint32_t i = 0; i < devices_.size(); ++i) {
+        devices_[i]->cueTap.reset();
+        shm_->deviceState[i].store(kDeviceDisconnected, std::memory_order_release);
+    }
 }
 
-// ---- Push IOProc (master clock) ----
-// Direct passthrough: hardware → shared memory, shared memory → hardware.
-// Also publishes clock timestamps for the plugin's GetZeroTimeStamp.
+// ---- Sample rates ----
+// The session runs at the virtual device's rate; every device at another
+// rate converts through fixed stages (EngineCore::setSessionRate). Any
+// change — a client setting the virtual device, or a device's own rate
+// moving under us — restarts the devices' IO on the new rates. The region
+// and the plugin's connection stay up; the plugin serves silence until
+// sessionRate matches its own again, and the clock cache gets the
+// estimators back to lock quickly.
 
-void AudioEngine::onPushIO(
-    AudioDeviceID /*device*/,
-    const AudioTimeStamp* now,
-    const AudioBufferList* inputData,
-    const AudioTimeStamp* inputTime,
-    AudioBufferList* outputData,
-    const AudioTimeStamp* outputTime)
+void AudioEngine::followRates()
 {
-    // Update Push DLL.
-    if (now->mFlags & kAudioTimeStampHostTimeValid) {
-        uint32_t frames = 0;
-        if (inputData && inputData->mNumberBuffers > 0) {
-            frames = inputData->mBuffers[0].mDataByteSize / kBytesPerFrame;
+    if (!running_) return;
+
+    bool changed = false;
+    auto requested = static_cast<double>(shm_->requestedRate.load(std::memory_order_acquire));
+    if (isSupportedSampleRate(requested) && requested != core_.sessionRate()) {
+        os_log_info(sLog, "Session rate %.0f → %.0f Hz", core_.sessionRate(), requested);
+        changed = true;
+    }
+    const auto& configs = core_.config().devices;
+    for (uint32_t i = 0; i < devices_.size(); ++i) {
+        const Device& device = *devices_[i];
+        if (device.nominal <= 0.0) continue;
+        double rate = device.hw.nominalSampleRate();
+        if (rate > 0.0 && rate != device.nominal) {
+            os_log_info(sLog, "%{public}s sample rate %.0f → %.0f Hz",
+                        configs[i].name.c_str(), device.nominal, rate);
+            changed = true;
         }
-        pushDLL_.update(now->mHostTime, frames);
     }
+    if (!changed) return;
 
-    // Publish Push clock → plugin reads this in GetZeroTimeStamp.
-    if (inputTime
-        && (inputTime->mFlags & kAudioTimeStampSampleTimeValid)
-        && (inputTime->mFlags & kAudioTimeStampHostTimeValid))
-    {
-        shm_->pushClock.sampleTime.store(
-            inputTime->mSampleTime, std::memory_order_relaxed);
-        shm_->pushClock.hostTime.store(
-            inputTime->mHostTime, std::memory_order_relaxed);
+    stopDevices();
+    if (!startDevices()) {
+        shm_->helperStatus.store(kHelperError, std::memory_order_release);
+        running_ = false;
     }
+}
 
-    // Push input → shared memory (for plugin to serve to Ableton).
-    if (inputData && inputData->mNumberBuffers > 0) {
-        const auto& buf = inputData->mBuffers[0];
-        shm_->pushInput.write(buf.mData, buf.mDataByteSize);
-    }
+// ---- Clock cache ----
+// A session's estimates are only worth keeping once they are its own: a
+// seeded estimator reports stable from the first callback, so wait out
+// kClockCacheSettleSeconds before the first save. After that, rewrite the
+// entry only when a rate has moved by more than kClockCacheResavePpm.
 
-    // Shared memory → Push output (Ableton's audio going to Push hardware).
-    if (outputData && outputData->mNumberBuffers > 0) {
-        auto& buf = outputData->mBuffers[0];
-        if (!shm_->pushOutput.read(buf.mData, buf.mDataByteSize)) {
-            std::memset(buf.mData, 0, buf.mDataByteSize);
-        }
+static constexpr double kClockCacheSettleSeconds = 30.0;
+static constexpr double kClockCacheResavePpm = 0.5;
+
+static bool movedBeyond(double rate, double saved, double ppm)
+{
+    return saved <= 0.0 || std::fabs(rate / saved - 1.0) > ppm * 1e-6;
+}
+
+bool AudioEngine::setResampler(uint32_t device, StreamRole role, const ResamplerTier& tier)
+{
+    core_.collect();
+    const char* name = device < devices_.size() ? core_.config().devices[device].name.c_str() : "?";
+    if (!running_ || !core_.setResampler(device, role, tier)) {
+        os_log_error(sLog, "Can't switch %{public}s stream %u to resampler %s",
+                     name, role, resamplerTierName(tier));
+        return false;
     }
+    os_log_info(sLog, "%{public}s stream %u crossfading to resampler %s",
+                name, role, resamplerTierName(tier));
+    return true;
 }
 
-// ---- FLX4 IOProc (slave — resampled to/from Push clock) ----
-// Input: read from FLX4 hardware, resample to Push clock, write to shared memory.
-// Output: read from shared memory, resample to FLX4 clock, write to hardware.
+void AudioEngine::collectResamplers()
+{
+    if (running_) core_.collect();
+}
 
-void AudioEngine::onFLX4IO(
-    AudioDeviceID /*device*/,
-    const AudioTimeStamp* now,
-    const AudioBufferList* inputData,
-    const AudioTimeStamp* /*inputTime*/,
-    AudioBufferList* outputData,
-    const AudioTimeStamp* /*outputTime*/)
+void AudioEngine::saveClockRates()
 {
-    // Update FLX4 DLL.
-    if (now->mFlags & kAudioTimeStampHostTimeValid) {
-        uint32_t frames = 0;
-        if (inputData && inputData->mNumberBuffers > 0) {
-            frames = inputData->mBuffers[0].mDataByteSize / kBytesPerFrame;
+    if (!clockCache_ || !clockCache_->enabled()) return;
+    const Device& master = *devices_[kMasterDevice];
+    if (master.nominal <= 0.0) return;
+
+    // The drift records count the master in session samples; the cache
+    // keeps its own, as the estimator it seeds runs on them.
+    double masterScale = master.nominal / core_.sessionRate();
+
+    std::chrono::duration<double> running = std::chrono::steady_clock::now() - startedAt_;
+    if (running.count() < kClockCacheSettleSeconds) return;
+
+    // One entry per slave, paired with the master.
+    const auto& configs = core_.config().devices;
+    for (uint32_t i = 1; i < devices_.size(); ++i) {
+        Device& device = *devices_[i];
+        if (device.nominal <= 0.0) continue;
+
+        DriftSnapshot drift;
+        if (!shm_->drift[i].tryLoad(&drift) || !drift.ready) continue;
+        double masterRate = drift.masterRate * masterScale;
+
+        if (!movedBeyond(masterRate, device.savedRates.masterRate, kClockCacheResavePpm)
+            && !movedBeyond(drift.slaveRate, device.savedRates.slaveRate, kClockCacheResavePpm))
+        {
+            continue;
         }
-        flx4DLL_.update(now->mHostTime, frames);
-    }
-
-    // Publish drift ratio for monitoring.
-    if (pushDLL_.isStable() && flx4DLL_.isStable()) {
-        shm_->driftRatio.store(
-            pushDLL_.rate() / flx4DLL_.rate(), std::memory_order_relaxed);
-    }
 
-    bool dllReady = pushDLL_.isStable() && flx4DLL_.isStable();
-
-    // ---- FLX4 Input → resample → shared memory ----
-    if (inputData && inputData->mNumberBuffers > 0 && resamplerIn_ && dllReady) {
-        const auto& buf = inputData->mBuffers[0];
-        uint32_t inputFrames = buf.mDataByteSize / kBytesPerFrame;
-        double ratio = pushDLL_.rate() / flx4DLL_.rate();
-
-        uint32_t maxOutput = static_cast<uint32_t>(
-            static_cast<double>(inputFrames) * ratio + 4);
-        if (maxOutput > kResampleBufFrames) maxOutput = kResampleBufFrames;
-
-        SRC_DATA data;
-        data.data_in = static_cast<const float*>(buf.mData);
-        data.data_out = resampleBuf_;
-        data.input_frames = inputFrames;
-        data.output_frames = maxOutput;
-        data.src_ratio = ratio;
-        data.end_of_input = 0;
-
-        if (src_process(resamplerIn_, &data) == 0 && data.output_frames_gen > 0) {
-            shm_->flx4Input.write(
-                resampleBuf_,
-                data.output_frames_gen * kBytesPerFrame);
+        ClockCacheEntry entry;
+        entry.masterUID = configs[kMasterDevice].uid;
+        entry.slaveUID = configs[i].uid;
+        entry.masterNominal = master.nominal;
+        entry.slaveNominal = device.nominal;
+        entry.masterRate = masterRate;
+        entry.slaveRate = drift.slaveRate;
+        entry.savedAt = static_cast<int64_t>(std::time(nullptr));
+        if (clockCache_->store(entry)) {
+            device.savedRates = entry;
+            os_log_info(sLog, "Saved clock rates: %{public}s %.4f Hz, %{public}s %.4f Hz",
+                        configs[kMasterDevice].name.c_str(), entry.masterRate,
+                        configs[i].name.c_str(), entry.slaveRate);
         }
-    } else if (inputData && inputData->mNumberBuffers > 0) {
-        // DLL not stable yet — pass through raw (better than silence).
-        const auto& buf = inputData->mBuffers[0];
-        shm_->flx4Input.write(buf.mData, buf.mDataByteSize);
     }
+}
 
-    // ---- Shared memory → resample → FLX4 Output ----
-    if (outputData && outputData->mNumberBuffers > 0) {
-        auto& buf = outputData->mBuffers[0];
-        uint32_t outputFrames = buf.mDataByteSize / kBytesPerFrame;
-
-        if (resamplerOut_ && dllReady) {
-            double ratio = flx4DLL_.rate() / pushDLL_.rate();
-
-            // Read enough Push-clock-domain frames to produce outputFrames
-            // in FLX4-clock-domain after resampling.
-            uint32_t inputNeeded = static_cast<uint32_t>(
-                static_cast<double>(outputFrames) / ratio + 4);
-            uint32_t inputBytes = inputNeeded * kBytesPerFrame;
-
-            // Use resampleBuf_ as temporary input storage.
-            float tempIn[kResampleBufFrames * kChannelsPerDevice];
-            int32_t available = shm_->flx4Output.availableRead();
-            if (available >= static_cast<int32_t>(inputBytes)) {
-                shm_->flx4Output.read(tempIn, inputBytes);
-
-                SRC_DATA data;
-                data.data_in = tempIn;
-                data.data_out = static_cast<float*>(buf.mData);
-                data.input_frames = inputNeeded;
-                data.output_frames = outputFrames;
-                data.src_ratio = ratio;
-                data.end_of_input = 0;
-
-                if (src_process(resamplerOut_, &data) != 0
-                    || data.output_frames_gen < outputFrames)
-                {
-                    // Partial output — zero-pad the rest.
-                    uint32_t filled = data.output_frames_gen * kBytesPerFrame;
-                    if (filled < buf.mDataByteSize) {
-                        std::memset(
-                            static_cast<uint8_t*>(buf.mData) + filled,
-                            0, buf.mDataByteSize - filled);
-                    }
-                }
-            } else {
-                std::memset(buf.mData, 0, buf.mDataByteSize);
-            }
-        } else {
-            // DLL not ready — try direct passthrough.
-            if (!shm_->flx4Output.read(buf.mData, buf.mDataByteSize)) {
-                std::memset(buf.mData, 0, buf.mDataByteSize);
-            }
-        }
+// ---- IOProcs ----
+// The master clock device: passthrough both ways, publishes the master
+// clock. Slaves: resampled to/from the master clock, each publishes its
+// drift.
+
+void AudioEngine::onIO(
+    uint32_t device,
+    const AudioTimeStamp* now,
+    const AudioBufferList* inputData,
+    const AudioTimeStamp* inputTime,
+    AudioBufferList* outputData,
+    const AudioTimeStamp* outputTime)
+{
+    IOCycle cycle = ioCycle(now, inputData, inputTime, outputData, outputTime);
+    if (device == kMasterDevice) {
+        core_.masterIO(cycle);
+    } else {
+        core_.slaveIO(device, cycle);
     }
 }
 
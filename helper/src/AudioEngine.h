@@ -2,25 +2,36 @@
 
 // AudioEngine: the core of the helper daemon.
 //
-// Manages both hardware devices (Push = master, FLX4 = slave).
-// Runs DriftTrackers on both, feeds the adaptive resampler for FLX4,
-// and writes all audio + clock data into shared memory for the plugin.
-
+// Manages the configured hardware devices (device 0 = clock master, the
+// rest slaves) and their cue process taps, and feeds their IO to an
+// EngineCore, which runs the clock estimators and resamplers and writes
+// all audio + clock data into shared memory for the plugin. Every device
+// runs its own IOProc thread, so the slaves' processing spreads over as
+// many cores as the HAL gives them.
+
+#include "ClockCache.h"
+#include "EngineCore.h"
 #include "HardwareDevice.h"
 #include "ProcessTap.h"
 #include "SharedMemory.h"
-#include "DriftTracker.h"
 
-#include <samplerate.h>
+#include <chrono>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace flux {
 
 class AudioEngine {
 public:
+    // config: the devices (UIDs, cue taps, output queues, per-stream
+    // resampler tiers), clock estimator and worker threads (EngineCore.h);
+    // shm must be laid out for it (layoutFor). Workers are raised to the
+    // IOProcs' time-constraint class unless config brings its own setup.
+    // clockCache: warm-start rates for the estimators (may be null).
     AudioEngine(SharedMemoryLayout* shm,
-                const std::string& pushUID,
-                const std::string& flx4UID);
+                const EngineConfig& config = {},
+                ClockCache* clockCache = nullptr);
     ~AudioEngine();
 
     // Open devices and start IOProcs. Non-blocking — callbacks run on
@@ -32,49 +43,69 @@ public:
 
     bool isRunning() const { return running_; }
 
+    const EngineConfig& config() const { return core_.config(); }
+
+    // Crossfade one of a slave's resampled streams to another converter
+    // tier while running (EngineCore::setResampler). Main thread.
+    bool setResampler(uint32_t device, StreamRole role, const ResamplerTier& tier);
+
+    // Free converters retired by switches. Call periodically from the main
+    // thread.
+    void collectResamplers();
+
+    // Save the converged rates to the clock cache once the session's own
+    // estimates have settled, and again whenever they move. Call
+    // periodically from a non-realtime thread; stop() saves too.
+    void saveClockRates();
+
+    // Stop every device's IO and start it again when the plugin has asked
+    // for another session rate (SharedMemoryLayout::requestedRate) or a
+    // device's nominal rate has changed — nothing is reconfigured live, so
+    // clients hear a short gap. Call periodically from the main thread.
+    void followRates();
+
 private:
-    // IOProc callbacks — called on CoreAudio's realtime threads.
-    void onPushIO(
-        AudioDeviceID device,
+    // Open every device and start its IOProc; stop them all again. Each
+    // device runs at whatever nominal rate its hardware is set to — nothing
+    // here changes it — and its rate stages convert to and from the session
+    // rate. start() and stop() around them set the helper's status, which a
+    // rate change leaves running.
+    bool startDevices();
+    void stopDevices();
+
+    // IOProc callback for every device — called on CoreAudio's realtime
+    // threads. Translates the HAL's buffers and timestamps and hands off to
+    // core_: masterIO() for device 0, slaveIO() for the rest.
+    void onIO(
+        uint32_t device,
         const AudioTimeStamp* now,
         const AudioBufferList* inputData,
         const AudioTimeStamp* inputTime,
         AudioBufferList* outputData,
         const AudioTimeStamp* outputTime);
 
-    void onFLX4IO(
-        AudioDeviceID device,
-        const AudioTimeStamp* now,
-        const AudioBufferList* inputData,
-        const AudioTimeStamp* inputTime,
-        AudioBufferList* outputData,
-        const AudioTimeStamp* outputTime);
+    // One configured device, parallel to config().devices.
+    struct Device {
+        HardwareDevice hw;
+
+        // Process tap on one of a slave's output streams, if configured.
+        std::unique_ptr<ProcessTap> cueTap;
+
+        // Warm start (main thread only). Nominal rate is 0 if the device
+        // didn't open this session; savedRates is a slave's last save.
+        double          nominal = 0.0;
+        ClockCacheEntry savedRates;
+    };
 
     SharedMemoryLayout* shm_;
-    std::string pushUID_;
-    std::string flx4UID_;
-
-    HardwareDevice pushHW_;
-    HardwareDevice flx4HW_;
-
-    DriftTracker pushDLL_{48000.0};   // Push 3 native rate
-    DriftTracker flx4DLL_{48000.0};   // FLX4 supports 44100+48000, use 48k to match Push
-
-    // Resamplers for FLX4 slave path (stereo).
-    // Input resampler: FLX4 hardware → shared memory (FLX4→Push clock domain).
-    // Output resampler: shared memory → FLX4 hardware (Push→FLX4 clock domain).
-    // Cue resampler: tap audio → shared memory (FLX4→Push clock domain).
-    SRC_STATE* resamplerIn_  = nullptr;
-    SRC_STATE* resamplerOut_ = nullptr;
-    SRC_STATE* resamplerCue_ = nullptr;
-
-    // Process tap for FLX4 cue output (djay → FLX4 stream 1 = channels 3-4).
-    ProcessTap cueTap_;
-
-    // Intermediate buffer for resampler output.
-    static constexpr int kResampleBufFrames = 4096;
-    float resampleBuf_[kResampleBufFrames * kChannelsPerDevice] = {};
-    float cueResampleBuf_[kResampleBufFrames * kChannelsPerDevice] = {};
+
+    // Clock estimation, resampling and ring IO for every path.
+    EngineCore core_;
+
+    std::vector<std::unique_ptr<Device>> devices_;
+
+    ClockCache* clockCache_;
+    std::chrono::steady_clock::time_point startedAt_;
 
     bool running_ = false;
 };
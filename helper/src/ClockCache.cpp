@@ -0,0 +1,149 @@
+#include "ClockCache.h"
+#include <os/log.h>
+#include <sys/stat.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace flux {
+
+static os_log_t sLog = os_log_create("com.pushflx4.aggregate.helper", "ClockCache");
+
+static constexpr const char* kHeader = "# pushflx4 clock rates v1";
+
+// ---- File format ----
+// masterUID \t slaveUID \t masterNominal \t slaveNominal \t masterRate \t slaveRate \t savedAt
+
+static bool parseLine(const std::string& line, ClockCacheEntry* out)
+{
+    std::vector<std::string> fields;
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, '\t')) fields.push_back(field);
+    if (fields.size() != 7) return false;
+
+    out->masterUID = fields[0];
+    out->slaveUID = fields[1];
+    out->masterNominal = std::strtod(fields[2].c_str(), nullptr);
+    out->slaveNominal = std::strtod(fields[3].c_str(), nullptr);
+    out->masterRate = std::strtod(fields[4].c_str(), nullptr);
+    out->slaveRate = std::strtod(fields[5].c_str(), nullptr);
+    out->savedAt = std::strtoll(fields[6].c_str(), nullptr, 10);
+    return !out->masterUID.empty() && !out->slaveUID.empty();
+}
+
+static std::vector<ClockCacheEntry> readEntries(const std::string& path)
+{
+    std::vector<ClockCacheEntry> entries;
+    std::ifstream in(path);
+    if (!in) return entries;
+
+    std::string line;
+    if (!std::getline(in, line) || line != kHeader) {
+        os_log_error(sLog, "Ignoring clock cache %{public}s: unknown format", path.c_str());
+        return entries;
+    }
+    while (std::getline(in, line)) {
+        ClockCacheEntry entry;
+        if (parseLine(line, &entry)) entries.push_back(entry);
+    }
+    return entries;
+}
+
+static bool plausible(double rate, double nominal)
+{
+    return nominal > 0.0 && std::isfinite(rate)
+        && std::fabs(rate / nominal - 1.0) <= ClockCache::kMaxDeviation;
+}
+
+// ---- ClockCache ----
+
+ClockCache::ClockCache(std::string path)
+    : path_(std::move(path))
+{
+}
+
+std::string ClockCache::defaultPath()
+{
+    const char* home = std::getenv("HOME");
+    if (!home || !*home) return {};
+    return std::string(home) + "/Library/Caches/com.pushflx4.aggregate.helper/clock-rates.tsv";
+}
+
+bool ClockCache::lookup(const std::string& masterUID, const std::string& slaveUID,
+                        ClockCacheEntry* out) const
+{
+    if (!enabled()) return false;
+
+    int64_t now = static_cast<int64_t>(std::time(nullptr));
+    for (const auto& entry : readEntries(path_)) {
+        if (entry.masterUID != masterUID || entry.slaveUID != slaveUID) continue;
+
+        if (now - entry.savedAt > kMaxAgeSeconds) {
+            os_log_info(sLog, "Cached clock rates are stale — ignoring");
+            return false;
+        }
+        if (!plausible(entry.masterRate, entry.masterNominal)
+            || !plausible(entry.slaveRate, entry.slaveNominal))
+        {
+            os_log_error(sLog, "Cached clock rates out of range — ignoring");
+            return false;
+        }
+        *out = entry;
+        return true;
+    }
+    return false;
+}
+
+bool ClockCache::store(const ClockCacheEntry& entry)
+{
+    if (!enabled()) return false;
+
+    // Newest first; drop the pair's old entry and anything past the limit.
+    std::vector<ClockCacheEntry> entries{entry};
+    for (const auto& old : readEntries(path_)) {
+        if (old.masterUID == entry.masterUID && old.slaveUID == entry.slaveUID) continue;
+        if (entries.size() >= kMaxEntries) break;
+        entries.push_back(old);
+    }
+
+    auto slash = path_.rfind('/');
+    if (slash != std::string::npos && slash > 0) {
+        mkdir(path_.substr(0, slash).c_str(), 0755);   // Fine if it exists
+    }
+
+    std::string tmp = path_ + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) {
+            os_log_error(sLog, "Can't write clock cache %{public}s", tmp.c_str());
+            return false;
+        }
+        char line[64];
+        out << kHeader << '\n';
+        for (const auto& e : entries) {
+            out << e.masterUID << '\t' << e.slaveUID;
+            std::snprintf(line, sizeof(line), "\t%.0f\t%.0f", e.masterNominal, e.slaveNominal);
+            out << line;
+            std::snprintf(line, sizeof(line), "\t%.9f\t%.9f", e.masterRate, e.slaveRate);
+            out << line << '\t' << e.savedAt << '\n';
+        }
+        if (!out.flush()) {
+            os_log_error(sLog, "Can't write clock cache %{public}s", tmp.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmp.c_str(), path_.c_str()) != 0) {
+        os_log_error(sLog, "Can't replace clock cache %{public}s", path_.c_str());
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace flux
@@ -0,0 +1,61 @@
+#pragma once
+
+// ClockCache: converged clock rates persisted across helper restarts.
+//
+// A fresh helper starts every clock estimator at nominal, and until they
+// are stable a slave's paths run unresampled — the rings drift, and the
+// switch to resampling is a discontinuity. The crystals don't change much
+// between sessions, though, so the engine saves the converged rates per
+// (master UID, slave UID) pair and seeds the next session's estimators with
+// them (ClockEstimator::seed): resampling starts with the first callback.
+// A device running at a different nominal rate than when its entry was
+// saved must not be seeded from it — the engine checks per device.
+//
+// One tab-separated line per device pair, newest first, rewritten whole via
+// a temporary file and rename. Entries older than kMaxAgeSeconds, or
+// implausibly far from their nominal rates, are ignored.
+//
+// File I/O — never call from the realtime threads.
+
+#include <cstdint>
+#include <string>
+
+namespace flux {
+
+struct ClockCacheEntry {
+    std::string masterUID;
+    std::string slaveUID;
+    double      masterNominal = 0.0;
+    double      slaveNominal = 0.0;
+    double      masterRate = 0.0;   // Host-clock rates, as ClockEstimator::rate()
+    double      slaveRate = 0.0;
+    int64_t     savedAt = 0;        // Unix seconds
+};
+
+class ClockCache {
+public:
+    // path empty: caching disabled.
+    explicit ClockCache(std::string path);
+
+    // ~/Library/Caches/com.pushflx4.aggregate.helper/clock-rates.tsv
+    static std::string defaultPath();
+
+    bool enabled() const { return !path_.empty(); }
+    const std::string& path() const { return path_; }
+
+    // Usable rates for this pair.
+    bool lookup(const std::string& masterUID, const std::string& slaveUID,
+                ClockCacheEntry* out) const;
+
+    // Insert or replace the pair's entry.
+    bool store(const ClockCacheEntry& entry);
+
+    static constexpr int64_t  kMaxAgeSeconds = 30 * 24 * 3600;
+    static constexpr double   kMaxDeviation = 1000e-6;   // From nominal
+    static constexpr uint32_t kMaxEntries = 16;
+
+private:
+    std::string path_;
+};
+
+} // namespace flux
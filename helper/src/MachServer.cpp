@@ -30,56 +30,22 @@ MachServer::~MachServer()
     stop();
 }
 
-bool MachServer::start()
+void* MachServer::allocateRegion(size_t size)
 {
-    if (!allocateSharedMemory()) return false;
-    if (!registerService()) return false;
-
-    os_log_info(sLog, "MachServer started, service: %{public}s", kMachServiceName);
-    return true;
-}
-
-void MachServer::stop()
-{
-    stopRequested_.store(true, std::memory_order_relaxed);
-
-    if (servicePort_ != MACH_PORT_NULL) {
-        mach_port_deallocate(mach_task_self(), servicePort_);
-        servicePort_ = MACH_PORT_NULL;
-    }
-
-    if (memoryEntryPort_ != MACH_PORT_NULL) {
-        mach_port_deallocate(mach_task_self(), memoryEntryPort_);
-        memoryEntryPort_ = MACH_PORT_NULL;
-    }
-
-    if (sharedMemAddr_ != 0) {
-        mach_vm_deallocate(mach_task_self(), sharedMemAddr_, sharedMemSize_);
-        sharedMemAddr_ = 0;
-        sharedMem_ = nullptr;
-    }
-}
-
-bool MachServer::allocateSharedMemory()
-{
-    sharedMemSize_ = sizeof(SharedMemoryLayout);
-
     // Round up to page size.
     vm_size_t pageSize = 0;
     host_page_size(mach_host_self(), &pageSize);
-    sharedMemSize_ = ((sharedMemSize_ + pageSize - 1) / pageSize) * pageSize;
+    sharedMemSize_ = ((size + pageSize - 1) / pageSize) * pageSize;
 
     kern_return_t kr = mach_vm_allocate(
         mach_task_self(), &sharedMemAddr_, sharedMemSize_,
         VM_FLAGS_ANYWHERE);
     if (kr != KERN_SUCCESS) {
         os_log_error(sLog, "mach_vm_allocate failed: %s", mach_error_string(kr));
-        return false;
+        sharedMemAddr_ = 0;
+        return nullptr;
     }
 
-    sharedMem_ = reinterpret_cast<SharedMemoryLayout*>(sharedMemAddr_);
-    sharedMem_->init();
-
     // Create a memory entry port that the plugin can use to map this region.
     memory_object_size_t entrySize = sharedMemSize_;
     kr = mach_make_memory_entry_64(
@@ -94,34 +60,87 @@ bool MachServer::allocateSharedMemory()
                      mach_error_string(kr));
         mach_vm_deallocate(mach_task_self(), sharedMemAddr_, sharedMemSize_);
         sharedMemAddr_ = 0;
-        return false;
+        memoryEntryPort_ = MACH_PORT_NULL;
+        return nullptr;
     }
 
-    os_log_info(sLog, "Shared memory allocated: %llu bytes at %p",
-                sharedMemSize_, sharedMem_);
+    os_log_info(sLog, "Shared memory allocated: %llu bytes at 0x%llx, layout v%u",
+                sharedMemSize_, sharedMemAddr_, kLayoutVersion);
+    return reinterpret_cast<void*>(sharedMemAddr_);
+}
+
+void MachServer::releaseRegion()
+{
+    if (memoryEntryPort_ != MACH_PORT_NULL) {
+        mach_port_deallocate(mach_task_self(), memoryEntryPort_);
+        memoryEntryPort_ = MACH_PORT_NULL;
+    }
+
+    if (sharedMemAddr_ != 0) {
+        mach_vm_deallocate(mach_task_self(), sharedMemAddr_, sharedMemSize_);
+        sharedMemAddr_ = 0;
+    }
+}
+
+bool MachServer::mapMirror(void* at, size_t size, uint64_t offset)
+{
+    // The memory entry covers the whole region: mapping a piece of it over
+    // the region shares that piece's pages rather than copying them.
+    auto addr = reinterpret_cast<mach_vm_address_t>(at);
+    kern_return_t kr = mach_vm_map(
+        mach_task_self(),
+        &addr,
+        size,
+        0,          // alignment mask
+        VM_FLAGS_FIXED | VM_FLAGS_OVERWRITE,
+        memoryEntryPort_,
+        offset,
+        FALSE,      // copy — FALSE = share the pages
+        VM_PROT_READ | VM_PROT_WRITE,
+        VM_PROT_READ | VM_PROT_WRITE,
+        VM_INHERIT_NONE);
+    if (kr != KERN_SUCCESS) {
+        os_log_error(sLog, "Mirror mach_vm_map failed: %s", mach_error_string(kr));
+        return false;
+    }
     return true;
 }
 
-bool MachServer::registerService()
+bool MachServer::publish()
 {
     kern_return_t kr = bootstrap_check_in(
         bootstrap_port, kMachServiceName, &servicePort_);
     if (kr != KERN_SUCCESS) {
         os_log_error(sLog, "bootstrap_check_in failed: %s (is another instance running?)",
                      mach_error_string(kr));
+        servicePort_ = MACH_PORT_NULL;
         return false;
     }
 
-    os_log_info(sLog, "Registered Mach service: %{public}s", kMachServiceName);
+    os_log_info(sLog, "MachServer started, service: %{public}s", kMachServiceName);
     return true;
 }
 
+void MachServer::unpublish()
+{
+    if (servicePort_ != MACH_PORT_NULL) {
+        mach_port_deallocate(mach_task_self(), servicePort_);
+        servicePort_ = MACH_PORT_NULL;
+    }
+}
+
+void MachServer::onError(const char* what)
+{
+    os_log_error(sLog, "MachServer: %{public}s", what);
+}
+
 void MachServer::runMessageLoop()
 {
     // Buffer large enough for request + trailer.
     uint8_t msgBuf[sizeof(RequestMsg) + 256];
 
-    while (!stopRequested_.load(std::memory_order_relaxed)) {
+    while (!stopRequested()) {
+        beat();
         auto* msg = reinterpret_cast<mach_msg_header_t*>(msgBuf);
         std::memset(msgBuf, 0, sizeof(msgBuf));
 
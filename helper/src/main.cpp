@@ -1,15 +1,22 @@
 #include "AudioEngine.h"
+#include "ClockCache.h"
 #include "MachServer.h"
 #include "Constants.h"
 
 #include <os/log.h>
 #include <CoreFoundation/CoreFoundation.h>
 #include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
 #include <thread>
+#include <vector>
 
 static os_log_t sLog = os_log_create("com.pushflx4.aggregate.helper", "main");
 
 static std::atomic<bool> gShouldQuit{false};
+static std::atomic<bool> gReloadResamplers{false};
 
 static void signalHandler(int sig)
 {
@@ -18,36 +25,381 @@ static void signalHandler(int sig)
     CFRunLoopStop(CFRunLoopGetMain());
 }
 
+static void reloadHandler(int sig)
+{
+    gReloadResamplers.store(true, std::memory_order_relaxed);
+    CFRunLoopStop(CFRunLoopGetMain());
+}
+
+// ~/Library/Application Support/com.pushflx4.aggregate.helper/resamplers.conf
+static std::string defaultResamplerFile()
+{
+    const char* home = std::getenv("HOME");
+    if (!home || !*home) return {};
+    return std::string(home)
+         + "/Library/Application Support/com.pushflx4.aggregate.helper/resamplers.conf";
+}
+
+// ~/Library/Application Support/com.pushflx4.aggregate.helper/devices.conf
+static std::string defaultDeviceFile()
+{
+    const char* home = std::getenv("HOME");
+    if (!home || !*home) return {};
+    return std::string(home)
+         + "/Library/Application Support/com.pushflx4.aggregate.helper/devices.conf";
+}
+
+// Apply a resampler file: one --resampler value per line, '#' comments.
+// A missing file changes nothing.
+static void readResamplerFile(const std::string& path, flux::EngineConfig* config)
+{
+    if (path.empty()) return;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        line.erase(0, line.find_first_not_of(" \t"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (line.empty() || line[0] == '#') continue;
+        if (!flux::parseResamplerArg(line.c_str(), config)) {
+            os_log_error(sLog, "Ignoring resampler %{public}s in %{public}s",
+                         line.c_str(), path.c_str());
+        }
+    }
+}
+
+static void logResamplers(const flux::EngineConfig& config)
+{
+    for (size_t i = 1; i < config.devices.size(); ++i) {
+        const flux::DeviceConfig& device = config.devices[i];
+        os_log_info(sLog, "Resamplers %{public}s: in %{public}s, cue %{public}s, out %{public}s",
+                    device.name.c_str(),
+                    flux::resamplerTierName(device.inputResampler),
+                    device.cue ? flux::resamplerTierName(device.cueResampler) : "-",
+                    flux::resamplerTierName(device.outputResampler));
+    }
+}
+
+// Re-read the resampler file and crossfade every stream whose tier changed.
+static void reloadResamplers(const std::string& path, flux::AudioEngine& engine)
+{
+    flux::EngineConfig wanted = engine.config();
+    readResamplerFile(path, &wanted);
+
+    const flux::EngineConfig& current = engine.config();
+    for (uint32_t i = 1; i < wanted.devices.size(); ++i) {
+        const flux::DeviceConfig& to = wanted.devices[i];
+        const flux::DeviceConfig& from = current.devices[i];
+        if (to.inputResampler != from.inputResampler) {
+            engine.setResampler(i, flux::kStreamCapture, to.inputResampler);
+        }
+        if (to.cue && to.cueResampler != from.cueResampler) {
+            engine.setResampler(i, flux::kStreamCue, to.cueResampler);
+        }
+        if (to.outputResampler != from.outputResampler) {
+            engine.setResampler(i, flux::kStreamPlayback, to.outputResampler);
+        }
+    }
+    logResamplers(engine.config());
+}
+
+// Parse a ring size argument: round up to a power of two, keep the default
+// on garbage. The floor leaves room for the input alignment latency.
+static uint32_t ringFramesArg(const char* arg, uint32_t fallback)
+{
+    unsigned long n = std::strtoul(arg, nullptr, 10);
+    if (n < 2 * flux::kInputAlignmentLatency || n > (1ul << 20)) {
+        os_log_error(sLog, "Ignoring ring size %{public}s", arg);
+        return fallback;
+    }
+    uint32_t frames = 1;
+    while (frames < n) frames <<= 1;
+    return frames;
+}
+
+// Parse a queue length argument (frames); keep the default on garbage. It
+// has to leave the servo room to measure against.
+static uint32_t queueFramesArg(const char* arg, uint32_t fallback)
+{
+    unsigned long n = std::strtoul(arg, nullptr, 10);
+    if (n <= static_cast<unsigned long>(flux::kResamplerGroupDelay) || n > (1ul << 19)) {
+        os_log_error(sLog, "Ignoring queue length %{public}s", arg);
+        return fallback;
+    }
+    return static_cast<uint32_t>(n);
+}
+
+// Parse a channel count argument (1..kMaxStreamChannels); keep the default
+// on garbage.
+static uint32_t channelsArg(const char* arg, uint32_t fallback)
+{
+    auto n = static_cast<uint32_t>(std::strtoul(arg, nullptr, 10));
+    if (!flux::LayoutTable::validChannels(n)) {
+        os_log_error(sLog, "Ignoring channel count %{public}s", arg);
+        return fallback;
+    }
+    return n;
+}
+
+// Parse one device: "<name> [key=value ...] <uid>", the UID being the
+// rest of the line (UIDs have spaces). Keys: cue=<output stream index> taps
+// that stream for a cue input, process=<bundle id substring> picks whose
+// audio (djay by default), gain=<factor> makes up for the tap's
+// attenuation, ring=<frames> sizes the device's rings, queue=<frames> sets
+// a slave's output queue, inputs=<n> and outputs=<n> (or channels=<n> for
+// both) set how many of the device's channels its streams carry.
+static bool parseDevice(const std::string& text, flux::DeviceConfig* out)
+{
+    std::istringstream in(text);
+    flux::DeviceConfig device;
+    if (!(in >> device.name) || device.name.size() >= flux::kDeviceNameLength) return false;
+
+    std::string token;
+    while (in >> token) {
+        auto eq = token.find('=');
+        if (eq == std::string::npos) break;
+        std::string key = token.substr(0, eq);
+        const char* value = token.c_str() + eq + 1;
+        if (key == "cue") {
+            device.cue = true;
+            device.cueStreamIndex = std::atoi(value);
+        } else if (key == "process") {
+            device.cueProcess = value;
+        } else if (key == "gain") {
+            device.cueGain = static_cast<float>(std::atof(value));
+        } else if (key == "ring") {
+            device.ringFrames = ringFramesArg(value, 0);
+        } else if (key == "queue") {
+            device.outputQueue = queueFramesArg(value, device.outputQueue);
+        } else if (key == "inputs") {
+            device.inputChannels = channelsArg(value, device.inputChannels);
+        } else if (key == "outputs") {
+            device.outputChannels = channelsArg(value, device.outputChannels);
+        } else if (key == "channels") {
+            device.inputChannels = channelsArg(value, device.inputChannels);
+            device.outputChannels = channelsArg(value, device.outputChannels);
+        } else {
+            break;
+        }
+        token.clear();
+    }
+
+    // The rest of the line, from the first token that isn't an option.
+    std::string rest;
+    std::getline(in, rest);
+    device.uid = token + rest;
+    device.uid.erase(device.uid.find_last_not_of(" \t\r") + 1);
+    if (device.uid.empty()) return false;
+    *out = device;
+    return true;
+}
+
+// Read a device file: one parseDevice() line per device, the clock master
+// first, '#' comments. False if the file is missing or names no devices.
+static bool readDeviceFile(const std::string& path, std::vector<flux::DeviceConfig>* out)
+{
+    if (path.empty()) return false;
+    std::ifstream in(path);
+    if (!in) return false;
+
+    std::vector<flux::DeviceConfig> devices;
+    std::string line;
+    while (std::getline(in, line)) {
+        line.erase(0, line.find_first_not_of(" \t"));
+        if (line.empty() || line[0] == '#') continue;
+        flux::DeviceConfig device;
+        if (parseDevice(line, &device)) {
+            devices.push_back(device);
+        } else {
+            os_log_error(sLog, "Ignoring device %{public}s in %{public}s",
+                         line.c_str(), path.c_str());
+        }
+    }
+    if (devices.empty()) return false;
+    *out = devices;
+    return true;
+}
+
+// The configured device with a name, nullptr if none.
+static flux::DeviceConfig* findDevice(flux::EngineConfig& config, const char* name)
+{
+    for (auto& device : config.devices) {
+        if (device.name == name) return &device;
+    }
+    return nullptr;
+}
+
 int main(int argc, const char* argv[])
 {
     os_log_info(sLog, "PushFLX4 helper daemon starting");
 
-    // ---- Device UIDs (defaults from Constants.h, overridable via CLI) ----
-    std::string pushUID = flux::kDefaultPushUID;
-    std::string flx4UID = flux::kDefaultFLX4UID;
+    // ---- Devices (Push + FLX4 unless configured, EngineCore.h) ----
+    // --device lines replace the device file; the Push/FLX4 options below
+    // adjust the devices named push and flx4, whichever list that is.
+    std::vector<std::string> deviceArgs;
+    std::string deviceFile = defaultDeviceFile();
+    std::string pushUID, flx4UID;
+    uint32_t pushRingFrames = 0, flx4RingFrames = 0, flx4OutputQueue = 0;
+    bool mirroredRings = false;     // SharedMemory.h, FrameRing
+
+    // ---- Clock estimator (ClockEstimator.h) ----
+    flux::ClockEstimatorKind clockEstimator = flux::kClockEstimatorKalman;
 
-    // Override from command line: --push-uid <uid> --flx4-uid <uid>
+    // ---- Resampler tier per slave stream (Resampler.h) ----
+    // Command line first, then the resampler file, which is re-read on
+    // SIGHUP to switch tiers while running.
+    flux::EngineConfig engineConfig;
+    std::vector<std::string> resamplerArgs;
+    std::string resamplerFile = defaultResamplerFile();
+
+    // ---- Warm-start clock cache (ClockCache.h; empty path disables) ----
+    std::string clockCachePath = flux::ClockCache::defaultPath();
+
+    // Override from command line: --device "<name> [key=value ...] <uid>"
+    //                                 (repeatable, master first; see
+    //                                 parseDevice)
+    //                             --devices-file <path>|""
+    //                             --push-uid <uid> --flx4-uid <uid>
+    //                             --push-ring-frames <n> --flx4-ring-frames <n>
+    //                             --flx4-output-queue <n>
+    //                             --ring-mode modulo|mirrored
+    //                             --clock-estimator dll|adaptive|kalman|lsq
+    //                             --clock-cache <path>|""
+    //                             --resampler [<device>-in=|<device>-cue=|<device>-out=]<tier>
+    //                                 (repeatable; tiers: linear, cubic,
+    //                                 sinc|polyphase|samplerate[-low|-medium|-high])
+    //                             --resampler-file <path>|""
+    //                             --workers <n>  (slave input conversions
+    //                                 on worker threads; 0 = inline)
     for (int i = 1; i < argc - 1; ++i) {
-        if (std::string(argv[i]) == "--push-uid") {
+        if (std::string(argv[i]) == "--device") {
+            deviceArgs.push_back(argv[++i]);
+        } else if (std::string(argv[i]) == "--devices-file") {
+            deviceFile = argv[++i];
+        } else if (std::string(argv[i]) == "--push-uid") {
             pushUID = argv[++i];
         } else if (std::string(argv[i]) == "--flx4-uid") {
             flx4UID = argv[++i];
+        } else if (std::string(argv[i]) == "--push-ring-frames") {
+            pushRingFrames = ringFramesArg(argv[++i], pushRingFrames);
+        } else if (std::string(argv[i]) == "--flx4-ring-frames") {
+            flx4RingFrames = ringFramesArg(argv[++i], flx4RingFrames);
+        } else if (std::string(argv[i]) == "--flx4-output-queue") {
+            flx4OutputQueue = queueFramesArg(argv[++i], flx4OutputQueue);
+        } else if (std::string(argv[i]) == "--ring-mode") {
+            std::string mode = argv[++i];
+            if (mode == "modulo" || mode == "mirrored") {
+                mirroredRings = mode == "mirrored";
+            } else {
+                os_log_error(sLog, "Ignoring ring mode %{public}s", argv[i]);
+            }
+        } else if (std::string(argv[i]) == "--clock-estimator") {
+            if (!flux::parseClockEstimatorKind(argv[++i], &clockEstimator)) {
+                os_log_error(sLog, "Ignoring clock estimator %{public}s", argv[i]);
+            }
+        } else if (std::string(argv[i]) == "--clock-cache") {
+            clockCachePath = argv[++i];
+        } else if (std::string(argv[i]) == "--resampler") {
+            resamplerArgs.push_back(argv[++i]);
+        } else if (std::string(argv[i]) == "--resampler-file") {
+            resamplerFile = argv[++i];
+        } else if (std::string(argv[i]) == "--workers") {
+            unsigned long n = std::strtoul(argv[++i], nullptr, 10);
+            if (n > flux::WorkerPool::kMaxWorkers) {
+                os_log_error(sLog, "Ignoring worker count %{public}s", argv[i]);
+            } else {
+                engineConfig.workerThreads = static_cast<uint32_t>(n);
+            }
+        }
+    }
+
+    // The device list: command line, else the device file, else defaults.
+    if (!deviceArgs.empty()) {
+        engineConfig.devices.clear();
+        for (const auto& arg : deviceArgs) {
+            flux::DeviceConfig device;
+            if (parseDevice(arg, &device)) {
+                engineConfig.devices.push_back(device);
+            } else {
+                os_log_error(sLog, "Ignoring device %{public}s", arg.c_str());
+            }
         }
+    } else if (readDeviceFile(deviceFile, &engineConfig.devices)) {
+        os_log_info(sLog, "Devices from %{public}s", deviceFile.c_str());
+    }
+    if (flux::DeviceConfig* push = findDevice(engineConfig, "push")) {
+        if (!pushUID.empty()) push->uid = pushUID;
+        if (pushRingFrames) push->ringFrames = pushRingFrames;
+    }
+    if (flux::DeviceConfig* flx4 = findDevice(engineConfig, "flx4")) {
+        if (!flx4UID.empty()) flx4->uid = flx4UID;
+        if (flx4RingFrames) flx4->ringFrames = flx4RingFrames;
+        if (flx4OutputQueue) flx4->outputQueue = flx4OutputQueue;
+    }
+
+    flux::LayoutTable layout;
+    if (!flux::layoutFor(engineConfig, &layout)) {
+        os_log_error(sLog, "Invalid device configuration (%zu devices, at most %u with "
+                     "unique names) — using Push + FLX4",
+                     engineConfig.devices.size(), flux::kMaxDevices);
+        engineConfig.devices = flux::defaultDevices();
+        flux::layoutFor(engineConfig, &layout);
+    }
+    layout.mirrored = mirroredRings;
+    if (mirroredRings) os_log_info(sLog, "Rings mapped mirrored");
+
+    for (const auto& arg : resamplerArgs) {
+        if (!flux::parseResamplerArg(arg.c_str(), &engineConfig)) {
+            os_log_error(sLog, "Ignoring resampler %{public}s", arg.c_str());
+        }
+    }
+    readResamplerFile(resamplerFile, &engineConfig);
+
+    // Each slave's output queue is held in its ring, so it has to fit with
+    // a buffer spare.
+    for (size_t i = 1; i < engineConfig.devices.size(); ++i) {
+        flux::DeviceConfig& device = engineConfig.devices[i];
+        uint32_t ringFrames = device.ringFrames ? device.ringFrames : flux::kSlaveRingFrames;
+        if (device.outputQueue + flux::kLatencyResyncFrames >= ringFrames) {
+            os_log_error(sLog, "%{public}s output queue %u doesn't fit a %u-frame ring, using %u",
+                         device.name.c_str(), device.outputQueue, ringFrames,
+                         flux::kSlaveOutputQueueFrames);
+            device.outputQueue = flux::kSlaveOutputQueueFrames;
+        }
+        if (device.outputQueue != flux::kSlaveOutputQueueFrames) {
+            os_log_info(sLog, "%{public}s output queue %u frames",
+                        device.name.c_str(), device.outputQueue);
+        }
+    }
+    for (size_t i = 0; i < engineConfig.devices.size(); ++i) {
+        const flux::DeviceConfig& device = engineConfig.devices[i];
+        os_log_info(sLog, "Device %zu %{public}s (%{public}s): %{public}s, %u in / %u out%{public}s",
+                    i, device.name.c_str(), i == flux::kMasterDevice ? "master" : "slave",
+                    device.uid.c_str(), device.inputChannels, device.outputChannels,
+                    device.cue ? ", cue tap" : "");
     }
 
     // ---- Signal handling ----
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
+    signal(SIGHUP, reloadHandler);
 
     // ---- Mach IPC server ----
     flux::MachServer server;
-    if (!server.start()) {
+    if (!server.start(layout)) {
         os_log_error(sLog, "Failed to start Mach server — exiting");
         return 1;
     }
 
     // ---- Audio engine ----
-    flux::AudioEngine engine(server.sharedMemory(), pushUID, flx4UID);
+    flux::ClockCache clockCache(clockCachePath);
+    engineConfig.clockEstimator = clockEstimator;
+    flux::AudioEngine engine(server.sharedMemory(), engineConfig, &clockCache);
+    os_log_info(sLog, "Clock estimator: %{public}s", flux::clockEstimatorName(clockEstimator));
+    logResamplers(engineConfig);
+    if (engineConfig.workerThreads > 0) {
+        os_log_info(sLog, "Slave input conversions on %u worker thread(s)",
+                    engineConfig.workerThreads);
+    }
     if (!engine.start()) {
         os_log_error(sLog, "Failed to start audio engine — exiting");
         return 1;
@@ -61,8 +413,16 @@ int main(int argc, const char* argv[])
     os_log_info(sLog, "Helper daemon running — waiting for plugin connections");
 
     // ---- Main run loop (needed for CoreAudio callbacks + IOKit notifications) ----
+    // Short passes: a sample rate change leaves the plugin silent until
+    // followRates() has restarted the devices on it.
     while (!gShouldQuit.load(std::memory_order_relaxed)) {
-        CFRunLoopRunInMode(kCFRunLoopDefaultMode, 1.0, true);
+        CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0.25, true);
+        if (gReloadResamplers.exchange(false, std::memory_order_relaxed)) {
+            reloadResamplers(resamplerFile, engine);
+        }
+        engine.followRates();
+        engine.collectResamplers();
+        engine.saveClockRates();
     }
 
     // ---- Shutdown ----
@@ -0,0 +1,149 @@
+#include "ConnectionManager.h"
+#include "Constants.h"
+
+#include <os/log.h>
+
+namespace flux {
+
+static os_log_t sLog = os_log_create("com.pushflx4.aggregate.plugin", "ConnectionManager");
+
+// How often the thread checks on the helper, and how long it waits between
+// connection attempts while the helper is down.
+static constexpr auto kPollInterval  = std::chrono::milliseconds(250);
+static constexpr auto kRetryInterval = std::chrono::seconds(1);
+
+ConnectionManager::ConnectionManager(ClientFactory factory)
+    : factory_(std::move(factory))
+{
+}
+
+ConnectionManager::~ConnectionManager()
+{
+    stop();
+}
+
+void ConnectionManager::start()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (thread_.joinable()) return;
+    stopRequested_ = false;
+    thread_ = std::thread([this] { run(); });
+}
+
+void ConnectionManager::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!thread_.joinable()) return;
+        stopRequested_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+    thread_ = std::thread();
+    swap(nullptr);
+}
+
+void ConnectionManager::run()
+{
+    os_log_info(sLog, "Connection thread started");
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopRequested_) {
+        lock.unlock();
+
+        bool connected = current_.load(std::memory_order_acquire) != nullptr;
+        if (connected && !sessionAlive()) {
+            swap(nullptr);
+            connected = false;
+        }
+        if (!connected) {
+            connected = tryConnect();
+        }
+        if (connected && watcher_) {
+            // This thread is the only one that swaps sessions out.
+            watcher_(*current_.load(std::memory_order_acquire)->client->sharedMemory());
+        }
+
+        lock.lock();
+        wake_.wait_for(lock, connected ? kPollInterval : kRetryInterval,
+                       [this] { return stopRequested_; });
+    }
+
+    os_log_info(sLog, "Connection thread stopped");
+}
+
+bool ConnectionManager::tryConnect()
+{
+    auto client = factory_();
+    if (!client || !client->connect()) return false;
+
+    // The helper only answers once its engine is up, so an offline region
+    // belongs to a helper on its way out. Try again later.
+    auto* shm = client->sharedMemory();
+    if (shm->helperStatus.load(std::memory_order_acquire) == kHelperOffline) {
+        return false;
+    }
+
+    auto* session = new Session;
+    session->client = std::move(client);
+    session->generation = ++generation_;
+
+    lastHeartbeat_ = shm->heartbeat.load(std::memory_order_relaxed);
+    lastHeartbeatChange_ = std::chrono::steady_clock::now();
+
+    os_log_info(sLog, "Attached to helper session %llu (generation %llu)",
+                shm->sessionId, session->generation);
+    swap(session);
+    return true;
+}
+
+bool ConnectionManager::sessionAlive()
+{
+    const Session* session = current_.load(std::memory_order_acquire);
+    auto* shm = session->client->sharedMemory();
+
+    // A clean shutdown marks the region offline before the helper exits.
+    if (shm->helperStatus.load(std::memory_order_acquire) == kHelperOffline) {
+        os_log_info(sLog, "Helper session %llu went offline", shm->sessionId);
+        return false;
+    }
+
+    // A crashed one just stops beating.
+    auto now = std::chrono::steady_clock::now();
+    uint64_t heartbeat = shm->heartbeat.load(std::memory_order_relaxed);
+    if (heartbeat != lastHeartbeat_) {
+        lastHeartbeat_ = heartbeat;
+        lastHeartbeatChange_ = now;
+        return true;
+    }
+
+    auto silentFor = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now - lastHeartbeatChange_);
+    if (silentFor.count() < kHelperHeartbeatTimeoutMs) return true;
+
+    os_log_info(sLog, "Helper session %llu stopped responding (no heartbeat for %lld ms)",
+                shm->sessionId, static_cast<long long>(silentFor.count()));
+    return false;
+}
+
+void ConnectionManager::waitForLeases() const
+{
+    while (leases_.load(std::memory_order_seq_cst) != 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+void ConnectionManager::swap(Session* next)
+{
+    Session* previous = current_.exchange(next, std::memory_order_seq_cst);
+    if (!previous) return;
+
+    // Wait out any IO callback that may still hold the old session.
+    waitForLeases();
+
+    os_log_info(sLog, "Detached from helper session (generation %llu)",
+                previous->generation);
+    delete previous;   // Unmaps the region
+}
+
+} // namespace flux
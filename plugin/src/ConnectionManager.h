@@ -0,0 +1,136 @@
+#pragma once
+
+// ConnectionManager: keeps the plugin attached to the helper without ever
+// blocking coreaudiod.
+//
+// A background thread owns all transport work: connecting (the Mach
+// handshake can take seconds when the helper is down), watching the helper's
+// status and heartbeat, and — when the helper goes away and comes back —
+// mapping the new region and swapping it in. The HAL threads only ever take
+// a Lease: one atomic increment, one pointer load. No lease, no helper →
+// callers serve silence.
+//
+// Swap protocol: the thread publishes the new session pointer, then waits
+// for the lease count to drop to zero before unmapping the old one. A lease
+// increments the count before loading the pointer, so any reader that could
+// have seen the old session is counted. Leases are held for one IO callback,
+// so the wait is at most one buffer.
+
+#include "Transport.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace flux {
+
+class ConnectionManager {
+public:
+    using ClientFactory = std::function<std::unique_ptr<TransportClient>()>;
+
+    // Called on the connection thread after every poll that finds the
+    // helper attached — for work that follows what the helper publishes.
+    using Watcher = std::function<void(SharedMemoryLayout& shm)>;
+
+    explicit ConnectionManager(ClientFactory factory);
+    ~ConnectionManager();
+
+    ConnectionManager(const ConnectionManager&) = delete;
+    ConnectionManager& operator=(const ConnectionManager&) = delete;
+
+    // Set before start().
+    void setWatcher(Watcher watcher) { watcher_ = std::move(watcher); }
+
+    // Start the background thread. Idempotent; returns immediately.
+    void start();
+
+    // Stop the thread and drop the current session.
+    void stop();
+
+    // One mapped helper region. Immutable once published.
+    struct Session {
+        std::unique_ptr<TransportClient> client;
+        uint64_t generation = 0;    // Bumped on every swap, starts at 1
+    };
+
+    // Realtime-safe access to the current session. Hold for the duration of
+    // one IO callback, never longer.
+    class Lease {
+    public:
+        explicit Lease(ConnectionManager& manager)
+            : manager_(manager)
+        {
+            manager_.leases_.fetch_add(1, std::memory_order_seq_cst);
+            session_ = manager_.current_.load(std::memory_order_seq_cst);
+        }
+
+        ~Lease() { manager_.leases_.fetch_sub(1, std::memory_order_release); }
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        // nullptr while disconnected.
+        const Session* session() const { return session_; }
+
+        SharedMemoryLayout* sharedMemory() const
+        {
+            return session_ ? session_->client->sharedMemory() : nullptr;
+        }
+
+        // By index into the session's stream table; nullptr past its end.
+        AudioRing* ring(uint32_t stream) const
+        {
+            return session_ ? session_->client->ring(stream) : nullptr;
+        }
+
+        StreamMetrics* metrics(uint32_t stream) const
+        {
+            return session_ ? session_->client->metrics(stream) : nullptr;
+        }
+
+        // Attached to a helper that is currently running its engine.
+        bool helperRunning() const
+        {
+            auto* shm = sharedMemory();
+            return shm && shm->helperStatus.load(std::memory_order_acquire) == kHelperRunning;
+        }
+
+    private:
+        ConnectionManager& manager_;
+        const Session*     session_ = nullptr;
+    };
+
+    bool isConnected() const { return current_.load(std::memory_order_acquire) != nullptr; }
+
+    // Wait until every lease held at the time of the call has been
+    // released, for state the IO callbacks reach under a lease other than
+    // the session itself. Never on the IO thread.
+    void waitForLeases() const;
+
+private:
+    void run();
+    bool tryConnect();
+    bool sessionAlive();
+    void swap(Session* next);
+
+    ClientFactory factory_;
+    Watcher       watcher_;
+
+    std::atomic<Session*> current_{nullptr};
+    std::atomic<uint32_t> leases_{0};
+    uint64_t              generation_ = 0;
+
+    // Liveness tracking for the current session (background thread only).
+    uint64_t lastHeartbeat_ = 0;
+    std::chrono::steady_clock::time_point lastHeartbeatChange_;
+
+    std::thread             thread_;
+    std::mutex              mutex_;
+    std::condition_variable wake_;
+    bool                    stopRequested_ = false;
+};
+
+} // namespace flux
@@ -29,10 +29,8 @@ MachClient::~MachClient()
     disconnect();
 }
 
-bool MachClient::connect()
+bool MachClient::mapRegion(void** outAddr, size_t* outSize)
 {
-    if (sharedMem_) return true;
-
     // Look up the helper's Mach service.
     mach_port_t servicePort = MACH_PORT_NULL;
     kern_return_t kr = bootstrap_look_up(
@@ -121,32 +119,66 @@ bool MachClient::connect()
         memPort,
         0,          // offset
         FALSE,      // copy — FALSE = share the pages
-        VM_PROT_READ | VM_PROT_WRITE,
-        VM_PROT_READ | VM_PROT_WRITE,
+        readOnly() ? VM_PROT_READ : VM_PROT_READ | VM_PROT_WRITE,
+        readOnly() ? VM_PROT_READ : VM_PROT_READ | VM_PROT_WRITE,
         VM_INHERIT_NONE);
 
-    mach_port_deallocate(mach_task_self(), memPort);
-
     if (kr != KERN_SUCCESS) {
         os_log_error(sLog, "mach_vm_map failed: %s", mach_error_string(kr));
+        mach_port_deallocate(mach_task_self(), memPort);
         return false;
     }
 
+    // The port stays ours until unmapRegion(): mirrored rings map from it.
     mappedAddr_ = addr;
     mappedSize_ = memSize;
-    sharedMem_ = reinterpret_cast<SharedMemoryLayout*>(addr);
+    memoryPort_ = memPort;
+    *outAddr = reinterpret_cast<void*>(addr);
+    *outSize = static_cast<size_t>(memSize);
+
+    os_log_info(sLog, "Shared memory mapped: %llu bytes at 0x%llx", memSize, addr);
+    return true;
+}
 
-    os_log_info(sLog, "Shared memory mapped: %llu bytes at %p", memSize, sharedMem_);
+void MachClient::onLayoutRejected(const SharedMemoryLayout& layout, size_t mappedSize)
+{
+    os_log_error(sLog, "Shared memory layout mismatch: magic 0x%08x version %u "
+                 "(expected 0x%08x v%u), %zu bytes mapped",
+                 layout.magic, layout.version, kLayoutMagic, kLayoutVersion, mappedSize);
+}
+
+bool MachClient::mapMirror(void* at, size_t size, uint64_t offset)
+{
+    auto addr = reinterpret_cast<mach_vm_address_t>(at);
+    kern_return_t kr = mach_vm_map(
+        mach_task_self(),
+        &addr,
+        size,
+        0,          // alignment mask
+        VM_FLAGS_FIXED | VM_FLAGS_OVERWRITE,
+        memoryPort_,
+        offset,
+        FALSE,      // copy — FALSE = share the pages
+        readOnly() ? VM_PROT_READ : VM_PROT_READ | VM_PROT_WRITE,
+        readOnly() ? VM_PROT_READ : VM_PROT_READ | VM_PROT_WRITE,
+        VM_INHERIT_NONE);
+    if (kr != KERN_SUCCESS) {
+        os_log_error(sLog, "Mirror mach_vm_map failed: %s", mach_error_string(kr));
+        return false;
+    }
     return true;
 }
 
-void MachClient::disconnect()
+void MachClient::unmapRegion()
 {
     if (mappedAddr_ != 0) {
         mach_vm_deallocate(mach_task_self(), mappedAddr_, mappedSize_);
         mappedAddr_ = 0;
         mappedSize_ = 0;
-        sharedMem_ = nullptr;
+    }
+    if (memoryPort_ != MACH_PORT_NULL) {
+        mach_port_deallocate(mach_task_self(), memoryPort_);
+        memoryPort_ = MACH_PORT_NULL;
     }
 }
 
@@ -1,36 +1,36 @@
 #pragma once
 
-// MachClient: plugin-side IPC. Connects to the helper daemon's Mach bootstrap
-// service and maps the shared memory region into this process (coreaudiod).
+// MachClient: Mach transport, plugin side. Connects to the helper daemon's
+// Mach bootstrap service and maps the shared memory region into this process
+// (coreaudiod).
 //
-// Called once during plugin initialization. After mapping, the plugin accesses
-// SharedMemoryLayout directly — no further Mach messages needed for audio IO.
+// Called once during plugin initialization. After mapping, TransportClient
+// checks the layout's magic/version and resolves the rings through the
+// stream table; the plugin then accesses them directly — no further Mach
+// messages needed for audio IO.
 
-#include "SharedMemory.h"
+#include "Transport.h"
 
 #include <mach/mach.h>
 
 namespace flux {
 
-class MachClient {
+class MachClient : public TransportClient {
 public:
     MachClient() = default;
-    ~MachClient();
+    ~MachClient() override;
 
+private:
     // Look up the helper's Mach service, request the shared memory port,
     // and map it into this process. Returns false if the helper is not running.
-    bool connect();
-
-    // Unmap shared memory.
-    void disconnect();
+    bool mapRegion(void** outAddr, size_t* outSize) override;
+    void unmapRegion() override;
+    bool mapMirror(void* at, size_t size, uint64_t offset) override;
+    void onLayoutRejected(const SharedMemoryLayout& layout, size_t mappedSize) override;
 
-    bool isConnected() const { return sharedMem_ != nullptr; }
-    SharedMemoryLayout* sharedMemory() { return sharedMem_; }
-
-private:
-    SharedMemoryLayout* sharedMem_ = nullptr;
     mach_vm_address_t   mappedAddr_ = 0;
     mach_vm_size_t      mappedSize_ = 0;
+    mach_port_t         memoryPort_ = MACH_PORT_NULL;   // Kept for mapMirror()
 };
 
 } // namespace flux
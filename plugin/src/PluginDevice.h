@@ -1,15 +1,17 @@
 #pragma once
 
 // PluginDevice: aspl::Device subclass that overrides GetZeroTimeStamp to
-// derive the virtual device's clock from the Push hardware clock, read
-// from shared memory published by the helper daemon.
+// derive the virtual device's clock from the master's hardware clock (Push
+// by default), read from shared memory published by the helper daemon.
 //
 // The plugin NEVER touches CoreAudio client API. All hardware interaction
-// is in the helper process. This device just exposes timestamps.
+// is in the helper process. This device just exposes timestamps, and passes
+// a client's change of its sample rate on (setRateListener).
 
-#include "SharedMemory.h"
+#include "ConnectionManager.h"
 
 #include <aspl/Device.hpp>
+#include <functional>
 
 namespace flux {
 
@@ -17,29 +19,38 @@ class PluginDevice : public aspl::Device {
 public:
     PluginDevice(std::shared_ptr<aspl::Context> context,
                  const aspl::DeviceParameters& params,
-                 SharedMemoryLayout* shm)
+                 std::shared_ptr<ConnectionManager> connection)
         : aspl::Device(std::move(context), params)
-        , shm_(shm)
+        , connection_(std::move(connection))
     {
     }
 
-    void setSharedMemory(SharedMemoryLayout* shm) { shm_ = shm; }
+    // Called with the new rate once the HAL has applied a change of the
+    // device's nominal sample rate. Set before the device is published.
+    void setRateListener(std::function<void(Float64)> listener)
+    {
+        rateListener_ = std::move(listener);
+    }
 
 protected:
     // Called by the HAL on the IO thread to get the current clock position.
-    // We just read whatever the helper last wrote from Push's IOProc.
+    // We just read whatever the helper last wrote from the master's IOProc, as one
+    // consistent (sample time, host time, seed) point.
+    // A new helper session starts a new timeline, so the connection
+    // generation goes in the seed's upper half, the helper's seed in the
+    // lower: no (generation, seed) pair reports another's value.
     OSStatus GetZeroTimeStampImpl(UInt32   /*clientID*/,
                                   Float64* outSampleTime,
                                   UInt64*  outHostTime,
                                   UInt64*  outSeed) override
     {
-        if (shm_) {
-            *outSampleTime = shm_->pushClock.sampleTime.load(
-                std::memory_order_relaxed);
-            *outHostTime = shm_->pushClock.hostTime.load(
-                std::memory_order_relaxed);
-            *outSeed = shm_->pushClock.seed.load(
-                std::memory_order_relaxed);
+        ConnectionManager::Lease lease(*connection_);
+        auto* shm = lease.sharedMemory();
+        ClockSnapshot clock;
+        if (shm && shm->masterClock.tryLoad(&clock)) {
+            *outSampleTime = clock.sampleTime;
+            *outHostTime = clock.hostTime;
+            *outSeed = lease.session()->generation << 32 | (clock.seed & 0xffffffff);
         } else {
             *outSampleTime = 0.0;
             *outHostTime = 0;
@@ -48,8 +59,17 @@ protected:
         return kAudioHardwareNoError;
     }
 
+    // Runs inside the HAL's configuration change, with IO stopped.
+    OSStatus SetNominalSampleRateImpl(Float64 rate) override
+    {
+        OSStatus status = aspl::Device::SetNominalSampleRateImpl(rate);
+        if (status == kAudioHardwareNoError && rateListener_) rateListener_(rate);
+        return status;
+    }
+
 private:
-    SharedMemoryLayout* shm_ = nullptr;
+    std::shared_ptr<ConnectionManager> connection_;
+    std::function<void(Float64)>       rateListener_;
 };
 
 } // namespace flux
@@ -1,19 +1,25 @@
 #include <aspl/Driver.hpp>
 #include <aspl/Plugin.hpp>
 
+#include "ConnectionManager.h"
 #include "Constants.h"
 #include "MachClient.h"
 #include "PluginDevice.h"
 #include "PluginHandler.h"
 
+#include <vector>
+
 using namespace flux;
 
 static std::shared_ptr<aspl::Driver> CreateDriver()
 {
     auto context = std::make_shared<aspl::Context>();
 
-    // The MachClient will connect to the helper on first OnStartIO.
-    auto machClient = std::make_shared<MachClient>();
+    // The connection manager attaches to the helper in the background,
+    // starting on first OnStartIO, and re-attaches after helper restarts.
+    auto connection = std::make_shared<ConnectionManager>([] {
+        return std::make_unique<MachClient>();
+    });
 
     // Virtual aggregate device parameters.
     aspl::DeviceParameters params;
@@ -31,52 +37,27 @@ static std::shared_ptr<aspl::Driver> CreateDriver()
     params.CanBeDefault = true;
     params.CanBeDefaultForSystemSounds = false;
 
-    // Device reads clock from shared memory (nullptr until connected).
-    auto device = std::make_shared<PluginDevice>(context, params, nullptr);
-
-    // --- Push streams (master, zero added latency) ---
-    aspl::StreamParameters pushInParams;
-    pushInParams.Direction = aspl::Direction::Input;
-    pushInParams.Format.mChannelsPerFrame = kChannelsPerDevice;
-    pushInParams.Format.mSampleRate = kNominalSampleRate;
-    pushInParams.Latency = 0;
-    auto pushIn = device->AddStreamAsync(pushInParams);
-
-    aspl::StreamParameters pushOutParams;
-    pushOutParams.Direction = aspl::Direction::Output;
-    pushOutParams.Format.mChannelsPerFrame = kChannelsPerDevice;
-    pushOutParams.Format.mSampleRate = kNominalSampleRate;
-    pushOutParams.Latency = 0;
-    auto pushOut = device->AddStreamAsync(pushOutParams);
+    // Device reads clock from shared memory (zero until connected).
+    auto device = std::make_shared<PluginDevice>(context, params, connection);
 
-    // --- FLX4 streams (slave, latency = ring buffer + resampler) ---
-    aspl::StreamParameters flx4InParams;
-    flx4InParams.Direction = aspl::Direction::Input;
-    flx4InParams.Format.mChannelsPerFrame = kChannelsPerDevice;
-    flx4InParams.Format.mSampleRate = kNominalSampleRate;
-    flx4InParams.Latency = kFLX4StreamLatency;
-    auto flx4In = device->AddStreamAsync(flx4InParams);
+    // Clients pick the rate; the helper follows it.
+    std::vector<AudioValueRange> rates;
+    for (double rate : kSupportedSampleRates) rates.push_back({rate, rate});
+    device->SetAvailableSampleRatesAsync(rates);
 
-    aspl::StreamParameters flx4OutParams;
-    flx4OutParams.Direction = aspl::Direction::Output;
-    flx4OutParams.Format.mChannelsPerFrame = kChannelsPerDevice;
-    flx4OutParams.Format.mSampleRate = kNominalSampleRate;
-    flx4OutParams.Latency = kFLX4StreamLatency;
-    auto flx4Out = device->AddStreamAsync(flx4OutParams);
-
-    // --- FLX4 cue stream (tapped from djay's cue output via ProcessTap) ---
-    aspl::StreamParameters flx4CueInParams;
-    flx4CueInParams.Direction = aspl::Direction::Input;
-    flx4CueInParams.Format.mChannelsPerFrame = kChannelsPerDevice;
-    flx4CueInParams.Format.mSampleRate = kNominalSampleRate;
-    flx4CueInParams.Latency = kFLX4StreamLatency;
-    auto flx4CueIn = device->AddStreamAsync(flx4CueInParams);
-
-    // Wire handler — connects shared memory to streams.
-    auto handler = std::make_shared<PluginHandler>(
-        machClient, pushIn, pushOut, flx4In, flx4Out, flx4CueIn);
+    // Wire handler — creates the default layout's streams and connects
+    // them to shared memory.
+    auto handler = std::make_shared<PluginHandler>(connection, device);
     device->SetControlHandler(handler);
     device->SetIOHandler(handler);
+    device->setRateListener([weak = std::weak_ptr<PluginHandler>(handler)](Float64 rate) {
+        if (auto h = weak.lock()) h->setSampleRate(rate);
+    });
+
+    // The stream set and stream latencies follow the helper's.
+    connection->setWatcher([weak = std::weak_ptr<PluginHandler>(handler)](SharedMemoryLayout& shm) {
+        if (auto h = weak.lock()) h->followLayout(shm);
+    });
 
     auto plugin = std::make_shared<aspl::Plugin>(context);
     plugin->AddDevice(device);
@@ -2,47 +2,76 @@
 #include "Constants.h"
 
 #include <os/log.h>
+#include <algorithm>
+#include <cmath>
 #include <cstring>
+#include <utility>
 
 namespace flux {
 
 static os_log_t sLog = os_log_create("com.pushflx4.aggregate.plugin", "Handler");
 
+namespace {
+
+const char* roleName(StreamRole role)
+{
+    switch (role) {
+        case kStreamCapture:  return "in";
+        case kStreamCue:      return "cue";
+        case kStreamPlayback: return "out";
+        default:              return "?";
+    }
+}
+
+// Every input is served at the same alignment latency so they stay
+// sample-aligned with each other; a slave output's is a default until the
+// helper publishes the one its converter tier gives.
+aspl::StreamParameters streamParameters(const StreamDescriptor& desc, Float64 rate)
+{
+    aspl::StreamParameters params;
+    params.Direction = desc.direction == kStreamDirInput ? aspl::Direction::Input
+                                                         : aspl::Direction::Output;
+    params.Format.mChannelsPerFrame = desc.channels;
+    params.Format.mBytesPerFrame = desc.channels * sizeof(float);
+    params.Format.mBytesPerPacket = params.Format.mBytesPerFrame;
+    params.Format.mSampleRate = rate;
+    params.Latency = defaultStreamLatency(desc);
+    return params;
+}
+
+} // namespace
+
 PluginHandler::PluginHandler(
-    std::shared_ptr<MachClient> client,
-    std::shared_ptr<aspl::Stream> pushIn,
-    std::shared_ptr<aspl::Stream> pushOut,
-    std::shared_ptr<aspl::Stream> flx4In,
-    std::shared_ptr<aspl::Stream> flx4Out,
-    std::shared_ptr<aspl::Stream> flx4CueIn)
-    : client_(std::move(client))
-    , pushIn_(std::move(pushIn))
-    , pushOut_(std::move(pushOut))
-    , flx4In_(std::move(flx4In))
-    , flx4Out_(std::move(flx4Out))
-    , flx4CueIn_(std::move(flx4CueIn))
+    std::shared_ptr<ConnectionManager> connection,
+    std::shared_ptr<aspl::Device> device,
+    const LayoutTable& table)
+    : connection_(std::move(connection))
+    , device_(device)
 {
+    publish(bind(*device, table.devices.data(), static_cast<uint32_t>(table.devices.size()),
+                 table.streams.data(), static_cast<uint32_t>(table.streams.size()), nullptr));
 }
 
 PluginHandler::~PluginHandler() = default;
 
 OSStatus PluginHandler::OnStartIO()
 {
-    if (!client_->isConnected()) {
-        os_log_info(sLog, "OnStartIO: connecting to helper daemon");
-        if (!client_->connect()) {
-            os_log_error(sLog, "OnStartIO: helper not available");
-            return kAudioHardwareNotRunningError;
-        }
-    }
+    // Never block coreaudiod on the helper: the connection thread attaches
+    // (and re-attaches) in the background, IO serves silence until then.
+    connection_->start();
 
-    auto* shm = client_->sharedMemory();
-    if (!shm || shm->helperStatus.load(std::memory_order_acquire) != kHelperRunning) {
-        os_log_error(sLog, "OnStartIO: helper not running");
-        return kAudioHardwareNotRunningError;
+    // IO isn't running yet: every client's concealers start from silence.
+    for (auto& inputs : clients_) {
+        for (auto& stream : inputs.stream) stream.store(nullptr, std::memory_order_relaxed);
     }
 
-    os_log_info(sLog, "OnStartIO: connected, helper running");
+    ConnectionManager::Lease lease(*connection_);
+    if (!lease.helperRunning()) {
+        os_log_info(sLog, "OnStartIO: helper not attached yet, serving silence");
+    } else {
+        os_log_info(sLog, "OnStartIO: connected, helper running (generation %llu)",
+                    lease.session()->generation);
+    }
     return kAudioHardwareNoError;
 }
 
@@ -51,62 +80,299 @@ void PluginHandler::OnStopIO()
     os_log_info(sLog, "OnStopIO");
 }
 
+void PluginHandler::OnRemoveClient(const std::shared_ptr<aspl::Client>& client)
+{
+    // The client's IO is over; its cursors no longer hold any ring back.
+    UInt32 id = client->GetClientID();
+    for (auto& inputs : clients_) {
+        if (inputs.client.load(std::memory_order_acquire) != id) continue;
+        for (auto& stream : inputs.stream) stream.store(nullptr, std::memory_order_relaxed);
+        inputs.client.store(0, std::memory_order_release);
+    }
+}
+
+// ---- Stream set ----
+// The device carries one stream per entry of the helper's stream table. A
+// helper started with a different device config brings a different table;
+// the streams it shares with the current set keep their aspl::Stream, so
+// clients only see the streams that actually came or went. aspl queues the
+// changes and notifies clients.
+
+std::unique_ptr<PluginHandler::Bindings> PluginHandler::bind(
+    aspl::Device& device,
+    const DeviceDescriptor* devices, uint32_t deviceCount,
+    const StreamDescriptor* streams, uint32_t streamCount,
+    const Bindings* current)
+{
+    auto next = std::make_unique<Bindings>();
+    for (uint32_t i = 0; i < streamCount && i < kMaxStreams; ++i) {
+        const StreamDescriptor& desc = streams[i];
+        if (desc.device >= deviceCount) continue;
+        const char* name = devices[desc.device].name;
+
+        Binding& b = next->entries[next->count++];
+        std::strncpy(b.device, name, kDeviceNameLength - 1);
+        b.role = static_cast<StreamRole>(desc.role);
+        b.channels = desc.channels;
+
+        // A stream whose width changed is a new stream to clients.
+        for (uint32_t j = 0; current && j < current->count; ++j) {
+            const Binding& old = current->entries[j];
+            if (old.role == b.role && old.channels == b.channels
+                && std::strncmp(old.device, b.device, kDeviceNameLength) == 0)
+            {
+                b.stream = old.stream;
+                break;
+            }
+        }
+        if (!b.stream) {
+            b.stream = device.AddStreamAsync(
+                streamParameters(desc, rate_.load(std::memory_order_relaxed)));
+            os_log_info(sLog, "Stream %{public}s-%{public}s added (%u channels)",
+                        b.device, roleName(b.role), b.channels);
+        }
+    }
+    return next;
+}
+
+void PluginHandler::publish(std::unique_ptr<Bindings> next)
+{
+    bindings_.store(next.get(), std::memory_order_seq_cst);
+    connection_->waitForLeases();
+    owned_ = std::move(next);
+}
+
+void PluginHandler::followLayout(SharedMemoryLayout& shm)
+{
+    auto device = device_.lock();
+    if (!device) return;
+    std::lock_guard<std::mutex> lock(configMutex_);
+    Bindings* current = bindings_.load(std::memory_order_acquire);
+
+    bool same = current->count == shm.streamCount;
+    for (uint32_t i = 0; same && i < current->count; ++i) {
+        const Binding& b = current->entries[i];
+        const StreamDescriptor& desc = shm.streams[i];
+        same = desc.role == b.role && desc.channels == b.channels && desc.device < shm.deviceCount
+            && std::strncmp(shm.devices[desc.device].name, b.device, kDeviceNameLength) == 0;
+    }
+
+    if (!same) {
+        auto next = bind(*device, shm.devices, shm.deviceCount, shm.streams, shm.streamCount,
+                         current);
+        for (uint32_t i = 0; i < current->count; ++i) {
+            const Binding& old = current->entries[i];
+            bool kept = false;
+            for (uint32_t j = 0; j < next->count && !kept; ++j) {
+                kept = next->entries[j].stream == old.stream;
+            }
+            if (kept) continue;
+            device->RemoveStreamAsync(old.stream);
+            os_log_info(sLog, "Stream %{public}s-%{public}s removed", old.device, roleName(old.role));
+        }
+        publish(std::move(next));
+        current = bindings_.load(std::memory_order_acquire);
+    }
+
+    // The helper follows the rate clients set the device to — a helper
+    // that restarted too.
+    shm.requestedRate.store(rate_.load(std::memory_order_relaxed), std::memory_order_release);
+
+    // Stream latency: a tier switch in the helper shows up as a latency
+    // change Ableton recompensates for. The stream set now matches the
+    // helper's table entry for entry.
+    for (uint32_t i = 0; i < current->count; ++i) {
+        const Binding& b = current->entries[i];
+        UInt32 latency = shm.latency[i].load(std::memory_order_relaxed);
+        if (latency == b.stream->GetLatency()) continue;
+
+        os_log_info(sLog, "Stream %{public}s-%{public}s latency %u → %u frames",
+                    b.device, roleName(b.role), b.stream->GetLatency(), latency);
+        b.stream->SetLatencyAsync(latency);
+    }
+}
+
+void PluginHandler::setSampleRate(Float64 rate)
+{
+    auto hz = static_cast<uint32_t>(rate);
+    std::lock_guard<std::mutex> lock(configMutex_);
+    if (hz == rate_.exchange(hz, std::memory_order_relaxed)) return;
+
+    Bindings* current = bindings_.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < current->count; ++i) {
+        AudioStreamBasicDescription format = current->entries[i].stream->GetPhysicalFormat();
+        format.mSampleRate = rate;
+        current->entries[i].stream->SetPhysicalFormatAsync(format);
+    }
+    os_log_info(sLog, "Sample rate %u Hz requested", hz);
+}
+
 // ---- Realtime IO ----
 // These run on the HAL IO thread. No allocations, no locks, no syscalls.
 // Just memcpy between shared memory ring buffers and Ableton's buffers.
+// Each callback holds a ConnectionManager lease for its duration, so neither
+// the mapping nor the bindings can be freed from under it; no helper →
+// silence.
+// Short reads are partial, not all-or-nothing: whatever the ring has is
+// served and the concealer fades across the gap.
+//
+// Input streams are read by timestamp: every stream serves the frames the
+// helper tagged with master sample time (timestamp - kInputAlignmentLatency),
+// so every device's input and cue come out sample-aligned at a fixed latency.
+//
+// Inputs are broadcast: any number of clients read the same ring, each at
+// its own timestamp, each through its own concealer. Nothing is consumed by
+// a read; a client releases the ring up to where the client furthest back
+// on the stream has read to, so every one's next frames stay put. The first
+// client in slot order reports the stream's read metrics.
+//
+// A stream finds its ring by (device name, role) in the session's tables
+// once per session, then by the cached index. While the helper's session
+// runs at another rate than the device — a rate change on its way — its
+// rings and clock are in the wrong samples: inputs fade out and outputs are
+// dropped until it has caught up.
+
+PluginHandler::Binding* PluginHandler::find(const aspl::Stream* stream, uint32_t* entry) const
+{
+    Bindings* bindings = bindings_.load(std::memory_order_seq_cst);
+    for (uint32_t i = 0; i < bindings->count; ++i) {
+        if (bindings->entries[i].stream.get() != stream) continue;
+        if (entry) *entry = i;
+        return &bindings->entries[i];
+    }
+    return nullptr;
+}
+
+PluginHandler::ClientInputs* PluginHandler::clientInputs(UInt32 client)
+{
+    for (auto& inputs : clients_) {
+        if (inputs.client.load(std::memory_order_acquire) == client) return &inputs;
+    }
+    for (auto& inputs : clients_) {
+        UInt32 free = 0;
+        if (inputs.client.compare_exchange_strong(free, client, std::memory_order_acq_rel)) {
+            return &inputs;
+        }
+    }
+    return nullptr;
+}
+
+bool PluginHandler::rateMatches(const ConnectionManager::Lease& lease) const
+{
+    return lease.sharedMemory()->sessionRate.load(std::memory_order_acquire)
+           == rate_.load(std::memory_order_relaxed);
+}
+
+int PluginHandler::resolve(Binding& binding, const ConnectionManager::Lease& lease)
+{
+    uint64_t generation = lease.session()->generation;
+    uint64_t packed = binding.resolved.load(std::memory_order_relaxed);
+    if ((packed >> 8) != generation) {
+        const SharedMemoryLayout* shm = lease.sharedMemory();
+        int device = shm->findDevice(binding.device);
+        int index = device < 0 ? -1 : shm->findStream(static_cast<uint32_t>(device), binding.role);
+        // Not until the stream set has followed a change of width.
+        if (index >= 0 && shm->streams[index].channels != binding.channels) index = -1;
+        packed = generation << 8 | (index < 0 ? kUnresolved : static_cast<uint64_t>(index));
+        binding.resolved.store(packed, std::memory_order_relaxed);
+    }
+    uint64_t index = packed & 0xff;
+    return index == kUnresolved ? -1 : static_cast<int>(index);
+}
 
 void PluginHandler::OnReadClientInput(
-    const std::shared_ptr<aspl::Client>& /*client*/,
+    const std::shared_ptr<aspl::Client>& client,
     const std::shared_ptr<aspl::Stream>& stream,
     Float64 /*zeroTimestamp*/,
-    Float64 /*timestamp*/,
+    Float64 timestamp,
     void*   buff,
     UInt32  buffBytesSize)
 {
-    auto* shm = client_->sharedMemory();
-    if (!shm) {
+    ConnectionManager::Lease lease(*connection_);
+    uint32_t entry = 0;
+    Binding* binding = find(stream.get(), &entry);
+    if (!binding) {
         std::memset(buff, 0, buffBytesSize);
         return;
     }
 
-    if (stream == pushIn_) {
-        if (!shm->pushInput.read(buff, buffBytesSize)) {
-            std::memset(buff, 0, buffBytesSize);
+    auto* dst = static_cast<float*>(buff);
+    uint32_t frames = buffBytesSize / (binding->channels * sizeof(float));
+    int64_t sampleTime = std::llround(timestamp) - kInputAlignmentLatency;
+
+    // The client's own concealer, from silence for a stream new to it.
+    ClientInputs* inputs = client ? clientInputs(client->GetClientID()) : nullptr;
+    StreamConcealer* conceal = nullptr;
+    if (inputs) {
+        if (inputs->stream[entry].load(std::memory_order_relaxed) != stream.get()) {
+            inputs->conceal[entry].setChannels(binding->channels);
+            inputs->cursor[entry].store(sampleTime, std::memory_order_relaxed);
+            inputs->stream[entry].store(stream.get(), std::memory_order_release);
         }
+        conceal = &inputs->conceal[entry];
     }
-    else if (stream == flx4In_) {
-        // Already resampled to Push clock by the helper.
-        if (!shm->flx4Input.read(buff, buffBytesSize)) {
+
+    // No helper, a helper without this stream or one still on another
+    // rate: fade out whatever was last played rather than cutting.
+    int index = lease.helperRunning() && rateMatches(lease) ? resolve(*binding, lease) : -1;
+    AudioRing* ring = index >= 0 ? lease.ring(static_cast<uint32_t>(index)) : nullptr;
+    if (!ring) {
+        if (conceal) {
+            conceal->apply(dst, frames, 0, 0);
+        } else {
             std::memset(buff, 0, buffBytesSize);
         }
+        return;
     }
-    else if (stream == flx4CueIn_) {
-        // Cue audio tapped from djay's FLX4 output, resampled by helper.
-        if (!shm->flx4CueInput.read(buff, buffBytesSize)) {
-            std::memset(buff, 0, buffBytesSize);
+
+    uint32_t fill = ring->availableRead();
+    uint32_t lead = 0;
+    uint32_t served = ring->peekAt(dst, frames, sampleTime, &lead);
+    if (conceal) conceal->apply(dst, frames, lead, served);
+    if (!inputs) return;
+
+    // Keep what the other clients reading this stream still need. One
+    // that has fallen half a ring behind has stopped reading it.
+    int64_t end = sampleTime + frames;
+    inputs->cursor[entry].store(end, std::memory_order_release);
+    int64_t oldest = end;
+    bool reports = true;
+    for (auto& other : clients_) {
+        if (&other == inputs || other.client.load(std::memory_order_relaxed) == 0
+            || other.stream[entry].load(std::memory_order_acquire) != stream.get())
+        {
+            continue;
         }
+        int64_t cursor = other.cursor[entry].load(std::memory_order_acquire);
+        if (end - cursor > ring->capacity / 2) continue;
+        oldest = std::min(oldest, cursor);
+        if (&other < inputs) reports = false;
     }
-    else {
-        std::memset(buff, 0, buffBytesSize);
-    }
+    ring->release(oldest);
+    if (reports) lease.metrics(static_cast<uint32_t>(index))->onRead(fill, frames, served);
 }
 
 void PluginHandler::OnWriteMixedOutput(
     const std::shared_ptr<aspl::Stream>& stream,
     Float64 /*zeroTimestamp*/,
-    Float64 /*timestamp*/,
+    Float64 timestamp,
     const void* buff,
     UInt32 buffBytesSize)
 {
-    auto* shm = client_->sharedMemory();
-    if (!shm) return;
+    ConnectionManager::Lease lease(*connection_);
+    if (!lease.helperRunning() || !rateMatches(lease)) return;
 
-    if (stream == pushOut_) {
-        shm->pushOutput.write(buff, buffBytesSize);
-    }
-    else if (stream == flx4Out_) {
-        // Helper will resample from Push clock to FLX4 clock.
-        shm->flx4Output.write(buff, buffBytesSize);
+    Binding* binding = find(stream.get());
+    int index = binding ? resolve(*binding, lease) : -1;
+    if (index < 0) return;
+
+    if (AudioRing* ring = lease.ring(static_cast<uint32_t>(index))) {
+        // Stamp with the HAL output time; the helper servos a slave output's
+        // latency against it (EngineCore::slaveIO).
+        ring->alignTo(std::llround(timestamp), 0);
+        uint32_t lost = ring->produce(static_cast<const float*>(buff),
+                                      buffBytesSize / (binding->channels * sizeof(float)));
+        lease.metrics(static_cast<uint32_t>(index))->onWrite(lost);
     }
 }
 
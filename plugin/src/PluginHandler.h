@@ -7,31 +7,61 @@
 // to shared memory for the helper to send to hardware.
 //
 // No resampling, no DLL, no hardware access. All that is in the helper.
+//
+// The device's streams come from the helper's layout: one per entry of its
+// stream table, each bound to a (device name, role) pair. The handler
+// creates the default layout's streams up front, so the device has them
+// before the helper is up, and follows the helper's device table from the
+// connection thread once attached — adding and removing streams as the
+// helper's configuration has them.
+//
+// The device's sample rate is the clients' to pick (kSupportedSampleRates).
+// The handler asks the helper for it through the region header and serves
+// silence until the helper's session runs at it.
+//
+// Every client reads the inputs on its own IO thread, at its own timestamp.
+// The input rings are written once and read by all of them: a client copies
+// its frames without consuming (FrameRing::peekAt), through a concealer of
+// its own, and the ring is only released up to the oldest frame a client
+// still reads.
 
-#include "MachClient.h"
+#include "Conceal.h"
+#include "ConnectionManager.h"
 #include "SharedMemory.h"
 
 #include <aspl/ControlRequestHandler.hpp>
+#include <aspl/Device.hpp>
 #include <aspl/IORequestHandler.hpp>
 #include <aspl/Stream.hpp>
+#include <atomic>
 #include <memory>
+#include <mutex>
 
 namespace flux {
 
 class PluginHandler : public aspl::ControlRequestHandler,
                       public aspl::IORequestHandler {
 public:
+    // Creates table's streams on device.
     PluginHandler(
-        std::shared_ptr<MachClient> client,
-        std::shared_ptr<aspl::Stream> pushIn,
-        std::shared_ptr<aspl::Stream> pushOut,
-        std::shared_ptr<aspl::Stream> flx4In,
-        std::shared_ptr<aspl::Stream> flx4Out,
-        std::shared_ptr<aspl::Stream> flx4CueIn);
+        std::shared_ptr<ConnectionManager> connection,
+        std::shared_ptr<aspl::Device> device,
+        const LayoutTable& table = defaultLayoutTable());
 
     ~PluginHandler() override;
 
+    // Bring the device's streams in line with the helper's layout, and
+    // report the stream latencies it publishes — a slave output's follows
+    // its converter tier. Connection thread (ConnectionManager watcher).
+    void followLayout(SharedMemoryLayout& shm);
+
+    // The device's nominal sample rate changed: carry it to the streams'
+    // formats and, from the next followLayout(), to the helper. Called
+    // inside the HAL's configuration change (PluginDevice).
+    void setSampleRate(Float64 rate);
+
     // -- ControlRequestHandler --
+    void     OnRemoveClient(const std::shared_ptr<aspl::Client>& client) override;
     OSStatus OnStartIO() override;
     void     OnStopIO() override;
 
@@ -52,12 +82,88 @@ public:
         UInt32 buffBytesSize) override;
 
 private:
-    std::shared_ptr<MachClient>    client_;
-    std::shared_ptr<aspl::Stream>  pushIn_;
-    std::shared_ptr<aspl::Stream>  pushOut_;
-    std::shared_ptr<aspl::Stream>  flx4In_;
-    std::shared_ptr<aspl::Stream>  flx4Out_;
-    std::shared_ptr<aspl::Stream>  flx4CueIn_;
+    // One device stream and the helper stream it carries.
+    struct Binding {
+        std::shared_ptr<aspl::Stream> stream;
+        char       device[kDeviceNameLength] = {};
+        StreamRole role = kStreamCapture;
+        uint32_t   channels = kChannelsPerDevice;    // Interleaved, as the layout has them
+
+        // The stream's index in the layout of one session, resolved by
+        // the IO thread on first use: generation << 8 | index, index
+        // kUnresolved if that layout doesn't carry the stream.
+        std::atomic<uint64_t> resolved{0};
+    };
+
+    // The device's streams. Immutable once published, except for the
+    // bindings' IO-thread state; replaced whole when the layout changes.
+    struct Bindings {
+        Binding  entries[kMaxStreams];
+        uint32_t count = 0;
+    };
+
+    static constexpr uint64_t kUnresolved = 0xff;
+
+    // Clients reading inputs at once with state of their own. More share
+    // the streams' frames all the same, without concealment.
+    static constexpr uint32_t kMaxClients = 8;
+
+    // One client's read cursors and concealers, per entry of the current
+    // bindings. A slot is claimed by the client's IO thread on its first
+    // read and only touched by it until OnRemoveClient frees it; other
+    // clients only look at its cursors.
+    struct ClientInputs {
+        std::atomic<UInt32> client{0};     // aspl client ID, 0 if free
+
+        // Where the client's latest read of each stream ended (master
+        // sample time), while the entry still carries the stream the
+        // cursor was read from.
+        std::atomic<int64_t>       cursor[kMaxStreams] = {};
+        std::atomic<const aspl::Stream*> stream[kMaxStreams] = {};
+        StreamConcealer            conceal[kMaxStreams];
+    };
+
+    // The client's slot, claiming a free one; nullptr if all are taken.
+    ClientInputs* clientInputs(UInt32 client);
+
+    // The binding for a device stream, nullptr if none; *entry its index
+    // in the current bindings. IO thread, under a lease.
+    Binding* find(const aspl::Stream* stream, uint32_t* entry = nullptr) const;
+
+    // The binding's stream index in the lease's session, -1 if none.
+    static int resolve(Binding& binding, const ConnectionManager::Lease& lease);
+
+    // Bindings for a device and stream table, reusing current's streams
+    // where the (device name, role) matches and creating the rest.
+    std::unique_ptr<Bindings> bind(aspl::Device& device,
+                                   const DeviceDescriptor* devices, uint32_t deviceCount,
+                                   const StreamDescriptor* streams, uint32_t streamCount,
+                                   const Bindings* current);
+
+    // Publish a new set of bindings and free the old one once no IO
+    // callback can still be looking at it: every bindings access on the IO
+    // thread is under a lease, so the connection's lease drain covers it.
+    // Not on the IO thread.
+    void publish(std::unique_ptr<Bindings> next);
+
+    // The helper's session runs at the device's rate. IO thread.
+    bool rateMatches(const ConnectionManager::Lease& lease) const;
+
+    std::shared_ptr<ConnectionManager> connection_;
+    std::weak_ptr<aspl::Device>        device_;
+
+    // The device's nominal sample rate (Hz), as the streams' formats have it.
+    std::atomic<uint32_t> rate_{static_cast<uint32_t>(kNominalSampleRate)};
+
+    // Serializes the connection thread's stream set changes with the HAL's
+    // rate changes, so a stream is created at the rate the set gets carried
+    // to. Never taken on the IO thread.
+    std::mutex configMutex_;
+
+    std::atomic<Bindings*>    bindings_{nullptr};
+    std::unique_ptr<Bindings> owned_;   // The set bindings_ points at
+
+    ClientInputs clients_[kMaxClients];
 };
 
 } // namespace flux
@@ -0,0 +1,91 @@
+#pragma once
+
+// Clock rate estimation interface.
+//
+// Each hardware device's IOProc feeds its estimator one observation per
+// callback — the buffer's host timestamp and its length in frames — and
+// reads back the device's true sample rate in host-clock terms. The ratio
+// of two estimates drives the resampler (AudioEngine) and the published
+// Push clock (GetZeroTimeStamp).
+//
+// Implementations (ClockEstimators.h):
+//   dll       fixed-bandwidth second-order DLL (DriftTracker)
+//   adaptive  two-stage DLL: wide bandwidth to acquire, narrow to track
+//   kalman    two-state Kalman filter with innovation gating
+//   lsq       least-squares line through a window of (frames, time) pairs
+// flux_bench_clock compares them on synthetic clocks.
+//
+// Timestamps go through a TimeSource, so every estimator runs off macOS.
+// update() must be realtime-safe: no allocation, no locks, bounded work.
+// Not thread-safe — one estimator per IOProc.
+
+#include "TimeSource.h"
+
+#include <cstdint>
+
+namespace flux {
+
+enum ClockEstimatorKind : uint32_t {
+    kClockEstimatorDLL      = 0,
+    kClockEstimatorAdaptive = 1,
+    kClockEstimatorKalman   = 2,
+    kClockEstimatorLSQ      = 3,
+    kClockEstimatorKindCount
+};
+
+class ClockEstimator {
+public:
+    ClockEstimator(double nominalRate, const TimeSource& time)
+        : nominalRate_(nominalRate)
+        , time_(&time)
+    {
+    }
+    virtual ~ClockEstimator() = default;
+
+    // One callback: host time of the buffer and its length. The next
+    // callback is expected bufferFrames later.
+    virtual void update(uint64_t hostTime, uint32_t bufferFrames) = 0;
+
+    // Forget everything (device restarted, timeline broke), seed included.
+    virtual void reset() = 0;
+
+    // Warm start: begin from a rate measured in an earlier session instead
+    // of nominal. The estimate counts as stable from the first callback
+    // and keeps refining. Only the Kalman filter also settles sooner for
+    // it (and drops a seed its timestamps disagree with); the others just
+    // skip the unresampled start. Call after construction or reset().
+    virtual void seed(double rate) = 0;
+
+    // Estimated sample rate (frames per host second). nominalRate() until
+    // the first estimate exists.
+    virtual double rate() const = 0;
+
+    // The estimate is good enough to resample with.
+    virtual bool isStable() const = 0;
+
+    virtual ClockEstimatorKind kind() const = 0;
+
+    double nominalRate() const { return nominalRate_; }
+
+protected:
+    double seconds(uint64_t hostTime, uint64_t origin) const
+    {
+        return time_->deltaSeconds(hostTime, origin);
+    }
+
+    double            nominalRate_;
+    const TimeSource* time_;
+};
+
+inline const char* clockEstimatorName(ClockEstimatorKind kind)
+{
+    switch (kind) {
+        case kClockEstimatorDLL:      return "dll";
+        case kClockEstimatorAdaptive: return "adaptive";
+        case kClockEstimatorKalman:   return "kalman";
+        case kClockEstimatorLSQ:      return "lsq";
+        default:                      return "?";
+    }
+}
+
+} // namespace flux
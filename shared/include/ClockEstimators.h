@@ -0,0 +1,46 @@
+#pragma once
+
+// All clock estimators, and construction by kind (see ClockEstimator.h).
+
+#include "ClockEstimator.h"
+#include "DriftTracker.h"
+#include "KalmanClock.h"
+#include "RegressionClock.h"
+
+#include <cstring>
+#include <memory>
+
+namespace flux {
+
+// Allocates — call off the realtime threads.
+inline std::unique_ptr<ClockEstimator> makeClockEstimator(
+    ClockEstimatorKind kind, double nominalRate,
+    const TimeSource& time = hostTimeSource())
+{
+    switch (kind) {
+        case kClockEstimatorAdaptive:
+            return std::make_unique<AdaptiveDriftTracker>(nominalRate, time);
+        case kClockEstimatorKalman:
+            return std::make_unique<KalmanClock>(nominalRate, time);
+        case kClockEstimatorLSQ:
+            return std::make_unique<RegressionClock>(nominalRate, time);
+        case kClockEstimatorDLL:
+        default:
+            return std::make_unique<DriftTracker>(nominalRate, 1.0, time);
+    }
+}
+
+// Name (as printed by clockEstimatorName) → kind. False if unknown.
+inline bool parseClockEstimatorKind(const char* name, ClockEstimatorKind* out)
+{
+    for (uint32_t k = 0; k < kClockEstimatorKindCount; ++k) {
+        auto kind = static_cast<ClockEstimatorKind>(k);
+        if (std::strcmp(name, clockEstimatorName(kind)) == 0) {
+            *out = kind;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace flux
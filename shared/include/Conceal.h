@@ -0,0 +1,157 @@
+#pragma once
+
+// Concealer: hides ring underruns from the listener.
+//
+// A consumer that comes up short (FrameRing::readSome / readAt serving
+// fewer frames than asked) would otherwise cut from audio straight to
+// silence and back — a click at each edge, and a whole buffer of nothing
+// for a ring that missed by a few frames. The concealer instead:
+//   - starts a gap by playing the last kConcealFrames of real audio
+//     backwards under a linear fade to silence (backwards, so the first
+//     concealed frame continues from the last real one), and
+//   - fades real audio in over kConcealFrames when it comes back.
+// So a short ring costs ~1 ms of softened audio instead of a dropout.
+//
+// One concealer per consumer stream, owned by the consumer's IO thread.
+// Plain process memory — nothing here is shared. Like FrameRing, the channel
+// count is a template parameter or, with kDynamicChannels, the stream's —
+// up to kMaxStreamChannels, set at construction or with setChannels().
+
+#include "Constants.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace flux {
+
+template <uint32_t Channels, typename Sample>
+class Concealer {
+public:
+    explicit Concealer(uint32_t channels = Channels != kDynamicChannels ? Channels
+                                                                      : kChannelsPerDevice)
+    {
+        setChannels(channels);
+    }
+
+    // Change the frame width (dynamic concealers only); forgets the audio.
+    void setChannels(uint32_t channels)
+    {
+        if (Channels == kDynamicChannels) {
+            channels_ = channels < 1 ? 1 : channels > kMaxStreamChannels ? kMaxStreamChannels
+                                                                        : channels;
+        }
+        reset();
+    }
+
+    uint32_t channels() const { return Channels != kDynamicChannels ? Channels : channels_; }
+
+    // Process one buffer of frames in place after a ring read: frames
+    // [lead, lead + served) are real audio, everything else is a gap.
+    void apply(Sample* buf, uint32_t frames, uint32_t lead, uint32_t served)
+    {
+        const uint32_t ch = channels();
+        if (served == 0) {
+            conceal(buf, frames);
+            return;
+        }
+
+        if (lead > 0) conceal(buf, lead);
+
+        Sample* real = buf + static_cast<size_t>(lead) * ch;
+        fadeIn(real, served);
+        remember(real, served);
+        inGap_ = false;
+        fadeOutPos_ = 0;
+
+        uint32_t end = lead + served;
+        if (end < frames) {
+            conceal(buf + static_cast<size_t>(end) * ch, frames - end);
+        }
+    }
+
+    // Forget the last audio (stream restarted); the next real frames fade in.
+    void reset()
+    {
+        inGap_ = true;
+        historyFrames_ = 0;
+        fadeOutPos_ = 0;
+        fadeInPos_ = 0;
+    }
+
+private:
+    // Fill a gap: continue the fade-out of the remembered audio where the
+    // previous gap left off, silence once it's done.
+    void conceal(Sample* dst, uint32_t frames)
+    {
+        const uint32_t ch = channels();
+        if (!inGap_) {
+            inGap_ = true;
+            fadeInPos_ = 0;
+        }
+
+        uint32_t i = 0;
+        for (; i < frames && fadeOutPos_ < historyFrames_; ++i, ++fadeOutPos_) {
+            const Sample* src = history_
+                + static_cast<size_t>(historyFrames_ - 1 - fadeOutPos_) * ch;
+            Sample gain = static_cast<Sample>(historyFrames_ - fadeOutPos_)
+                        / static_cast<Sample>(historyFrames_ + 1);
+            for (uint32_t c = 0; c < ch; ++c) {
+                dst[i * ch + c] = src[c] * gain;
+            }
+        }
+        if (i < frames) {
+            std::memset(dst + static_cast<size_t>(i) * ch, 0,
+                        static_cast<size_t>(frames - i) * ch * sizeof(Sample));
+        }
+    }
+
+    // Ramp the first frames of audio after a gap up from silence. A ramp
+    // cut short by the end of the buffer continues in the next one.
+    void fadeIn(Sample* dst, uint32_t frames)
+    {
+        const uint32_t ch = channels();
+        for (uint32_t i = 0; i < frames && fadeInPos_ < kConcealFrames; ++i, ++fadeInPos_) {
+            Sample gain = static_cast<Sample>(fadeInPos_ + 1)
+                        / static_cast<Sample>(kConcealFrames + 1);
+            for (uint32_t c = 0; c < ch; ++c) {
+                dst[i * ch + c] *= gain;
+            }
+        }
+    }
+
+    // Keep the last kConcealFrames frames of real audio.
+    void remember(const Sample* src, uint32_t frames)
+    {
+        const uint32_t ch = channels();
+        const size_t frameBytes = ch * sizeof(Sample);
+        if (frames >= kConcealFrames) {
+            std::memcpy(history_, src + static_cast<size_t>(frames - kConcealFrames) * ch,
+                        kConcealFrames * frameBytes);
+            historyFrames_ = kConcealFrames;
+            return;
+        }
+        uint32_t keep = historyFrames_ + frames > kConcealFrames
+                      ? kConcealFrames - frames : historyFrames_;
+        std::memmove(history_, history_ + static_cast<size_t>(historyFrames_ - keep) * ch,
+                     keep * frameBytes);
+        std::memcpy(history_ + static_cast<size_t>(keep) * ch, src, frames * frameBytes);
+        historyFrames_ = keep + frames;
+    }
+
+    static constexpr uint32_t kHistoryChannels =
+        Channels != kDynamicChannels ? Channels : kMaxStreamChannels;
+
+    Sample   history_[kConcealFrames * kHistoryChannels] = {};
+    uint32_t channels_ = Channels;
+    uint32_t historyFrames_ = 0;
+    uint32_t fadeOutPos_ = 0;   // Frames of history already played into the current gap
+    uint32_t fadeInPos_ = 0;    // Frames of fade-in applied since the last gap
+    bool     inGap_ = true;     // Last frame delivered was concealment or silence
+};
+
+using StereoConcealer = Concealer<kChannelsPerDevice, float>;
+
+// For a shared layout stream (AudioRing): its channel count.
+using StreamConcealer = Concealer<kDynamicChannels, float>;
+
+} // namespace flux
@@ -11,31 +11,104 @@ namespace flux {
 // Must match AudioServerPlugIn_MachServices in Info.plist.
 constexpr const char* kMachServiceName = "com.pushflx4.aggregate.helper";
 
-// Ring buffer capacity per stream (bytes).
-// 65536 bytes = ~370ms at 44100Hz stereo float32. Enough runway for DLL
-// convergence (~2-5s) without underruns, while keeping latency low.
-constexpr int32_t kRingBufferCapacity = 65536;
+// Socket path for the POSIX transport (UnixTransport.h), used off macOS.
+constexpr const char* kUnixSocketPath = "/tmp/com.pushflx4.aggregate.helper.sock";
 
-// Number of channels per device (stereo).
+// Channels per stream unless a device is configured with more (stereo).
 constexpr uint32_t kChannelsPerDevice = 2;
 
-// Bytes per frame (stereo float32).
+// Bytes per frame of a stereo float32 stream.
 constexpr uint32_t kBytesPerFrame = kChannelsPerDevice * sizeof(float);
 
+// Most channels one stream carries — all of a device's channels in one
+// ring and one converter, as wide as the converters' SIMD kernels go.
+constexpr uint32_t kMaxStreamChannels = 8;
+
+// FrameRing / Concealer channel count meaning "set at runtime".
+constexpr uint32_t kDynamicChannels = 0;
+
+// Largest hardware buffer (frames) the engine takes in one pass when it
+// has to gather or scatter a device's channels (non-interleaved buffers, or
+// more channels than the stream carries). Bigger buffers go in chunks.
+constexpr uint32_t kMaxIOBufferFrames = 4096;
+
+// Most hardware buffers a device's AudioBufferList is read from — one per
+// channel on a non-interleaved device.
+constexpr uint32_t kMaxIOBuffers = 32;
+
 // Default nominal sample rate (Push 3 runs at 48kHz).
 constexpr double kNominalSampleRate = 48000.0;
 
-// Default device UIDs.
+// Sample rates the virtual device offers. The helper runs shared memory at
+// whichever one it is set to; a device at another rate converts through
+// fixed-ratio stages.
+constexpr double kSupportedSampleRates[] = {44100.0, 48000.0, 88200.0, 96000.0};
+
+constexpr bool isSupportedSampleRate(double rate)
+{
+    for (double supported : kSupportedSampleRates) {
+        if (rate == supported) return true;
+    }
+    return false;
+}
+
+// Default device UIDs: the Push + FLX4 pair the helper aggregates unless
+// configured otherwise.
 constexpr const char* kDefaultPushUID =
     "AppleUSBAudioEngine:Ableton:Ableton Push 3:37589272:2,3";
 constexpr const char* kDefaultFLX4UID =
     "AppleUSBAudioEngine:AlphaTheta Corporation:DDJ-FLX4:DKVC227610NN:2,1";
 
-// FLX4 slave path latency reported to Ableton for delay compensation.
-// Ring buffer target fill (~1024 frames) + resampler group delay (~64 frames).
-constexpr uint32_t kFLX4StreamLatency = 1088;
+// Converter group delay (frames) the fixed latencies below budget for: the
+// medium sinc tiers', rounded up. Slower tiers still fit — on the input side
+// they eat into the ring queue the alignment latency leaves.
+constexpr uint32_t kResamplerGroupDelay = 64;
+
+// Master-domain audio (frames) a slave's output path holds queued in its
+// ring ahead of the converter.
+constexpr uint32_t kSlaveOutputQueueFrames = 1024;
+
+// Slave path latency reported to Ableton for delay compensation, until the
+// helper publishes the one its active converter gives (SharedMemory.h):
+// output queue + budgeted group delay.
+constexpr uint32_t kSlaveStreamLatency = kSlaveOutputQueueFrames + kResamplerGroupDelay;
+
+// Ring capacity per stream (frames, power of two).
+// The master's direct paths only need to cover the input alignment latency
+// plus one HAL buffer, so they stay small and cache-resident (32 KB / 16 KB).
+// Every resampled slave path keeps 8192 frames (~170 ms at 48 kHz, 64 KB)
+// of runway for DLL convergence without underruns.
+constexpr uint32_t kMasterInputRingFrames  = 4096;
+constexpr uint32_t kMasterOutputRingFrames = 2048;
+constexpr uint32_t kSlaveRingFrames        = 8192;
+
+// A mirrored ring's data (SharedMemory.h) is mapped twice, so it has to start
+// on and fill whole pages wherever the region is mapped: 16 KB covers both
+// Apple silicon's pages and 4 KB ones. Every stereo size above qualifies.
+constexpr uint32_t kMirrorAlignment = 16384;
+
+// Input alignment latency (frames). The plugin serves every input stream at
+// (HAL input time - kInputAlignmentLatency), reading the rings by their
+// master sample-time tags, so every device's input and cue lands
+// sample-aligned. Must cover the slowest input path, a resampled slave one.
+constexpr uint32_t kInputAlignmentLatency = kSlaveStreamLatency;
+
+// How far (frames) a resampled stream's host-time-derived stamp may wander
+// from its running frame count before the timeline is re-anchored.
+constexpr int64_t kResampledTimelineTolerance = 64;
+
+// Latency error (frames) beyond which a slave output path stops servoing and
+// resyncs — skipping the excess, or holding silence until the latency has
+// built up — instead of slewing the resampler for seconds to get back.
+constexpr int64_t kLatencyResyncFrames = 512;
+
+// Underrun concealment length (frames, ~1.3 ms at 48 kHz): a gap starts with
+// this much of the last audio played backwards under a fade to silence, and
+// audio coming back after a gap fades in over the same length.
+constexpr uint32_t kConcealFrames = 64;
 
 // Process tap: djay Pro AI bundle ID substring for findProcessByName().
+// The default for a device's cue tap.
 constexpr const char* kDjayBundleSubstring = "algoriddim";
 
 // FLX4 output stream index for cue (0-based). Stream 0 = outputs 1-2 (master),
@@ -44,9 +117,61 @@ constexpr int kFLX4CueStreamIndex = 1;
 
 // Gain compensation for multi-channel tap attenuation bug.
 // FLX4 has 2 stereo output pairs → tap attenuates by -6 dB (factor of 0.5).
-// Compensate by multiplying tapped audio by 2.0 (+6 dB).
+// Compensate by multiplying tapped audio by 2.0 (+6 dB). Other devices set
+// their own (the helper's device config); a single-pair device needs none.
 constexpr float kCueTapGainCompensation = 2.0f;
 
+// Shared memory layout identification. The helper stamps these into the
+// region header; the plugin refuses to use a region whose magic or version
+// it doesn't recognize. Bump kLayoutVersion on any header or ring change.
+constexpr uint32_t kLayoutMagic   = 0x50463441;   // 'PF4A'
+constexpr uint32_t kLayoutVersion = 11;     // 11: mirrored rings
+
+// Helper liveness. The helper bumps the header's heartbeat from its message
+// loop (every ~500 ms); the plugin treats a mapping whose heartbeat hasn't
+// moved for kHelperHeartbeatTimeoutMs as belonging to a dead helper.
+constexpr uint32_t kHelperHeartbeatTimeoutMs = 2000;
+
+// Device and stream table sizes in the region header. Eight devices with
+// a capture, a cue and a playback stream each just fit.
+constexpr uint32_t kMaxDevices = 8;
+constexpr uint32_t kMaxStreams = 24;
+
+// Device names (stream names, logs, --resampler): short, including the NUL.
+constexpr uint32_t kDeviceNameLength = 16;
+
+// The clock master is always device 0 of the device table.
+constexpr uint32_t kMasterDevice = 0;
+
+// What a stream in the shared memory stream table carries, relative to the
+// device it belongs to. A device has at most one stream of each.
+enum StreamRole : uint32_t {
+    kStreamCapture  = 0,        // Device input (resampled on slaves) → plugin
+    kStreamCue      = 1,        // Process tap on the device's output (resampled) → plugin
+    kStreamPlayback = 2,        // Plugin → device output (resampled on slaves)
+    kStreamRoleCount
+};
+
+// Direction relative to the plugin (the client-facing side).
+enum StreamDirection : uint32_t {
+    kStreamDirInput  = 0,       // Helper writes, plugin reads
+    kStreamDirOutput = 1,       // Plugin writes, helper reads
+};
+
+// What a ring does with a block that doesn't fit (see FrameRing::produce).
+enum OverflowPolicy : uint32_t {
+    kOverflowDropNewest = 0,    // Keep what's queued, lose the block's tail
+    kOverflowDropOldest = 1,    // Reclaim the oldest queued frames; readers never see them torn
+    kOverflowOverwrite  = 2,    // Like drop-oldest, but readers don't check — cheapest, may tear
+    kOverflowPolicyCount
+};
+
+// Hardware clock a device, and so its streams, runs on.
+enum ClockDomain : uint32_t {
+    kClockDomainMaster = 0,     // The master clock (Push by default)
+    kClockDomainSlave  = 1,     // Its own clock, resampled to the master
+};
+
 // Mach message IDs for the IPC protocol.
 enum MachMsgID : uint32_t {
     kMsgRequestMemory = 100,    // Plugin → Helper: "give me the shared memory"
@@ -1,91 +1,177 @@
 #pragma once
 
-// Second-order delay-locked loop for USB clock rate estimation.
-// Filters noisy mach_absolute_time timestamps to extract the true sample rate
-// of an independent USB audio device. Feed the output ratio to libsamplerate
+// Second-order delay-locked loops for USB clock rate estimation.
+// Filters noisy host timestamps to extract the true sample rate of an
+// independent USB audio device. Feed the output ratio to libsamplerate
 // for adaptive drift correction.
 //
-// Based on Fons Adriaensen's technique (JACK zita-a2j).
-// Used by the helper daemon only — the plugin never touches this.
+// Based on Fons Adriaensen's technique (JACK zita-a2j): the loop predicts
+// the next callback's host time from the current period estimate, and the
+// prediction error corrects both the phase (gain b) and the period (gain c).
+// Bandwidth trades lock time for jitter rejection, so:
+//   DriftTracker          fixed bandwidth (1 Hz)
+//   AdaptiveDriftTracker  starts wide (8 Hz) to pull in within a few
+//                         hundred ms, then narrows to 0.05 Hz to track
+// Both are ClockEstimators (ClockEstimator.h).
+
+#include "ClockEstimator.h"
 
 #include <cmath>
 #include <cstdint>
-#include <mach/mach_time.h>
 
 namespace flux {
 
-class DriftTracker {
+class DriftTracker : public ClockEstimator {
 public:
-    explicit DriftTracker(double nominalRate = 44100.0, double bandwidth = 1.0)
-        : nominalRate_(nominalRate)
+    explicit DriftTracker(double nominalRate = 44100.0, double bandwidth = 1.0,
+                          const TimeSource& time = hostTimeSource())
+        : ClockEstimator(nominalRate, time)
         , bandwidth_(bandwidth)
-        , rate_(nominalRate)
+        , secondsPerFrame_(1.0 / nominalRate)
     {
     }
 
-    void update(uint64_t hostTime, uint32_t bufferFrames)
+    void update(uint64_t hostTime, uint32_t bufferFrames) override
     {
-        double t = hostTimeToSeconds(hostTime);
+        if (bufferFrames == 0) return;
 
         if (!initialized_) {
-            predictedTime_ = t;
-            rate_ = nominalRate_;
+            origin_ = hostTime;
+            secondsPerFrame_ = 1.0 / (seeded_ ? seedRate_ : nominalRate_);
+            predictedTime_ = bufferFrames * secondsPerFrame_;
             initialized_ = true;
             stableCount_ = 0;
+            elapsed_ = 0.0;
             return;
         }
 
-        double period = static_cast<double>(bufferFrames) / rate_;
-        double omega = 2.0 * M_PI * bandwidth_ * period;
+        double t = seconds(hostTime, origin_);
+        double period = bufferFrames * secondsPerFrame_;
+
+        // Loop gains for this period. Keep omega well below 1 so large
+        // buffers can't make a wide loop unstable.
+        double omega = std::fmin(2.0 * M_PI * bandwidth_ * period, 0.5);
         double b = omega * 1.4142135623731;   // sqrt(2) — critically damped
         double c = omega * omega;
 
         double error = t - predictedTime_;
         predictedTime_ += period + b * error;
-        integral_ += c * error;
-        rate_ = static_cast<double>(bufferFrames) / (period + integral_);
+        secondsPerFrame_ += c * error / bufferFrames;
+        elapsed_ = t;
 
         if (stableCount_ < 200) {
             ++stableCount_;
         }
     }
 
-    void reset()
+    void reset() override
     {
         initialized_ = false;
-        rate_ = nominalRate_;
+        secondsPerFrame_ = 1.0 / nominalRate_;
         predictedTime_ = 0.0;
-        integral_ = 0.0;
         stableCount_ = 0;
+        elapsed_ = 0.0;
+        seeded_ = false;
+    }
+
+    void seed(double rate) override
+    {
+        seedRate_ = rate;
+        seeded_ = true;
+        secondsPerFrame_ = 1.0 / rate;
     }
 
-    double rate() const { return rate_; }
-    double nominalRate() const { return nominalRate_; }
+    double rate() const override { return 1.0 / secondsPerFrame_; }
+
+    // Stable after ~50 callbacks (~1-2 seconds at typical buffer sizes),
+    // or at once when seeded.
+    bool isStable() const override { return initialized_ && (seeded_ || stableCount_ > 50); }
+
+    ClockEstimatorKind kind() const override { return kClockEstimatorDLL; }
+
+    double bandwidth() const { return bandwidth_; }
 
-    // Stable after ~50 callbacks (~1-2 seconds at typical buffer sizes).
-    bool isStable() const { return initialized_ && stableCount_ > 50; }
+protected:
+    void setBandwidth(double bandwidth) { bandwidth_ = bandwidth; }
+
+    // Host seconds since the first callback.
+    double elapsed() const { return elapsed_; }
+    bool initialized() const { return initialized_; }
+    bool seeded() const { return seeded_; }
 
 private:
-    static double hostTimeToSeconds(uint64_t hostTime)
+    double   bandwidth_;
+    double   secondsPerFrame_;
+    double   predictedTime_ = 0.0;   // Seconds since origin_
+    double   elapsed_ = 0.0;
+    double   seedRate_ = 0.0;
+    uint64_t origin_ = 0;
+    bool     initialized_ = false;
+    bool     seeded_ = false;
+    int      stableCount_ = 0;
+};
+
+// Two-stage DLL. Acquire at a wide bandwidth, then narrow exponentially to
+// the tracking bandwidth. A wide loop's rate estimate carries most of the
+// timestamp jitter, so the estimate only counts as usable once the loop has
+// narrowed past kStableBandwidth. A seeded loop skips straight to there.
+class AdaptiveDriftTracker : public DriftTracker {
+public:
+    explicit AdaptiveDriftTracker(double nominalRate = 44100.0,
+                                  const TimeSource& time = hostTimeSource(),
+                                  double acquireBandwidth = 8.0,
+                                  double trackBandwidth = 0.05)
+        : DriftTracker(nominalRate, acquireBandwidth, time)
+        , acquireBandwidth_(acquireBandwidth)
+        , trackBandwidth_(trackBandwidth)
     {
-        // Apple Silicon has a non-trivial timebase (not 1:1 like Intel).
-        static mach_timebase_info_data_t info = {};
-        if (info.denom == 0) {
-            mach_timebase_info(&info);
-        }
-        return static_cast<double>(hostTime)
-             * static_cast<double>(info.numer)
-             / static_cast<double>(info.denom)
-             / 1e9;
     }
 
-    double nominalRate_;
-    double bandwidth_;
-    double rate_;
-    double predictedTime_ = 0.0;
-    double integral_ = 0.0;
-    bool   initialized_ = false;
-    int    stableCount_ = 0;
+    void update(uint64_t hostTime, uint32_t bufferFrames) override
+    {
+        DriftTracker::update(hostTime, bufferFrames);
+
+        // Halve the bandwidth every kNarrowHalfLife once acquired.
+        double t = elapsed() - kAcquireSeconds + (seeded() ? seedSkip() : 0.0);
+        double bw = t <= 0.0 ? acquireBandwidth_
+                             : acquireBandwidth_ * std::exp2(-t / kNarrowHalfLife);
+        setBandwidth(std::fmax(bw, trackBandwidth_));
+    }
+
+    void reset() override
+    {
+        DriftTracker::reset();
+        setBandwidth(acquireBandwidth_);
+    }
+
+    void seed(double rate) override
+    {
+        DriftTracker::seed(rate);
+        setBandwidth(std::fmax(kStableBandwidth, trackBandwidth_));
+    }
+
+    bool isStable() const override
+    {
+        return initialized()
+            && (seeded() || (elapsed() > kAcquireSeconds && bandwidth() <= kStableBandwidth));
+    }
+
+    ClockEstimatorKind kind() const override { return kClockEstimatorAdaptive; }
+
+private:
+    // Narrowing time from the acquire bandwidth down to kStableBandwidth.
+    double seedSkip() const
+    {
+        return kAcquireSeconds
+             + kNarrowHalfLife * std::log2(std::fmax(acquireBandwidth_ / kStableBandwidth, 1.0));
+    }
+
+    static constexpr double kAcquireSeconds = 0.25;
+    static constexpr double kNarrowHalfLife = 0.3;
+    static constexpr double kStableBandwidth = 0.5;
+
+    double acquireBandwidth_;
+    double trackBandwidth_;
 };
 
 } // namespace flux
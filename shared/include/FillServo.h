@@ -0,0 +1,120 @@
+#pragma once
+
+// PI controller that trims a resampling ratio to hold a resampled stream
+// at its target latency.
+//
+// The DLL ratio (DriftTracker) is open loop: any bias in it — timestamp
+// jitter that doesn't average out, a DLL that settled slightly off — walks
+// the stream's latency a little every callback until its ring over- or
+// underruns. The servo closes the loop on the stream's latency error,
+// read off the ring's master-timeline stamps rather than its fill: fill
+// seen from the consumer's callback carries the producer's block phase, a
+// slow sawtooth between two nearly equal periods, which the stamps don't.
+//
+//   ratio = dllRatio * (1 - correction)
+//   correction = Kp * e + Ki * ∫e dt        e = error in frames
+//
+// Input and cue streams pass the timeline error FrameRing::alignTo returns
+// (their stamps against the master clock); outputs pass the latency
+// FrameRing::tailTime gives against the buffer's master output time, less
+// the target. A stream that is ahead, or holds too much, resamples slightly
+// slower until it's back on target, and the integral term learns the DLL's
+// residual bias. The gains come from a loop bandwidth and damping
+// (second-order loop, like the DLL); the error is low-passed first so
+// stamp jitter doesn't turn into ratio wobble. correction is clamped, and
+// its rate of change is limited, so the pitch never moves faster than
+// maxSlew per second no matter what the error does.
+//
+// Used by the helper's IOProc threads, one servo per resampled stream and
+// thread. Not thread-safe.
+
+#include <cmath>
+#include <cstdint>
+
+namespace flux {
+
+struct FillServoConfig {
+    double bandwidth = 0.5;         // Loop natural frequency (rad/s)
+    double damping = 0.8;
+    double errorTimeConstant = 0.25;// Error low-pass (s); well inside the loop
+    double maxCorrection = 500e-6;  // |correction| limit — 500 ppm
+    double maxSlew = 200e-6;        // |d correction / dt| limit (per second)
+};
+
+class FillServo {
+public:
+    explicit FillServo(double nominalRate = 48000.0, FillServoConfig config = {})
+        : nominalRate_(nominalRate)
+        , config_(config)
+    {
+        // The error integrates the correction at nominalRate frames/s per
+        // unit correction — nominalRate is the rate of the frames the
+        // error is counted in. Pick Kp, Ki for s² + 2ζω s + ω² around that.
+        kp_ = 2.0 * config_.damping * config_.bandwidth / nominalRate_;
+        ki_ = config_.bandwidth * config_.bandwidth / nominalRate_;
+    }
+
+    // One control step. errorFrames = measured - target (positive: ahead,
+    // or too much queued), frames = frames processed since the previous step, at
+    // frameRate (nominalRate if 0 — a device on another clock or rate than
+    // the error's passes its own). Returns the new correction.
+    double update(double errorFrames, uint32_t frames, double frameRate = 0.0)
+    {
+        double dt = static_cast<double>(frames) / (frameRate > 0.0 ? frameRate : nominalRate_);
+        if (dt <= 0.0) return correction_;
+
+        if (!initialized_) {
+            filtered_ = errorFrames;
+            initialized_ = true;
+        } else {
+            double alpha = dt / (config_.errorTimeConstant + dt);
+            filtered_ += alpha * (errorFrames - filtered_);
+        }
+
+        // Integrate, but not further into saturation (anti-windup).
+        double integral = integral_ + filtered_ * dt;
+        double target = kp_ * filtered_ + ki_ * integral;
+        bool saturated = std::fabs(target) > config_.maxCorrection
+                      && (target > 0) == (filtered_ > 0);
+        if (!saturated) {
+            integral_ = integral;
+        }
+        target = kp_ * filtered_ + ki_ * integral_;
+        target = clamp(target, config_.maxCorrection);
+
+        double step = clamp(target - correction_, config_.maxSlew * dt);
+        correction_ += step;
+        return correction_;
+    }
+
+    // Apply the current correction to a resampling ratio (output / input).
+    double apply(double ratio) const { return ratio * (1.0 - correction_); }
+
+    void reset()
+    {
+        initialized_ = false;
+        filtered_ = 0.0;
+        integral_ = 0.0;
+        correction_ = 0.0;
+    }
+
+    double correction() const { return correction_; }
+    double filteredError() const { return filtered_; }
+
+private:
+    static double clamp(double x, double limit)
+    {
+        return x > limit ? limit : (x < -limit ? -limit : x);
+    }
+
+    double          nominalRate_;
+    FillServoConfig config_;
+    double          kp_ = 0.0;
+    double          ki_ = 0.0;
+    double          filtered_ = 0.0;
+    double          integral_ = 0.0;
+    double          correction_ = 0.0;
+    bool            initialized_ = false;
+};
+
+} // namespace flux
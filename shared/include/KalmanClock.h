@@ -0,0 +1,208 @@
+#pragma once
+
+// Kalman filter clock estimator.
+//
+// State: the host time of the next callback t (seconds since the first)
+// and the device's period p (host seconds per frame). Each callback
+// predicts t' = t + frames·p, and the measured timestamp corrects both in
+// proportion to their uncertainty, so the filter converges as fast as the
+// timestamps allow and settles as narrow as they allow — no bandwidth to
+// pick. The period is modelled as a slow random walk (crystal temperature
+// drift).
+//
+// USB timestamps mostly jitter a little and occasionally a lot (a late
+// wakeup, a missed microframe). The measurement noise R is learned from
+// the innovations — never below kNoiseFloor of their variance, or the
+// first few, which the initial phase uncertainty explains, would talk R
+// down to nothing and leave the period to soak up the phase error — and an
+// innovation beyond kGate standard deviations is treated as an outlier and
+// skipped. A run of kMaxOutliers in a row means the device really did jump
+// (stall, restart), so the filter restarts.
+//
+// A seed (warm start) sets the initial period and shrinks its uncertainty
+// to kSeedTolerance, about what a crystal moves between sessions, so the
+// jitter can't pull the period far off it while the filter settles. The
+// seed is checked against the timestamps for kSeedWindow callbacks: if
+// the smoothed innovation runs away from zero the filter restarts cold.
+
+#include "ClockEstimator.h"
+
+#include <cmath>
+#include <cstdint>
+
+namespace flux {
+
+class KalmanClock : public ClockEstimator {
+public:
+    explicit KalmanClock(double nominalRate = 44100.0,
+                         const TimeSource& time = hostTimeSource())
+        : ClockEstimator(nominalRate, time)
+    {
+        reset();
+    }
+
+    void update(uint64_t hostTime, uint32_t bufferFrames) override
+    {
+        if (bufferFrames == 0) return;
+
+        if (!initialized_) {
+            origin_ = hostTime;
+            t_ = 0.0;
+            r_ = kInitialJitter * kInitialJitter;
+            p00_ = r_;
+            p01_ = 0.0;
+            period_ = seeded_ ? 1.0 / seedRate_ : 1.0 / nominalRate_;
+            double sp = (seeded_ ? kSeedTolerance : kInitialTolerance) * period_;
+            p11_ = sp * sp;
+            initialized_ = true;
+            predict(bufferFrames);
+            return;
+        }
+
+        double z = seconds(hostTime, origin_);
+        double innovation = z - t_;
+        double s = p00_ + r_;
+
+        if (innovation * innovation > kGate * kGate * s) {
+            ++rejected_;
+            if (++outlierRun_ > kMaxOutliers) {
+                // Restart, keeping the current period as the seed.
+                double rate = 1.0 / period_;
+                bool seeded = seeded_ || isStable();
+                reset();
+                if (seeded) seed(rate);
+                update(hostTime, bufferFrames);
+                return;
+            }
+            // Coast on the prediction.
+            predict(bufferFrames);
+            return;
+        }
+        outlierRun_ = 0;
+
+        // Measurement noise: innovation variance minus what the state
+        // uncertainty explains.
+        ewma_ += kNoiseAlpha * (innovation * innovation - ewma_);
+        r_ = std::fmax(std::fmax(ewma_ - p00_, kNoiseFloor * ewma_), kMinJitter * kMinJitter);
+        bias_ += kNoiseAlpha * (innovation - bias_);
+
+        // A seed the timestamps disagree with is dropped and the filter
+        // restarts cold from here. One that lasts kSeedWindow callbacks
+        // has done its job; the filter's own uncertainty decides stability
+        // from then on.
+        if (seeded_ && !seedAgrees()) {
+            reset();
+            update(hostTime, bufferFrames);
+            return;
+        }
+        if (seeded_ && ++seedAge_ >= kSeedWindow) seeded_ = false;
+
+        double k0 = p00_ / s;
+        double k1 = p01_ / s;
+        t_ += k0 * innovation;
+        period_ += k1 * innovation;
+
+        double p00 = (1.0 - k0) * p00_;
+        double p01 = (1.0 - k0) * p01_;
+        double p11 = p11_ - k1 * p01_;
+        p00_ = p00;
+        p01_ = p01;
+        p11_ = p11;
+
+        if (updates_ < kMinUpdates) ++updates_;
+        predict(bufferFrames);
+    }
+
+    void reset() override
+    {
+        initialized_ = false;
+        period_ = 1.0 / nominalRate_;
+        t_ = 0.0;
+        p00_ = p01_ = p11_ = 0.0;
+        ewma_ = kInitialJitter * kInitialJitter;
+        r_ = ewma_;
+        bias_ = 0.0;
+        seedAge_ = 0;
+        outlierRun_ = 0;
+        updates_ = 0;
+        seeded_ = false;
+    }
+
+    void seed(double rate) override
+    {
+        seedRate_ = rate;
+        seeded_ = true;
+        period_ = 1.0 / rate;
+    }
+
+    double rate() const override { return 1.0 / period_; }
+
+    // Usable once the period's standard deviation is under
+    // kStableUncertainty, or at once when seeded — for as long as the
+    // timestamps agree with the seed.
+    bool isStable() const override
+    {
+        if (!initialized_) return false;
+        return (seeded_ && seedAgrees())
+            || (updates_ >= kMinUpdates && std::sqrt(p11_) < kStableUncertainty * period_);
+    }
+
+    ClockEstimatorKind kind() const override { return kClockEstimatorKalman; }
+
+    // Diagnostics.
+    double jitterSeconds() const { return std::sqrt(r_); }
+    uint64_t rejected() const { return rejected_; }
+
+private:
+    // The smoothed innovation stays within a timestamp's jitter: the
+    // prediction isn't running away from the timestamps.
+    bool seedAgrees() const { return bias_ * bias_ < kSeedAgreement * kSeedAgreement * ewma_; }
+
+    // Advance the state to the next callback, bufferFrames from now.
+    void predict(uint32_t bufferFrames)
+    {
+        double n = static_cast<double>(bufferFrames);
+        double dt = n * period_;
+        t_ += dt;
+
+        // P = F P Fᵀ + Q, F = [1 n; 0 1]
+        double p00 = p00_ + 2.0 * n * p01_ + n * n * p11_;
+        double p01 = p01_ + n * p11_;
+        double drift = kRateWander * period_;
+        p00_ = p00 + kPhaseWander * kPhaseWander * dt;
+        p01_ = p01;
+        p11_ = p11_ + drift * drift * dt;
+    }
+
+    static constexpr double kInitialJitter     = 200e-6;  // s; R before any learning
+    static constexpr double kMinJitter         = 1e-6;    // s; floor on learned R
+    static constexpr double kInitialTolerance  = 1000e-6; // Crystal tolerance (1σ, relative)
+    static constexpr double kSeedTolerance     = 2e-6;    // Seeded period (1σ, relative)
+    static constexpr double kRateWander        = 0.1e-6;  // Relative rate random walk per √s
+    static constexpr double kPhaseWander       = 1e-6;    // Phase random walk (s per √s)
+    static constexpr double kNoiseAlpha        = 0.01;    // R learning rate per callback
+    static constexpr double kNoiseFloor        = 0.5;     // R vs innovation variance, at least
+    static constexpr double kGate              = 4.0;     // Outlier gate (σ)
+    static constexpr int    kMaxOutliers       = 8;
+    static constexpr int    kMinUpdates        = 16;
+    static constexpr double kSeedAgreement     = 0.3;     // |smoothed innovation| / jitter
+    static constexpr int    kSeedWindow        = 1024;    // Callbacks a seed is checked for
+    static constexpr double kStableUncertainty = 2e-6;    // Relative period σ
+
+    double   period_ = 0.0;       // Host seconds per frame
+    double   t_ = 0.0;            // Predicted time of the next callback
+    double   p00_ = 0.0, p01_ = 0.0, p11_ = 0.0;
+    double   r_ = 0.0;            // Measurement noise variance (s²)
+    double   ewma_ = 0.0;         // Smoothed innovation²
+    double   bias_ = 0.0;         // Smoothed innovation
+    double   seedRate_ = 0.0;
+    uint64_t origin_ = 0;
+    uint64_t rejected_ = 0;
+    int      seedAge_ = 0;
+    int      outlierRun_ = 0;
+    int      updates_ = 0;
+    bool     initialized_ = false;
+    bool     seeded_ = false;
+};
+
+} // namespace flux
@@ -0,0 +1,100 @@
+#pragma once
+
+// Per-stream realtime metrics, kept in the shared memory header next to the
+// stream table (SharedMemoryLayout::metrics).
+//
+// Every counter has exactly one writer: the producer side of a stream owns
+// the write-side fields, the consumer side owns the read-side fields. Both
+// update them with relaxed atomics from their realtime threads — no fences,
+// no read-modify-write contention. Readers (flux_inspect, logs) sample them
+// at any rate and never affect the audio threads.
+//
+// Counters only grow; rates and windows are the reader's job (diff two
+// samples). The fill history is a small ring of consumer-side fill levels,
+// one entry per read callback, indexed by a monotonic head.
+
+#include <atomic>
+#include <cstdint>
+
+namespace flux {
+
+// Entries in each stream's fill-level history (power of two). At 256-frame
+// buffers and 48 kHz that's ~1.4 s of callbacks.
+constexpr uint32_t kFillHistoryLength = 256;
+
+struct alignas(64) StreamMetrics {
+    // ---- Producer side ----
+    std::atomic<uint64_t> writes{0};        // Write callbacks
+    std::atomic<uint64_t> overruns{0};      // Writes that lost frames: ring full
+    std::atomic<uint64_t> droppedFrames{0}; // Frames those writes lost
+
+    // ---- Consumer side ----
+    alignas(64) std::atomic<uint64_t> reads{0};     // Read callbacks
+    std::atomic<uint64_t> underruns{0};     // Nothing served — all silence
+    std::atomic<uint64_t> partials{0};      // Served some, concealed the rest
+    std::atomic<uint32_t> fillMin{0};       // Fill (frames) seen before a read
+    std::atomic<uint32_t> fillMax{0};
+    std::atomic<uint64_t> historyHead{0};   // Total entries ever written
+    std::atomic<uint32_t> fillHistory[kFillHistoryLength] = {};
+
+    void reset()
+    {
+        writes.store(0, std::memory_order_relaxed);
+        overruns.store(0, std::memory_order_relaxed);
+        droppedFrames.store(0, std::memory_order_relaxed);
+        reads.store(0, std::memory_order_relaxed);
+        underruns.store(0, std::memory_order_relaxed);
+        partials.store(0, std::memory_order_relaxed);
+        fillMin.store(UINT32_MAX, std::memory_order_relaxed);
+        fillMax.store(0, std::memory_order_relaxed);
+        historyHead.store(0, std::memory_order_relaxed);
+        for (auto& fill : fillHistory) fill.store(0, std::memory_order_relaxed);
+    }
+
+    // Producer: one write. lost = frames the ring's overflow policy threw
+    // away (FrameRing::produce / reserve), 0 when everything fit.
+    void onWrite(uint32_t lost)
+    {
+        bump(writes);
+        if (lost > 0) {
+            bump(overruns);
+            bump(droppedFrames, lost);
+        }
+    }
+
+    // Consumer: one read callback. fill = frames available before reading,
+    // requested/served = frames asked for and frames of real audio given.
+    void onRead(uint32_t fill, uint32_t requested, uint32_t served)
+    {
+        bump(reads);
+        if (served == 0 && requested > 0) {
+            bump(underruns);
+        } else if (served < requested) {
+            bump(partials);
+        }
+
+        if (fill < fillMin.load(std::memory_order_relaxed)) {
+            fillMin.store(fill, std::memory_order_relaxed);
+        }
+        if (fill > fillMax.load(std::memory_order_relaxed)) {
+            fillMax.store(fill, std::memory_order_relaxed);
+        }
+
+        uint64_t head = historyHead.load(std::memory_order_relaxed);
+        fillHistory[head & (kFillHistoryLength - 1)].store(fill, std::memory_order_relaxed);
+        historyHead.store(head + 1, std::memory_order_release);
+    }
+
+private:
+    // Single writer per field, so load + store is enough — no locked RMW.
+    static void bump(std::atomic<uint64_t>& counter, uint64_t by = 1)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + by,
+                      std::memory_order_relaxed);
+    }
+};
+
+static_assert((kFillHistoryLength & (kFillHistoryLength - 1)) == 0,
+              "kFillHistoryLength must be a power of two");
+
+} // namespace flux
@@ -0,0 +1,138 @@
+#pragma once
+
+// Least-squares clock estimator.
+//
+// Keeps the last kWindow (frame position, host time) pairs and fits a line
+// through them; the slope is host seconds per frame. Every point in the
+// window counts equally, so jitter averages down as 1/√N and there is no
+// loop to settle — but an outlier pulls the fit until it leaves the window,
+// and the estimate is only as current as the window is short.
+//
+// A seed stands in as the estimate until the window's own fit is stable.
+//
+// Refits from scratch each callback (two passes over the window) rather
+// than keeping running sums, which lose precision as the positions grow.
+
+#include "ClockEstimator.h"
+
+#include <cmath>
+#include <cstdint>
+
+namespace flux {
+
+class RegressionClock : public ClockEstimator {
+public:
+    static constexpr uint32_t kWindow = 2048;      // Callbacks (~11 s at 256 frames)
+
+    explicit RegressionClock(double nominalRate = 44100.0,
+                             const TimeSource& time = hostTimeSource())
+        : ClockEstimator(nominalRate, time)
+    {
+        reset();
+    }
+
+    void update(uint64_t hostTime, uint32_t bufferFrames) override
+    {
+        if (bufferFrames == 0) return;
+
+        if (count_ == 0 && head_ == 0) {
+            origin_ = hostTime;
+            position_ = 0;
+        }
+
+        Point& pt = points_[head_ % kWindow];
+        pt.frames = static_cast<double>(position_);
+        pt.seconds = seconds(hostTime, origin_);
+        ++head_;
+        if (count_ < kWindow) ++count_;
+        position_ += bufferFrames;
+
+        if (count_ >= 2) fit();
+    }
+
+    void reset() override
+    {
+        head_ = 0;
+        count_ = 0;
+        position_ = 0;
+        origin_ = 0;
+        period_ = 1.0 / nominalRate_;
+        stderr_ = 1.0;
+        seeded_ = false;
+    }
+
+    void seed(double rate) override
+    {
+        seeded_ = true;
+        period_ = 1.0 / rate;
+    }
+
+    double rate() const override { return 1.0 / period_; }
+
+    // Usable once the slope's standard error is under kStableUncertainty,
+    // or at once when seeded.
+    bool isStable() const override { return (seeded_ && count_ > 0) || fitStable(); }
+
+    ClockEstimatorKind kind() const override { return kClockEstimatorLSQ; }
+
+private:
+    struct Point {
+        double frames = 0.0;
+        double seconds = 0.0;
+    };
+
+    void fit()
+    {
+        // Oldest point in the window is the reference, for precision.
+        const Point& ref = points_[(head_ - count_) % kWindow];
+
+        double mx = 0.0, my = 0.0;
+        for (uint32_t i = 0; i < count_; ++i) {
+            const Point& pt = points_[(head_ - count_ + i) % kWindow];
+            mx += pt.frames - ref.frames;
+            my += pt.seconds - ref.seconds;
+        }
+        mx /= count_;
+        my /= count_;
+
+        double sxx = 0.0, sxy = 0.0, syy = 0.0;
+        for (uint32_t i = 0; i < count_; ++i) {
+            const Point& pt = points_[(head_ - count_ + i) % kWindow];
+            double dx = pt.frames - ref.frames - mx;
+            double dy = pt.seconds - ref.seconds - my;
+            sxx += dx * dx;
+            sxy += dx * dy;
+            syy += dy * dy;
+        }
+        if (sxx <= 0.0) return;
+
+        double slope = sxy / sxx;
+        if (slope <= 0.0) return;
+
+        // Residual variance from the fit: Σr² = Syy - slope·Sxy.
+        if (count_ > 2) {
+            double residual = std::fmax(syy - slope * sxy, 0.0) / (count_ - 2);
+            stderr_ = std::sqrt(residual / sxx);
+        }
+        if (!seeded_ || fitStable()) period_ = slope;
+    }
+
+    bool fitStable() const
+    {
+        return count_ >= kMinPoints && stderr_ < kStableUncertainty * period_;
+    }
+
+    static constexpr uint32_t kMinPoints = 16;
+    static constexpr double   kStableUncertainty = 2e-6;   // Relative slope σ
+
+    Point    points_[kWindow];
+    uint64_t head_ = 0;           // Points ever added
+    uint32_t count_ = 0;          // Points in the window
+    uint64_t position_ = 0;       // Frames since origin_
+    uint64_t origin_ = 0;
+    double   period_ = 0.0;       // Host seconds per frame
+    double   stderr_ = 1.0;       // Slope standard error
+    bool     seeded_ = false;
+};
+
+} // namespace flux
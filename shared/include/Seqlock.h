@@ -0,0 +1,89 @@
+#pragma once
+
+// Seqlock: single-writer, lock-free snapshot of a small multi-field record.
+//
+// The writer bumps a sequence counter to odd, stores the fields, then bumps
+// it back to even. A reader copies the fields between two reads of the
+// counter and keeps the copy only if both reads saw the same even value —
+// otherwise a store overlapped and it tries again. Readers never block the
+// writer and never see a mix of two stores (e.g. the sample time of one
+// clock point with the host time of the next).
+//
+// The record is held as relaxed atomic 64-bit words rather than a plain T,
+// so concurrent copies are well-defined in both processes. T must be
+// trivially copyable; keep it to a few words — readers copy all of it.
+//
+// Exactly one writer per Seqlock (one IOProc thread). Any number of readers,
+// in either process. Works in shared memory: no pointers, zero-filled
+// storage is a valid (all-zero) record at sequence 0.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace flux {
+
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Seqlock records are copied word by word");
+
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+public:
+    // Writer side. Not reentrant; one writer thread only.
+    void store(const T& value)
+    {
+        uint64_t buf[kWords] = {};
+        std::memcpy(buf, &value, sizeof(T));
+
+        uint64_t seq = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kWords; ++i) {
+            words_[i].store(buf[i], std::memory_order_relaxed);
+        }
+        sequence_.store(seq + 2, std::memory_order_release);
+    }
+
+    // Reader side. Returns false if every attempt overlapped a store —
+    // only possible if the writer is publishing continuously, since a store
+    // is a handful of word writes. Realtime readers use this.
+    bool tryLoad(T* out, int attempts = 4) const
+    {
+        uint64_t buf[kWords];
+        for (int n = 0; n < attempts; ++n) {
+            uint64_t before = sequence_.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            for (size_t i = 0; i < kWords; ++i) {
+                buf[i] = words_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence_.load(std::memory_order_relaxed) == before) {
+                std::memcpy(out, buf, sizeof(T));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Reader side, retrying until a consistent copy is read.
+    T load() const
+    {
+        T value;
+        while (!tryLoad(&value)) {}
+        return value;
+    }
+
+    // Number of completed stores. Lets a reader tell whether anything was
+    // published since it last looked.
+    uint64_t version() const { return sequence_.load(std::memory_order_acquire) / 2; }
+
+private:
+    std::atomic<uint64_t> sequence_{0};
+    std::atomic<uint64_t> words_[kWords] = {};
+};
+
+} // namespace flux
@@ -6,169 +6,964 @@
 // entry port (mach_make_memory_entry_64), and hands it to the plugin via
 // Mach message. Both processes map the same physical pages.
 //
-// Lock-free SPSC ring buffers: helper writes audio, plugin reads (input path).
-// Plugin writes audio, helper reads (output path).
+// The region is self-describing: a fixed header (magic, layout version,
+// status, clock) with a table of the devices the helper aggregates and a
+// table of stream descriptors, each naming its device and pointing at a
+// ring somewhere after the header. The helper picks devices, ring counts and
+// sizes at startup; the plugin validates magic/version and builds its
+// streams from the tables, so it doesn't have to be rebuilt when the device
+// set or the sizing changes.
+//
+// Lock-free SPSC rings: helper writes audio, plugin reads (input streams).
+// Plugin writes audio, helper reads (output streams).
 // Clock timestamps: helper writes, plugin reads (for GetZeroTimeStamp).
 //
 // All shared fields use atomics or are naturally aligned for lock-free access.
 
 #include "Constants.h"
+#include "Metrics.h"
+#include "Seqlock.h"
 
 #include <atomic>
+#include <cstddef>
 #include <cstring>
 #include <cstdint>
+#include <vector>
 
 namespace flux {
 
-// ---- Lock-free SPSC ring buffer for shared memory ----
-// No mmap mirror trick (can't do that across processes). Instead, uses
-// modular arithmetic on atomic head/tail indices. The data region is
-// inline in the struct so the whole thing lives in a single allocation.
+// ---- Contiguous pieces of a ring region ----
+// A region of a ring is at most two spans: up to the end of the data, then
+// from the start. Lengths are in frames; the second span is empty unless
+// the region wraps, which it never does on a mirrored ring.
+
+template <typename Sample>
+struct RingSpans {
+    Sample*  data1   = nullptr;
+    uint32_t frames1 = 0;
+    Sample*  data2   = nullptr;
+    uint32_t frames2 = 0;
+
+    uint32_t total() const { return frames1 + frames2; }
+};
+
+// ---- Lock-free SPSC frame ring for shared memory ----
+// Channel count and sample type are template parameters, so the copy loops
+// are specialized for the frame size at compile time — or, with Channels
+// kDynamicChannels, the count is the ring's own, set at init(): what the
+// shared layout uses, so every stream carries as many channels as its
+// device has (StreamDescriptor::channels). Frames are always interleaved,
+// the layout the converters' SIMD kernels take. Capacity is chosen
+// when the layout is built and must be a power of two: positions are 64-bit
+// monotonic frame counters (they never wrap in practice) and the data index
+// is pos & mask — no modulo, and the full capacity is usable.
+//
+// This struct is the ring's header; its data follows it directly in the
+// shared region (see data()), so a ring is one contiguous block at the
+// offset its StreamDescriptor gives.
+//
+// A mirrored ring's data is mapped a second time directly behind itself
+// (the transports map it in every process, see Transport.h), so a region
+// running past the end carries on into the same frames: every transfer is
+// one memcpy and every span handed out is contiguous. The layout opts rings
+// in (LayoutTable::mirrored); the others keep the two-span split.
+//
+// Transfers come in three flavours:
+//   write() / read()         all or nothing — the block moves whole or not at all
+//   writeSome() / readSome() partial — as many frames as fit / are there
+//   produce() / reserve()    the stream's OverflowPolicy decides what is lost
+// The realtime paths use the last two, so a short ring costs a few frames
+// (concealed by the reader, see Conceal.h) rather than a whole buffer.
+//
+// Overflow without blocking the consumer: readPos belongs to the consumer
+// alone, so a producer that has to discard queued frames (drop-oldest,
+// overwrite) raises dropFloor instead — a floor the consumer's position is
+// clamped to. Under drop-oldest the producer publishes the floor before it
+// touches the reclaimed slots and the consumer re-checks the floor after
+// copying, seqlock style, discarding a copy the producer overlapped. Under
+// overwrite nobody checks: a read racing a lap may mix old and new frames.
+//
+// Input rings also carry a master-domain timeline: frame n (writePos/readPos
+// index) sits at absolute master sample time origin + n. The helper stamps
+// every block it writes (alignTo) and only moves origin on a discontinuity —
+// a dropped block, a device restart, timestamp drift past the tolerance. The
+// plugin reads by timestamp (readAt, or peekAt for several clients at once)
+// instead of taking whatever sits in the ring, so every input stream read at
+// the same timestamp is sample-aligned with the others, independent of when
+// each path started. Drop-oldest keeps positions contiguous through an
+// overflow, so it doesn't cost a re-anchor.
+// Output rings carry the same timeline the other way round: the plugin
+// stamps each block with its HAL output time, and the helper reads the
+// stream's latency off it (tailTime) to servo a slave's resampler.
+
+template <uint32_t Channels, typename Sample>
+struct alignas(64) FrameRing {
+    static constexpr uint32_t kChannels = Channels;   // kDynamicChannels: see channels
+
+    alignas(64) std::atomic<uint64_t> writePos{0};  // Frames written (producer)
+    std::atomic<uint64_t> dropFloor{0};             // Reclaimed below here (producer)
+    alignas(64) std::atomic<uint64_t> readPos{0};   // Frames read (consumer)
+
+    // Master-domain timeline. Producer writes, consumer reads.
+    alignas(64) std::atomic<int64_t> origin{0};
+    std::atomic<uint32_t> anchored{0};      // 0 until the first alignTo()
 
-struct alignas(64) SPSCRingBuffer {
-    alignas(64) std::atomic<int32_t> head{0};  // Write position (producer)
-    alignas(64) std::atomic<int32_t> tail{0};  // Read position (consumer)
-    int32_t capacity = 0;
-    uint8_t data[kRingBufferCapacity];
+    uint32_t capacity = 0;                  // Frames, power of two
+    uint32_t policy = kOverflowDropNewest;  // OverflowPolicy
+    uint64_t mask = 0;
+    uint32_t channels = Channels;           // Samples per frame
+    uint32_t mirrored = 0;                  // Data mapped twice back to back
 
-    void init(int32_t cap)
+    uint32_t frameSamples() const { return Channels != kDynamicChannels ? Channels : channels; }
+    size_t   frameBytes() const { return frameSamples() * sizeof(Sample); }
+
+    // Bytes a ring of this capacity and channel count occupies in the
+    // shared region.
+    static size_t bytesFor(uint32_t capacityFrames, uint32_t channelCount = Channels)
     {
-        capacity = cap;
-        head.store(0, std::memory_order_relaxed);
-        tail.store(0, std::memory_order_relaxed);
-        std::memset(data, 0, sizeof(data));
+        return sizeof(FrameRing)
+             + static_cast<size_t>(capacityFrames) * channelCount * sizeof(Sample);
     }
 
-    // Available bytes to read.
-    int32_t availableRead() const
+    Sample*       data()       { return reinterpret_cast<Sample*>(this + 1); }
+    const Sample* data() const { return reinterpret_cast<const Sample*>(this + 1); }
+
+    // A mirrored ring's second mapping has to be in place before the ring
+    // is used, in every process using it.
+    void init(uint32_t capacityFrames, uint32_t overflowPolicy = kOverflowDropNewest,
+              uint32_t channelCount = Channels, bool mirror = false)
     {
-        int32_t h = head.load(std::memory_order_acquire);
-        int32_t t = tail.load(std::memory_order_relaxed);
-        int32_t avail = h - t;
-        if (avail < 0) avail += capacity;
-        return avail;
+        capacity = capacityFrames;
+        policy = overflowPolicy;
+        mask = capacityFrames - 1;
+        channels = Channels != kDynamicChannels ? Channels : channelCount;
+        mirrored = mirror ? 1 : 0;
+        writePos.store(0, std::memory_order_relaxed);
+        dropFloor.store(0, std::memory_order_relaxed);
+        readPos.store(0, std::memory_order_relaxed);
+        origin.store(0, std::memory_order_relaxed);
+        anchored.store(0, std::memory_order_relaxed);
+        std::memset(data(), 0, static_cast<size_t>(capacityFrames) * frameBytes());
     }
 
-    // Available space to write.
-    int32_t availableWrite() const
+    // Available frames to read.
+    uint32_t availableRead() const
     {
-        return capacity - 1 - availableRead();
+        uint64_t w = writePos.load(std::memory_order_acquire);
+        return static_cast<uint32_t>(w - tailAt(w));
     }
 
-    // Write bytes into the ring buffer. Returns false if not enough space.
-    bool write(const void* src, int32_t len)
+    // Available space to write, in frames.
+    uint32_t availableWrite() const
     {
-        if (len > availableWrite()) return false;
+        uint64_t w = writePos.load(std::memory_order_relaxed);
+        return capacity - static_cast<uint32_t>(w - tailAt(w));
+    }
+
+    // ---- Producer ----
 
-        int32_t h = head.load(std::memory_order_relaxed);
-        const auto* srcBytes = static_cast<const uint8_t*>(src);
+    // Write frames into the ring. Returns false if not enough space.
+    bool write(const Sample* src, uint32_t frames)
+    {
+        if (frames > availableWrite()) return false;
+        storeAt(writePos.load(std::memory_order_relaxed), src, frames);
+        return true;
+    }
 
-        // May need two memcpy's if wrapping around.
-        int32_t firstChunk = capacity - h;
-        if (firstChunk >= len) {
-            std::memcpy(data + h, srcBytes, len);
-        } else {
-            std::memcpy(data + h, srcBytes, firstChunk);
-            std::memcpy(data, srcBytes + firstChunk, len - firstChunk);
+    // Write as many frames as fit. Returns frames written.
+    uint32_t writeSome(const Sample* src, uint32_t frames)
+    {
+        uint32_t avail = availableWrite();
+        if (frames > avail) frames = avail;
+        storeAt(writePos.load(std::memory_order_relaxed), src, frames);
+        return frames;
+    }
+
+    // Write a block under the ring's overflow policy. Returns frames lost:
+    // the block's tail under drop-newest, queued frames otherwise (plus the
+    // block's head if it is longer than the whole ring). 0 if it all fit.
+    uint32_t produce(const Sample* src, uint32_t frames)
+    {
+        uint32_t avail = availableWrite();
+        if (frames <= avail) {
+            storeAt(writePos.load(std::memory_order_relaxed), src, frames);
+            return 0;
+        }
+        if (policy == kOverflowDropNewest) {
+            storeAt(writePos.load(std::memory_order_relaxed), src, avail);
+            return frames - avail;
         }
 
-        int32_t newHead = (h + len) % capacity;
-        head.store(newHead, std::memory_order_release);
-        return true;
+        // Only the newest capacity frames of an oversized block can be kept.
+        uint32_t skip = frames > capacity ? frames - capacity : 0;
+        uint32_t lost = reclaim(frames);
+        uint64_t w = writePos.load(std::memory_order_relaxed);
+        auto spans = spansAt(w + skip, frames - skip);
+        src += static_cast<size_t>(skip) * frameSamples();
+        copyFrames(spans.data1, src, spans.frames1);
+        copyFrames(spans.data2, src + spans.frames1 * frameSamples(), spans.frames2);
+        writePos.store(w + frames, std::memory_order_release);
+        return lost;
     }
 
-    // Read bytes from the ring buffer. Returns false if not enough data.
-    bool read(void* dst, int32_t len)
+    // ---- Consumer ----
+
+    // Read frames from the ring. Returns false if not enough data.
+    bool read(Sample* dst, uint32_t frames)
+    {
+        if (frames > availableRead()) return false;
+        return readSome(dst, frames) == frames;
+    }
+
+    // Read up to frames frames. Returns frames read. On a drop-oldest ring a
+    // copy the producer overlapped is thrown away and retried; 0 if it kept
+    // losing (the ring is overflowing every few microseconds).
+    uint32_t readSome(Sample* dst, uint32_t frames)
     {
-        if (len > availableRead()) return false;
+        for (int attempt = 0; attempt < 4; ++attempt) {
+            uint64_t w = writePos.load(std::memory_order_acquire);
+            uint64_t r = tailAt(w);
+            auto avail = static_cast<uint32_t>(w - r);
+            uint32_t n = frames < avail ? frames : avail;
 
-        int32_t t = tail.load(std::memory_order_relaxed);
-        auto* dstBytes = static_cast<uint8_t*>(dst);
+            auto spans = spansAt(r, n);
+            copyFrames(dst, spans.data1, spans.frames1);
+            copyFrames(dst + spans.frames1 * frameSamples(), spans.data2, spans.frames2);
 
-        int32_t firstChunk = capacity - t;
-        if (firstChunk >= len) {
-            std::memcpy(dstBytes, data + t, len);
-        } else {
-            std::memcpy(dstBytes, data + t, firstChunk);
-            std::memcpy(dstBytes + firstChunk, data, len - firstChunk);
+            if (policy == kOverflowDropOldest) {
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (dropFloor.load(std::memory_order_relaxed) > r) continue;
+            }
+            readPos.store(r + n, std::memory_order_release);
+            return n;
         }
+        return 0;
+    }
 
-        int32_t newTail = (t + len) % capacity;
-        tail.store(newTail, std::memory_order_release);
-        return true;
+    // ---- Zero-copy access ----
+    // Hand out the ring's own memory so producers (e.g. a resampler) can
+    // write straight into it and consumers can process in place.
+
+    // Writable spans covering min(frames, availableWrite()) frames.
+    // Fill them, then publish with commitWrite().
+    RingSpans<Sample> prepareWrite(uint32_t frames)
+    {
+        uint32_t avail = availableWrite();
+        if (frames > avail) frames = avail;
+        return spansAt(writePos.load(std::memory_order_relaxed), frames);
+    }
+
+    // prepareWrite() under the overflow policy: drop-oldest / overwrite
+    // rings reclaim queued frames so the spans cover min(frames, capacity);
+    // drop-newest rings hand out what's free. *lost = frames reclaimed or,
+    // for drop-newest, frames that won't fit.
+    RingSpans<Sample> reserve(uint32_t frames, uint32_t* lost)
+    {
+        uint32_t avail = availableWrite();
+        *lost = 0;
+        if (frames > avail) {
+            if (policy == kOverflowDropNewest) {
+                *lost = frames - avail;
+                frames = avail;
+            } else {
+                if (frames > capacity) frames = capacity;
+                *lost = reclaim(frames);
+            }
+        }
+        return spansAt(writePos.load(std::memory_order_relaxed), frames);
+    }
+
+    void commitWrite(uint32_t frames)
+    {
+        uint64_t w = writePos.load(std::memory_order_relaxed);
+        writePos.store(w + frames, std::memory_order_release);
     }
 
-    // Peek without consuming. Returns pointer to contiguous data up to
-    // min(available, capacity - tail). Caller must handle wrap manually
-    // or just use read() for simplicity.
-    const uint8_t* peek(int32_t* outAvailable) const
+    // Readable spans covering everything available.
+    // Process them in place, then release with consume(). Nothing guards
+    // in-place processing against a producer reclaiming the same frames —
+    // give zero-copy consumers a drop-newest ring.
+    RingSpans<const Sample> readSpans() const
     {
-        int32_t t = tail.load(std::memory_order_relaxed);
-        int32_t avail = availableRead();
-        int32_t contiguous = capacity - t;
-        *outAvailable = (avail < contiguous) ? avail : contiguous;
-        return data + t;
+        uint64_t w = writePos.load(std::memory_order_acquire);
+        uint64_t r = tailAt(w);
+        auto spans = const_cast<FrameRing*>(this)->spansAt(r, static_cast<uint32_t>(w - r));
+        return {spans.data1, spans.frames1, spans.data2, spans.frames2};
+    }
+
+    void consume(uint32_t frames)
+    {
+        uint64_t r = tailAt(writePos.load(std::memory_order_acquire));
+        readPos.store(r + frames, std::memory_order_release);
     }
 
     void clear()
     {
-        tail.store(head.load(std::memory_order_relaxed),
-                   std::memory_order_release);
+        readPos.store(writePos.load(std::memory_order_acquire),
+                      std::memory_order_release);
     }
+
+    // ---- Timeline, helper side ----
+
+    // Declare that the next frame written sits at master sample time
+    // sampleTime. Re-anchors only if the timeline is off by more than
+    // tolerance frames, so jittery stamps don't cause jumps. Returns the
+    // error left standing (stamp - timeline, within ±tolerance; 0 after a
+    // re-anchor) — what a rate servo should drive to zero.
+    int64_t alignTo(int64_t sampleTime, int64_t tolerance)
+    {
+        auto written = static_cast<int64_t>(writePos.load(std::memory_order_relaxed));
+        int64_t error = sampleTime - (origin.load(std::memory_order_relaxed) + written);
+        if (anchored.load(std::memory_order_relaxed) == 0
+            || error > tolerance || error < -tolerance)
+        {
+            origin.store(sampleTime - written, std::memory_order_release);
+            anchored.store(1, std::memory_order_release);
+            return 0;
+        }
+        return error;
+    }
+
+    // ---- Timeline, consumer side ----
+
+    // Master sample time of the oldest unread frame. False until anchored.
+    // Lets a consumer measure a stream's latency as a time rather than a
+    // fill level, which would swing by a block with the producer's phase.
+    bool tailTime(int64_t* outSampleTime) const
+    {
+        if (anchored.load(std::memory_order_acquire) == 0) return false;
+        uint64_t w = writePos.load(std::memory_order_acquire);
+        *outSampleTime = origin.load(std::memory_order_acquire)
+                       + static_cast<int64_t>(tailAt(w));
+        return true;
+    }
+
+    // Fill dst with the frames starting at master sample time sampleTime.
+    // Always fills the whole buffer; gaps come out as silence. Falls back
+    // to a plain FIFO read until the helper has anchored the timeline.
+    // Returns how many of the frames were real audio; they start at frame
+    // *lead (silence before the ring's oldest frame), the rest is padding.
+    uint32_t readAt(Sample* dst, uint32_t frames, int64_t sampleTime,
+                    uint32_t* lead = nullptr)
+    {
+        if (lead) *lead = 0;
+
+        if (anchored.load(std::memory_order_acquire) == 0) {
+            uint32_t n = readSome(dst, frames);
+            zeroFrames(dst + static_cast<size_t>(n) * frameSamples(), frames - n);
+            return n;
+        }
+
+        auto head = static_cast<int64_t>(writePos.load(std::memory_order_acquire));
+        auto tail = static_cast<int64_t>(tailAt(static_cast<uint64_t>(head)));
+        int64_t start = sampleTime - origin.load(std::memory_order_acquire);
+
+        // Drop frames older than the request.
+        if (start > tail) {
+            tail = start < head ? start : head;
+            readPos.store(static_cast<uint64_t>(tail), std::memory_order_release);
+        }
+
+        // Ran out before reaching the request — nothing usable.
+        if (tail < start) {
+            zeroFrames(dst, frames);
+            return 0;
+        }
+
+        // Silence for the part of the request before the oldest frame.
+        int64_t pad = tail - start;
+        if (pad > frames) pad = frames;
+        zeroFrames(dst, static_cast<uint32_t>(pad));
+        if (lead) *lead = static_cast<uint32_t>(pad);
+
+        auto remaining = static_cast<uint32_t>(frames - pad);
+        dst += pad * frameSamples();
+        uint32_t n = remaining > 0 ? readSome(dst, remaining) : 0;
+        zeroFrames(dst + static_cast<size_t>(n) * frameSamples(), remaining - n);
+        return n;
+    }
+
+    // ---- Timeline, several consumers ----
+    // A ring several readers share at their own timestamps (the plugin's
+    // clients): each copies its frames with peekAt(), which consumes
+    // nothing, and the readers together release() what none of them will
+    // read again. readPos is then only the oldest timestamp still wanted,
+    // raised by whichever reader gets there first; everything from it on
+    // is kept for all of them.
+
+    // readAt() without consuming: the same frames, padding, return and
+    // *lead. Silence until the helper has anchored the timeline. On a
+    // drop-oldest ring a copy the producer overlapped is retried, then
+    // served as silence.
+    uint32_t peekAt(Sample* dst, uint32_t frames, int64_t sampleTime,
+                    uint32_t* lead = nullptr)
+    {
+        if (lead) *lead = 0;
+        if (anchored.load(std::memory_order_acquire) != 0) {
+            for (int attempt = 0; attempt < 4; ++attempt) {
+                auto head = static_cast<int64_t>(writePos.load(std::memory_order_acquire));
+                auto tail = static_cast<int64_t>(tailAt(static_cast<uint64_t>(head)));
+                int64_t start = sampleTime - origin.load(std::memory_order_acquire);
+                int64_t end = start + frames;
+
+                // The part of the request the ring still holds.
+                int64_t from = start > tail ? start : tail;
+                int64_t to = end < head ? end : head;
+                if (to <= from) break;
+
+                auto pad = static_cast<uint32_t>(from - start);
+                auto n = static_cast<uint32_t>(to - from);
+                auto spans = spansAt(static_cast<uint64_t>(from), n);
+                zeroFrames(dst, pad);
+                Sample* real = dst + static_cast<size_t>(pad) * frameSamples();
+                copyFrames(real, spans.data1, spans.frames1);
+                copyFrames(real + spans.frames1 * frameSamples(), spans.data2, spans.frames2);
+                zeroFrames(real + static_cast<size_t>(n) * frameSamples(), frames - pad - n);
+
+                if (policy == kOverflowDropOldest) {
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (dropFloor.load(std::memory_order_relaxed) > static_cast<uint64_t>(from)) {
+                        continue;
+                    }
+                }
+                if (lead) *lead = pad;
+                return n;
+            }
+        }
+        zeroFrames(dst, frames);
+        return 0;
+    }
+
+    // No reader will ask for frames before master sample time sampleTime
+    // again: hand them back to the producer. Never moves readPos back or
+    // past the frames written; safe from several readers at once.
+    void release(int64_t sampleTime)
+    {
+        if (anchored.load(std::memory_order_acquire) == 0) return;
+        auto head = writePos.load(std::memory_order_acquire);
+        int64_t pos = sampleTime - origin.load(std::memory_order_acquire);
+        if (pos <= 0) return;
+        auto target = static_cast<uint64_t>(pos) < head ? static_cast<uint64_t>(pos) : head;
+
+        uint64_t r = readPos.load(std::memory_order_relaxed);
+        while (r < target
+               && !readPos.compare_exchange_weak(r, target, std::memory_order_release,
+                                                 std::memory_order_relaxed))
+        {
+        }
+    }
+
+private:
+    // Consumer's effective position: readPos, raised to the drop floor.
+    // Clamped to w while a producer that raised the floor past it (a block
+    // longer than the ring) hasn't published the block yet.
+    uint64_t tailAt(uint64_t w) const
+    {
+        uint64_t r = readPos.load(std::memory_order_acquire);
+        uint64_t floor = dropFloor.load(std::memory_order_acquire);
+        if (floor > r) r = floor;
+        return r < w ? r : w;
+    }
+
+    // Producer: give up queued frames so a block of frames fits. Under
+    // drop-oldest the floor is published before any reclaimed slot is
+    // overwritten (paired with the fence in readSome). Returns frames lost.
+    uint32_t reclaim(uint32_t frames)
+    {
+        uint64_t w = writePos.load(std::memory_order_relaxed);
+        uint64_t tail = tailAt(w);
+        uint64_t floor = w + frames - capacity;
+        if (floor <= tail) return 0;
+
+        dropFloor.store(floor, std::memory_order_relaxed);
+        if (policy == kOverflowDropOldest) {
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+        return static_cast<uint32_t>(floor - tail);
+    }
+
+    void storeAt(uint64_t w, const Sample* src, uint32_t frames)
+    {
+        auto spans = spansAt(w, frames);
+        copyFrames(spans.data1, src, spans.frames1);
+        copyFrames(spans.data2, src + spans.frames1 * frameSamples(), spans.frames2);
+        writePos.store(w + frames, std::memory_order_release);
+    }
+
+    RingSpans<Sample> spansAt(uint64_t pos, uint32_t frames)
+    {
+        auto index = static_cast<uint32_t>(pos & mask);
+        uint32_t firstChunk = capacity - index;
+        Sample* start = data() + static_cast<size_t>(index) * frameSamples();
+        if (mirrored || firstChunk >= frames) {
+            return {start, frames, nullptr, 0};
+        }
+        return {start, firstChunk, data(), frames - firstChunk};
+    }
+
+    void copyFrames(Sample* dst, const Sample* src, uint32_t frames) const
+    {
+        if (frames > 0) std::memcpy(dst, src, frames * frameBytes());
+    }
+
+    void zeroFrames(Sample* dst, uint32_t frames) const
+    {
+        if (frames > 0) std::memset(dst, 0, frames * frameBytes());
+    }
+};
+
+// The shared layout's rings: interleaved float32, each stream with its own
+// channel count. StereoRing is the fixed-width ring for code that only
+// ever moves stereo.
+using AudioRing  = FrameRing<kDynamicChannels, float>;
+using StereoRing = FrameRing<kChannelsPerDevice, float>;
+
+// ---- Clock and rate records published by the helper ----
+// Each is written by exactly one IOProc thread through a Seqlock, so readers
+// (plugin GetZeroTimeStamp, the slave IOProcs, the cue taps) always get all
+// fields from the same publish.
+
+// Master clock. One point on the master timeline plus the DLL rate to
+// extrapolate from it, both in session samples (sessionRate) — the master's
+// own, scaled when it runs at another rate. Written by the master IOProc.
+struct ClockSnapshot {
+    double   sampleTime = 0.0;
+    uint64_t hostTime = 0;      // 0 until the first publish
+    uint64_t seed = 0;          // Bumped on every timeline discontinuity
+    double   rate = 0.0;        // Master DLL rate (Hz)
+    uint32_t rateStable = 0;    // Master DLL converged
+    uint32_t _pad = 0;
+};
+
+// Slave → master drift. Written by the slave's IOProc, from its own DLL and
+// the master rate in the latest ClockSnapshot.
+struct DriftSnapshot {
+    double   masterRate = 0.0;  // In session samples, as ClockSnapshot::rate
+    double   slaveRate = 0.0;
+    double   ratio = 1.0;       // masterRate / slaveRate
+    double   inputCorrection = 0.0;  // Capture servo trim (FillServo.h)
+    double   outputCorrection = 0.0; // Playback servo trim
+    uint32_t ready = 0;         // Both DLLs converged; ratio is usable
+    uint32_t _pad = 0;
+};
+
+// One slave's drift record, on a cache line of its own: every slave's is
+// written by a different IOProc.
+struct alignas(64) DriftRecord : Seqlock<DriftSnapshot> {};
+
+// ---- Device table ----
+// One entry per hardware device the helper aggregates, in its configured
+// order: the clock master is device 0, every other device is a slave whose
+// streams the helper resamples to the master's clock.
+
+struct DeviceDescriptor {
+    uint32_t clockDomain = 0;               // ClockDomain
+    uint32_t _pad = 0;
+    char     name[kDeviceNameLength] = {};  // NUL-terminated, unique
 };
 
-// ---- Clock data published by the helper (Push master clock) ----
+// ---- Stream table ----
+// One entry per ring. Offsets are from the start of the region. A stream is
+// identified by its device and role; clockDomain is the device's. The ring
+// contents are always in the master clock domain — the helper resamples.
+
+struct StreamDescriptor {
+    uint32_t role = 0;             // StreamRole
+    uint32_t device = 0;           // Index into the device table
+    uint32_t direction = 0;        // StreamDirection
+    uint32_t clockDomain = 0;      // ClockDomain
+    uint32_t channels = 0;         // Interleaved, 1..kMaxStreamChannels
+    uint32_t capacityFrames = 0;   // Power of two
+    uint32_t overflowPolicy = 0;   // OverflowPolicy
+    uint32_t mirrored = 0;         // Ring data mapped twice (FrameRing); set by init()
+    uint64_t offset = 0;           // Ring header offset from region start
+};
+
+// What a layout is built from: the devices and their streams.
+struct LayoutTable {
+    std::vector<DeviceDescriptor> devices;
+    std::vector<StreamDescriptor> streams;
+
+    // Mirror every ring whose data fills whole kMirrorAlignment blocks
+    // (FrameRing). Off by default: each mirrored ring reserves its data size
+    // once more in the region, and its data starts on the next block.
+    bool mirrored = false;
+
+    // Append a device and its streams. The first device is the clock
+    // master — capture and playback, passed through. Every later one is a
+    // slave — capture, a cue tap if asked for, and playback, all resampled.
+    // Rings are sized from Constants.h unless ringFrames (a power of two)
+    // is given, of which the master's playback ring gets half. Input rings
+    // drop the oldest frames on overflow — the freshest audio wins and the
+    // timeline stays contiguous; output rings are drained zero-copy, so they
+    // drop the newest. Capture and playback carry inputChannels /
+    // outputChannels channels (up to kMaxStreamChannels); a cue tap is
+    // stereo. False if the tables are full, the name doesn't fit or a
+    // channel count is out of range.
+    bool addDevice(const char* name, bool cue = false, uint32_t ringFrames = 0,
+                   uint32_t inputChannels = kChannelsPerDevice,
+                   uint32_t outputChannels = kChannelsPerDevice)
+    {
+        bool master = devices.empty();
+        uint32_t streamCount = master ? 2 : (cue ? 3 : 2);
+        size_t length = std::strlen(name);
+        if (devices.size() >= kMaxDevices || streams.size() + streamCount > kMaxStreams
+            || length == 0 || length >= kDeviceNameLength
+            || !validChannels(inputChannels) || !validChannels(outputChannels))
+        {
+            return false;
+        }
+
+        DeviceDescriptor device;
+        device.clockDomain = master ? kClockDomainMaster : kClockDomainSlave;
+        std::memcpy(device.name, name, length);
+        auto index = static_cast<uint32_t>(devices.size());
+        devices.push_back(device);
 
-struct alignas(64) ClockData {
-    std::atomic<double>   sampleTime{0.0};
-    std::atomic<uint64_t> hostTime{0};
-    std::atomic<uint64_t> seed{0};
+        uint32_t in = ringFrames ? ringFrames : master ? kMasterInputRingFrames : kSlaveRingFrames;
+        uint32_t out = !master ? in : ringFrames ? ringFrames / 2 : kMasterOutputRingFrames;
+        auto add = [&](StreamRole role, uint32_t direction, uint32_t channels,
+                       uint32_t frames, uint32_t policy) {
+            StreamDescriptor desc;
+            desc.role = role;
+            desc.device = index;
+            desc.direction = direction;
+            desc.clockDomain = device.clockDomain;
+            desc.channels = channels;
+            desc.capacityFrames = frames;
+            desc.overflowPolicy = policy;
+            streams.push_back(desc);
+        };
+        add(kStreamCapture, kStreamDirInput, inputChannels, in, kOverflowDropOldest);
+        if (!master && cue) {
+            add(kStreamCue, kStreamDirInput, kChannelsPerDevice, in, kOverflowDropOldest);
+        }
+        add(kStreamPlayback, kStreamDirOutput, outputChannels, out, kOverflowDropNewest);
+        return true;
+    }
+
+    static constexpr bool validChannels(uint32_t channels)
+    {
+        return channels >= 1 && channels <= kMaxStreamChannels;
+    }
 };
 
-// ---- Top-level shared memory layout ----
+// Default layout: Push as the master and the FLX4 with its cue tap — what
+// the helper runs without a device configuration.
+inline LayoutTable defaultLayoutTable()
+{
+    LayoutTable table;
+    table.addDevice("push");
+    table.addDevice("flx4", true);
+    return table;
+}
+
+// Latency (frames) a stream reports until the helper publishes its own.
+// Inputs are served at the alignment latency; a slave's output adds its
+// queue and converter, the master's nothing.
+inline uint32_t defaultStreamLatency(const StreamDescriptor& desc)
+{
+    if (desc.direction == kStreamDirInput) return kInputAlignmentLatency;
+    return desc.clockDomain == kClockDomainSlave ? kSlaveStreamLatency : 0;
+}
+
+// ---- Top-level shared memory layout (region header) ----
 // Helper writes status + clock + input rings.
 // Plugin reads status + clock + input rings, writes output rings.
 
 struct SharedMemoryLayout {
-    // Header — status and device state
+    // Identification — written once by the helper, checked by the plugin.
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t headerSize = 0;       // sizeof(SharedMemoryLayout) in the helper
+    uint32_t streamCount = 0;
+    uint64_t totalSize = 0;        // Bytes used, header + all rings
+    uint64_t sessionId = 0;        // Unique per helper run (per region)
+    uint32_t deviceCount = 0;
+
+    // Status
     std::atomic<uint32_t> helperStatus{kHelperOffline};
-    std::atomic<uint32_t> pushState{kDeviceDisconnected};
-    std::atomic<uint32_t> flx4State{kDeviceDisconnected};
-    uint32_t _pad0 = 0;
 
-    // Push master clock — plugin reads for GetZeroTimeStamp
-    ClockData pushClock;
+    // Master clock — plugin reads for GetZeroTimeStamp
+    alignas(64) Seqlock<ClockSnapshot> masterClock;
+
+    // Bumped periodically by the helper while it is alive.
+    std::atomic<uint64_t> heartbeat{0};
+
+    // Sample rate (Hz) of every ring and of masterClock, set by the helper.
+    // requestedRate is the plugin's side: the rate a client last set the
+    // virtual device to (0 until one does). The helper switches to it when
+    // it can, stopping IO to rebuild its converters; the plugin serves
+    // silence while the two differ.
+    std::atomic<uint32_t> sessionRate{0};
+    std::atomic<uint32_t> requestedRate{0};
 
-    // Drift ratio (push_rate / flx4_rate) — informational, for monitoring
-    std::atomic<double> driftRatio{1.0};
+    DeviceDescriptor devices[kMaxDevices];
 
-    // Audio ring buffers
-    // Input: helper writes (from hardware) → plugin reads (serves to Ableton)
-    SPSCRingBuffer pushInput;
-    SPSCRingBuffer flx4Input;   // Already resampled to Push clock by helper
+    // Connection state per device (DeviceState), parallel to devices[].
+    std::atomic<uint32_t> deviceState[kMaxDevices] = {};
 
-    // Cue tap: helper taps djay's FLX4 output stream 1 (channels 3-4 = cue)
-    // via AudioHardwareCreateProcessTap. Resampled to Push clock.
-    SPSCRingBuffer flx4CueInput;
+    // Drift ratio and both DLL rates per slave, parallel to devices[] (the
+    // master's stays empty) — resampling paths + monitoring.
+    DriftRecord drift[kMaxDevices];
 
-    // Output: plugin writes (from Ableton) → helper reads (sends to hardware)
-    SPSCRingBuffer pushOutput;
-    SPSCRingBuffer flx4Output;  // Helper resamples to FLX4 clock before sending
+    StreamDescriptor streams[kMaxStreams];
 
-    void init()
+    // Realtime counters, parallel to streams[] (see Metrics.h).
+    StreamMetrics metrics[kMaxStreams];
+
+    // Latency (frames) the plugin reports per stream, parallel to streams[].
+    // The helper updates it when a stream's converter changes.
+    std::atomic<uint32_t> latency[kMaxStreams] = {};
+
+    // Bytes needed for a header plus the table's streams. Rings start on
+    // 64-byte boundaries after the header; a mirrored ring's data starts on
+    // a kMirrorAlignment one and is followed by as many bytes for its
+    // second mapping.
+    static size_t sizeFor(const LayoutTable& table)
     {
+        size_t size = alignUp(sizeof(SharedMemoryLayout));
+        for (const auto& desc : table.streams) {
+            placeRing(desc, mirrors(table, desc), &size);
+        }
+        return size;
+    }
+
+    // Helper side: lay out the streams after the header and initialize
+    // everything. The region must be at least sizeFor(table) bytes.
+    // Returns false if the table is invalid.
+    bool init(const LayoutTable& table, uint64_t session)
+    {
+        if (table.devices.empty() || table.devices.size() > kMaxDevices
+            || table.streams.size() > kMaxStreams)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < table.devices.size(); ++i) {
+            if (!validDevice(table.devices[i], static_cast<uint32_t>(i))) return false;
+            for (size_t j = 0; j < i; ++j) {
+                if (std::strncmp(table.devices[j].name, table.devices[i].name,
+                                 kDeviceNameLength) == 0)
+                {
+                    return false;
+                }
+            }
+        }
+        for (size_t i = 0; i < table.streams.size(); ++i) {
+            const StreamDescriptor& desc = table.streams[i];
+            if (!validStream(desc, static_cast<uint32_t>(table.devices.size()))) return false;
+            for (size_t j = 0; j < i; ++j) {
+                const StreamDescriptor& other = table.streams[j];
+                if (other.device == desc.device && other.role == desc.role) return false;
+            }
+        }
+
         helperStatus.store(kHelperOffline, std::memory_order_relaxed);
-        pushState.store(kDeviceDisconnected, std::memory_order_relaxed);
-        flx4State.store(kDeviceDisconnected, std::memory_order_relaxed);
-        pushClock.sampleTime.store(0.0, std::memory_order_relaxed);
-        pushClock.hostTime.store(0, std::memory_order_relaxed);
-        pushClock.seed.store(0, std::memory_order_relaxed);
-        driftRatio.store(1.0, std::memory_order_relaxed);
-        pushInput.init(kRingBufferCapacity);
-        flx4Input.init(kRingBufferCapacity);
-        flx4CueInput.init(kRingBufferCapacity);
-        pushOutput.init(kRingBufferCapacity);
-        flx4Output.init(kRingBufferCapacity);
+        masterClock.store(ClockSnapshot{});
+        heartbeat.store(0, std::memory_order_relaxed);
+        sessionRate.store(static_cast<uint32_t>(kNominalSampleRate), std::memory_order_relaxed);
+        requestedRate.store(0, std::memory_order_relaxed);
+
+        deviceCount = 0;
+        for (const auto& device : table.devices) {
+            deviceState[deviceCount].store(kDeviceDisconnected, std::memory_order_relaxed);
+            drift[deviceCount].store(DriftSnapshot{});
+            devices[deviceCount++] = device;
+        }
+
+        for (auto& m : metrics) m.reset();
+
+        size_t offset = alignUp(sizeof(SharedMemoryLayout));
+        streamCount = 0;
+        for (const auto& desc : table.streams) {
+            latency[streamCount].store(defaultStreamLatency(desc), std::memory_order_relaxed);
+            StreamDescriptor& slot = streams[streamCount++];
+            slot = desc;
+            slot.mirrored = mirrors(table, desc) ? 1 : 0;
+            slot.offset = placeRing(slot, slot.mirrored != 0, &offset);
+            ringAtOffset(slot.offset)->init(desc.capacityFrames, desc.overflowPolicy,
+                                            desc.channels, slot.mirrored != 0);
+        }
+
+        headerSize = sizeof(SharedMemoryLayout);
+        totalSize = offset;
+        sessionId = session;
+        version = kLayoutVersion;
+
+        // Magic last: a reader that sees it sees a complete layout.
+        std::atomic_thread_fence(std::memory_order_release);
+        magic = kLayoutMagic;
+        return true;
+    }
+
+    // Plugin side: check that a mapped region of mappedSize bytes holds a
+    // layout this build understands, and that every ring lies inside it.
+    bool validate(uint64_t mappedSize) const
+    {
+        if (mappedSize < sizeof(SharedMemoryLayout)) return false;
+        if (magic != kLayoutMagic || version != kLayoutVersion) return false;
+        if (headerSize != sizeof(SharedMemoryLayout)) return false;
+        if (totalSize > mappedSize || streamCount > kMaxStreams) return false;
+        if (deviceCount == 0 || deviceCount > kMaxDevices) return false;
+
+        for (uint32_t i = 0; i < deviceCount; ++i) {
+            if (!validDevice(devices[i], i)) return false;
+        }
+        for (uint32_t i = 0; i < streamCount; ++i) {
+            const StreamDescriptor& desc = streams[i];
+            if (!validStream(desc, deviceCount)
+                || desc.offset < headerSize
+                || desc.offset % 64 != 0
+                || desc.offset + AudioRing::bytesFor(desc.capacityFrames, desc.channels) > totalSize
+                || ringAtOffset(desc.offset)->channels != desc.channels
+                || ringAtOffset(desc.offset)->mirrored != desc.mirrored
+                || (desc.mirrored != 0 && !validMirror(desc)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The second mapping streams[stream] needs if it is mirrored: *size
+    // bytes of the region from *offset (its data), mapped again at
+    // *offset + *size. False if it isn't mirrored.
+    bool mirrorOf(uint32_t stream, uint64_t* offset, uint64_t* size) const
+    {
+        const StreamDescriptor& desc = streams[stream];
+        if (desc.mirrored == 0) return false;
+        *offset = desc.offset + sizeof(AudioRing);
+        *size = dataBytes(desc);
+        return true;
+    }
+
+    // ---- Lookup ----
+    // Linear scans — look streams up once and cache what you need.
+
+    // Index of a device's stream in streams[], -1 if this layout doesn't
+    // have it.
+    int findStream(uint32_t device, StreamRole role) const
+    {
+        for (uint32_t i = 0; i < streamCount; ++i) {
+            if (streams[i].device == device && streams[i].role == role) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    // Index of a device by name, -1 if none.
+    int findDevice(const char* name) const
+    {
+        for (uint32_t i = 0; i < deviceCount; ++i) {
+            if (std::strncmp(devices[i].name, name, kDeviceNameLength) == 0) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    // streams[stream]'s ring. stream < streamCount.
+    AudioRing* streamRing(uint32_t stream) { return ringAtOffset(streams[stream].offset); }
+
+    // A device's stream, its metrics, its reported latency and its
+    // descriptor. nullptr if this layout doesn't have it.
+    AudioRing* ring(uint32_t device, StreamRole role)
+    {
+        int i = findStream(device, role);
+        return i < 0 ? nullptr : streamRing(static_cast<uint32_t>(i));
+    }
+
+    StreamMetrics* streamMetrics(uint32_t device, StreamRole role)
+    {
+        int i = findStream(device, role);
+        return i < 0 ? nullptr : &metrics[i];
+    }
+
+    std::atomic<uint32_t>* streamLatency(uint32_t device, StreamRole role)
+    {
+        int i = findStream(device, role);
+        return i < 0 ? nullptr : &latency[i];
+    }
+
+    const StreamDescriptor* descriptor(uint32_t device, StreamRole role) const
+    {
+        int i = findStream(device, role);
+        return i < 0 ? nullptr : &streams[i];
+    }
+
+private:
+    static constexpr size_t alignUp(size_t n, size_t to = 64) { return (n + to - 1) & ~(to - 1); }
+    static constexpr bool isPowerOfTwo(uint32_t n) { return n != 0 && (n & (n - 1)) == 0; }
+
+    // Device `index` of a table: named, master first and only first.
+    static bool validDevice(const DeviceDescriptor& device, uint32_t index)
+    {
+        uint32_t clock = index == kMasterDevice ? kClockDomainMaster : kClockDomainSlave;
+        return device.clockDomain == clock
+            && device.name[0] != '\0'
+            && std::memchr(device.name, '\0', kDeviceNameLength) != nullptr;
+    }
+
+    // A stream of one of deviceCount devices, its domain the device's.
+    bool validStream(const StreamDescriptor& desc, uint32_t count) const
+    {
+        return desc.device < count
+            && desc.role < kStreamRoleCount
+            && desc.clockDomain == (desc.device == kMasterDevice ? kClockDomainMaster
+                                                                 : kClockDomainSlave)
+            && desc.direction == (desc.role == kStreamPlayback ? kStreamDirOutput
+                                                               : kStreamDirInput)
+            && LayoutTable::validChannels(desc.channels)
+            && isPowerOfTwo(desc.capacityFrames)
+            && desc.overflowPolicy < kOverflowPolicyCount;
+    }
+
+    static size_t dataBytes(const StreamDescriptor& desc)
+    {
+        return static_cast<size_t>(desc.capacityFrames) * desc.channels * sizeof(float);
+    }
+
+    static bool mirrors(const LayoutTable& table, const StreamDescriptor& desc)
+    {
+        return table.mirrored && dataBytes(desc) % kMirrorAlignment == 0;
+    }
+
+    // Place a ring after *end, where the previous one ended, and move *end
+    // past it. Returns the ring's offset.
+    static uint64_t placeRing(const StreamDescriptor& desc, bool mirror, size_t* end)
+    {
+        size_t at = *end;
+        size_t bytes = AudioRing::bytesFor(desc.capacityFrames, desc.channels);
+        if (mirror) {
+            at = alignUp(at + sizeof(AudioRing), kMirrorAlignment) - sizeof(AudioRing);
+            bytes += dataBytes(desc);
+        }
+        *end = alignUp(at + bytes);
+        return at;
+    }
+
+    // A mirrored stream's data on whole blocks, its second mapping inside
+    // the layout.
+    bool validMirror(const StreamDescriptor& desc) const
+    {
+        uint64_t data = desc.offset + sizeof(AudioRing);
+        return desc.mirrored == 1
+            && data % kMirrorAlignment == 0
+            && dataBytes(desc) % kMirrorAlignment == 0
+            && data + 2 * dataBytes(desc) <= totalSize;
+    }
+
+    AudioRing* ringAtOffset(uint64_t offset)
+    {
+        return reinterpret_cast<AudioRing*>(
+            reinterpret_cast<uint8_t*>(this) + offset);
+    }
+
+    const AudioRing* ringAtOffset(uint64_t offset) const
+    {
+        return reinterpret_cast<const AudioRing*>(
+            reinterpret_cast<const uint8_t*>(this) + offset);
     }
 };
 
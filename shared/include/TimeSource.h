@@ -0,0 +1,86 @@
+#pragma once
+
+// Host clock abstraction for the clock estimators.
+//
+// CoreAudio timestamps are mach_absolute_time ticks, whose length depends on
+// the machine (1 ns on Intel, 125/3 ns on Apple Silicon). The estimators
+// only ever need tick differences in seconds, so they take a TimeSource
+// instead of calling mach_timebase_info themselves — which lets the same
+// code run off macOS (benchmarks, simulations) on nanosecond ticks.
+//
+// hostTimeSource() is the process's real host clock: Mach ticks on macOS,
+// steady_clock nanoseconds elsewhere. Both are safe to call from realtime
+// threads once the first call has returned.
+
+#include <chrono>
+#include <cstdint>
+
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
+
+namespace flux {
+
+class TimeSource {
+public:
+    virtual ~TimeSource() = default;
+
+    // Current host time, in ticks.
+    virtual uint64_t now() const = 0;
+
+    // Length of a tick count in seconds.
+    virtual double toSeconds(double ticks) const = 0;
+
+    // Signed difference a - b, in seconds.
+    double deltaSeconds(uint64_t a, uint64_t b) const
+    {
+        double ticks = (a >= b) ? static_cast<double>(a - b)
+                                : -static_cast<double>(b - a);
+        return toSeconds(ticks);
+    }
+};
+
+// Ticks are nanoseconds: std::chrono::steady_clock, or synthetic clocks.
+class NanosecondTimeSource : public TimeSource {
+public:
+    uint64_t now() const override
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    double toSeconds(double ticks) const override { return ticks * 1e-9; }
+};
+
+#ifdef __APPLE__
+// mach_absolute_time ticks, as in AudioTimeStamp::mHostTime.
+class MachTimeSource : public TimeSource {
+public:
+    MachTimeSource()
+    {
+        mach_timebase_info_data_t info = {};
+        mach_timebase_info(&info);
+        secondsPerTick_ = static_cast<double>(info.numer)
+                        / static_cast<double>(info.denom) / 1e9;
+    }
+
+    uint64_t now() const override { return mach_absolute_time(); }
+
+    double toSeconds(double ticks) const override { return ticks * secondsPerTick_; }
+
+private:
+    double secondsPerTick_ = 0.0;
+};
+#endif
+
+inline const TimeSource& hostTimeSource()
+{
+#ifdef __APPLE__
+    static const MachTimeSource source;
+#else
+    static const NanosecondTimeSource source;
+#endif
+    return source;
+}
+
+} // namespace flux
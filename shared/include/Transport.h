@@ -0,0 +1,241 @@
+#pragma once
+
+// Transport: how the helper's shared memory region gets to the plugin.
+//
+// The data plane (SharedMemoryLayout, rings, clock) only needs one region
+// mapped into both processes. Everything OS-specific — allocating the
+// region, publishing a service, passing the memory handle, mapping it on the
+// other side — sits behind these two interfaces:
+//
+//   - MachServer / MachClient (helper/src, plugin/src): mach_vm_allocate +
+//     memory entry port over a bootstrap service. What coreaudiod needs.
+//   - UnixSocketServer / UnixSocketClient (UnixTransport.h): memfd passed
+//     with SCM_RIGHTS over an AF_UNIX socket. Lets the producer and consumer
+//     sides run as two real processes off macOS (see bench/IpcBench.cpp).
+//
+// The base classes own the layout handling so every backend builds and
+// validates the region the same way: the server lays out the device and
+// stream tables in the region it allocated, the client validates what it
+// mapped and resolves its rings once. Both then give every mirrored ring
+// (SharedMemory.h) its second mapping, through the backend's mapMirror(), so
+// a layout that opts in gets contiguous rings on both sides or not at all.
+
+#include "SharedMemory.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace flux {
+
+// ---- Helper side ----
+
+class TransportServer {
+public:
+    virtual ~TransportServer() = default;
+
+    TransportServer(const TransportServer&) = delete;
+    TransportServer& operator=(const TransportServer&) = delete;
+
+    // Allocate a region laid out for the given devices and streams and
+    // start accepting clients. Call runMessageLoop() afterwards to serve
+    // them.
+    bool start(const LayoutTable& table = defaultLayoutTable())
+    {
+        if (layout_) return true;
+        stopRequested_.store(false, std::memory_order_relaxed);
+
+        void* region = allocateRegion(SharedMemoryLayout::sizeFor(table));
+        if (!region) return false;
+
+        // Regions come back zero-filled, so placement-new only has to set
+        // up the header's atomics before init() lays out the streams.
+        // The session id only has to differ between helper runs; a
+        // monotonic timestamp does that without any OS-specific calls.
+        auto session = static_cast<uint64_t>(
+            std::chrono::steady_clock::now().time_since_epoch().count());
+
+        layout_ = new (region) SharedMemoryLayout;
+        if (!layout_->init(table, session)) {
+            onError("invalid device or stream table");
+            layout_ = nullptr;
+            releaseRegion();
+            return false;
+        }
+        for (uint32_t i = 0; i < layout_->streamCount; ++i) {
+            uint64_t offset = 0, bytes = 0;
+            if (layout_->mirrorOf(i, &offset, &bytes)
+                && !mapMirror(static_cast<uint8_t*>(region) + offset + bytes, bytes, offset))
+            {
+                onError("can't map a mirrored ring");
+                layout_ = nullptr;
+                releaseRegion();
+                return false;
+            }
+        }
+
+        if (!publish()) {
+            layout_ = nullptr;
+            releaseRegion();
+            return false;
+        }
+        return true;
+    }
+
+    // Stop serving and free the region.
+    void stop()
+    {
+        stopRequested_.store(true, std::memory_order_relaxed);
+        unpublish();
+        if (layout_) {
+            // Clients may keep their mapping alive after we free ours; tell
+            // them the helper is gone rather than leaving them to time out.
+            layout_->helperStatus.store(kHelperOffline, std::memory_order_release);
+            layout_ = nullptr;
+            releaseRegion();
+        }
+    }
+
+    // Serve client requests until requestStop(). Blocking — run it on a
+    // dedicated thread. Backends poll with a timeout so stop requests are
+    // noticed within a fraction of a second, and call beat() on every pass.
+    virtual void runMessageLoop() = 0;
+
+    void requestStop() { stopRequested_.store(true, std::memory_order_relaxed); }
+
+    // The layout (valid between start() and stop()).
+    SharedMemoryLayout* sharedMemory() { return layout_; }
+
+protected:
+    TransportServer() = default;
+
+    // Allocate and map a zero-filled region of at least size bytes (rounded
+    // up to whole pages as the backend needs). nullptr on failure.
+    virtual void* allocateRegion(size_t size) = 0;
+    virtual void  releaseRegion() = 0;
+
+    // Make the region reachable by clients (register the service, bind the
+    // socket, ...). unpublish() must be safe to call when not published.
+    virtual bool publish() = 0;
+    virtual void unpublish() = 0;
+
+    // Map size bytes of the region, from offset, a second time at at —
+    // inside the region's own mapping, replacing what is there. Builds a
+    // mirrored ring; page-aligned throughout. releaseRegion() unmaps it
+    // with the rest.
+    virtual bool mapMirror(void* at, size_t size, uint64_t offset) = 0;
+
+    // Report a failure detected by the base class. Backends log it.
+    virtual void onError(const char* what) { (void)what; }
+
+    bool stopRequested() const { return stopRequested_.load(std::memory_order_relaxed); }
+
+    // Liveness signal for clients (see kHelperHeartbeatTimeoutMs).
+    void beat()
+    {
+        if (layout_) layout_->heartbeat.fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    SharedMemoryLayout* layout_ = nullptr;
+    std::atomic<bool>   stopRequested_{false};
+};
+
+// ---- Plugin side ----
+
+class TransportClient {
+public:
+    virtual ~TransportClient() = default;
+
+    TransportClient(const TransportClient&) = delete;
+    TransportClient& operator=(const TransportClient&) = delete;
+
+    // Find the helper, map its region and validate the layout. Returns false
+    // if the helper isn't reachable or its layout doesn't match this build.
+    bool connect()
+    {
+        if (layout_) return true;
+
+        void*  addr = nullptr;
+        size_t size = 0;
+        if (!mapRegion(&addr, &size)) return false;
+
+        // Refuse a layout from a helper built against a different header, or
+        // one whose stream table points outside the mapping.
+        auto* layout = static_cast<SharedMemoryLayout*>(addr);
+        if (!layout->validate(size)) {
+            onLayoutRejected(*layout, size);
+            unmapRegion();
+            return false;
+        }
+        for (uint32_t i = 0; i < layout->streamCount; ++i) {
+            uint64_t offset = 0, bytes = 0;
+            if (layout->mirrorOf(i, &offset, &bytes)
+                && !mapMirror(static_cast<uint8_t*>(addr) + offset + bytes, bytes, offset))
+            {
+                unmapRegion();
+                return false;
+            }
+        }
+
+        layout_ = layout;
+        for (uint32_t i = 0; i < layout_->streamCount; ++i) {
+            rings_[i] = layout_->streamRing(i);
+            metrics_[i] = &layout_->metrics[i];
+        }
+        return true;
+    }
+
+    void disconnect()
+    {
+        if (!layout_) return;
+        layout_ = nullptr;
+        for (auto& ring : rings_) ring = nullptr;
+        for (auto& m : metrics_) m = nullptr;
+        unmapRegion();
+    }
+
+    bool isConnected() const { return layout_ != nullptr; }
+    SharedMemoryLayout* sharedMemory() { return layout_; }
+
+    // Ring for an entry of the layout's stream table, resolved at
+    // connect(). nullptr past the table's end. Look a device's streams up
+    // with SharedMemoryLayout::findStream().
+    AudioRing* ring(uint32_t stream) { return stream < kMaxStreams ? rings_[stream] : nullptr; }
+    StreamMetrics* metrics(uint32_t stream) { return stream < kMaxStreams ? metrics_[stream] : nullptr; }
+
+    // Map the region read-only (monitoring tools). Set before connect().
+    // Rings must not be read or written through a read-only client — only
+    // the header, clock and metrics are meant to be sampled.
+    void setReadOnly(bool readOnly) { readOnly_ = readOnly; }
+    bool readOnly() const { return readOnly_; }
+
+protected:
+    TransportClient() = default;
+
+    // Obtain the helper's region and map it. Reports the mapping's address
+    // and size; the backend keeps whatever it needs for unmapRegion().
+    virtual bool mapRegion(void** outAddr, size_t* outSize) = 0;
+    virtual void unmapRegion() = 0;
+
+    // TransportServer::mapMirror(), on the client's mapping (read-only for
+    // a read-only client). Backends log a failure; connect() then fails.
+    virtual bool mapMirror(void* at, size_t size, uint64_t offset) = 0;
+
+    // The mapped layout failed validation. Backends log it.
+    virtual void onLayoutRejected(const SharedMemoryLayout& layout, size_t mappedSize)
+    {
+        (void)layout;
+        (void)mappedSize;
+    }
+
+private:
+    SharedMemoryLayout* layout_ = nullptr;
+    AudioRing*          rings_[kMaxStreams] = {};
+    StreamMetrics*      metrics_[kMaxStreams] = {};
+    bool                readOnly_ = false;
+};
+
+} // namespace flux
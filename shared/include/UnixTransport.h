@@ -0,0 +1,368 @@
+#pragma once
+
+// UnixTransport: POSIX transport backend. The helper side backs the region
+// with an anonymous shared memory file and listens on an AF_UNIX stream
+// socket; the plugin side connects, receives the file descriptor with
+// SCM_RIGHTS and maps it.
+//
+// Same handshake as the Mach backend, with the same message IDs:
+// 1. Client connects to the socket path, sends kMsgRequestMemory
+// 2. Server replies kMsgMemoryReply + region size, with the fd attached
+// 3. Client mmaps the fd MAP_SHARED, keeping it while connected
+//
+// Both sides map a mirrored ring's second copy from the same fd, MAP_FIXED
+// over the region's own mapping.
+//
+// The region is a memfd on Linux, and an immediately unlinked shm_open
+// object elsewhere. Not used inside coreaudiod (the plugin sandbox only
+// allows Mach lookups); it exists so the producer and consumer sides of the
+// data plane can run as two real processes on any POSIX system.
+
+#include "Transport.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace flux {
+
+// Wire format for both directions. The fd rides along as ancillary data.
+struct UnixTransportMsg {
+    uint32_t id = 0;            // MachMsgID
+    uint32_t _pad = 0;
+    uint64_t size = 0;          // Region size (reply only)
+};
+
+namespace unix_transport {
+
+inline bool fillAddress(const std::string& path, sockaddr_un* addr)
+{
+    std::memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr->sun_path)) return false;
+    std::memcpy(addr->sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// Anonymous shared memory file of the given size. -1 on failure.
+inline int createRegionFd(size_t size)
+{
+#if defined(__linux__)
+    int fd = memfd_create("flux-shared-memory", MFD_CLOEXEC);
+#else
+    char name[64];
+    std::snprintf(name, sizeof(name), "/flux-shm-%d", static_cast<int>(getpid()));
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0) shm_unlink(name);
+#endif
+    if (fd < 0) return -1;
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Map size bytes of the region file from offset at at, over the region's
+// own mapping.
+inline bool mapMirror(int fd, void* at, size_t size, uint64_t offset, int prot)
+{
+    void* mapped = mmap(at, size, prot, MAP_SHARED | MAP_FIXED, fd, static_cast<off_t>(offset));
+    if (mapped == MAP_FAILED) {
+        std::perror("UnixTransport: mirror mmap");
+        return false;
+    }
+    return true;
+}
+
+} // namespace unix_transport
+
+// ---- Helper side ----
+
+class UnixSocketServer : public TransportServer {
+public:
+    explicit UnixSocketServer(std::string socketPath = kUnixSocketPath)
+        : socketPath_(std::move(socketPath))
+    {
+    }
+
+    ~UnixSocketServer() override { stop(); }
+
+    void runMessageLoop() override
+    {
+        while (!stopRequested()) {
+            beat();
+            pollfd pfd{listenFd_, POLLIN, 0};
+            int ready = poll(&pfd, 1, 500);     // 500ms, to notice stop requests
+            if (ready < 0 && errno != EINTR) {
+                std::perror("UnixSocketServer: poll");
+                return;
+            }
+            if (ready <= 0) continue;
+
+            int conn = accept(listenFd_, nullptr, nullptr);
+            if (conn < 0) continue;
+            handleConnection(conn);
+            close(conn);
+        }
+    }
+
+    const std::string& socketPath() const { return socketPath_; }
+
+private:
+    void* allocateRegion(size_t size) override
+    {
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        regionSize_ = ((size + page - 1) / page) * page;
+
+        regionFd_ = unix_transport::createRegionFd(regionSize_);
+        if (regionFd_ < 0) {
+            std::perror("UnixSocketServer: shared memory file");
+            return nullptr;
+        }
+
+        // Fresh file pages read as zero, as start() expects.
+        void* addr = mmap(nullptr, regionSize_, PROT_READ | PROT_WRITE,
+                          MAP_SHARED, regionFd_, 0);
+        if (addr == MAP_FAILED) {
+            std::perror("UnixSocketServer: mmap");
+            close(regionFd_);
+            regionFd_ = -1;
+            return nullptr;
+        }
+        region_ = addr;
+        return region_;
+    }
+
+    void releaseRegion() override
+    {
+        if (region_) {
+            munmap(region_, regionSize_);
+            region_ = nullptr;
+        }
+        if (regionFd_ >= 0) {
+            close(regionFd_);
+            regionFd_ = -1;
+        }
+    }
+
+    bool mapMirror(void* at, size_t size, uint64_t offset) override
+    {
+        return unix_transport::mapMirror(regionFd_, at, size, offset, PROT_READ | PROT_WRITE);
+    }
+
+    bool publish() override
+    {
+        sockaddr_un addr;
+        if (!unix_transport::fillAddress(socketPath_, &addr)) {
+            std::fprintf(stderr, "UnixSocketServer: socket path too long: %s\n",
+                         socketPath_.c_str());
+            return false;
+        }
+
+        listenFd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFd_ < 0) {
+            std::perror("UnixSocketServer: socket");
+            return false;
+        }
+        fcntl(listenFd_, F_SETFD, FD_CLOEXEC);
+
+        // A stale socket file from a crashed helper would make bind() fail.
+        unlink(socketPath_.c_str());
+        if (bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+            || listen(listenFd_, 4) != 0)
+        {
+            std::perror("UnixSocketServer: bind/listen");
+            close(listenFd_);
+            listenFd_ = -1;
+            return false;
+        }
+        return true;
+    }
+
+    void unpublish() override
+    {
+        if (listenFd_ >= 0) {
+            close(listenFd_);
+            listenFd_ = -1;
+            unlink(socketPath_.c_str());
+        }
+    }
+
+    void onError(const char* what) override
+    {
+        std::fprintf(stderr, "UnixSocketServer: %s\n", what);
+    }
+
+    void handleConnection(int conn)
+    {
+        UnixTransportMsg request;
+        if (recv(conn, &request, sizeof(request), MSG_WAITALL)
+                != static_cast<ssize_t>(sizeof(request))
+            || request.id != kMsgRequestMemory)
+        {
+            return;
+        }
+
+        UnixTransportMsg reply;
+        reply.id = kMsgMemoryReply;
+        reply.size = regionSize_;
+
+        iovec iov{&reply, sizeof(reply)};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &regionFd_, sizeof(int));
+
+        if (sendmsg(conn, &msg, 0) < 0) {
+            std::perror("UnixSocketServer: sendmsg");
+        }
+    }
+
+    std::string socketPath_;
+    int         listenFd_ = -1;
+    int         regionFd_ = -1;
+    void*       region_ = nullptr;
+    size_t      regionSize_ = 0;
+};
+
+// ---- Plugin side ----
+
+class UnixSocketClient : public TransportClient {
+public:
+    explicit UnixSocketClient(std::string socketPath = kUnixSocketPath)
+        : socketPath_(std::move(socketPath))
+    {
+    }
+
+    ~UnixSocketClient() override { disconnect(); }
+
+private:
+    bool mapRegion(void** outAddr, size_t* outSize) override
+    {
+        sockaddr_un addr;
+        if (!unix_transport::fillAddress(socketPath_, &addr)) return false;
+
+        int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (sock < 0) return false;
+
+        int fd = -1;
+        UnixTransportMsg reply;
+        if (connectTo(sock, addr) && requestRegion(sock, &reply, &fd)) {
+            int prot = readOnly() ? PROT_READ : PROT_READ | PROT_WRITE;
+            void* mapped = mmap(nullptr, reply.size, prot, MAP_SHARED, fd, 0);
+            if (mapped != MAP_FAILED) {
+                mapped_ = mapped;
+                mappedSize_ = reply.size;
+            } else {
+                std::perror("UnixSocketClient: mmap");
+            }
+        }
+
+        // Kept for the mirrored rings' mappings until unmapRegion().
+        if (mapped_) {
+            regionFd_ = fd;
+        } else if (fd >= 0) {
+            close(fd);
+        }
+        close(sock);
+
+        if (!mapped_) return false;
+        *outAddr = mapped_;
+        *outSize = mappedSize_;
+        return true;
+    }
+
+    void unmapRegion() override
+    {
+        if (mapped_) {
+            munmap(mapped_, mappedSize_);
+            mapped_ = nullptr;
+            mappedSize_ = 0;
+        }
+        if (regionFd_ >= 0) {
+            close(regionFd_);
+            regionFd_ = -1;
+        }
+    }
+
+    bool mapMirror(void* at, size_t size, uint64_t offset) override
+    {
+        int prot = readOnly() ? PROT_READ : PROT_READ | PROT_WRITE;
+        return unix_transport::mapMirror(regionFd_, at, size, offset, prot);
+    }
+
+    void onLayoutRejected(const SharedMemoryLayout& layout, size_t mappedSize) override
+    {
+        std::fprintf(stderr,
+                     "UnixSocketClient: layout mismatch: magic 0x%08x version %u "
+                     "(expected 0x%08x v%u), %zu bytes mapped\n",
+                     layout.magic, layout.version, kLayoutMagic, kLayoutVersion,
+                     mappedSize);
+    }
+
+    static bool connectTo(int sock, const sockaddr_un& addr)
+    {
+        return ::connect(sock, reinterpret_cast<const sockaddr*>(&addr),
+                         sizeof(addr)) == 0;
+    }
+
+    static bool requestRegion(int sock, UnixTransportMsg* reply, int* outFd)
+    {
+        UnixTransportMsg request;
+        request.id = kMsgRequestMemory;
+        if (send(sock, &request, sizeof(request), 0)
+                != static_cast<ssize_t>(sizeof(request)))
+        {
+            return false;
+        }
+
+        iovec iov{reply, sizeof(*reply)};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(sock, &msg, MSG_WAITALL) != static_cast<ssize_t>(sizeof(*reply))
+            || reply->id != kMsgMemoryReply)
+        {
+            return false;
+        }
+
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+            return false;
+        }
+        std::memcpy(outFd, CMSG_DATA(cmsg), sizeof(int));
+        return true;
+    }
+
+    std::string socketPath_;
+    int         regionFd_ = -1;
+    void*       mapped_ = nullptr;
+    size_t      mappedSize_ = 0;
+};
+
+} // namespace flux
@@ -0,0 +1,251 @@
+// flux_inspect: live view of the helper's shared memory region.
+//
+// Maps the region read-only through the same transport the plugin uses
+// (Mach on macOS, the POSIX socket elsewhere) and samples it at a high rate:
+// each stream's realtime counters (Metrics.h), its current fill, and the
+// fill levels recorded by the consumer since the last report. Also prints
+// the master clock, each slave's drift record, the session's sample rate and
+// the helper's heartbeat.
+//
+// Nothing here writes to the region, so it can run next to a live session
+// without touching the audio threads. Use it to size ring capacities (ring=
+// in the helper's device config): a stream whose window minimum keeps
+// touching zero, or that reports underruns, needs more headroom; one whose
+// fill sits near capacity is adding latency for nothing.
+//
+// Usage: flux_inspect [report-interval-ms] [reports] [sample-interval-us]
+//        (reports = 0 runs until interrupted)
+
+#ifdef __APPLE__
+#include "MachClient.h"
+#else
+#include "UnixTransport.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+using namespace flux;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// "<device>-in", "<device>-cue", "<device>-out", as the helper's
+// --resampler takes them.
+std::string streamName(const SharedMemoryLayout& shm, const StreamDescriptor& desc)
+{
+    static const char* const kRoleNames[] = {"in", "cue", "out"};
+    std::string name = desc.device < shm.deviceCount ? shm.devices[desc.device].name : "?";
+    return name + "-" + (desc.role < kStreamRoleCount ? kRoleNames[desc.role] : "?");
+}
+
+const char* statusName(uint32_t status)
+{
+    switch (status) {
+        case kHelperOffline: return "offline";
+        case kHelperRunning: return "running";
+        case kHelperError:   return "error";
+        default:             return "?";
+    }
+}
+
+// Counter values at the previous report, to print deltas.
+struct Counters {
+    uint64_t writes = 0;
+    uint64_t overruns = 0;
+    uint64_t dropped = 0;
+    uint64_t reads = 0;
+    uint64_t underruns = 0;
+    uint64_t partials = 0;
+
+    static Counters of(const StreamMetrics& m)
+    {
+        Counters c;
+        c.writes = m.writes.load(std::memory_order_relaxed);
+        c.overruns = m.overruns.load(std::memory_order_relaxed);
+        c.dropped = m.droppedFrames.load(std::memory_order_relaxed);
+        c.reads = m.reads.load(std::memory_order_relaxed);
+        c.underruns = m.underruns.load(std::memory_order_relaxed);
+        c.partials = m.partials.load(std::memory_order_relaxed);
+        return c;
+    }
+};
+
+// Fill levels seen by the consumer during one report window, collected from
+// the metrics history between samples.
+struct Window {
+    uint64_t head = 0;       // History entries consumed so far
+    uint64_t missed = 0;     // Entries overwritten before we sampled them
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint32_t min = UINT32_MAX;
+    uint32_t max = 0;
+
+    void sample(const StreamMetrics& m)
+    {
+        uint64_t newHead = m.historyHead.load(std::memory_order_acquire);
+        if (newHead - head > kFillHistoryLength) {
+            missed += newHead - head - kFillHistoryLength;
+            head = newHead - kFillHistoryLength;
+        }
+        for (; head < newHead; ++head) {
+            uint32_t fill = m.fillHistory[head & (kFillHistoryLength - 1)]
+                                .load(std::memory_order_relaxed);
+            min = std::min(min, fill);
+            max = std::max(max, fill);
+            sum += fill;
+            ++count;
+        }
+    }
+
+    void clear()
+    {
+        missed = count = sum = 0;
+        min = UINT32_MAX;
+        max = 0;
+    }
+};
+
+struct StreamView {
+    Counters last;
+    Window   window;
+};
+
+void printReport(SharedMemoryLayout* shm, StreamView* views, double elapsed,
+                 uint64_t heartbeatDelta)
+{
+    ClockSnapshot clock = shm->masterClock.load();
+
+    std::printf("\n[%8.2f s] session %llu  helper %s  heartbeat +%llu  rate %u Hz",
+                elapsed, static_cast<unsigned long long>(shm->sessionId),
+                statusName(shm->helperStatus.load(std::memory_order_relaxed)),
+                static_cast<unsigned long long>(heartbeatDelta),
+                shm->sessionRate.load(std::memory_order_relaxed));
+    uint32_t requested = shm->requestedRate.load(std::memory_order_relaxed);
+    if (requested != 0 && requested != shm->sessionRate.load(std::memory_order_relaxed)) {
+        std::printf(" (%u requested)", requested);
+    }
+    std::printf("\n");
+    std::printf("  clock       %s  sample %.0f  seed %llu  rate %.3f Hz%s\n",
+                shm->devices[kMasterDevice].name,
+                clock.sampleTime, static_cast<unsigned long long>(clock.seed),
+                clock.rate, clock.rateStable ? "" : " (settling)");
+    for (uint32_t device = 1; device < shm->deviceCount; ++device) {
+        DriftSnapshot drift = shm->drift[device].load();
+        std::printf("  drift       %s %.3f  ratio %.8f  servo in %+.1f out %+.1f ppm%s\n",
+                    shm->devices[device].name, drift.slaveRate, drift.ratio,
+                    drift.inputCorrection * 1e6, drift.outputCorrection * 1e6,
+                    drift.ready ? "" : " (not ready)");
+    }
+
+    std::printf("  %-12s %2s %6s %6s %8s %8s %8s %8s %8s %8s %6s %19s %13s\n",
+                "stream", "ch", "cap", "fill", "writes", "overrun", "dropped", "reads",
+                "underrun", "partial", "miss", "window min/avg/max", "all min/max");
+
+    for (uint32_t i = 0; i < shm->streamCount; ++i) {
+        const auto& desc = shm->streams[i];
+        const auto& m = shm->metrics[i];
+        auto& view = views[i];
+
+        view.window.sample(m);
+        Counters now = Counters::of(m);
+        uint32_t fill = shm->streamRing(i)->availableRead();
+
+        char window[32] = "-";
+        if (view.window.count > 0) {
+            std::snprintf(window, sizeof(window), "%u/%llu/%u", view.window.min,
+                          static_cast<unsigned long long>(view.window.sum / view.window.count),
+                          view.window.max);
+        }
+        char lifetime[32] = "-";
+        uint32_t fillMin = m.fillMin.load(std::memory_order_relaxed);
+        if (fillMin != UINT32_MAX) {
+            std::snprintf(lifetime, sizeof(lifetime), "%u/%u", fillMin,
+                          m.fillMax.load(std::memory_order_relaxed));
+        }
+
+        std::printf("  %-12s %2u %6u %6u %8llu %8llu %8llu %8llu %8llu %8llu %6llu %19s %13s\n",
+                    streamName(*shm, desc).c_str(), desc.channels, desc.capacityFrames, fill,
+                    static_cast<unsigned long long>(now.writes - view.last.writes),
+                    static_cast<unsigned long long>(now.overruns - view.last.overruns),
+                    static_cast<unsigned long long>(now.dropped - view.last.dropped),
+                    static_cast<unsigned long long>(now.reads - view.last.reads),
+                    static_cast<unsigned long long>(now.underruns - view.last.underruns),
+                    static_cast<unsigned long long>(now.partials - view.last.partials),
+                    static_cast<unsigned long long>(view.window.missed),
+                    window, lifetime);
+
+        view.last = now;
+        view.window.clear();
+    }
+    std::fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    long reportMs = argc > 1 ? std::atol(argv[1]) : 1000;
+    long reports = argc > 2 ? std::atol(argv[2]) : 0;
+    long sampleUs = argc > 3 ? std::atol(argv[3]) : 1000;
+    if (reportMs <= 0 || reports < 0 || sampleUs <= 0) {
+        std::fprintf(stderr,
+                     "usage: %s [report-interval-ms] [reports] [sample-interval-us]\n",
+                     argv[0]);
+        return 1;
+    }
+
+#ifdef __APPLE__
+    MachClient client;
+#else
+    UnixSocketClient client;
+#endif
+    client.setReadOnly(true);
+    if (!client.connect()) {
+        std::fprintf(stderr, "flux_inspect: helper not reachable\n");
+        return 1;
+    }
+
+    auto* shm = client.sharedMemory();
+    std::printf("Attached to session %llu: layout v%u, %u devices, %u streams, %llu bytes\n",
+                static_cast<unsigned long long>(shm->sessionId), shm->version,
+                shm->deviceCount, shm->streamCount,
+                static_cast<unsigned long long>(shm->totalSize));
+
+    // Start every window at the current history head and every delta at the
+    // current counters, so the first report covers only its own interval.
+    StreamView views[kMaxStreams];
+    for (uint32_t i = 0; i < shm->streamCount; ++i) {
+        views[i].last = Counters::of(shm->metrics[i]);
+        views[i].window.head = shm->metrics[i].historyHead.load(std::memory_order_acquire);
+    }
+
+    auto start = Clock::now();
+    auto nextReport = start + std::chrono::milliseconds(reportMs);
+    uint64_t lastHeartbeat = shm->heartbeat.load(std::memory_order_relaxed);
+
+    for (long n = 0; reports == 0 || n < reports;) {
+        // Between reports, drain the fill histories often enough that the
+        // consumer can't lap them.
+        std::this_thread::sleep_for(std::chrono::microseconds(sampleUs));
+        for (uint32_t i = 0; i < shm->streamCount; ++i) {
+            views[i].window.sample(shm->metrics[i]);
+        }
+
+        auto now = Clock::now();
+        if (now < nextReport) continue;
+
+        uint64_t heartbeat = shm->heartbeat.load(std::memory_order_relaxed);
+        printReport(shm, views, std::chrono::duration<double>(now - start).count(),
+                    heartbeat - lastHeartbeat);
+        lastHeartbeat = heartbeat;
+        nextReport += std::chrono::milliseconds(reportMs);
+        ++n;
+    }
+    return 0;
+}